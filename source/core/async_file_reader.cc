@@ -0,0 +1,165 @@
+#include "async_file_reader.h"
+
+#include <algorithm>
+
+#include "file.h"
+#include "platform.h"
+#include "worker_pool.h"
+
+#if P_OS_LINUX
+#include "async_file_reader_linux.h"
+#endif  // P_OS_LINUX
+
+namespace pixel {
+
+//------------------------------------------------------------------------------
+/// @brief      Blocking reads on a few dedicated threads so that slow storage
+///             does not hold up the process-wide worker pool.
+///
+class AsyncFileReaderThreadPool final : public AsyncFileReader {
+ public:
+  static constexpr size_t kMaxWorkerCount = 4u;
+
+  AsyncFileReaderThreadPool(size_t queue_depth)
+      : pool_(std::clamp<size_t>(queue_depth, 1u, kMaxWorkerCount),
+              ThreadOptions{.name = "File Reader"}) {}
+
+  // |AsyncFileReader|
+  ~AsyncFileReaderThreadPool() override = default;
+
+  // |AsyncFileReader|
+  AsyncFileReaderType GetType() const override {
+    return AsyncFileReaderType::kAsyncFileReaderTypeThreadPool;
+  }
+
+  // |AsyncFileReader|
+  bool ReadFiles(std::vector<std::filesystem::path> paths,
+                 BatchReadCallback callback) override {
+    if (!callback) {
+      return false;
+    }
+    auto batch = std::make_shared<Batch>(paths.size(), std::move(callback));
+    for (size_t i = 0; i < paths.size(); i++) {
+      pool_.PostTask([batch, i, path = std::move(paths[i])]() {
+        // Empty files cannot be mapped.
+        std::error_code error;
+        if (std::filesystem::file_size(path, error) == 0 && !error) {
+          batch->Complete(i, UnownedMapping(nullptr, 0u));
+          return;
+        }
+        // Populating the mapping does the reads here instead of faulting them
+        // in on the thread that uses the mapping.
+        FileMappingOptions options;
+        options.access_pattern =
+            FileAccessPattern::kFileAccessPatternSequential;
+        options.populate = true;
+        batch->Complete(i, OpenFile(path, options));
+      });
+    }
+    return true;
+  }
+
+ private:
+  WorkerPool pool_;
+
+  P_DISALLOW_COPY_AND_ASSIGN(AsyncFileReaderThreadPool);
+};
+
+AsyncFileReader& AsyncFileReader::ForProcess() {
+  static auto reader = Create();
+  return *reader;
+}
+
+std::unique_ptr<AsyncFileReader> AsyncFileReader::Create(size_t queue_depth,
+                                                         bool allow_io_uring) {
+#if P_OS_LINUX
+  if (allow_io_uring) {
+    auto reader = std::make_unique<AsyncFileReaderLinux>(queue_depth);
+    if (reader->IsValid()) {
+      return reader;
+    }
+  }
+#endif  // P_OS_LINUX
+  return std::make_unique<AsyncFileReaderThreadPool>(queue_depth);
+}
+
+AsyncFileReader::AsyncFileReader() = default;
+
+AsyncFileReader::~AsyncFileReader() = default;
+
+bool AsyncFileReader::ReadFiles(
+    std::vector<std::filesystem::path> paths,
+    std::shared_ptr<EventLoop::Dispatcher> dispatcher,
+    BatchReadCallback callback) {
+  if (!dispatcher || !callback) {
+    return false;
+  }
+  return ReadFiles(
+      std::move(paths),
+      [dispatcher = std::move(dispatcher), callback = std::move(callback)](
+          std::vector<std::unique_ptr<Mapping>> mappings) mutable {
+        dispatcher->PostTask(
+            [callback = std::move(callback),
+             mappings = std::move(mappings)]() mutable {
+              callback(std::move(mappings));
+            },
+            TaskPriority::kTaskPriorityNormal, "File Read");
+      });
+}
+
+bool AsyncFileReader::ReadFile(std::filesystem::path path,
+                               ReadCallback callback) {
+  if (!callback) {
+    return false;
+  }
+  std::vector<std::filesystem::path> paths;
+  paths.emplace_back(std::move(path));
+  return ReadFiles(
+      std::move(paths),
+      [callback = std::move(callback)](
+          std::vector<std::unique_ptr<Mapping>> mappings) mutable {
+        callback(std::move(mappings.front()));
+      });
+}
+
+bool AsyncFileReader::ReadFile(
+    std::filesystem::path path,
+    std::shared_ptr<EventLoop::Dispatcher> dispatcher,
+    ReadCallback callback) {
+  if (!callback) {
+    return false;
+  }
+  std::vector<std::filesystem::path> paths;
+  paths.emplace_back(std::move(path));
+  return ReadFiles(
+      std::move(paths), std::move(dispatcher),
+      [callback = std::move(callback)](
+          std::vector<std::unique_ptr<Mapping>> mappings) mutable {
+        callback(std::move(mappings.front()));
+      });
+}
+
+AsyncFileReader::Batch::Batch(size_t count, BatchReadCallback callback)
+    : results_(count), remaining_(count), callback_(std::move(callback)) {
+  if (remaining_ == 0) {
+    callback_({});
+  }
+}
+
+AsyncFileReader::Batch::~Batch() = default;
+
+void AsyncFileReader::Batch::Complete(size_t index,
+                                      std::unique_ptr<Mapping> mapping) {
+  {
+    std::scoped_lock lock(mutex_);
+    P_ASSERT(index < results_.size() && remaining_ > 0);
+    results_[index] = std::move(mapping);
+    if (--remaining_ != 0) {
+      return;
+    }
+  }
+  // The results are no longer touched by other reads.
+  callback_(std::move(results_));
+}
+
+}  // namespace pixel
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "closure.h"
+#include "event_loop.h"
+#include "macros.h"
+#include "mapping.h"
+
+namespace pixel {
+
+enum class AsyncFileReaderType {
+  kAsyncFileReaderTypeIOURing,
+  kAsyncFileReaderTypeThreadPool,
+};
+
+//------------------------------------------------------------------------------
+/// @brief      Reads whole files into memory off the calling thread. Many files
+///             may be read in one batch. On Linux, the reads of a batch are all
+///             in flight at once using io_uring. Elsewhere, or if io_uring is
+///             not available, a small pool of threads does blocking reads.
+///
+class AsyncFileReader {
+ public:
+  static constexpr size_t kDefaultQueueDepth = 64u;
+
+  //----------------------------------------------------------------------------
+  /// @brief      The results are in the same order as the paths. Files that
+  ///             could not be read have null mappings.
+  ///
+  using BatchReadCallback =
+      UniqueFunction<void(std::vector<std::unique_ptr<Mapping>>)>;
+
+  using ReadCallback = UniqueFunction<void(std::unique_ptr<Mapping>)>;
+
+  static AsyncFileReader& ForProcess();
+
+  //----------------------------------------------------------------------------
+  /// @brief      Create a reader.
+  ///
+  /// @param[in]  queue_depth     The most reads that may be in flight at once.
+  ///                             Reads beyond that are queued.
+  /// @param[in]  allow_io_uring  If io_uring may be used where available.
+  ///
+  static std::unique_ptr<AsyncFileReader> Create(
+      size_t queue_depth = kDefaultQueueDepth,
+      bool allow_io_uring = true);
+
+  AsyncFileReader();
+
+  //----------------------------------------------------------------------------
+  /// @brief      Waits for reads that are in flight. The callbacks of batches
+  ///             that have not completed may be dropped.
+  ///
+  virtual ~AsyncFileReader();
+
+  virtual AsyncFileReaderType GetType() const = 0;
+
+  //----------------------------------------------------------------------------
+  /// @brief      Read the files and invoke the callback once all of them have
+  ///             been read or have failed. The callback is invoked on the
+  ///             thread of the reader that completed the last read, or on the
+  ///             calling thread if there are no files. It must not block.
+  ///
+  virtual bool ReadFiles(std::vector<std::filesystem::path> paths,
+                         BatchReadCallback callback) = 0;
+
+  //----------------------------------------------------------------------------
+  /// @brief      Read the files and post the callback to the dispatcher once
+  ///             all of them have been read or have failed.
+  ///
+  bool ReadFiles(std::vector<std::filesystem::path> paths,
+                 std::shared_ptr<EventLoop::Dispatcher> dispatcher,
+                 BatchReadCallback callback);
+
+  bool ReadFile(std::filesystem::path path, ReadCallback callback);
+
+  bool ReadFile(std::filesystem::path path,
+                std::shared_ptr<EventLoop::Dispatcher> dispatcher,
+                ReadCallback callback);
+
+ protected:
+  //----------------------------------------------------------------------------
+  /// @brief      The results of a batch as the reads complete. Thread safe.
+  ///
+  class Batch {
+   public:
+    Batch(size_t count, BatchReadCallback callback);
+
+    ~Batch();
+
+    //--------------------------------------------------------------------------
+    /// @brief      Record the result of the read at the index. Invokes the
+    ///             callback once all reads have completed.
+    ///
+    void Complete(size_t index, std::unique_ptr<Mapping> mapping);
+
+   private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Mapping>> results_;
+    size_t remaining_ = 0;
+    BatchReadCallback callback_;
+
+    P_DISALLOW_COPY_AND_ASSIGN(Batch);
+  };
+
+ private:
+  P_DISALLOW_COPY_AND_ASSIGN(AsyncFileReader);
+};
+
+}  // namespace pixel
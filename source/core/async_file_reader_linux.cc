@@ -0,0 +1,366 @@
+#include "async_file_reader_linux.h"
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include "logging.h"
+
+namespace pixel {
+
+// The length of a single read is 32 bits wide.
+static constexpr size_t kMaxReadSize = 1u << 30;
+
+static unsigned LoadAcquire(const unsigned* value) {
+  return std::atomic_ref<const unsigned>(*value).load(
+      std::memory_order_acquire);
+}
+
+static void StoreRelease(unsigned* value, unsigned new_value) {
+  std::atomic_ref<unsigned>(*value).store(new_value,
+                                          std::memory_order_release);
+}
+
+struct AsyncFileReaderLinux::Ring {
+  UniqueFD fd;
+  void* sq_ring = MAP_FAILED;
+  size_t sq_ring_size = 0;
+  void* cq_ring = MAP_FAILED;
+  size_t cq_ring_size = 0;
+  struct io_uring_sqe* sqes = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+  size_t sqes_size = 0;
+
+  unsigned* sq_head = nullptr;
+  unsigned* sq_tail = nullptr;
+  unsigned* sq_array = nullptr;
+  unsigned sq_mask = 0;
+  unsigned sq_entries = 0;
+
+  unsigned* cq_head = nullptr;
+  unsigned* cq_tail = nullptr;
+  struct io_uring_cqe* cqes = nullptr;
+  unsigned cq_mask = 0;
+
+  Ring() = default;
+
+  ~Ring() {
+    if (sqes != MAP_FAILED) {
+      ::munmap(sqes, sqes_size);
+    }
+    if (cq_ring != MAP_FAILED && cq_ring != sq_ring) {
+      ::munmap(cq_ring, cq_ring_size);
+    }
+    if (sq_ring != MAP_FAILED) {
+      ::munmap(sq_ring, sq_ring_size);
+    }
+  }
+
+  bool Setup(unsigned entries) {
+    struct io_uring_params params = {};
+    fd.Reset(::syscall(__NR_io_uring_setup, entries, &params));
+    if (!fd.IsValid()) {
+      return false;
+    }
+
+    if (!SupportsRead()) {
+      return false;
+    }
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size =
+        params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+      sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+    }
+
+    sq_ring = ::mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd.Get(), IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED) {
+      return false;
+    }
+    cq_ring = single_mmap ? sq_ring
+                          : ::mmap(nullptr, cq_ring_size,
+                                   PROT_READ | PROT_WRITE,
+                                   MAP_SHARED | MAP_POPULATE, fd.Get(),
+                                   IORING_OFF_CQ_RING);
+    if (cq_ring == MAP_FAILED) {
+      return false;
+    }
+    sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = static_cast<struct io_uring_sqe*>(
+        ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, fd.Get(), IORING_OFF_SQES));
+    if (sqes == MAP_FAILED) {
+      return false;
+    }
+
+    auto sq_bytes = static_cast<uint8_t*>(sq_ring);
+    sq_head = reinterpret_cast<unsigned*>(sq_bytes + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(sq_bytes + params.sq_off.tail);
+    sq_array = reinterpret_cast<unsigned*>(sq_bytes + params.sq_off.array);
+    sq_mask = *reinterpret_cast<unsigned*>(sq_bytes + params.sq_off.ring_mask);
+    sq_entries = params.sq_entries;
+
+    auto cq_bytes = static_cast<uint8_t*>(cq_ring);
+    cq_head = reinterpret_cast<unsigned*>(cq_bytes + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq_bytes + params.cq_off.tail);
+    cqes =
+        reinterpret_cast<struct io_uring_cqe*>(cq_bytes + params.cq_off.cqes);
+    cq_mask = *reinterpret_cast<unsigned*>(cq_bytes + params.cq_off.ring_mask);
+    return true;
+  }
+
+  // Kernels before 5.6 have io_uring but can only do vectored reads.
+  bool SupportsRead() const {
+    constexpr size_t kOpCount = IORING_OP_READ + 1u;
+    std::vector<uint8_t> storage(sizeof(struct io_uring_probe) +
+                                 kOpCount * sizeof(struct io_uring_probe_op));
+    auto probe = reinterpret_cast<struct io_uring_probe*>(storage.data());
+    if (::syscall(__NR_io_uring_register, fd.Get(), IORING_REGISTER_PROBE,
+                  probe, kOpCount) != 0) {
+      return false;
+    }
+    return probe->last_op >= IORING_OP_READ &&
+           (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+  }
+
+  bool RegisterEventFD(int event_fd) {
+    return ::syscall(__NR_io_uring_register, fd.Get(), IORING_REGISTER_EVENTFD,
+                     &event_fd, 1) == 0;
+  }
+
+  bool Enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+    const auto result = P_TEMP_FAILURE_RETRY(
+        ::syscall(__NR_io_uring_enter, fd.Get(), to_submit, min_complete,
+                  flags, nullptr, 0));
+    if (result < 0) {
+      P_ERROR << "Could not enter the io_uring: " << strerror(errno);
+      return false;
+    }
+    return true;
+  }
+
+  P_DISALLOW_COPY_AND_ASSIGN(Ring);
+};
+
+struct AsyncFileReaderLinux::Read {
+  std::shared_ptr<Batch> batch;
+  size_t index = 0;
+  UniqueFD fd;
+  uint8_t* buffer = nullptr;
+  size_t size = 0;
+  size_t offset = 0;
+
+  Read() = default;
+
+  ~Read() { ::free(buffer); }
+
+  void Complete() {
+    auto allocation = buffer;
+    buffer = nullptr;
+    batch->Complete(index,
+                    UnownedMapping(allocation, size,
+                                   [allocation]() { ::free(allocation); }));
+  }
+
+  void Fail() { batch->Complete(index, nullptr); }
+
+  P_DISALLOW_COPY_AND_ASSIGN(Read);
+};
+
+AsyncFileReaderLinux::AsyncFileReaderLinux(size_t queue_depth)
+    : ring_(std::make_unique<Ring>()),
+      event_fd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      thread_("File Reader") {
+  if (!event_fd_.IsValid()) {
+    P_ERROR << "Could not create eventfd: " << strerror(errno);
+    return;
+  }
+  if (!ring_->Setup(std::clamp<size_t>(queue_depth, 1u, 4096u))) {
+    // Not an error. The caller falls back to blocking reads.
+    return;
+  }
+  if (!ring_->RegisterEventFD(event_fd_.Get())) {
+    P_ERROR << "Could not register eventfd with io_uring: " << strerror(errno);
+    return;
+  }
+  thread_.GetDispatcher()->PostTask([this]() { StartWatchingCompletions(); },
+                                    TaskPriority::kTaskPriorityNormal,
+                                    "File Reader Setup");
+  is_valid_ = true;
+}
+
+AsyncFileReaderLinux::~AsyncFileReaderLinux() {
+  if (is_valid_) {
+    // The kernel may still be writing into the buffers of reads in flight.
+    thread_.GetDispatcher()->PostTask([this]() { WaitForReadsInFlight(); });
+  }
+}
+
+bool AsyncFileReaderLinux::IsValid() const {
+  return is_valid_;
+}
+
+AsyncFileReaderType AsyncFileReaderLinux::GetType() const {
+  return AsyncFileReaderType::kAsyncFileReaderTypeIOURing;
+}
+
+void AsyncFileReaderLinux::StartWatchingCompletions() {
+  auto source = EventLoop::ForCurrentThread().AddFileDescriptorSource(
+      event_fd_.Get(), kFileDescriptorEventReadable, [this](uint32_t events) {
+        uint64_t count = 0;
+        P_TEMP_FAILURE_RETRY(::read(event_fd_.Get(), &count, sizeof(count)));
+        ReapCompletions();
+        SubmitPendingReads();
+      });
+  if (!source.has_value()) {
+    P_ERROR << "Could not watch for io_uring completions. Expect no file "
+               "reads to complete.";
+  }
+}
+
+bool AsyncFileReaderLinux::ReadFiles(
+    std::vector<std::filesystem::path> paths,
+    BatchReadCallback callback) {
+  if (!is_valid_ || !callback) {
+    return false;
+  }
+  auto batch = std::make_shared<Batch>(paths.size(), std::move(callback));
+  return thread_.GetDispatcher()->PostTask(
+      [this, batch, paths = std::move(paths)]() {
+        for (size_t i = 0; i < paths.size(); i++) {
+          OpenAndQueueRead(batch, i, paths[i]);
+        }
+        SubmitPendingReads();
+      },
+      TaskPriority::kTaskPriorityNormal, "File Read Submission");
+}
+
+void AsyncFileReaderLinux::OpenAndQueueRead(std::shared_ptr<Batch> batch,
+                                            size_t index,
+                                            const std::filesystem::path& path) {
+  auto read = std::make_unique<Read>();
+  read->batch = std::move(batch);
+  read->index = index;
+  read->fd.Reset(
+      P_TEMP_FAILURE_RETRY(::open(path.c_str(), O_RDONLY | O_CLOEXEC)));
+  if (!read->fd.IsValid()) {
+    P_ERROR << "Could not open " << path << ": " << strerror(errno);
+    read->Fail();
+    return;
+  }
+
+  struct stat stat_buf = {};
+  if (::fstat(read->fd.Get(), &stat_buf) != 0) {
+    P_ERROR << "Could not stat " << path << ": " << strerror(errno);
+    read->Fail();
+    return;
+  }
+
+  read->size = stat_buf.st_size;
+  if (read->size == 0) {
+    read->Complete();
+    return;
+  }
+
+  read->buffer = static_cast<uint8_t*>(::malloc(read->size));
+  if (read->buffer == nullptr) {
+    P_ERROR << "Could not allocate " << read->size << " bytes for " << path;
+    read->Fail();
+    return;
+  }
+
+  pending_reads_.emplace_back(std::move(read));
+}
+
+void AsyncFileReaderLinux::SubmitPendingReads() {
+  auto tail = *ring_->sq_tail;
+  while (!pending_reads_.empty() && in_flight_count_ < ring_->sq_entries) {
+    // The kernel owns the completed read until it is reaped.
+    auto read = pending_reads_.front().release();
+    pending_reads_.pop_front();
+
+    const auto index = tail & ring_->sq_mask;
+    auto& sqe = ring_->sqes[index];
+    ::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_READ;
+    sqe.fd = read->fd.Get();
+    sqe.addr = reinterpret_cast<uintptr_t>(read->buffer + read->offset);
+    sqe.len = std::min(read->size - read->offset, kMaxReadSize);
+    sqe.off = read->offset;
+    sqe.user_data = reinterpret_cast<uintptr_t>(read);
+    ring_->sq_array[index] = index;
+
+    tail++;
+    in_flight_count_++;
+  }
+  StoreRelease(ring_->sq_tail, tail);
+
+  // Includes entries a previous submission could not hand to the kernel.
+  const auto to_submit = tail - LoadAcquire(ring_->sq_head);
+  if (to_submit > 0) {
+    ring_->Enter(to_submit, 0u, 0u);
+  }
+}
+
+void AsyncFileReaderLinux::ReapCompletions() {
+  auto head = *ring_->cq_head;
+  const auto tail = LoadAcquire(ring_->cq_tail);
+  std::vector<std::pair<std::unique_ptr<Read>, int>> completions;
+  for (; head != tail; head++) {
+    const auto& cqe = ring_->cqes[head & ring_->cq_mask];
+    completions.emplace_back(reinterpret_cast<Read*>(cqe.user_data), cqe.res);
+  }
+  StoreRelease(ring_->cq_head, head);
+  in_flight_count_ -= completions.size();
+
+  for (auto& completion : completions) {
+    auto& read = completion.first;
+    const auto result = completion.second;
+    if (result == -EINTR || result == -EAGAIN) {
+      pending_reads_.emplace_back(std::move(read));
+      continue;
+    }
+    if (result < 0) {
+      P_ERROR << "Could not read file: " << strerror(-result);
+      read->Fail();
+      continue;
+    }
+    if (result == 0) {
+      P_ERROR << "File was truncated while being read.";
+      read->Fail();
+      continue;
+    }
+    read->offset += result;
+    if (read->offset < read->size) {
+      // Short reads are resumed where they left off.
+      pending_reads_.emplace_back(std::move(read));
+      continue;
+    }
+    read->Complete();
+  }
+}
+
+void AsyncFileReaderLinux::WaitForReadsInFlight() {
+  while (in_flight_count_ > 0) {
+    if (!ring_->Enter(0u, 1u, IORING_ENTER_GETEVENTS)) {
+      // Leak the buffers rather than free them from under the kernel.
+      return;
+    }
+    ReapCompletions();
+  }
+  pending_reads_.clear();
+}
+
+}  // namespace pixel
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+
+#include "async_file_reader.h"
+#include "file.h"
+#include "macros.h"
+#include "thread.h"
+
+namespace pixel {
+
+//------------------------------------------------------------------------------
+/// @brief      Reads files using io_uring. Files are opened and reads are
+///             submitted on a dedicated thread. Completions are noticed via an
+///             eventfd that is a file descriptor source on the event loop of
+///             that thread.
+///
+class AsyncFileReaderLinux final : public AsyncFileReader {
+ public:
+  AsyncFileReaderLinux(size_t queue_depth);
+
+  // |AsyncFileReader|
+  ~AsyncFileReaderLinux() override;
+
+  //----------------------------------------------------------------------------
+  /// @brief      If io_uring could be set up. It may be missing from the
+  ///             kernel or disallowed in sandboxes.
+  ///
+  bool IsValid() const;
+
+  // |AsyncFileReader|
+  AsyncFileReaderType GetType() const override;
+
+  // |AsyncFileReader|
+  bool ReadFiles(std::vector<std::filesystem::path> paths,
+                 BatchReadCallback callback) override;
+
+ private:
+  struct Ring;
+  struct Read;
+
+  std::unique_ptr<Ring> ring_;
+  UniqueFD event_fd_;
+  // Only accessed on the reader thread.
+  std::deque<std::unique_ptr<Read>> pending_reads_;
+  size_t in_flight_count_ = 0;
+  bool is_valid_ = false;
+  // Must be last so that the thread is gone before the ring is collected.
+  Thread thread_;
+
+  void StartWatchingCompletions();
+
+  void OpenAndQueueRead(std::shared_ptr<Batch> batch,
+                        size_t index,
+                        const std::filesystem::path& path);
+
+  void SubmitPendingReads();
+
+  void ReapCompletions();
+
+  void WaitForReadsInFlight();
+
+  P_DISALLOW_COPY_AND_ASSIGN(AsyncFileReaderLinux);
+};
+
+}  // namespace pixel
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <future>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include "async_file_reader.h"
+#include "fixture.h"
+#include "scoped_temp_directory.h"
+#include "thread.h"
+
+namespace pixel {
+namespace testing {
+
+static std::string_view ToStringView(const Mapping& mapping) {
+  return {reinterpret_cast<const char*>(mapping.GetData()), mapping.GetSize()};
+}
+
+static std::filesystem::path WriteFile(const std::filesystem::path& directory,
+                                       const std::string& name,
+                                       const std::string& contents) {
+  const auto path = directory / name;
+  std::ofstream stream(path, std::ios::binary);
+  stream << contents;
+  return path;
+}
+
+class AsyncFileReaderTest : public ::testing::TestWithParam<bool> {
+ public:
+  std::unique_ptr<AsyncFileReader> CreateReader() {
+    return AsyncFileReader::Create(4u, GetParam());
+  }
+};
+
+TEST_P(AsyncFileReaderTest, CanReadBatchOfFiles) {
+  auto reader = CreateReader();
+  ASSERT_TRUE(reader);
+  if (!GetParam()) {
+    ASSERT_EQ(reader->GetType(),
+              AsyncFileReaderType::kAsyncFileReaderTypeThreadPool);
+  }
+
+  ScopedTempDirectory directory("pixel_read");
+  ASSERT_TRUE(directory.IsValid());
+
+  // More files than the queue depth and one large enough to need many pages.
+  std::vector<std::filesystem::path> paths;
+  std::vector<std::string> contents;
+  for (size_t i = 0; i < 10; i++) {
+    contents.push_back(std::string(i * 1000u + 1u, 'a' + i));
+    paths.push_back(
+        WriteFile(directory.GetPath(), std::to_string(i), contents.back()));
+  }
+  contents.push_back(std::string(8u * 1024u * 1024u, 'z'));
+  paths.push_back(WriteFile(directory.GetPath(), "large", contents.back()));
+  contents.push_back("");
+  paths.push_back(WriteFile(directory.GetPath(), "empty", contents.back()));
+  paths.push_back(P_FIXTURES_LOCATION "does_not_exist.txt");
+
+  Thread thread("Reader Callback");
+  std::promise<std::vector<std::unique_ptr<Mapping>>> promise;
+  ASSERT_TRUE(reader->ReadFiles(
+      paths, thread.GetDispatcher(),
+      [&, dispatcher = thread.GetDispatcher()](
+          std::vector<std::unique_ptr<Mapping>> mappings) {
+        ASSERT_TRUE(dispatcher->RunsTasksOnCurrentThread());
+        promise.set_value(std::move(mappings));
+      }));
+  auto mappings = promise.get_future().get();
+
+  ASSERT_EQ(mappings.size(), paths.size());
+  for (size_t i = 0; i < contents.size(); i++) {
+    ASSERT_TRUE(mappings[i]);
+    ASSERT_EQ(ToStringView(*mappings[i]), contents[i]);
+  }
+  ASSERT_FALSE(mappings.back());
+}
+
+TEST_P(AsyncFileReaderTest, CanReadSingleFile) {
+  auto reader = CreateReader();
+  Thread thread("Reader Callback");
+  std::promise<std::unique_ptr<Mapping>> promise;
+  ASSERT_TRUE(reader->ReadFile(P_FIXTURES_LOCATION "hello.txt",
+                               thread.GetDispatcher(),
+                               [&](std::unique_ptr<Mapping> mapping) {
+                                 promise.set_value(std::move(mapping));
+                               }));
+  auto mapping = promise.get_future().get();
+  ASSERT_TRUE(mapping);
+  ASSERT_GT(mapping->GetSize(), 0u);
+}
+
+TEST_P(AsyncFileReaderTest, CanCompleteReadsOnTheReader) {
+  auto reader = CreateReader();
+  const auto caller = std::this_thread::get_id();
+  std::promise<std::pair<std::thread::id, std::unique_ptr<Mapping>>> promise;
+  ASSERT_TRUE(reader->ReadFile(
+      P_FIXTURES_LOCATION "hello.txt", [&](std::unique_ptr<Mapping> mapping) {
+        promise.set_value({std::this_thread::get_id(), std::move(mapping)});
+      }));
+  auto [completer, mapping] = promise.get_future().get();
+  ASSERT_NE(completer, caller);
+  ASSERT_TRUE(mapping);
+  ASSERT_GT(mapping->GetSize(), 0u);
+}
+
+TEST_P(AsyncFileReaderTest, EmptyBatchesComplete) {
+  auto reader = CreateReader();
+  Thread thread("Reader Callback");
+  std::promise<size_t> promise;
+  ASSERT_TRUE(reader->ReadFiles(
+      {}, thread.GetDispatcher(),
+      [&](std::vector<std::unique_ptr<Mapping>> mappings) {
+        promise.set_value(mappings.size());
+      }));
+  ASSERT_EQ(promise.get_future().get(), 0u);
+}
+
+INSTANTIATE_TEST_SUITE_P(AsyncFileReader,
+                         AsyncFileReaderTest,
+                         ::testing::Bool(),
+                         [](const auto& info) {
+                           return info.param ? "AllowIOURing" : "ThreadPool";
+                         });
+
+}  // namespace testing
+}  // namespace pixel
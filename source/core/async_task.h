@@ -0,0 +1,139 @@
+#pragma once
+
+#include <coroutine>
+#include <cstdlib>
+#include <optional>
+#include <utility>
+
+#include "macros.h"
+
+namespace pixel {
+
+template <class T>
+class AsyncTask;
+
+template <class T>
+struct AsyncTaskResult {
+  std::optional<T> value;
+
+  void return_value(T result) { value.emplace(std::move(result)); }
+
+  T TakeResult() { return std::move(value.value()); }
+};
+
+template <>
+struct AsyncTaskResult<void> {
+  void return_void() {}
+
+  void TakeResult() {}
+};
+
+//------------------------------------------------------------------------------
+/// @brief      The result of a coroutine. The coroutine does not start till the
+///             task is either awaited or detached. Awaiting the task resumes
+///             the awaiting coroutine on whichever thread the task finished.
+///
+///             Threads may be switched within a coroutine by awaiting
+///             `EventLoop::Dispatcher::Resume` or `WorkerPool::Resume`.
+///
+template <class T = void>
+class [[nodiscard]] AsyncTask {
+ public:
+  struct promise_type : public AsyncTaskResult<T> {
+    std::coroutine_handle<> continuation;
+    bool detached = false;
+
+    AsyncTask get_return_object() {
+      return AsyncTask{
+          std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter {
+      bool await_ready() noexcept { return false; }
+
+      std::coroutine_handle<> await_suspend(
+          std::coroutine_handle<promise_type> handle) noexcept {
+        auto& promise = handle.promise();
+        if (promise.continuation) {
+          return promise.continuation;
+        }
+        if (promise.detached) {
+          handle.destroy();
+        }
+        return std::noop_coroutine();
+      }
+
+      void await_resume() noexcept {}
+    };
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    // Exceptions are disabled.
+    void unhandled_exception() { std::abort(); }
+  };
+
+  using Handle = std::coroutine_handle<promise_type>;
+
+  AsyncTask(AsyncTask&& other) : handle_(std::exchange(other.handle_, {})) {}
+
+  AsyncTask& operator=(AsyncTask&& other) {
+    if (this != &other) {
+      Reset();
+      handle_ = std::exchange(other.handle_, {});
+    }
+    return *this;
+  }
+
+  ~AsyncTask() { Reset(); }
+
+  bool IsDone() const { return !handle_ || handle_.done(); }
+
+  //----------------------------------------------------------------------------
+  /// @brief      Start the coroutine without waiting on its result. The
+  ///             coroutine frame is collected once it finishes.
+  ///
+  void Detach() && {
+    if (!handle_) {
+      return;
+    }
+    auto handle = std::exchange(handle_, {});
+    handle.promise().detached = true;
+    handle.resume();
+  }
+
+  auto operator co_await() && {
+    struct Awaiter {
+      Handle handle;
+
+      bool await_ready() const { return handle.done(); }
+
+      std::coroutine_handle<> await_suspend(
+          std::coroutine_handle<> continuation) {
+        handle.promise().continuation = continuation;
+        return handle;
+      }
+
+      T await_resume() { return handle.promise().TakeResult(); }
+    };
+    P_ASSERT(handle_);
+    return Awaiter{handle_};
+  }
+
+ private:
+  Handle handle_;
+
+  explicit AsyncTask(Handle handle) : handle_(handle) {}
+
+  void Reset() {
+    if (handle_) {
+      handle_.destroy();
+      handle_ = {};
+    }
+  }
+
+  P_DISALLOW_COPY_AND_ASSIGN(AsyncTask);
+};
+
+}  // namespace pixel
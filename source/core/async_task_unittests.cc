@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include <future>
+#include <thread>
+
+#include "async_task.h"
+#include "event_loop.h"
+#include "thread.h"
+#include "worker_pool.h"
+
+namespace pixel {
+namespace testing {
+
+static AsyncTask<size_t> Add(size_t a, size_t b) {
+  co_return a + b;
+}
+
+static AsyncTask<size_t> AddThrice(size_t value) {
+  auto result = co_await Add(value, value);
+  co_return co_await Add(result, value);
+}
+
+template <class T>
+static AsyncTask<void> SetPromiseValue(AsyncTask<T> task,
+                                       std::promise<T>& promise) {
+  promise.set_value(co_await std::move(task));
+}
+
+// Blocks the calling thread till the task is done.
+template <class T>
+static T WaitForTask(AsyncTask<T> task) {
+  std::promise<T> promise;
+  auto future = promise.get_future();
+  SetPromiseValue(std::move(task), promise).Detach();
+  return future.get();
+}
+
+TEST(AsyncTaskTest, TasksAreLazy) {
+  size_t runs = 0;
+  auto task = [](size_t& runs) -> AsyncTask<void> {
+    runs++;
+    co_return;
+  }(runs);
+  ASSERT_EQ(runs, 0u);
+  ASSERT_FALSE(task.IsDone());
+  std::move(task).Detach();
+  ASSERT_EQ(runs, 1u);
+}
+
+TEST(AsyncTaskTest, CanAwaitNestedTasks) {
+  ASSERT_EQ(WaitForTask(AddThrice(14)), 42u);
+}
+
+TEST(AsyncTaskTest, CanHopBetweenThreads) {
+  Thread thread("AsyncTaskTest");
+  auto dispatcher = thread.GetDispatcher();
+
+  auto task = [](std::shared_ptr<EventLoop::Dispatcher> dispatcher)
+      -> AsyncTask<bool> {
+    if (!co_await dispatcher->Resume()) {
+      co_return false;
+    }
+    if (!dispatcher->RunsTasksOnCurrentThread()) {
+      co_return false;
+    }
+
+    co_await WorkerPool::ForProcess().Resume();
+    if (dispatcher->RunsTasksOnCurrentThread()) {
+      co_return false;
+    }
+
+    co_await dispatcher->Resume(TaskPriority::kTaskPriorityHigh);
+    co_return dispatcher->RunsTasksOnCurrentThread();
+  };
+
+  ASSERT_TRUE(WaitForTask(task(dispatcher)));
+}
+
+TEST(AsyncTaskTest, ResumingOnCollectedLoopContinuesInline) {
+  std::shared_ptr<EventLoop::Dispatcher> dispatcher;
+  {
+    Thread thread("AsyncTaskTest");
+    dispatcher = thread.GetDispatcher();
+  }
+
+  auto task = [](std::shared_ptr<EventLoop::Dispatcher> dispatcher,
+                 std::thread::id thread_id) -> AsyncTask<bool> {
+    const auto resumed = co_await dispatcher->Resume();
+    co_return !resumed && std::this_thread::get_id() == thread_id;
+  };
+
+  ASSERT_TRUE(WaitForTask(task(dispatcher, std::this_thread::get_id())));
+}
+
+}  // namespace testing
+}  // namespace pixel
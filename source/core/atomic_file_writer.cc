@@ -0,0 +1,198 @@
+#include "atomic_file_writer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+
+#if P_OS_WINDOWS
+#include <Windows.h>
+
+#include "win_utils.h"
+#else  // P_OS_WINDOWS
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#endif  // P_OS_WINDOWS
+
+#include "logging.h"
+
+namespace pixel {
+
+bool AtomicFileWriter::WriteFile(const std::filesystem::path& path,
+                                 const uint8_t* data,
+                                 size_t size,
+                                 bool sync) {
+  AtomicFileWriter writer(path, sync);
+  return writer.Write(data, size) && writer.Commit();
+}
+
+AtomicFileWriter::AtomicFileWriter(std::filesystem::path path, bool sync)
+    : path_(std::move(path)), sync_(sync) {
+  if (path_.empty() || !path_.has_filename()) {
+    P_ERROR << "Invalid path to write to: " << path_;
+    return;
+  }
+
+  static std::atomic_size_t sTempFileCount = 0;
+
+#if P_OS_WINDOWS
+  auto temp_path = path_;
+  temp_path += ".tmp" + std::to_string(::GetCurrentProcessId()) + "-" +
+               std::to_string(++sTempFileCount);
+  fd_.Reset(::CreateFileW(temp_path.c_str(),      // lpFileName
+                          GENERIC_WRITE,          // dwDesiredAccess
+                          0,                      // dwShareMode
+                          nullptr,                // lpSecurityAttributes
+                          CREATE_NEW,             // dwCreationDisposition
+                          FILE_ATTRIBUTE_NORMAL,  // dwFlagsAndAttributes
+                          nullptr                 // hTemplateFile
+                          ));
+  if (!fd_.IsValid()) {
+    P_ERROR << "Could not create temporary file " << temp_path << ": "
+            << GetLastErrorMessage();
+    return;
+  }
+  temp_path_ = std::move(temp_path);
+#else   // P_OS_WINDOWS
+  // A replaced file keeps its mode. New files get the usual mode of new files
+  // with the umask of the process applied by open.
+  struct stat destination_stat = {};
+  const bool replaces_file = ::stat(path_.c_str(), &destination_stat) == 0;
+  const mode_t mode = replaces_file ? destination_stat.st_mode & 07777 : 0666;
+  // Names are only reused if a process with the same ID left a temporary
+  // file behind.
+  std::filesystem::path temp_path;
+  for (size_t attempt = 0; attempt < 16u && !fd_.IsValid(); attempt++) {
+    temp_path = path_;
+    temp_path += ".tmp" + std::to_string(::getpid()) + "-" +
+                 std::to_string(++sTempFileCount);
+    fd_.Reset(P_TEMP_FAILURE_RETRY(
+        ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+               mode)));
+    if (!fd_.IsValid() && errno != EEXIST) {
+      break;
+    }
+  }
+  if (!fd_.IsValid()) {
+    P_ERROR << "Could not create temporary file for " << path_ << ": "
+            << strerror(errno);
+    return;
+  }
+  temp_path_ = std::move(temp_path);
+  // The umask was applied to the mode of the replaced file as well.
+  if (replaces_file && ::fchmod(fd_.Get(), mode) != 0) {
+    P_WARNING << "Could not keep the mode of " << path_ << ": "
+              << strerror(errno);
+  }
+#endif  // P_OS_WINDOWS
+}
+
+AtomicFileWriter::~AtomicFileWriter() {
+  Discard();
+}
+
+bool AtomicFileWriter::IsValid() const {
+  return fd_.IsValid();
+}
+
+bool AtomicFileWriter::Write(const uint8_t* data, size_t size) {
+  if (!IsValid()) {
+    return false;
+  }
+  while (size > 0) {
+#if P_OS_WINDOWS
+    DWORD written = 0;
+    const auto chunk = static_cast<DWORD>(std::min<size_t>(size, 1u << 30));
+    if (!::WriteFile(fd_.Get(), data, chunk, &written, nullptr)) {
+      P_ERROR << "Could not write to " << temp_path_ << ": "
+              << GetLastErrorMessage();
+      Discard();
+      return false;
+    }
+#else   // P_OS_WINDOWS
+    const auto written = P_TEMP_FAILURE_RETRY(::write(fd_.Get(), data, size));
+    if (written < 0) {
+      P_ERROR << "Could not write to " << temp_path_ << ": "
+              << strerror(errno);
+      Discard();
+      return false;
+    }
+#endif  // P_OS_WINDOWS
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+bool AtomicFileWriter::Write(const Mapping& mapping) {
+  return Write(mapping.GetData(), mapping.GetSize());
+}
+
+bool AtomicFileWriter::Commit() {
+  if (!IsValid()) {
+    return false;
+  }
+
+#if P_OS_WINDOWS
+  if (sync_ && !::FlushFileBuffers(fd_.Get())) {
+    P_ERROR << "Could not flush " << temp_path_ << ": "
+            << GetLastErrorMessage();
+    Discard();
+    return false;
+  }
+  fd_.Reset();
+  const DWORD flags =
+      MOVEFILE_REPLACE_EXISTING | (sync_ ? MOVEFILE_WRITE_THROUGH : 0);
+  if (!::MoveFileExW(temp_path_.c_str(), path_.c_str(), flags)) {
+    P_ERROR << "Could not replace " << path_ << ": " << GetLastErrorMessage();
+    Discard();
+    return false;
+  }
+#else   // P_OS_WINDOWS
+  if (sync_ && P_TEMP_FAILURE_RETRY(::fsync(fd_.Get())) != 0) {
+    P_ERROR << "Could not sync " << temp_path_ << ": " << strerror(errno);
+    Discard();
+    return false;
+  }
+  fd_.Reset();
+  if (::rename(temp_path_.c_str(), path_.c_str()) != 0) {
+    P_ERROR << "Could not replace " << path_ << ": " << strerror(errno);
+    Discard();
+    return false;
+  }
+  if (sync_) {
+    // The rename itself is only durable once the directory is synced.
+    auto directory = path_.parent_path();
+    if (directory.empty()) {
+      directory = ".";
+    }
+    UniqueFD directory_fd(P_TEMP_FAILURE_RETRY(
+        ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)));
+    // The destination has already been replaced, so the commit succeeded
+    // even if the rename may not survive a crash of the machine.
+    if (!directory_fd.IsValid() ||
+        P_TEMP_FAILURE_RETRY(::fsync(directory_fd.Get())) != 0) {
+      P_ERROR << "Replaced " << path_ << " but could not sync directory "
+              << directory << ", so the replacement may not be durable: "
+              << strerror(errno);
+    }
+  }
+#endif  // P_OS_WINDOWS
+
+  temp_path_.clear();
+  return true;
+}
+
+void AtomicFileWriter::Discard() {
+  fd_.Reset();
+  if (!temp_path_.empty()) {
+    std::error_code error;
+    std::filesystem::remove(temp_path_, error);
+    temp_path_.clear();
+  }
+}
+
+}  // namespace pixel
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <filesystem>
+
+#include "file.h"
+#include "macros.h"
+#include "mapping.h"
+
+namespace pixel {
+
+//------------------------------------------------------------------------------
+/// @brief      Writes a file such that readers either see the previous
+///             contents or all of the new contents, even if the process or the
+///             machine crashes halfway. The contents are written to a
+///             temporary file next to the destination which is then renamed
+///             over the destination.
+///
+class AtomicFileWriter {
+ public:
+  //----------------------------------------------------------------------------
+  /// @brief      Write the data to the path and commit it.
+  ///
+  static bool WriteFile(const std::filesystem::path& path,
+                        const uint8_t* data,
+                        size_t size,
+                        bool sync = true);
+
+  //----------------------------------------------------------------------------
+  /// @brief      Start writing a file.
+  ///
+  /// @param[in]  path  The destination path. Its directory must exist. A
+  ///                   destination that is replaced keeps its permissions.
+  ///                   New files get the default permissions of new files.
+  /// @param[in]  sync  If the contents and the rename must be on disk before
+  ///                   the commit returns. Without this, a crash of the
+  ///                   machine may leave the destination empty on some file
+  ///                   systems, though never partially written.
+  ///
+  AtomicFileWriter(std::filesystem::path path, bool sync = true);
+
+  //----------------------------------------------------------------------------
+  /// @brief      Discards the contents if they were not committed.
+  ///
+  ~AtomicFileWriter();
+
+  bool IsValid() const;
+
+  bool Write(const uint8_t* data, size_t size);
+
+  bool Write(const Mapping& mapping);
+
+  //----------------------------------------------------------------------------
+  /// @brief      Replace the destination with the contents written so far.
+  ///             The writer is no longer valid after this call regardless of
+  ///             whether it succeeded.
+  ///
+  /// @return     If the destination was replaced. When syncing, a failure to
+  ///             sync the directory after the rename is only logged. The new
+  ///             contents are visible by then but might not survive a crash
+  ///             of the machine.
+  ///
+  bool Commit();
+
+ private:
+  const std::filesystem::path path_;
+  const bool sync_;
+  std::filesystem::path temp_path_;
+  UniqueFD fd_;
+
+  void Discard();
+
+  P_DISALLOW_COPY_AND_ASSIGN(AtomicFileWriter);
+};
+
+}  // namespace pixel
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+#include "atomic_file_writer.h"
+#include "file.h"
+#include "platform.h"
+#include "scoped_temp_directory.h"
+
+#if !P_OS_WINDOWS
+#include <sys/stat.h>
+#endif  // !P_OS_WINDOWS
+
+namespace pixel {
+namespace testing {
+
+static std::string ReadFile(const std::filesystem::path& path) {
+  auto mapping = OpenFile(path);
+  if (!mapping) {
+    return {};
+  }
+  return {reinterpret_cast<const char*>(mapping->GetData()),
+          mapping->GetSize()};
+}
+
+static size_t CountFiles(const std::filesystem::path& directory) {
+  size_t count = 0;
+  for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+    (void)entry;
+    count++;
+  }
+  return count;
+}
+
+static const uint8_t* ToBytes(std::string_view string) {
+  return reinterpret_cast<const uint8_t*>(string.data());
+}
+
+TEST(AtomicFileWriterTest, CommitReplacesDestination) {
+  ScopedTempDirectory temp_directory("pixel_atomic");
+  ASSERT_TRUE(temp_directory.IsValid());
+  const auto& directory = temp_directory.GetPath();
+  const auto path = directory / "cache.bin";
+  ASSERT_TRUE(AtomicFileWriter::WriteFile(path, ToBytes("old"), 3u));
+  ASSERT_EQ(ReadFile(path), "old");
+
+  for (auto sync : {true, false}) {
+    AtomicFileWriter writer(path, sync);
+    ASSERT_TRUE(writer.IsValid());
+    ASSERT_TRUE(writer.Write(ToBytes("new "), 4u));
+    // The destination is untouched until the commit.
+    ASSERT_EQ(ReadFile(path), "old");
+    auto mapping = CopyMapping(ToBytes("contents"), 8u);
+    ASSERT_TRUE(writer.Write(*mapping));
+    ASSERT_TRUE(writer.Commit());
+    ASSERT_FALSE(writer.IsValid());
+    ASSERT_FALSE(writer.Commit());
+    ASSERT_EQ(ReadFile(path), "new contents");
+    ASSERT_EQ(CountFiles(directory), 1u);
+    ASSERT_TRUE(AtomicFileWriter::WriteFile(path, ToBytes("old"), 3u));
+  }
+}
+
+TEST(AtomicFileWriterTest, UncommittedWritesAreDiscarded) {
+  ScopedTempDirectory temp_directory("pixel_atomic");
+  ASSERT_TRUE(temp_directory.IsValid());
+  const auto& directory = temp_directory.GetPath();
+  const auto path = directory / "cache.bin";
+  {
+    AtomicFileWriter writer(path);
+    ASSERT_TRUE(writer.Write(ToBytes("partial"), 7u));
+    ASSERT_EQ(CountFiles(directory), 1u);
+  }
+  ASSERT_FALSE(std::filesystem::exists(path));
+  ASSERT_EQ(CountFiles(directory), 0u);
+
+  AtomicFileWriter missing_directory(directory / "missing" / "cache.bin");
+  ASSERT_FALSE(missing_directory.IsValid());
+  ASSERT_FALSE(missing_directory.Write(ToBytes("a"), 1u));
+}
+
+#if !P_OS_WINDOWS
+static mode_t GetMode(const std::filesystem::path& path) {
+  struct stat path_stat = {};
+  if (::stat(path.c_str(), &path_stat) != 0) {
+    return 0;
+  }
+  return path_stat.st_mode & 07777;
+}
+
+TEST(AtomicFileWriterTest, NewFilesRespectTheUmask) {
+  ScopedTempDirectory temp_directory("pixel_atomic");
+  ASSERT_TRUE(temp_directory.IsValid());
+  const auto path = temp_directory.GetPath() / "cache.bin";
+  const mode_t mask = ::umask(0);
+  ::umask(mask);
+  ASSERT_TRUE(AtomicFileWriter::WriteFile(path, ToBytes("new"), 3u));
+  ASSERT_EQ(GetMode(path), 0666 & ~mask);
+}
+
+TEST(AtomicFileWriterTest, ReplacedFilesKeepTheirMode) {
+  ScopedTempDirectory temp_directory("pixel_atomic");
+  ASSERT_TRUE(temp_directory.IsValid());
+  const auto path = temp_directory.GetPath() / "cache.bin";
+  ASSERT_TRUE(AtomicFileWriter::WriteFile(path, ToBytes("old"), 3u));
+  ASSERT_EQ(::chmod(path.c_str(), 0600), 0);
+  ASSERT_TRUE(AtomicFileWriter::WriteFile(path, ToBytes("new"), 3u));
+  ASSERT_EQ(ReadFile(path), "new");
+  ASSERT_EQ(GetMode(path), 0600u);
+}
+#endif  // !P_OS_WINDOWS
+
+}  // namespace testing
+}  // namespace pixel
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <cstddef>
 #include <functional>
 #include <map>
 #include <memory>
+#include <new>
+#include <type_traits>
 #include <utility>
 
 #include "macros.h"
@@ -11,6 +14,162 @@ namespace pixel {
 
 using Closure = std::function<void(void)>;
 
+template <class Signature>
+class UniqueFunction;
+
+//------------------------------------------------------------------------------
+/// @brief      A move-only alternative to `std::function`. Unlike
+///             `std::function`, the callable may capture move-only types like
+///             promises and unique pointers without having to go through
+///             `MakeCopyable`. Callables that fit in the inline buffer are
+///             stored without a heap allocation.
+///
+template <class ReturnType, class... ArgTypes>
+class UniqueFunction<ReturnType(ArgTypes...)> {
+ public:
+  static constexpr size_t kInlineSize = 5 * sizeof(void*);
+
+  UniqueFunction() = default;
+
+  UniqueFunction(std::nullptr_t) {}
+
+  template <class Callable,
+            class = std::enable_if_t<
+                !std::is_same_v<std::decay_t<Callable>, UniqueFunction> &&
+                std::is_invocable_r_v<ReturnType,
+                                      std::decay_t<Callable>&,
+                                      ArgTypes...>>>
+  UniqueFunction(Callable&& callable) {
+    using Target = std::decay_t<Callable>;
+    if constexpr (kIsNullable<Target>) {
+      if (!callable) {
+        return;
+      }
+    }
+    if constexpr (kIsStoredInline<Target>) {
+      new (&storage_) Target(std::forward<Callable>(callable));
+    } else {
+      *reinterpret_cast<Target**>(&storage_) =
+          new Target(std::forward<Callable>(callable));
+    }
+    operations_ = &kOperations<Target>;
+  }
+
+  UniqueFunction(UniqueFunction&& other) { MoveFrom(other); }
+
+  UniqueFunction& operator=(UniqueFunction&& other) {
+    if (this != &other) {
+      Reset();
+      MoveFrom(other);
+    }
+    return *this;
+  }
+
+  UniqueFunction& operator=(std::nullptr_t) {
+    Reset();
+    return *this;
+  }
+
+  ~UniqueFunction() { Reset(); }
+
+  explicit operator bool() const { return operations_ != nullptr; }
+
+  ReturnType operator()(ArgTypes... args) const {
+    P_ASSERT(operations_ != nullptr);
+    return operations_->invoke(&storage_, std::forward<ArgTypes>(args)...);
+  }
+
+ private:
+  struct Operations {
+    ReturnType (*invoke)(void* storage, ArgTypes&&... args);
+    // Move constructs the target into uninitialized storage and destroys the
+    // moved from target.
+    void (*relocate)(void* to, void* from);
+    void (*destroy)(void* storage);
+  };
+
+  template <class T>
+  struct IsStdFunction : std::false_type {};
+
+  template <class T>
+  struct IsStdFunction<std::function<T>> : std::true_type {};
+
+  template <class Target>
+  static constexpr bool kIsNullable = std::is_pointer_v<Target> ||
+                                      std::is_member_pointer_v<Target> ||
+                                      IsStdFunction<Target>::value;
+
+  template <class Target>
+  static constexpr bool kIsStoredInline =
+      sizeof(Target) <= kInlineSize &&
+      alignof(Target) <= alignof(std::max_align_t) &&
+      std::is_nothrow_move_constructible_v<Target>;
+
+  template <class Target>
+  static Target* GetTarget(void* storage) {
+    if constexpr (kIsStoredInline<Target>) {
+      return std::launder(reinterpret_cast<Target*>(storage));
+    } else {
+      return *reinterpret_cast<Target**>(storage);
+    }
+  }
+
+  template <class Target>
+  static constexpr Operations kOperations = {
+      [](void* storage, ArgTypes&&... args) -> ReturnType {
+        if constexpr (std::is_void_v<ReturnType>) {
+          std::invoke(*GetTarget<Target>(storage),
+                      std::forward<ArgTypes>(args)...);
+        } else {
+          return std::invoke(*GetTarget<Target>(storage),
+                             std::forward<ArgTypes>(args)...);
+        }
+      },
+      [](void* to, void* from) {
+        if constexpr (kIsStoredInline<Target>) {
+          auto target = GetTarget<Target>(from);
+          new (to) Target(std::move(*target));
+          target->~Target();
+        } else {
+          *reinterpret_cast<Target**>(to) = GetTarget<Target>(from);
+        }
+      },
+      [](void* storage) {
+        if constexpr (kIsStoredInline<Target>) {
+          GetTarget<Target>(storage)->~Target();
+        } else {
+          delete GetTarget<Target>(storage);
+        }
+      },
+  };
+
+  // Mutable so that callables with mutable captures can be invoked via a const
+  // reference, just like `std::function`.
+  alignas(std::max_align_t) mutable std::byte storage_[kInlineSize];
+  const Operations* operations_ = nullptr;
+
+  void MoveFrom(UniqueFunction& other) {
+    if (other.operations_ == nullptr) {
+      return;
+    }
+    other.operations_->relocate(&storage_, &other.storage_);
+    operations_ = other.operations_;
+    other.operations_ = nullptr;
+  }
+
+  void Reset() {
+    if (operations_ == nullptr) {
+      return;
+    }
+    operations_->destroy(&storage_);
+    operations_ = nullptr;
+  }
+
+  P_DISALLOW_COPY_AND_ASSIGN(UniqueFunction);
+};
+
+using UniqueClosure = UniqueFunction<void(void)>;
+
 class AutoClosure {
  public:
   AutoClosure(Closure closure) : closure_(closure) {}
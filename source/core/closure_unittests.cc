@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+#include "closure.h"
+#include "event_loop.h"
+#include "logging.h"
+
+// Counts heap allocations made on each thread so that tests can check that
+// posting tasks does not allocate.
+static thread_local size_t tAllocationCount = 0;
+
+void* operator new(size_t size) {
+  tAllocationCount++;
+  if (auto allocation = std::malloc(size == 0 ? 1 : size)) {
+    return allocation;
+  }
+  std::abort();
+}
+
+void operator delete(void* allocation) noexcept {
+  std::free(allocation);
+}
+
+void operator delete(void* allocation, size_t) noexcept {
+  std::free(allocation);
+}
+
+namespace pixel {
+namespace testing {
+
+TEST(ClosureTest, UniqueClosureCanCaptureMoveOnlyTypes) {
+  size_t value = 0;
+  UniqueClosure closure = [&value, answer = std::make_unique<size_t>(42)]() {
+    value = *answer;
+  };
+  ASSERT_TRUE(closure);
+
+  UniqueClosure other = std::move(closure);
+  ASSERT_FALSE(closure);
+  ASSERT_TRUE(other);
+  other();
+  ASSERT_EQ(value, 42u);
+
+  other = nullptr;
+  ASSERT_FALSE(other);
+}
+
+TEST(ClosureTest, EmptyCallablesMakeEmptyUniqueClosures) {
+  ASSERT_FALSE(UniqueClosure{});
+  ASSERT_FALSE(UniqueClosure{nullptr});
+  void (*function)(void) = nullptr;
+  ASSERT_FALSE(UniqueClosure{function});
+  ASSERT_FALSE(UniqueClosure{Closure{}});
+  ASSERT_TRUE(UniqueClosure{Closure{[]() {}}});
+}
+
+TEST(ClosureTest, UniqueFunctionForwardsArgumentsAndResults) {
+  UniqueFunction<size_t(std::unique_ptr<size_t>, size_t)> function =
+      [](std::unique_ptr<size_t> a, size_t b) { return *a + b; };
+  ASSERT_EQ(function(std::make_unique<size_t>(40), 2u), 42u);
+}
+
+TEST(ClosureTest, LargeCallablesAreCollected) {
+  auto counter = std::make_shared<size_t>(0);
+  struct Large {
+    std::shared_ptr<size_t> counter;
+    char padding[UniqueClosure::kInlineSize] = {};
+
+    void operator()() const { (*counter)++; }
+  };
+
+  {
+    UniqueClosure closure = Large{counter};
+    UniqueClosure other = std::move(closure);
+    other();
+    ASSERT_EQ(counter.use_count(), 2);
+  }
+  ASSERT_EQ(counter.use_count(), 1);
+  ASSERT_EQ(*counter, 1u);
+}
+
+TEST(ClosureTest, PostingAllocationsBenchmark) {
+  constexpr size_t kPostCount = 512;
+
+  auto& loop = EventLoop::ForCurrentThread();
+  auto dispatcher = loop.GetDispatcher();
+  auto shared_state = std::make_shared<size_t>(0);
+  size_t tasks_run = 0;
+
+  // A lambda with a typical set of captures.
+  auto allocations_before = tAllocationCount;
+  for (size_t i = 0; i < kPostCount; i++) {
+    dispatcher->PostTask([&tasks_run, shared_state, i]() {
+      tasks_run++;
+      *shared_state += i;
+    });
+  }
+  const auto unique_closure_allocations =
+      tAllocationCount - allocations_before;
+  loop.FlushTasksNow();
+
+  // The same lambda with a move-only capture, as it would have had to be
+  // posted before.
+  allocations_before = tAllocationCount;
+  for (size_t i = 0; i < kPostCount; i++) {
+    Closure closure = MakeCopyable(
+        [&tasks_run, shared_state, i, unique = std::unique_ptr<size_t>()]() {
+          tasks_run++;
+          *shared_state += i;
+        });
+    dispatcher->PostTask(std::move(closure));
+  }
+  const auto copyable_closure_allocations =
+      tAllocationCount - allocations_before;
+  loop.FlushTasksNow();
+
+  ASSERT_EQ(tasks_run, 2 * kPostCount);
+
+  P_LOG << "Allocations per post: UniqueClosure: "
+        << static_cast<double>(unique_closure_allocations) / kPostCount
+        << ", MakeCopyable + Closure: "
+        << static_cast<double>(copyable_closure_allocations) / kPostCount;
+
+  ASSERT_EQ(unique_closure_allocations, 0u);
+}
+
+}  // namespace testing
+}  // namespace pixel
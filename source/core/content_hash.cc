@@ -0,0 +1,981 @@
+#include "content_hash.h"
+
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define P_HASH_SSE2 1
+#include <immintrin.h>
+#if defined(__GNUC__)
+// The AVX2 kernel is compiled for AVX2 regardless of the target and is only
+// used if the CPU supports it.
+#define P_HASH_AVX2 1
+#define P_HASH_AVX2_TARGET __attribute__((target("avx2")))
+#elif defined(__AVX2__)
+#define P_HASH_AVX2 1
+#define P_HASH_AVX2_TARGET
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#define P_HASH_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+namespace pixel {
+
+static constexpr uint32_t kPrime32_1 = 0x9E3779B1u;
+static constexpr uint32_t kPrime32_2 = 0x85EBCA77u;
+static constexpr uint32_t kPrime32_3 = 0xC2B2AE3Du;
+static constexpr uint64_t kPrime64_1 = 0x9E3779B185EBCA87u;
+static constexpr uint64_t kPrime64_2 = 0xC2B2AE3D27D4EB4Fu;
+static constexpr uint64_t kPrime64_3 = 0x165667B19E3779F9u;
+static constexpr uint64_t kPrime64_4 = 0x85EBCA77C2B2AE63u;
+static constexpr uint64_t kPrime64_5 = 0x27D4EB2F165667C5u;
+static constexpr uint64_t kPrimeMx1 = 0x165667919E3779F9u;
+static constexpr uint64_t kPrimeMx2 = 0x9FB21C651E98DF25u;
+
+static constexpr size_t kStripeSize = 64u;
+static constexpr size_t kSecretConsumeRate = 8u;
+static constexpr size_t kAccumulatorCount = 8u;
+static constexpr size_t kSecretSize = 192u;
+static constexpr size_t kSecretSizeMin = 136u;
+static constexpr size_t kMidSizeMax = 240u;
+static constexpr size_t kSecretMergeStart = 11u;
+static constexpr size_t kSecretLastStripeStart = 7u;
+static constexpr size_t kStripesPerBlock =
+    (kSecretSize - kStripeSize) / kSecretConsumeRate;
+
+alignas(64) static constexpr uint8_t kSecret[kSecretSize] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c,
+    0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+    0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e,
+    0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6,
+    0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+    0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97,
+    0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7,
+    0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+    0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83,
+    0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26,
+    0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+    0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f,
+    0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+// *****************************************************************************
+// *** Primitives
+// *****************************************************************************
+
+static constexpr uint32_t ByteSwap32(uint32_t value) {
+  return ((value << 24) & 0xff000000u) | ((value << 8) & 0x00ff0000u) |
+         ((value >> 8) & 0x0000ff00u) | ((value >> 24) & 0x000000ffu);
+}
+
+static constexpr uint64_t ByteSwap64(uint64_t value) {
+  return (static_cast<uint64_t>(ByteSwap32(static_cast<uint32_t>(value)))
+          << 32) |
+         ByteSwap32(static_cast<uint32_t>(value >> 32));
+}
+
+static uint32_t ReadLE32(const uint8_t* data) {
+  uint32_t value = 0;
+  ::memcpy(&value, data, sizeof(value));
+  if constexpr (std::endian::native == std::endian::big) {
+    value = ByteSwap32(value);
+  }
+  return value;
+}
+
+static uint64_t ReadLE64(const uint8_t* data) {
+  uint64_t value = 0;
+  ::memcpy(&value, data, sizeof(value));
+  if constexpr (std::endian::native == std::endian::big) {
+    value = ByteSwap64(value);
+  }
+  return value;
+}
+
+static void WriteLE64(uint8_t* data, uint64_t value) {
+  if constexpr (std::endian::native == std::endian::big) {
+    value = ByteSwap64(value);
+  }
+  ::memcpy(data, &value, sizeof(value));
+}
+
+static void Multiply64To128(uint64_t lhs,
+                            uint64_t rhs,
+                            uint64_t& low,
+                            uint64_t& high) {
+#if defined(__SIZEOF_INT128__)
+  const auto product = static_cast<unsigned __int128>(lhs) * rhs;
+  low = static_cast<uint64_t>(product);
+  high = static_cast<uint64_t>(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  low = _umul128(lhs, rhs, &high);
+#else
+  const uint64_t low_low = (lhs & 0xFFFFFFFFu) * (rhs & 0xFFFFFFFFu);
+  const uint64_t high_low = (lhs >> 32) * (rhs & 0xFFFFFFFFu);
+  const uint64_t low_high = (lhs & 0xFFFFFFFFu) * (rhs >> 32);
+  const uint64_t high_high = (lhs >> 32) * (rhs >> 32);
+  const uint64_t cross = (low_low >> 32) + (high_low & 0xFFFFFFFFu) + low_high;
+  high = (high_low >> 32) + (cross >> 32) + high_high;
+  low = (cross << 32) | (low_low & 0xFFFFFFFFu);
+#endif
+}
+
+static uint64_t Multiply128Fold64(uint64_t lhs, uint64_t rhs) {
+  uint64_t low = 0;
+  uint64_t high = 0;
+  Multiply64To128(lhs, rhs, low, high);
+  return low ^ high;
+}
+
+static constexpr uint64_t XorShift64(uint64_t value, int shift) {
+  return value ^ (value >> shift);
+}
+
+static constexpr uint64_t XXH64Avalanche(uint64_t value) {
+  value ^= value >> 33;
+  value *= kPrime64_2;
+  value ^= value >> 29;
+  value *= kPrime64_3;
+  value ^= value >> 32;
+  return value;
+}
+
+static constexpr uint64_t Avalanche(uint64_t value) {
+  value = XorShift64(value, 37);
+  value *= kPrimeMx1;
+  return XorShift64(value, 32);
+}
+
+static constexpr uint64_t StrongAvalanche(uint64_t value, uint64_t size) {
+  value ^= std::rotl(value, 49) ^ std::rotl(value, 24);
+  value *= kPrimeMx2;
+  value ^= (value >> 35) + size;
+  value *= kPrimeMx2;
+  return XorShift64(value, 28);
+}
+
+static uint64_t Mix16(const uint8_t* input,
+                      const uint8_t* secret,
+                      uint64_t seed) {
+  const auto input_low = ReadLE64(input);
+  const auto input_high = ReadLE64(input + 8);
+  return Multiply128Fold64(input_low ^ (ReadLE64(secret) + seed),
+                           input_high ^ (ReadLE64(secret + 8) - seed));
+}
+
+static void Mix32(uint64_t& low,
+                  uint64_t& high,
+                  const uint8_t* input_1,
+                  const uint8_t* input_2,
+                  const uint8_t* secret,
+                  uint64_t seed) {
+  low += Mix16(input_1, secret, seed);
+  low ^= ReadLE64(input_2) + ReadLE64(input_2 + 8);
+  high += Mix16(input_2, secret + 16, seed);
+  high ^= ReadLE64(input_1) + ReadLE64(input_1 + 8);
+}
+
+static void InitCustomSecret(uint8_t* secret, uint64_t seed) {
+  for (size_t i = 0; i < kSecretSize / 16u; i++) {
+    WriteLE64(secret + 16u * i, ReadLE64(kSecret + 16u * i) + seed);
+    WriteLE64(secret + 16u * i + 8u, ReadLE64(kSecret + 16u * i + 8u) - seed);
+  }
+}
+
+static void InitAccumulators(uint64_t* accumulators) {
+  accumulators[0] = kPrime32_3;
+  accumulators[1] = kPrime64_1;
+  accumulators[2] = kPrime64_2;
+  accumulators[3] = kPrime64_3;
+  accumulators[4] = kPrime64_4;
+  accumulators[5] = kPrime32_2;
+  accumulators[6] = kPrime64_5;
+  accumulators[7] = kPrime32_1;
+}
+
+static uint64_t MergeAccumulators(const uint64_t* accumulators,
+                                  const uint8_t* secret,
+                                  uint64_t start) {
+  auto result = start;
+  for (size_t i = 0; i < kAccumulatorCount / 2u; i++) {
+    result += Multiply128Fold64(
+        accumulators[2u * i] ^ ReadLE64(secret + 16u * i),
+        accumulators[2u * i + 1u] ^ ReadLE64(secret + 16u * i + 8u));
+  }
+  return Avalanche(result);
+}
+
+// *****************************************************************************
+// *** Kernels
+// *****************************************************************************
+
+// Accumulators are always 64-byte aligned. Input and secrets are not.
+struct Kernel {
+  void (*accumulate)(uint64_t* accumulators,
+                     const uint8_t* input,
+                     const uint8_t* secret,
+                     size_t stripes);
+  void (*scramble)(uint64_t* accumulators, const uint8_t* secret);
+};
+
+static inline void Accumulate512Scalar(uint64_t* accumulators,
+                                       const uint8_t* input,
+                                       const uint8_t* secret) {
+  for (size_t i = 0; i < kAccumulatorCount; i++) {
+    const auto data = ReadLE64(input + 8u * i);
+    const auto data_key = data ^ ReadLE64(secret + 8u * i);
+    accumulators[i ^ 1u] += data;
+    accumulators[i] += (data_key & 0xFFFFFFFFu) * (data_key >> 32);
+  }
+}
+
+static void AccumulateScalar(uint64_t* accumulators,
+                             const uint8_t* input,
+                             const uint8_t* secret,
+                             size_t stripes) {
+  for (size_t i = 0; i < stripes; i++) {
+    Accumulate512Scalar(accumulators, input + i * kStripeSize,
+                        secret + i * kSecretConsumeRate);
+  }
+}
+
+static void ScrambleScalar(uint64_t* accumulators, const uint8_t* secret) {
+  for (size_t i = 0; i < kAccumulatorCount; i++) {
+    auto accumulator = XorShift64(accumulators[i], 47);
+    accumulator ^= ReadLE64(secret + 8u * i);
+    accumulators[i] = accumulator * kPrime32_1;
+  }
+}
+
+#if P_HASH_SSE2
+static inline void Accumulate512SSE2(uint64_t* accumulators,
+                                     const uint8_t* input,
+                                     const uint8_t* secret) {
+  auto accumulator_vectors = reinterpret_cast<__m128i*>(accumulators);
+  auto input_vectors = reinterpret_cast<const __m128i*>(input);
+  auto secret_vectors = reinterpret_cast<const __m128i*>(secret);
+  for (size_t i = 0; i < kStripeSize / sizeof(__m128i); i++) {
+    const auto data = _mm_loadu_si128(input_vectors + i);
+    const auto key = _mm_loadu_si128(secret_vectors + i);
+    const auto data_key = _mm_xor_si128(data, key);
+    const auto data_key_high =
+        _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+    const auto product = _mm_mul_epu32(data_key, data_key_high);
+    const auto data_swap = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+    const auto sum =
+        _mm_add_epi64(_mm_load_si128(accumulator_vectors + i), data_swap);
+    _mm_store_si128(accumulator_vectors + i, _mm_add_epi64(product, sum));
+  }
+}
+
+static void AccumulateSSE2(uint64_t* accumulators,
+                           const uint8_t* input,
+                           const uint8_t* secret,
+                           size_t stripes) {
+  for (size_t i = 0; i < stripes; i++) {
+    Accumulate512SSE2(accumulators, input + i * kStripeSize,
+                      secret + i * kSecretConsumeRate);
+  }
+}
+
+static void ScrambleSSE2(uint64_t* accumulators, const uint8_t* secret) {
+  auto accumulator_vectors = reinterpret_cast<__m128i*>(accumulators);
+  auto secret_vectors = reinterpret_cast<const __m128i*>(secret);
+  const auto prime = _mm_set1_epi32(static_cast<int>(kPrime32_1));
+  for (size_t i = 0; i < kStripeSize / sizeof(__m128i); i++) {
+    const auto accumulator = _mm_load_si128(accumulator_vectors + i);
+    const auto data =
+        _mm_xor_si128(accumulator, _mm_srli_epi64(accumulator, 47));
+    const auto data_key =
+        _mm_xor_si128(data, _mm_loadu_si128(secret_vectors + i));
+    const auto data_key_high =
+        _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+    const auto product_low = _mm_mul_epu32(data_key, prime);
+    const auto product_high = _mm_mul_epu32(data_key_high, prime);
+    _mm_store_si128(
+        accumulator_vectors + i,
+        _mm_add_epi64(product_low, _mm_slli_epi64(product_high, 32)));
+  }
+}
+#endif  // P_HASH_SSE2
+
+#if P_HASH_AVX2
+P_HASH_AVX2_TARGET static inline void Accumulate512AVX2(
+    uint64_t* accumulators,
+    const uint8_t* input,
+    const uint8_t* secret) {
+  auto accumulator_vectors = reinterpret_cast<__m256i*>(accumulators);
+  auto input_vectors = reinterpret_cast<const __m256i*>(input);
+  auto secret_vectors = reinterpret_cast<const __m256i*>(secret);
+  for (size_t i = 0; i < kStripeSize / sizeof(__m256i); i++) {
+    const auto data = _mm256_loadu_si256(input_vectors + i);
+    const auto key = _mm256_loadu_si256(secret_vectors + i);
+    const auto data_key = _mm256_xor_si256(data, key);
+    const auto data_key_high = _mm256_srli_epi64(data_key, 32);
+    const auto product = _mm256_mul_epu32(data_key, data_key_high);
+    const auto data_swap =
+        _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+    const auto sum =
+        _mm256_add_epi64(_mm256_load_si256(accumulator_vectors + i), data_swap);
+    _mm256_store_si256(accumulator_vectors + i,
+                       _mm256_add_epi64(product, sum));
+  }
+}
+
+P_HASH_AVX2_TARGET static void AccumulateAVX2(uint64_t* accumulators,
+                                              const uint8_t* input,
+                                              const uint8_t* secret,
+                                              size_t stripes) {
+  for (size_t i = 0; i < stripes; i++) {
+    Accumulate512AVX2(accumulators, input + i * kStripeSize,
+                      secret + i * kSecretConsumeRate);
+  }
+}
+
+P_HASH_AVX2_TARGET static void ScrambleAVX2(uint64_t* accumulators,
+                                            const uint8_t* secret) {
+  auto accumulator_vectors = reinterpret_cast<__m256i*>(accumulators);
+  auto secret_vectors = reinterpret_cast<const __m256i*>(secret);
+  const auto prime = _mm256_set1_epi32(static_cast<int>(kPrime32_1));
+  for (size_t i = 0; i < kStripeSize / sizeof(__m256i); i++) {
+    const auto accumulator = _mm256_load_si256(accumulator_vectors + i);
+    const auto data =
+        _mm256_xor_si256(accumulator, _mm256_srli_epi64(accumulator, 47));
+    const auto data_key =
+        _mm256_xor_si256(data, _mm256_loadu_si256(secret_vectors + i));
+    const auto data_key_high = _mm256_srli_epi64(data_key, 32);
+    const auto product_low = _mm256_mul_epu32(data_key, prime);
+    const auto product_high = _mm256_mul_epu32(data_key_high, prime);
+    _mm256_store_si256(
+        accumulator_vectors + i,
+        _mm256_add_epi64(product_low, _mm256_slli_epi64(product_high, 32)));
+  }
+}
+#endif  // P_HASH_AVX2
+
+#if P_HASH_NEON
+static inline void Accumulate512NEON(uint64_t* accumulators,
+                                     const uint8_t* input,
+                                     const uint8_t* secret) {
+  for (size_t i = 0; i < kAccumulatorCount / 2u; i++) {
+    const auto data = vreinterpretq_u64_u8(vld1q_u8(input + 16u * i));
+    const auto key = vreinterpretq_u64_u8(vld1q_u8(secret + 16u * i));
+    const auto data_swap = vextq_u64(data, data, 1);
+    const auto data_key = veorq_u64(data, key);
+    const auto sum = vmlal_u32(data_swap, vmovn_u64(data_key),
+                               vshrn_n_u64(data_key, 32));
+    vst1q_u64(accumulators + 2u * i,
+              vaddq_u64(vld1q_u64(accumulators + 2u * i), sum));
+  }
+}
+
+static void AccumulateNEON(uint64_t* accumulators,
+                           const uint8_t* input,
+                           const uint8_t* secret,
+                           size_t stripes) {
+  for (size_t i = 0; i < stripes; i++) {
+    Accumulate512NEON(accumulators, input + i * kStripeSize,
+                      secret + i * kSecretConsumeRate);
+  }
+}
+
+static void ScrambleNEON(uint64_t* accumulators, const uint8_t* secret) {
+  const auto prime = vdup_n_u32(kPrime32_1);
+  for (size_t i = 0; i < kAccumulatorCount / 2u; i++) {
+    const auto accumulator = vld1q_u64(accumulators + 2u * i);
+    const auto data = veorq_u64(accumulator, vshrq_n_u64(accumulator, 47));
+    const auto data_key =
+        veorq_u64(data, vreinterpretq_u64_u8(vld1q_u8(secret + 16u * i)));
+    // The low 64 bits of the product of the 64-bit lane and the 32-bit prime.
+    const auto product_high =
+        vshlq_n_u64(vmull_u32(vshrn_n_u64(data_key, 32), prime), 32);
+    vst1q_u64(accumulators + 2u * i,
+              vmlal_u32(product_high, vmovn_u64(data_key), prime));
+  }
+}
+#endif  // P_HASH_NEON
+
+static bool IsHashKernelSupported(HashKernel kernel) {
+  switch (kernel) {
+    case HashKernel::kHashKernelScalar:
+      return true;
+    case HashKernel::kHashKernelSSE2:
+#if P_HASH_SSE2
+      return true;
+#else   // P_HASH_SSE2
+      return false;
+#endif  // P_HASH_SSE2
+    case HashKernel::kHashKernelAVX2:
+#if P_HASH_AVX2 && defined(__GNUC__)
+      return __builtin_cpu_supports("avx2");
+#elif P_HASH_AVX2
+      return true;
+#else   // P_HASH_AVX2
+      return false;
+#endif  // P_HASH_AVX2
+    case HashKernel::kHashKernelNEON:
+#if P_HASH_NEON
+      return true;
+#else   // P_HASH_NEON
+      return false;
+#endif  // P_HASH_NEON
+  }
+  return false;
+}
+
+std::vector<HashKernel> GetSupportedHashKernels() {
+  std::vector<HashKernel> kernels;
+  for (auto kernel :
+       {HashKernel::kHashKernelScalar, HashKernel::kHashKernelSSE2,
+        HashKernel::kHashKernelAVX2, HashKernel::kHashKernelNEON}) {
+    if (IsHashKernelSupported(kernel)) {
+      kernels.push_back(kernel);
+    }
+  }
+  return kernels;
+}
+
+HashKernel GetPreferredHashKernel() {
+  static const HashKernel kernel = []() {
+    for (auto kernel :
+         {HashKernel::kHashKernelAVX2, HashKernel::kHashKernelNEON,
+          HashKernel::kHashKernelSSE2}) {
+      if (IsHashKernelSupported(kernel)) {
+        return kernel;
+      }
+    }
+    return HashKernel::kHashKernelScalar;
+  }();
+  return kernel;
+}
+
+// Kernels that are not supported fall back to the scalar kernel.
+static Kernel GetKernel(HashKernel kernel) {
+  if (IsHashKernelSupported(kernel)) {
+    switch (kernel) {
+      case HashKernel::kHashKernelScalar:
+        break;
+#if P_HASH_SSE2
+      case HashKernel::kHashKernelSSE2:
+        return {AccumulateSSE2, ScrambleSSE2};
+#endif  // P_HASH_SSE2
+#if P_HASH_AVX2
+      case HashKernel::kHashKernelAVX2:
+        return {AccumulateAVX2, ScrambleAVX2};
+#endif  // P_HASH_AVX2
+#if P_HASH_NEON
+      case HashKernel::kHashKernelNEON:
+        return {AccumulateNEON, ScrambleNEON};
+#endif  // P_HASH_NEON
+      default:
+        break;
+    }
+  }
+  return {AccumulateScalar, ScrambleScalar};
+}
+
+// *****************************************************************************
+// *** Inputs of up to 240 bytes
+// *****************************************************************************
+
+static uint64_t Hash64Size1To3(const uint8_t* input,
+                               size_t size,
+                               const uint8_t* secret,
+                               uint64_t seed) {
+  const uint32_t combined = (static_cast<uint32_t>(input[0]) << 16) |
+                            (static_cast<uint32_t>(input[size >> 1]) << 24) |
+                            static_cast<uint32_t>(input[size - 1]) |
+                            (static_cast<uint32_t>(size) << 8);
+  const uint64_t flip = (ReadLE32(secret) ^ ReadLE32(secret + 4)) + seed;
+  return XXH64Avalanche(combined ^ flip);
+}
+
+static uint64_t Hash64Size4To8(const uint8_t* input,
+                               size_t size,
+                               const uint8_t* secret,
+                               uint64_t seed) {
+  seed ^= static_cast<uint64_t>(ByteSwap32(static_cast<uint32_t>(seed))) << 32;
+  const uint64_t input_1 = ReadLE32(input);
+  const uint64_t input_2 = ReadLE32(input + size - 4);
+  const auto flip = (ReadLE64(secret + 8) ^ ReadLE64(secret + 16)) - seed;
+  const auto input_64 = input_2 + (input_1 << 32);
+  return StrongAvalanche(input_64 ^ flip, size);
+}
+
+static uint64_t Hash64Size9To16(const uint8_t* input,
+                                size_t size,
+                                const uint8_t* secret,
+                                uint64_t seed) {
+  const auto flip_1 = (ReadLE64(secret + 24) ^ ReadLE64(secret + 32)) + seed;
+  const auto flip_2 = (ReadLE64(secret + 40) ^ ReadLE64(secret + 48)) - seed;
+  const auto input_low = ReadLE64(input) ^ flip_1;
+  const auto input_high = ReadLE64(input + size - 8) ^ flip_2;
+  const auto accumulator = size + ByteSwap64(input_low) + input_high +
+                           Multiply128Fold64(input_low, input_high);
+  return Avalanche(accumulator);
+}
+
+static uint64_t Hash64Size17To128(const uint8_t* input,
+                                  size_t size,
+                                  const uint8_t* secret,
+                                  uint64_t seed) {
+  uint64_t accumulator = size * kPrime64_1;
+  if (size > 32) {
+    if (size > 64) {
+      if (size > 96) {
+        accumulator += Mix16(input + 48, secret + 96, seed);
+        accumulator += Mix16(input + size - 64, secret + 112, seed);
+      }
+      accumulator += Mix16(input + 32, secret + 64, seed);
+      accumulator += Mix16(input + size - 48, secret + 80, seed);
+    }
+    accumulator += Mix16(input + 16, secret + 32, seed);
+    accumulator += Mix16(input + size - 32, secret + 48, seed);
+  }
+  accumulator += Mix16(input, secret, seed);
+  accumulator += Mix16(input + size - 16, secret + 16, seed);
+  return Avalanche(accumulator);
+}
+
+static uint64_t Hash64Size129To240(const uint8_t* input,
+                                   size_t size,
+                                   const uint8_t* secret,
+                                   uint64_t seed) {
+  constexpr size_t kStartOffset = 3u;
+  constexpr size_t kLastOffset = 17u;
+  uint64_t accumulator = size * kPrime64_1;
+  const size_t rounds = size / 16u;
+  for (size_t i = 0; i < 8u; i++) {
+    accumulator += Mix16(input + 16u * i, secret + 16u * i, seed);
+  }
+  accumulator = Avalanche(accumulator);
+  for (size_t i = 8u; i < rounds; i++) {
+    accumulator +=
+        Mix16(input + 16u * i, secret + 16u * (i - 8u) + kStartOffset, seed);
+  }
+  accumulator += Mix16(input + size - 16u,
+                       secret + kSecretSizeMin - kLastOffset, seed);
+  return Avalanche(accumulator);
+}
+
+static uint64_t Hash64Short(const uint8_t* input,
+                            size_t size,
+                            const uint8_t* secret,
+                            uint64_t seed) {
+  if (size > 128u) {
+    return Hash64Size129To240(input, size, secret, seed);
+  }
+  if (size > 16u) {
+    return Hash64Size17To128(input, size, secret, seed);
+  }
+  if (size > 8u) {
+    return Hash64Size9To16(input, size, secret, seed);
+  }
+  if (size >= 4u) {
+    return Hash64Size4To8(input, size, secret, seed);
+  }
+  if (size > 0u) {
+    return Hash64Size1To3(input, size, secret, seed);
+  }
+  return XXH64Avalanche(seed ^ ReadLE64(secret + 56) ^ ReadLE64(secret + 64));
+}
+
+static Hash128 Hash128Size1To3(const uint8_t* input,
+                               size_t size,
+                               const uint8_t* secret,
+                               uint64_t seed) {
+  const uint32_t combined_low =
+      (static_cast<uint32_t>(input[0]) << 16) |
+      (static_cast<uint32_t>(input[size >> 1]) << 24) |
+      static_cast<uint32_t>(input[size - 1]) |
+      (static_cast<uint32_t>(size) << 8);
+  const uint32_t combined_high = std::rotl(ByteSwap32(combined_low), 13);
+  const uint64_t flip_low = (ReadLE32(secret) ^ ReadLE32(secret + 4)) + seed;
+  const uint64_t flip_high =
+      (ReadLE32(secret + 8) ^ ReadLE32(secret + 12)) - seed;
+  return {XXH64Avalanche(combined_low ^ flip_low),
+          XXH64Avalanche(combined_high ^ flip_high)};
+}
+
+static Hash128 Hash128Size4To8(const uint8_t* input,
+                               size_t size,
+                               const uint8_t* secret,
+                               uint64_t seed) {
+  seed ^= static_cast<uint64_t>(ByteSwap32(static_cast<uint32_t>(seed))) << 32;
+  const uint64_t input_low = ReadLE32(input);
+  const uint64_t input_high = ReadLE32(input + size - 4);
+  const auto input_64 = input_low + (input_high << 32);
+  const auto flip = (ReadLE64(secret + 16) ^ ReadLE64(secret + 24)) + seed;
+  uint64_t low = 0;
+  uint64_t high = 0;
+  Multiply64To128(input_64 ^ flip, kPrime64_1 + (size << 2), low, high);
+  high += low << 1;
+  low ^= high >> 3;
+  low = XorShift64(low, 35) * kPrimeMx2;
+  low = XorShift64(low, 28);
+  return {low, Avalanche(high)};
+}
+
+static Hash128 Hash128Size9To16(const uint8_t* input,
+                                size_t size,
+                                const uint8_t* secret,
+                                uint64_t seed) {
+  const auto flip_low = (ReadLE64(secret + 32) ^ ReadLE64(secret + 40)) - seed;
+  const auto flip_high =
+      (ReadLE64(secret + 48) ^ ReadLE64(secret + 56)) + seed;
+  const auto input_low = ReadLE64(input);
+  auto input_high = ReadLE64(input + size - 8);
+  uint64_t multiply_low = 0;
+  uint64_t multiply_high = 0;
+  Multiply64To128(input_low ^ input_high ^ flip_low, kPrime64_1, multiply_low,
+                  multiply_high);
+  multiply_low += static_cast<uint64_t>(size - 1) << 54;
+  input_high ^= flip_high;
+  multiply_high +=
+      input_high + (input_high & 0xFFFFFFFFu) * (kPrime32_2 - 1u);
+  multiply_low ^= ByteSwap64(multiply_high);
+  uint64_t result_low = 0;
+  uint64_t result_high = 0;
+  Multiply64To128(multiply_low, kPrime64_2, result_low, result_high);
+  result_high += multiply_high * kPrime64_2;
+  return {Avalanche(result_low), Avalanche(result_high)};
+}
+
+static Hash128 FinishHash128Mid(uint64_t low,
+                                uint64_t high,
+                                size_t size,
+                                uint64_t seed) {
+  return {Avalanche(low + high),
+          0u - Avalanche(low * kPrime64_1 + high * kPrime64_4 +
+                         (size - seed) * kPrime64_2)};
+}
+
+static Hash128 Hash128Size17To128(const uint8_t* input,
+                                  size_t size,
+                                  const uint8_t* secret,
+                                  uint64_t seed) {
+  uint64_t low = size * kPrime64_1;
+  uint64_t high = 0;
+  if (size > 32) {
+    if (size > 64) {
+      if (size > 96) {
+        Mix32(low, high, input + 48, input + size - 64, secret + 96, seed);
+      }
+      Mix32(low, high, input + 32, input + size - 48, secret + 64, seed);
+    }
+    Mix32(low, high, input + 16, input + size - 32, secret + 32, seed);
+  }
+  Mix32(low, high, input, input + size - 16, secret, seed);
+  return FinishHash128Mid(low, high, size, seed);
+}
+
+static Hash128 Hash128Size129To240(const uint8_t* input,
+                                   size_t size,
+                                   const uint8_t* secret,
+                                   uint64_t seed) {
+  constexpr size_t kStartOffset = 3u;
+  constexpr size_t kLastOffset = 17u;
+  const size_t rounds = size / 32u;
+  uint64_t low = size * kPrime64_1;
+  uint64_t high = 0;
+  for (size_t i = 0; i < 4u; i++) {
+    Mix32(low, high, input + 32u * i, input + 32u * i + 16u, secret + 32u * i,
+          seed);
+  }
+  low = Avalanche(low);
+  high = Avalanche(high);
+  for (size_t i = 4u; i < rounds; i++) {
+    Mix32(low, high, input + 32u * i, input + 32u * i + 16u,
+          secret + kStartOffset + 32u * (i - 4u), seed);
+  }
+  Mix32(low, high, input + size - 16u, input + size - 32u,
+        secret + kSecretSizeMin - kLastOffset - 16u, 0u - seed);
+  return FinishHash128Mid(low, high, size, seed);
+}
+
+static Hash128 Hash128Short(const uint8_t* input,
+                            size_t size,
+                            const uint8_t* secret,
+                            uint64_t seed) {
+  if (size > 128u) {
+    return Hash128Size129To240(input, size, secret, seed);
+  }
+  if (size > 16u) {
+    return Hash128Size17To128(input, size, secret, seed);
+  }
+  if (size > 8u) {
+    return Hash128Size9To16(input, size, secret, seed);
+  }
+  if (size >= 4u) {
+    return Hash128Size4To8(input, size, secret, seed);
+  }
+  if (size > 0u) {
+    return Hash128Size1To3(input, size, secret, seed);
+  }
+  return {XXH64Avalanche(seed ^ ReadLE64(secret + 64) ^ ReadLE64(secret + 72)),
+          XXH64Avalanche(seed ^ ReadLE64(secret + 80) ^ ReadLE64(secret + 88))};
+}
+
+// *****************************************************************************
+// *** Inputs of more than 240 bytes
+// *****************************************************************************
+
+static void HashLong(uint64_t* accumulators,
+                     const uint8_t* input,
+                     size_t size,
+                     const uint8_t* secret,
+                     const Kernel& kernel) {
+  constexpr size_t kBlockSize = kStripeSize * kStripesPerBlock;
+  const size_t blocks = (size - 1u) / kBlockSize;
+  for (size_t i = 0; i < blocks; i++) {
+    kernel.accumulate(accumulators, input + i * kBlockSize, secret,
+                      kStripesPerBlock);
+    kernel.scramble(accumulators, secret + kSecretSize - kStripeSize);
+  }
+  const size_t stripes = ((size - 1u) - kBlockSize * blocks) / kStripeSize;
+  kernel.accumulate(accumulators, input + blocks * kBlockSize, secret, stripes);
+  kernel.accumulate(accumulators, input + size - kStripeSize,
+                    secret + kSecretSize - kStripeSize - kSecretLastStripeStart,
+                    1u);
+}
+
+static uint64_t Digest64Long(const uint64_t* accumulators,
+                             const uint8_t* secret,
+                             uint64_t size) {
+  return MergeAccumulators(accumulators, secret + kSecretMergeStart,
+                           size * kPrime64_1);
+}
+
+static Hash128 Digest128Long(const uint64_t* accumulators,
+                             const uint8_t* secret,
+                             uint64_t size) {
+  return {
+      MergeAccumulators(accumulators, secret + kSecretMergeStart,
+                        size * kPrime64_1),
+      MergeAccumulators(
+          accumulators,
+          secret + kSecretSize - sizeof(uint64_t) * kAccumulatorCount -
+              kSecretMergeStart,
+          ~(size * kPrime64_2)),
+  };
+}
+
+// *****************************************************************************
+// *** Public API
+// *****************************************************************************
+
+std::string Hash128::ToString() const {
+  constexpr char kDigits[] = "0123456789abcdef";
+  std::string string(32u, '0');
+  for (size_t i = 0; i < 16u; i++) {
+    string[15u - i] = kDigits[(high >> (4u * i)) & 0xFu];
+    string[31u - i] = kDigits[(low >> (4u * i)) & 0xFu];
+  }
+  return string;
+}
+
+uint64_t HashBytes64(const void* data, size_t size, uint64_t seed) {
+  return HashBytes64(data, size, seed, GetPreferredHashKernel());
+}
+
+uint64_t HashBytes64(const void* data,
+                     size_t size,
+                     uint64_t seed,
+                     HashKernel kernel) {
+  const auto input = static_cast<const uint8_t*>(data);
+  if (size <= kMidSizeMax) {
+    return Hash64Short(input, size, kSecret, seed);
+  }
+  alignas(64) uint8_t custom_secret[kSecretSize];
+  const uint8_t* secret = kSecret;
+  if (seed != 0u) {
+    InitCustomSecret(custom_secret, seed);
+    secret = custom_secret;
+  }
+  alignas(64) uint64_t accumulators[kAccumulatorCount];
+  InitAccumulators(accumulators);
+  HashLong(accumulators, input, size, secret, GetKernel(kernel));
+  return Digest64Long(accumulators, secret, size);
+}
+
+Hash128 HashBytes128(const void* data, size_t size, uint64_t seed) {
+  return HashBytes128(data, size, seed, GetPreferredHashKernel());
+}
+
+Hash128 HashBytes128(const void* data,
+                     size_t size,
+                     uint64_t seed,
+                     HashKernel kernel) {
+  const auto input = static_cast<const uint8_t*>(data);
+  if (size <= kMidSizeMax) {
+    return Hash128Short(input, size, kSecret, seed);
+  }
+  alignas(64) uint8_t custom_secret[kSecretSize];
+  const uint8_t* secret = kSecret;
+  if (seed != 0u) {
+    InitCustomSecret(custom_secret, seed);
+    secret = custom_secret;
+  }
+  alignas(64) uint64_t accumulators[kAccumulatorCount];
+  InitAccumulators(accumulators);
+  HashLong(accumulators, input, size, secret, GetKernel(kernel));
+  return Digest128Long(accumulators, secret, size);
+}
+
+uint64_t HashMapping64(const Mapping& mapping, uint64_t seed) {
+  return HashBytes64(mapping.GetData(), mapping.GetSize(), seed);
+}
+
+Hash128 HashMapping128(const Mapping& mapping, uint64_t seed) {
+  return HashBytes128(mapping.GetData(), mapping.GetSize(), seed);
+}
+
+// *****************************************************************************
+// *** ContentHasher
+// *****************************************************************************
+
+static_assert(kStripeSize * 4u == 256u);
+
+ContentHasher::ContentHasher(uint64_t seed)
+    : ContentHasher(seed, GetPreferredHashKernel()) {}
+
+ContentHasher::ContentHasher(uint64_t seed, HashKernel kernel)
+    : seed_(seed), kernel_(kernel) {
+  if (seed_ == 0u) {
+    ::memcpy(secret_, kSecret, kSecretSize);
+  } else {
+    InitCustomSecret(secret_, seed_);
+  }
+  Reset();
+}
+
+ContentHasher::~ContentHasher() = default;
+
+void ContentHasher::Reset() {
+  InitAccumulators(accumulators_);
+  buffered_size_ = 0;
+  stripes_accumulated_ = 0;
+  total_size_ = 0;
+}
+
+void ContentHasher::ConsumeStripes(uint64_t* accumulators,
+                                   size_t& stripes_accumulated,
+                                   const uint8_t* input,
+                                   size_t stripes) const {
+  const auto kernel = GetKernel(kernel_);
+  if (kStripesPerBlock - stripes_accumulated <= stripes) {
+    // Finish the block, scramble, and start the next block.
+    const auto stripes_to_end = kStripesPerBlock - stripes_accumulated;
+    const auto stripes_after_end = stripes - stripes_to_end;
+    kernel.accumulate(accumulators, input,
+                      secret_ + stripes_accumulated * kSecretConsumeRate,
+                      stripes_to_end);
+    kernel.scramble(accumulators, secret_ + kSecretSize - kStripeSize);
+    kernel.accumulate(accumulators, input + stripes_to_end * kStripeSize,
+                      secret_, stripes_after_end);
+    stripes_accumulated = stripes_after_end;
+  } else {
+    kernel.accumulate(accumulators, input,
+                      secret_ + stripes_accumulated * kSecretConsumeRate,
+                      stripes);
+    stripes_accumulated += stripes;
+  }
+}
+
+void ContentHasher::Update(const void* data, size_t size) {
+  constexpr size_t kBufferStripes = kBufferSize / kStripeSize;
+  auto input = static_cast<const uint8_t*>(data);
+  total_size_ += size;
+
+  if (buffered_size_ + size <= kBufferSize) {
+    if (size > 0u) {
+      ::memcpy(buffer_ + buffered_size_, input, size);
+    }
+    buffered_size_ += size;
+    return;
+  }
+
+  // The buffer is only consumed once more input arrives. That way, the final
+  // stripe is always in the buffer when digesting.
+  if (buffered_size_ > 0u) {
+    const auto fill_size = kBufferSize - buffered_size_;
+    ::memcpy(buffer_ + buffered_size_, input, fill_size);
+    input += fill_size;
+    size -= fill_size;
+    ConsumeStripes(accumulators_, stripes_accumulated_, buffer_,
+                   kBufferStripes);
+    buffered_size_ = 0u;
+  }
+
+  if (size > kBufferSize) {
+    do {
+      ConsumeStripes(accumulators_, stripes_accumulated_, input,
+                     kBufferStripes);
+      input += kBufferSize;
+      size -= kBufferSize;
+    } while (size > kBufferSize);
+    // Keep the last stripe consumed in case the final stripe needs it.
+    ::memcpy(buffer_ + kBufferSize - kStripeSize, input - kStripeSize,
+             kStripeSize);
+  }
+
+  ::memcpy(buffer_, input, size);
+  buffered_size_ = size;
+}
+
+void ContentHasher::Update(const Mapping& mapping) {
+  Update(mapping.GetData(), mapping.GetSize());
+}
+
+void ContentHasher::DigestLong(uint64_t* accumulators) const {
+  ::memcpy(accumulators, accumulators_, sizeof(accumulators_));
+  const auto kernel = GetKernel(kernel_);
+  const auto last_stripe_secret =
+      secret_ + kSecretSize - kStripeSize - kSecretLastStripeStart;
+  if (buffered_size_ >= kStripeSize) {
+    auto stripes_accumulated = stripes_accumulated_;
+    ConsumeStripes(accumulators, stripes_accumulated, buffer_,
+                   (buffered_size_ - 1u) / kStripeSize);
+    kernel.accumulate(accumulators, buffer_ + buffered_size_ - kStripeSize,
+                      last_stripe_secret, 1u);
+  } else {
+    // The final stripe overlaps input that has already been consumed.
+    uint8_t last_stripe[kStripeSize];
+    const auto catch_up_size = kStripeSize - buffered_size_;
+    ::memcpy(last_stripe, buffer_ + kBufferSize - catch_up_size,
+             catch_up_size);
+    ::memcpy(last_stripe + catch_up_size, buffer_, buffered_size_);
+    kernel.accumulate(accumulators, last_stripe, last_stripe_secret, 1u);
+  }
+}
+
+uint64_t ContentHasher::Digest64() const {
+  if (total_size_ <= kMidSizeMax) {
+    return Hash64Short(buffer_, total_size_, kSecret, seed_);
+  }
+  alignas(64) uint64_t accumulators[kAccumulatorCount];
+  DigestLong(accumulators);
+  return Digest64Long(accumulators, secret_, total_size_);
+}
+
+Hash128 ContentHasher::Digest128() const {
+  if (total_size_ <= kMidSizeMax) {
+    return Hash128Short(buffer_, total_size_, kSecret, seed_);
+  }
+  alignas(64) uint64_t accumulators[kAccumulatorCount];
+  DigestLong(accumulators);
+  return Digest128Long(accumulators, secret_, total_size_);
+}
+
+}  // namespace pixel
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "macros.h"
+#include "mapping.h"
+
+namespace pixel {
+
+//------------------------------------------------------------------------------
+/// @brief      Content hashes are XXH3. They are the same on all platforms and
+///             across processes, so they may be used to key data on disk. They
+///             are not cryptographic.
+///
+struct Hash128 {
+  uint64_t low = 0;
+  uint64_t high = 0;
+
+  constexpr bool operator==(const Hash128& other) const = default;
+
+  //----------------------------------------------------------------------------
+  /// @brief      The hash as 32 hex digits, high half first. This matches the
+  ///             canonical representation of XXH3 128-bit hashes.
+  ///
+  std::string ToString() const;
+};
+
+//------------------------------------------------------------------------------
+/// @brief      The implementation of the inner loop used for inputs larger than
+///             240 bytes. All kernels produce the same hashes.
+///
+enum class HashKernel {
+  kHashKernelScalar,
+  kHashKernelSSE2,
+  kHashKernelAVX2,
+  kHashKernelNEON,
+};
+
+//------------------------------------------------------------------------------
+/// @brief      The kernels that can be used on this machine. The scalar kernel
+///             is always supported.
+///
+std::vector<HashKernel> GetSupportedHashKernels();
+
+//------------------------------------------------------------------------------
+/// @brief      The fastest kernel supported on this machine. This is the
+///             kernel used unless one is specified.
+///
+HashKernel GetPreferredHashKernel();
+
+uint64_t HashBytes64(const void* data, size_t size, uint64_t seed = 0u);
+
+uint64_t HashBytes64(const void* data,
+                     size_t size,
+                     uint64_t seed,
+                     HashKernel kernel);
+
+Hash128 HashBytes128(const void* data, size_t size, uint64_t seed = 0u);
+
+Hash128 HashBytes128(const void* data,
+                     size_t size,
+                     uint64_t seed,
+                     HashKernel kernel);
+
+uint64_t HashMapping64(const Mapping& mapping, uint64_t seed = 0u);
+
+Hash128 HashMapping128(const Mapping& mapping, uint64_t seed = 0u);
+
+//------------------------------------------------------------------------------
+/// @brief      Hashes input that arrives in pieces. The digests are the same as
+///             the hash of all the pieces concatenated.
+///
+class ContentHasher {
+ public:
+  ContentHasher(uint64_t seed = 0u);
+
+  ContentHasher(uint64_t seed, HashKernel kernel);
+
+  ~ContentHasher();
+
+  void Reset();
+
+  void Update(const void* data, size_t size);
+
+  void Update(const Mapping& mapping);
+
+  uint64_t Digest64() const;
+
+  Hash128 Digest128() const;
+
+ private:
+  static constexpr size_t kSecretSize = 192u;
+  static constexpr size_t kBufferSize = 256u;
+
+  alignas(64) uint64_t accumulators_[8];
+  alignas(64) uint8_t secret_[kSecretSize];
+  alignas(64) uint8_t buffer_[kBufferSize];
+  size_t buffered_size_ = 0;
+  size_t stripes_accumulated_ = 0;
+  uint64_t total_size_ = 0;
+  const uint64_t seed_;
+  const HashKernel kernel_;
+
+  void ConsumeStripes(uint64_t* accumulators,
+                      size_t& stripes_accumulated,
+                      const uint8_t* input,
+                      size_t stripes) const;
+
+  void DigestLong(uint64_t* accumulators) const;
+
+  P_DISALLOW_COPY_AND_ASSIGN(ContentHasher);
+};
+
+}  // namespace pixel
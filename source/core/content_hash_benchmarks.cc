@@ -0,0 +1,65 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
+#include "content_hash.h"
+
+namespace pixel {
+namespace testing {
+
+static std::vector<uint8_t> CreateHashInput(size_t size) {
+  std::vector<uint8_t> input(size);
+  for (size_t i = 0; i < size; i++) {
+    input[i] = static_cast<uint8_t>(i * 131u + 7u);
+  }
+  return input;
+}
+
+static void BM_HashBytes64(benchmark::State& state, HashKernel kernel) {
+  const auto supported = GetSupportedHashKernels();
+  if (std::find(supported.begin(), supported.end(), kernel) ==
+      supported.end()) {
+    state.SkipWithError("The kernel is not supported on this machine.");
+    return;
+  }
+  const auto input = CreateHashInput(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        HashBytes64(input.data(), input.size(), 0u, kernel));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_CAPTURE(BM_HashBytes64, Scalar, HashKernel::kHashKernelScalar)
+    ->Range(16, 16 << 20);
+BENCHMARK_CAPTURE(BM_HashBytes64, SSE2, HashKernel::kHashKernelSSE2)
+    ->Range(16, 16 << 20);
+BENCHMARK_CAPTURE(BM_HashBytes64, AVX2, HashKernel::kHashKernelAVX2)
+    ->Range(16, 16 << 20);
+BENCHMARK_CAPTURE(BM_HashBytes64, NEON, HashKernel::kHashKernelNEON)
+    ->Range(16, 16 << 20);
+
+static void BM_HashBytes128(benchmark::State& state) {
+  const auto input = CreateHashInput(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(HashBytes128(input.data(), input.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HashBytes128)->Range(16, 16 << 20);
+
+// The baseline the content hashes are compared against.
+static void BM_StdHashStringView(benchmark::State& state) {
+  const auto input = CreateHashInput(static_cast<size_t>(state.range(0)));
+  const std::string_view view(reinterpret_cast<const char*>(input.data()),
+                              input.size());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(std::hash<std::string_view>{}(view));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StdHashStringView)->Range(16, 16 << 20);
+
+}  // namespace testing
+}  // namespace pixel
@@ -0,0 +1,246 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "content_hash.h"
+
+namespace pixel {
+namespace testing {
+
+static std::vector<uint8_t> CreateData(size_t size) {
+  std::vector<uint8_t> data(size);
+  for (size_t i = 0; i < size; i++) {
+    data[i] = static_cast<uint8_t>(i * 31u + (i >> 8) * 7u + 11u);
+  }
+  return data;
+}
+
+struct KnownHash {
+  size_t size = 0;
+  uint64_t seed = 0;
+  uint64_t hash_64 = 0;
+  Hash128 hash_128;
+};
+
+static constexpr uint64_t kSeed = 0x9E3779B97F4A7C15u;
+
+// From the reference XXH3 implementation.
+static const KnownHash kKnownHashes[] = {
+    {0u, 0u, 0x2d06800538d394c2u,
+     {0x6001c324468d497fu, 0x99aa06d3014798d8u}},
+    {0u, kSeed, 0x602b0e2cd6662c8bu,
+     {0x4ca5176998171787u, 0xd142977a2cca554bu}},
+    {1u, 0u, 0x4a4139caf4136257u,
+     {0x4a4139caf4136257u, 0x885f487031a56968u}},
+    {1u, kSeed, 0x323b4ad10b790c38u,
+     {0x323b4ad10b790c38u, 0x42adf4525a8455bbu}},
+    {3u, 0u, 0x23ec710a31c5e770u,
+     {0x23ec710a31c5e770u, 0xeabf60b54409c780u}},
+    {3u, kSeed, 0x6d05f8ff49dc073eu,
+     {0x6d05f8ff49dc073eu, 0x9dfd29efe655bb88u}},
+    {4u, 0u, 0xf4363e724d92bb05u,
+     {0x7eb4a1c7b2c1251du, 0x1a6a138f5da32aebu}},
+    {4u, kSeed, 0x377d025ba5de7802u,
+     {0x04f69654c266fd8bu, 0x271b60eb281a4774u}},
+    {8u, 0u, 0x08dc7c277fa2e559u,
+     {0xbd32be9ec38d8b92u, 0xafd288e5bb232c2bu}},
+    {8u, kSeed, 0x281b13346f59b7dcu,
+     {0xed0ff7c829391b30u, 0xcd12daed0da15ff3u}},
+    {9u, 0u, 0x431da44883c907dau,
+     {0x25c9441c87083534u, 0x6d548a21ad5a1988u}},
+    {9u, kSeed, 0x5b984d2f010c7312u,
+     {0xf6639938b7bf7792u, 0x6a997fef3caf4e1au}},
+    {16u, 0u, 0x7dd75adf86947281u,
+     {0x5ed5b0d00a12cd7bu, 0xdff2588709abb0bau}},
+    {16u, kSeed, 0x4d8834fcb7559cedu,
+     {0x182ceba5fa41a685u, 0xf309b84bd3962d50u}},
+    {17u, 0u, 0x1317dbd807b39570u,
+     {0xe73f5a08f59effb0u, 0xa8883d22dd91ba7cu}},
+    {17u, kSeed, 0x0dda120f11bef82fu,
+     {0x5ce01de410e752c8u, 0x02c3c4ec67402d2bu}},
+    {32u, 0u, 0xe41f3014fa9fdb70u,
+     {0x9339a587210c636eu, 0x9b59851567e01b87u}},
+    {32u, kSeed, 0x9af61d4172e0b17du,
+     {0x04dccc74fe6fd80fu, 0x859f09e5c5206d86u}},
+    {33u, 0u, 0xa48cfb6e0ba527e4u,
+     {0x0d003c03b40935bbu, 0x681751360b3d9bc6u}},
+    {33u, kSeed, 0x5587712cf471ddd9u,
+     {0xd23a9b2a987e4754u, 0x65be6a09c38dfa33u}},
+    {64u, 0u, 0xba6ac3b7d4e8960au,
+     {0x88020be815b4f7b1u, 0x7656aa2ce33c0c88u}},
+    {64u, kSeed, 0x8b64c743b079ab0au,
+     {0x245acd925f85cf23u, 0x0228bed5b872e60au}},
+    {65u, 0u, 0x5562e91b531e3e44u,
+     {0x5554b356abb4b72cu, 0x3f65d904eb7c63c5u}},
+    {65u, kSeed, 0xc8eec7eee7a49e93u,
+     {0x9116c025b44be3cbu, 0x3bc9265185b9572au}},
+    {96u, 0u, 0x927820500935992bu,
+     {0x89223f4270e55b48u, 0x3cb65eab95d65cf9u}},
+    {96u, kSeed, 0x1ff9c1b9fd26d03eu,
+     {0x632689f3f830b383u, 0xfb5c880bb4edbb6du}},
+    {97u, 0u, 0xd2df57b31db30ae6u,
+     {0x4f43e0f2a6a5b613u, 0x537498c00c2a98ffu}},
+    {97u, kSeed, 0xd82bd951b427159eu,
+     {0x92e155cab3ac823fu, 0x387c7431fe7af117u}},
+    {128u, 0u, 0x7d91e70acfd1aeecu,
+     {0xdf8b257b027f79f5u, 0x6b3ba18062e48b4au}},
+    {128u, kSeed, 0x601de1de208605bbu,
+     {0x922956ba68563de1u, 0x04d9795871815b70u}},
+    {129u, 0u, 0x97ec3c2cde08d0d6u,
+     {0xc26d0012e16a0682u, 0x49ebf8e7937a8d92u}},
+    {129u, kSeed, 0x9cb1f174044cd29cu,
+     {0xd8f1caf652756745u, 0x7755b18013484cbcu}},
+    {200u, 0u, 0x4236b4a20548ef43u,
+     {0xfce479e9dbbbac60u, 0x4bcb79e80c279ddcu}},
+    {200u, kSeed, 0xbf8095ff10e30869u,
+     {0xc15dbcc266461d1fu, 0x64439134b662eb11u}},
+    {240u, 0u, 0xb89b55d40b7790b7u,
+     {0xc893de4f620ea460u, 0x711425976de43457u}},
+    {240u, kSeed, 0x79243cd7d9cad5b5u,
+     {0x86f622cb53417100u, 0xa572d7c814626e25u}},
+    {241u, 0u, 0x2acf000988b1570bu,
+     {0x2acf000988b1570bu, 0x5a86a6b76122bb8cu}},
+    {241u, kSeed, 0x063d7088f6461c11u,
+     {0x063d7088f6461c11u, 0x301dad688e3fb4c8u}},
+    {256u, 0u, 0x6b4d6be4dde87777u,
+     {0x6b4d6be4dde87777u, 0x34e8ba57c341b11eu}},
+    {256u, kSeed, 0x0f6fa3da49126afbu,
+     {0x0f6fa3da49126afbu, 0x5087a4799ce1efd4u}},
+    {511u, 0u, 0x8ec218040f514012u,
+     {0x8ec218040f514012u, 0x8260dc931353fd25u}},
+    {511u, kSeed, 0xa0beb5349d20522eu,
+     {0xa0beb5349d20522eu, 0x618ff3ae9be31cefu}},
+    {1024u, 0u, 0x35af07269cf9948bu,
+     {0x35af07269cf9948bu, 0xaa3317cad58b0f55u}},
+    {1024u, kSeed, 0x7fd4eb375075b112u,
+     {0x7fd4eb375075b112u, 0xf09073ce7c39c128u}},
+    {1025u, 0u, 0x07bebed893d30466u,
+     {0x07bebed893d30466u, 0x44c0ac90fe59b2d3u}},
+    {1025u, kSeed, 0xf6527e3b8cf26279u,
+     {0xf6527e3b8cf26279u, 0x268c6fa8ce07717du}},
+    {10000u, 0u, 0x87e9bcd22fa796ddu,
+     {0x87e9bcd22fa796ddu, 0x7f18a79b445aa9d3u}},
+    {10000u, kSeed, 0xc69235d064c164e2u,
+     {0xc69235d064c164e2u, 0x85677be015002f11u}},
+    {100000u, 0u, 0xc3844f021cc0457cu,
+     {0xc3844f021cc0457cu, 0x36412145cf9db6c8u}},
+    {100000u, kSeed, 0x89f7d85e3b2d3a65u,
+     {0x89f7d85e3b2d3a65u, 0xcb28838fb22507feu}},
+};
+
+static std::vector<size_t> GetInterestingSizes() {
+  std::vector<size_t> sizes;
+  for (size_t size = 0; size <= 2048u; size++) {
+    sizes.push_back(size);
+  }
+  for (auto size : {4095u, 4096u, 4097u, 65536u, 100000u}) {
+    sizes.push_back(size);
+  }
+  return sizes;
+}
+
+TEST(ContentHashTest, MatchesKnownHashes) {
+  for (const auto& known : kKnownHashes) {
+    const auto data = CreateData(known.size);
+    ASSERT_EQ(HashBytes64(data.data(), data.size(), known.seed), known.hash_64)
+        << "Size: " << known.size << " Seed: " << known.seed;
+    ASSERT_EQ(HashBytes128(data.data(), data.size(), known.seed),
+              known.hash_128)
+        << "Size: " << known.size << " Seed: " << known.seed;
+  }
+}
+
+TEST(ContentHashTest, AllKernelsAgree) {
+  const auto kernels = GetSupportedHashKernels();
+  ASSERT_FALSE(kernels.empty());
+  ASSERT_EQ(kernels.front(), HashKernel::kHashKernelScalar);
+  const auto data = CreateData(100000u);
+  for (auto size : GetInterestingSizes()) {
+    for (auto seed : {uint64_t{0u}, kSeed}) {
+      const auto expected_64 = HashBytes64(data.data(), size, seed,
+                                           HashKernel::kHashKernelScalar);
+      const auto expected_128 = HashBytes128(data.data(), size, seed,
+                                             HashKernel::kHashKernelScalar);
+      for (auto kernel : kernels) {
+        ASSERT_EQ(HashBytes64(data.data(), size, seed, kernel), expected_64);
+        ASSERT_EQ(HashBytes128(data.data(), size, seed, kernel),
+                  expected_128);
+      }
+    }
+  }
+}
+
+TEST(ContentHashTest, UnalignedInputsHashTheSame) {
+  const auto data = CreateData(5000u);
+  auto shifted = std::vector<uint8_t>(data.size() + 1u);
+  ::memcpy(shifted.data() + 1u, data.data(), data.size());
+  for (auto kernel : GetSupportedHashKernels()) {
+    ASSERT_EQ(HashBytes64(data.data(), data.size(), 0u, kernel),
+              HashBytes64(shifted.data() + 1u, data.size(), 0u, kernel));
+  }
+}
+
+TEST(ContentHashTest, StreamingMatchesOneShot) {
+  const auto data = CreateData(100000u);
+  std::mt19937 generator(42u);
+  std::uniform_int_distribution<size_t> chunk_sizes(0u, 700u);
+  for (auto size : GetInterestingSizes()) {
+    for (auto seed : {uint64_t{0u}, kSeed}) {
+      ContentHasher hasher(seed);
+      size_t offset = 0;
+      while (offset < size) {
+        const auto chunk_size = std::min(chunk_sizes(generator), size - offset);
+        hasher.Update(data.data() + offset, chunk_size);
+        offset += chunk_size;
+      }
+      ASSERT_EQ(hasher.Digest64(), HashBytes64(data.data(), size, seed))
+          << "Size: " << size;
+      ASSERT_EQ(hasher.Digest128(), HashBytes128(data.data(), size, seed))
+          << "Size: " << size;
+    }
+  }
+}
+
+TEST(ContentHashTest, StreamingWithEachKernel) {
+  const auto data = CreateData(10000u);
+  const auto expected = HashBytes128(data.data(), data.size());
+  for (auto kernel : GetSupportedHashKernels()) {
+    ContentHasher hasher(0u, kernel);
+    for (size_t offset = 0; offset < data.size(); offset += 100u) {
+      hasher.Update(data.data() + offset, 100u);
+    }
+    ASSERT_EQ(hasher.Digest128(), expected);
+  }
+}
+
+TEST(ContentHashTest, HasherCanBeReset) {
+  const auto data = CreateData(1000u);
+  ContentHasher hasher;
+  hasher.Update(data.data(), 500u);
+  hasher.Reset();
+  hasher.Update(data.data(), data.size());
+  ASSERT_EQ(hasher.Digest64(), HashBytes64(data.data(), data.size()));
+  // Digesting does not disturb the state.
+  ASSERT_EQ(hasher.Digest64(), HashBytes64(data.data(), data.size()));
+}
+
+TEST(ContentHashTest, CanHashMappings) {
+  const auto data = CreateData(3000u);
+  const auto mapping = UnownedMapping(data.data(), data.size());
+  ASSERT_EQ(HashMapping64(*mapping), HashBytes64(data.data(), data.size()));
+  ASSERT_EQ(HashMapping128(*mapping, kSeed),
+            HashBytes128(data.data(), data.size(), kSeed));
+  ContentHasher hasher;
+  hasher.Update(*mapping);
+  ASSERT_EQ(hasher.Digest128(), HashMapping128(*mapping));
+}
+
+TEST(ContentHashTest, Hash128ToString) {
+  const Hash128 hash = {.low = 0x0123456789abcdefu,
+                        .high = 0xfedcba9876543210u};
+  ASSERT_EQ(hash.ToString(), "fedcba98765432100123456789abcdef");
+  ASSERT_EQ(Hash128{}.ToString(), "00000000000000000000000000000000");
+}
+
+}  // namespace testing
+}  // namespace pixel
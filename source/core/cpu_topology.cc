@@ -0,0 +1,276 @@
+#include "cpu_topology.h"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+
+#include "platform.h"
+#include "string_utils.h"
+
+namespace pixel {
+
+static std::optional<size_t> ParseSize(std::string_view string) {
+  size_t value = 0;
+  const auto result =
+      std::from_chars(string.data(), string.data() + string.size(), value);
+  if (result.ec != std::errc{} || result.ptr == string.data()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+std::optional<std::vector<size_t>> ParseCPUList(std::string_view list) {
+  std::set<size_t> cpus;
+  while (!list.empty()) {
+    const auto comma = list.find(',');
+    auto range = list.substr(0, comma);
+    list = comma == std::string_view::npos ? std::string_view{}
+                                           : list.substr(comma + 1);
+    if (range.empty()) {
+      continue;
+    }
+    const auto dash = range.find('-');
+    const auto first = ParseSize(range.substr(0, dash));
+    const auto last = dash == std::string_view::npos
+                          ? first
+                          : ParseSize(range.substr(dash + 1));
+    if (!first.has_value() || !last.has_value() ||
+        first.value() > last.value()) {
+      return std::nullopt;
+    }
+    for (auto cpu = first.value(); cpu <= last.value(); cpu++) {
+      cpus.insert(cpu);
+    }
+  }
+  return std::vector<size_t>{cpus.begin(), cpus.end()};
+}
+
+static std::optional<std::string> ReadSysfsString(
+    const std::filesystem::path& path) {
+  std::ifstream stream(path);
+  if (!stream.is_open()) {
+    return std::nullopt;
+  }
+  std::stringstream contents;
+  contents << stream.rdbuf();
+  return TrimString(contents.str());
+}
+
+static std::optional<size_t> ReadSysfsSize(const std::filesystem::path& path) {
+  auto string = ReadSysfsString(path);
+  if (!string.has_value()) {
+    return std::nullopt;
+  }
+  return ParseSize(string.value());
+}
+
+static std::optional<std::vector<size_t>> ReadSysfsCPUList(
+    const std::filesystem::path& path) {
+  auto string = ReadSysfsString(path);
+  if (!string.has_value()) {
+    return std::nullopt;
+  }
+  return ParseCPUList(string.value());
+}
+
+// Cache sizes are in the "32K" format.
+static std::optional<size_t> ReadSysfsCacheSize(
+    const std::filesystem::path& path) {
+  auto string = ReadSysfsString(path);
+  if (!string.has_value() || string->empty()) {
+    return std::nullopt;
+  }
+  size_t multiplier = 1;
+  switch (string->back()) {
+    case 'K':
+      multiplier = 1024;
+      break;
+    case 'M':
+      multiplier = 1024 * 1024;
+      break;
+    case 'G':
+      multiplier = 1024 * 1024 * 1024;
+      break;
+  }
+  if (multiplier != 1) {
+    string->pop_back();
+  }
+  auto size = ParseSize(string.value());
+  if (!size.has_value()) {
+    return std::nullopt;
+  }
+  return size.value() * multiplier;
+}
+
+// Directories named with the prefix followed by an index, sorted by index.
+static std::vector<std::pair<size_t, std::filesystem::path>>
+ListIndexedDirectories(const std::filesystem::path& directory,
+                       std::string_view prefix) {
+  std::vector<std::pair<size_t, std::filesystem::path>> result;
+  std::error_code error;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(directory, error)) {
+    const auto name = entry.path().filename().string();
+    if (name.compare(0, prefix.size(), prefix) != 0) {
+      continue;
+    }
+    if (auto index = ParseSize(std::string_view{name}.substr(prefix.size()));
+        index.has_value() &&
+        std::to_string(index.value()) == name.substr(prefix.size())) {
+      result.emplace_back(index.value(), entry.path());
+    }
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+std::optional<CPUTopology> CPUTopology::ReadFromSysfs(
+    const std::filesystem::path& root) {
+  const auto cpu_directory = root / "cpu";
+  auto online = ReadSysfsCPUList(cpu_directory / "online");
+  if (!online.has_value() || online->empty()) {
+    return std::nullopt;
+  }
+
+  std::map<std::pair<size_t, size_t>, Core> cores;
+  std::map<std::tuple<size_t, CacheType, std::vector<size_t>>, Cache> caches;
+
+  for (auto cpu : online.value()) {
+    const auto cpu_path = cpu_directory / ("cpu" + std::to_string(cpu));
+    const auto topology_path = cpu_path / "topology";
+
+    auto core_id = ReadSysfsSize(topology_path / "core_id");
+    if (!core_id.has_value()) {
+      // Without a core ID, the CPU is a core of its own.
+      core_id = cpu;
+    }
+    // Not all platforms know about packages.
+    const auto package =
+        ReadSysfsSize(topology_path / "physical_package_id").value_or(0u);
+
+    auto& core = cores[{package, core_id.value()}];
+    core.package = package;
+    core.id = core_id.value();
+    core.cpus.push_back(cpu);
+
+    for (const auto& index :
+         ListIndexedDirectories(cpu_path / "cache", "index")) {
+      auto level = ReadSysfsSize(index.second / "level");
+      auto type = ReadSysfsString(index.second / "type");
+      auto size = ReadSysfsCacheSize(index.second / "size");
+      auto shared = ReadSysfsCPUList(index.second / "shared_cpu_list");
+      if (!level.has_value() || !type.has_value() || !size.has_value() ||
+          !shared.has_value()) {
+        continue;
+      }
+      auto cache_type = CacheType::kCacheTypeUnified;
+      if (type.value() == "Data") {
+        cache_type = CacheType::kCacheTypeData;
+      } else if (type.value() == "Instruction") {
+        cache_type = CacheType::kCacheTypeInstruction;
+      }
+      caches[{level.value(), cache_type, shared.value()}] = {
+          level.value(), cache_type, size.value(), shared.value()};
+    }
+  }
+
+  std::vector<std::vector<size_t>> nodes;
+  for (const auto& node : ListIndexedDirectories(root / "node", "node")) {
+    if (auto cpus = ReadSysfsCPUList(node.second / "cpulist");
+        cpus.has_value() && !cpus->empty()) {
+      nodes.emplace_back(std::move(cpus.value()));
+    }
+  }
+
+  std::vector<Core> core_list;
+  for (auto& core : cores) {
+    core_list.emplace_back(std::move(core.second));
+  }
+  std::vector<Cache> cache_list;
+  for (auto& cache : caches) {
+    cache_list.emplace_back(std::move(cache.second));
+  }
+  return CPUTopology{std::move(core_list), std::move(cache_list),
+                     std::move(nodes)};
+}
+
+static CPUTopology CreateFlatTopology() {
+  std::vector<CPUTopology::Core> cores;
+  const size_t cpu_count = std::max(1u, std::thread::hardware_concurrency());
+  for (size_t i = 0; i < cpu_count; i++) {
+    cores.push_back({0u, i, {i}});
+  }
+  return CPUTopology{std::move(cores), {}, {}};
+}
+
+const CPUTopology& CPUTopology::ForProcess() {
+  static CPUTopology topology = []() {
+#if P_OS_LINUX
+    if (auto topology = ReadFromSysfs("/sys/devices/system")) {
+      return std::move(topology.value());
+    }
+#endif  // P_OS_LINUX
+    return CreateFlatTopology();
+  }();
+  return topology;
+}
+
+CPUTopology::CPUTopology(std::vector<Core> cores,
+                         std::vector<Cache> caches,
+                         std::vector<std::vector<size_t>> nodes)
+    : cores_(std::move(cores)),
+      caches_(std::move(caches)),
+      nodes_(std::move(nodes)) {}
+
+CPUTopology::~CPUTopology() = default;
+
+size_t CPUTopology::GetCPUCount() const {
+  size_t count = 0;
+  for (const auto& core : cores_) {
+    count += core.cpus.size();
+  }
+  return count;
+}
+
+const std::vector<CPUTopology::Core>& CPUTopology::GetCores() const {
+  return cores_;
+}
+
+const std::vector<CPUTopology::Cache>& CPUTopology::GetCaches() const {
+  return caches_;
+}
+
+const std::vector<std::vector<size_t>>& CPUTopology::GetNodes() const {
+  return nodes_;
+}
+
+std::vector<size_t> CPUTopology::GetSiblings(size_t cpu) const {
+  for (const auto& core : cores_) {
+    if (std::find(core.cpus.begin(), core.cpus.end(), cpu) !=
+        core.cpus.end()) {
+      return core.cpus;
+    }
+  }
+  return {};
+}
+
+std::pair<std::vector<size_t>, std::vector<size_t>> CPUTopology::PartitionCores(
+    size_t reserved_core_count) const {
+  std::vector<size_t> reserved;
+  std::vector<size_t> rest;
+  for (size_t i = 0; i < cores_.size(); i++) {
+    auto& cpus = i < reserved_core_count ? reserved : rest;
+    cpus.insert(cpus.end(), cores_[i].cpus.begin(), cores_[i].cpus.end());
+  }
+  std::sort(reserved.begin(), reserved.end());
+  std::sort(rest.begin(), rest.end());
+  return {std::move(reserved), std::move(rest)};
+}
+
+}  // namespace pixel
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "macros.h"
+
+namespace pixel {
+
+//------------------------------------------------------------------------------
+/// @brief      Parse a list of logical CPUs in the format used by the kernel.
+///             For example, "0-3,8,10-11".
+///
+/// @return     The sorted CPU indices or nullopt if the list is malformed.
+///
+std::optional<std::vector<size_t>> ParseCPUList(std::string_view list);
+
+//------------------------------------------------------------------------------
+/// @brief      The logical CPUs of the machine and how they share cores, caches
+///             and memory nodes. CPUs are identified by the same indices that
+///             are used for thread affinity.
+///
+class CPUTopology {
+ public:
+  struct Core {
+    size_t package = 0;
+    size_t id = 0;
+    // The logical CPUs of the core. More than one if the core has SMT.
+    std::vector<size_t> cpus;
+  };
+
+  enum class CacheType {
+    kCacheTypeData,
+    kCacheTypeInstruction,
+    kCacheTypeUnified,
+  };
+
+  struct Cache {
+    size_t level = 0;
+    CacheType type = CacheType::kCacheTypeUnified;
+    size_t size = 0;
+    // The logical CPUs that share the cache.
+    std::vector<size_t> cpus;
+  };
+
+  //----------------------------------------------------------------------------
+  /// @brief      The topology of this machine. On Linux, this is read from
+  ///             sysfs. Elsewhere, or if sysfs could not be read, every
+  ///             hardware thread is assumed to be its own core and nothing is
+  ///             known about caches.
+  ///
+  static const CPUTopology& ForProcess();
+
+  //----------------------------------------------------------------------------
+  /// @brief      Read the topology from a sysfs tree.
+  ///
+  /// @param[in]  root  The directory that contains the "cpu" and "node"
+  ///                   directories. Usually "/sys/devices/system".
+  ///
+  static std::optional<CPUTopology> ReadFromSysfs(
+      const std::filesystem::path& root);
+
+  CPUTopology(std::vector<Core> cores,
+              std::vector<Cache> caches,
+              std::vector<std::vector<size_t>> nodes);
+
+  ~CPUTopology();
+
+  size_t GetCPUCount() const;
+
+  //----------------------------------------------------------------------------
+  /// @brief      Cores ordered by package and then by ID.
+  ///
+  const std::vector<Core>& GetCores() const;
+
+  //----------------------------------------------------------------------------
+  /// @brief      Each distinct cache once, ordered by level.
+  ///
+  const std::vector<Cache>& GetCaches() const;
+
+  //----------------------------------------------------------------------------
+  /// @brief      The logical CPUs of each NUMA node. Empty if unknown.
+  ///
+  const std::vector<std::vector<size_t>>& GetNodes() const;
+
+  //----------------------------------------------------------------------------
+  /// @brief      The CPUs that share a core with the given CPU, including the
+  ///             CPU itself.
+  ///
+  std::vector<size_t> GetSiblings(size_t cpu) const;
+
+  //----------------------------------------------------------------------------
+  /// @brief      Split the CPUs into the CPUs of the first few cores and the
+  ///             CPUs of all other cores. SMT siblings always end up on the
+  ///             same side. This is useful for keeping frame-critical threads
+  ///             away from bulk work. If there are not enough cores to reserve,
+  ///             the second set is empty.
+  ///
+  std::pair<std::vector<size_t>, std::vector<size_t>> PartitionCores(
+      size_t reserved_core_count) const;
+
+ private:
+  std::vector<Core> cores_;
+  std::vector<Cache> caches_;
+  std::vector<std::vector<size_t>> nodes_;
+};
+
+}  // namespace pixel
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "cpu_topology.h"
+#include "scoped_temp_directory.h"
+
+namespace pixel {
+namespace testing {
+
+TEST(CPUTopologyTest, CanParseCPUList) {
+  ASSERT_EQ(ParseCPUList("0").value(), std::vector<size_t>({0}));
+  ASSERT_EQ(ParseCPUList("0-3,8,10-11").value(),
+            std::vector<size_t>({0, 1, 2, 3, 8, 10, 11}));
+  ASSERT_EQ(ParseCPUList("4,0-1").value(), std::vector<size_t>({0, 1, 4}));
+  ASSERT_TRUE(ParseCPUList("").value().empty());
+  ASSERT_FALSE(ParseCPUList("3-1").has_value());
+  ASSERT_FALSE(ParseCPUList("a").has_value());
+  ASSERT_FALSE(ParseCPUList("1-").has_value());
+}
+
+static void WriteSysfsFile(const std::filesystem::path& path,
+                           const std::string& contents) {
+  std::filesystem::create_directories(path.parent_path());
+  std::ofstream stream(path);
+  stream << contents << "\n";
+}
+
+// Two cores with two SMT siblings each. Siblings are numbered the way most
+// x86 machines number them.
+static void CreateSysfsTree(const std::filesystem::path& root) {
+  WriteSysfsFile(root / "cpu" / "online", "0-3");
+  for (size_t cpu = 0; cpu < 4; cpu++) {
+    const auto cpu_path = root / "cpu" / ("cpu" + std::to_string(cpu));
+    const auto core = cpu % 2;
+    const auto siblings = core == 0 ? "0,2" : "1,3";
+    WriteSysfsFile(cpu_path / "topology" / "core_id", std::to_string(core));
+    WriteSysfsFile(cpu_path / "topology" / "physical_package_id", "0");
+    WriteSysfsFile(cpu_path / "cache" / "index0" / "level", "1");
+    WriteSysfsFile(cpu_path / "cache" / "index0" / "type", "Data");
+    WriteSysfsFile(cpu_path / "cache" / "index0" / "size", "32K");
+    WriteSysfsFile(cpu_path / "cache" / "index0" / "shared_cpu_list",
+                   siblings);
+    WriteSysfsFile(cpu_path / "cache" / "index3" / "level", "3");
+    WriteSysfsFile(cpu_path / "cache" / "index3" / "type", "Unified");
+    WriteSysfsFile(cpu_path / "cache" / "index3" / "size", "8M");
+    WriteSysfsFile(cpu_path / "cache" / "index3" / "shared_cpu_list", "0-3");
+  }
+  WriteSysfsFile(root / "node" / "node0" / "cpulist", "0-3");
+}
+
+TEST(CPUTopologyTest, CanReadSysfsTree) {
+  ScopedTempDirectory root("pixel_sysfs");
+  ASSERT_TRUE(root.IsValid());
+  CreateSysfsTree(root.GetPath());
+  auto topology = CPUTopology::ReadFromSysfs(root.GetPath());
+  ASSERT_TRUE(topology.has_value());
+
+  ASSERT_EQ(topology->GetCPUCount(), 4u);
+  const auto& cores = topology->GetCores();
+  ASSERT_EQ(cores.size(), 2u);
+  ASSERT_EQ(cores[0].cpus, std::vector<size_t>({0, 2}));
+  ASSERT_EQ(cores[1].cpus, std::vector<size_t>({1, 3}));
+  ASSERT_EQ(topology->GetSiblings(3), std::vector<size_t>({1, 3}));
+  ASSERT_TRUE(topology->GetSiblings(4).empty());
+
+  // The private caches of each core and the shared cache.
+  const auto& caches = topology->GetCaches();
+  ASSERT_EQ(caches.size(), 3u);
+  ASSERT_EQ(caches[0].level, 1u);
+  ASSERT_EQ(caches[0].type, CPUTopology::CacheType::kCacheTypeData);
+  ASSERT_EQ(caches[0].size, 32u * 1024u);
+  ASSERT_EQ(caches[2].level, 3u);
+  ASSERT_EQ(caches[2].size, 8u * 1024u * 1024u);
+  ASSERT_EQ(caches[2].cpus, std::vector<size_t>({0, 1, 2, 3}));
+
+  ASSERT_EQ(topology->GetNodes().size(), 1u);
+
+  auto partition = topology->PartitionCores(1u);
+  ASSERT_EQ(partition.first, std::vector<size_t>({0, 2}));
+  ASSERT_EQ(partition.second, std::vector<size_t>({1, 3}));
+
+  partition = topology->PartitionCores(2u);
+  ASSERT_EQ(partition.first.size(), 4u);
+  ASSERT_TRUE(partition.second.empty());
+}
+
+TEST(CPUTopologyTest, MissingSysfsTreeIsAnError) {
+  ASSERT_FALSE(
+      CPUTopology::ReadFromSysfs("/this/path/does/not/exist").has_value());
+}
+
+TEST(CPUTopologyTest, ProcessTopologyIsConsistent) {
+  const auto& topology = CPUTopology::ForProcess();
+  ASSERT_GE(topology.GetCPUCount(), 1u);
+  ASSERT_GE(topology.GetCores().size(), 1u);
+  for (const auto& core : topology.GetCores()) {
+    ASSERT_FALSE(core.cpus.empty());
+  }
+}
+
+}  // namespace testing
+}  // namespace pixel
@@ -0,0 +1,82 @@
+#include "duration_histogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace pixel {
+
+size_t DurationHistogram::GetBucketIndex(std::chrono::nanoseconds duration) {
+  const auto micros =
+      std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+  if (micros <= 0) {
+    return 0;
+  }
+  return std::min<size_t>(std::bit_width(static_cast<uint64_t>(micros)),
+                          kBucketCount - 1);
+}
+
+DurationHistogram::DurationHistogram() = default;
+
+DurationHistogram::~DurationHistogram() = default;
+
+void DurationHistogram::Add(std::chrono::nanoseconds duration) {
+  duration = std::max(duration, std::chrono::nanoseconds::zero());
+  buckets_[GetBucketIndex(duration)]++;
+  count_++;
+  total_ += duration;
+  max_ = std::max(max_, duration);
+}
+
+void DurationHistogram::Merge(const DurationHistogram& other) {
+  for (size_t i = 0; i < kBucketCount; i++) {
+    buckets_[i] += other.buckets_[i];
+  }
+  count_ += other.count_;
+  total_ += other.total_;
+  max_ = std::max(max_, other.max_);
+}
+
+size_t DurationHistogram::GetCount() const {
+  return count_;
+}
+
+std::chrono::nanoseconds DurationHistogram::GetTotal() const {
+  return total_;
+}
+
+std::chrono::nanoseconds DurationHistogram::GetMean() const {
+  if (count_ == 0) {
+    return {};
+  }
+  return total_ / count_;
+}
+
+std::chrono::nanoseconds DurationHistogram::GetMax() const {
+  return max_;
+}
+
+std::chrono::nanoseconds DurationHistogram::GetPercentile(
+    double percentile) const {
+  if (count_ == 0) {
+    return {};
+  }
+  percentile = std::clamp(percentile, 0.0, 1.0);
+  const auto rank = std::max<size_t>(
+      1u, static_cast<size_t>(std::ceil(percentile * count_)));
+  size_t seen = 0;
+  for (size_t i = 0; i < kBucketCount - 1; i++) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      return std::min<std::chrono::nanoseconds>(
+          std::chrono::microseconds(uint64_t{1} << i), max_);
+    }
+  }
+  return max_;
+}
+
+const DurationHistogram::Buckets& DurationHistogram::GetBuckets() const {
+  return buckets_;
+}
+
+}  // namespace pixel
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+#include "macros.h"
+
+namespace pixel {
+
+//------------------------------------------------------------------------------
+/// @brief      A histogram of durations with power of two buckets. Bucket 0
+///             holds durations under a microsecond. Bucket N holds durations
+///             in [2^(N-1), 2^N) microseconds. The last bucket also holds
+///             everything longer.
+///
+class DurationHistogram {
+ public:
+  static constexpr size_t kBucketCount = 24;
+
+  using Buckets = std::array<size_t, kBucketCount>;
+
+  static size_t GetBucketIndex(std::chrono::nanoseconds duration);
+
+  DurationHistogram();
+
+  ~DurationHistogram();
+
+  void Add(std::chrono::nanoseconds duration);
+
+  void Merge(const DurationHistogram& other);
+
+  size_t GetCount() const;
+
+  std::chrono::nanoseconds GetTotal() const;
+
+  std::chrono::nanoseconds GetMean() const;
+
+  std::chrono::nanoseconds GetMax() const;
+
+  //----------------------------------------------------------------------------
+  /// @brief      An upper bound for the duration below which the given
+  ///             fraction of all durations fall. This is the upper bound of
+  ///             the bucket the percentile lands in, but never more than the
+  ///             longest duration seen.
+  ///
+  /// @param[in]  percentile  The fraction in [0, 1].
+  ///
+  std::chrono::nanoseconds GetPercentile(double percentile) const;
+
+  const Buckets& GetBuckets() const;
+
+ private:
+  Buckets buckets_ = {};
+  size_t count_ = 0;
+  std::chrono::nanoseconds total_ = {};
+  std::chrono::nanoseconds max_ = {};
+};
+
+}  // namespace pixel
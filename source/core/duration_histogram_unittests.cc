@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include "duration_histogram.h"
+
+namespace pixel {
+namespace testing {
+
+using namespace std::chrono_literals;
+
+TEST(DurationHistogramTest, BucketsArePowersOfTwoMicroseconds) {
+  ASSERT_EQ(DurationHistogram::GetBucketIndex(0ns), 0u);
+  ASSERT_EQ(DurationHistogram::GetBucketIndex(999ns), 0u);
+  ASSERT_EQ(DurationHistogram::GetBucketIndex(1us), 1u);
+  ASSERT_EQ(DurationHistogram::GetBucketIndex(2us), 2u);
+  ASSERT_EQ(DurationHistogram::GetBucketIndex(3us), 2u);
+  ASSERT_EQ(DurationHistogram::GetBucketIndex(4us), 3u);
+  ASSERT_EQ(DurationHistogram::GetBucketIndex(1000s),
+            DurationHistogram::kBucketCount - 1);
+}
+
+TEST(DurationHistogramTest, CanComputeSummaries) {
+  DurationHistogram histogram;
+  ASSERT_EQ(histogram.GetCount(), 0u);
+  ASSERT_EQ(histogram.GetPercentile(0.5), 0ns);
+  ASSERT_EQ(histogram.GetMean(), 0ns);
+
+  for (size_t i = 0; i < 99; i++) {
+    histogram.Add(3us);
+  }
+  histogram.Add(100ms);
+
+  ASSERT_EQ(histogram.GetCount(), 100u);
+  ASSERT_EQ(histogram.GetTotal(), 99 * 3us + 100ms);
+  ASSERT_EQ(histogram.GetMax(), 100ms);
+  ASSERT_EQ(histogram.GetPercentile(0.5), 4us);
+  ASSERT_EQ(histogram.GetPercentile(0.99), 4us);
+  ASSERT_EQ(histogram.GetPercentile(1.0), 100ms);
+}
+
+TEST(DurationHistogramTest, PercentilesNeverExceedMax) {
+  DurationHistogram histogram;
+  histogram.Add(5us);
+  ASSERT_EQ(histogram.GetPercentile(0.5), 5us);
+}
+
+TEST(DurationHistogramTest, CanMergeHistograms) {
+  DurationHistogram a;
+  DurationHistogram b;
+  a.Add(1us);
+  b.Add(1ms);
+  b.Add(2ms);
+  a.Merge(b);
+  ASSERT_EQ(a.GetCount(), 3u);
+  ASSERT_EQ(a.GetMax(), 2ms);
+  ASSERT_EQ(a.GetTotal(), 1us + 3ms);
+  ASSERT_EQ(a.GetBuckets()[1], 1u);
+}
+
+}  // namespace testing
+}  // namespace pixel
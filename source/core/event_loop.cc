@@ -1,37 +1,457 @@
 #include "event_loop.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <deque>
+#include <map>
 #include <mutex>
 #include <thread>
 
+#include "file.h"
 #include "logging.h"
 #include "macros.h"
+#include "mpsc_queue.h"
+#include "platform.h"
+#include "trace_event.h"
+
+#if P_OS_LINUX
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif  // P_OS_LINUX
 
 namespace pixel {
 
 thread_local std::unique_ptr<EventLoop> tEventLoop;
 
+[[maybe_unused]] static const char* GetTaskTraceName(const char* label) {
+  return label != nullptr ? label : "Task";
+}
+
 struct TasksHeap {
-  std::condition_variable tasks_cv;
-  std::mutex tasks_mutex;
-  std::vector<Closure> tasks;
+  using Clock = EventLoop::Clock;
+
+  static constexpr size_t kLaneCount =
+      static_cast<size_t>(TaskPriority::kTaskPriorityIdle) + 1;
+
+  struct PendingTask {
+    UniqueClosure task;
+    // Never earlier than the time the task was posted.
+    Clock::time_point deadline;
+    TaskPriority priority = TaskPriority::kTaskPriorityNormal;
+    const char* label = nullptr;
+    // Connects the post to the run in traces. Zero if not tracing.
+    uint64_t flow_id = 0;
+  };
+
+  struct Timer {
+    Clock::time_point deadline;
+    // Breaks ties between timers with the same deadline so that they fire in
+    // the order they were posted.
+    size_t sequence = 0;
+    UniqueClosure task;
+    TaskPriority priority = TaskPriority::kTaskPriorityNormal;
+    const char* label = nullptr;
+    uint64_t flow_id = 0;
+
+    // Used with the standard heap algorithms so that the timer that must fire
+    // first ends up at the front of the heap.
+    static bool FiresAfter(const Timer& lhs, const Timer& rhs) {
+      if (lhs.deadline != rhs.deadline) {
+        return lhs.deadline > rhs.deadline;
+      }
+      return lhs.sequence > rhs.sequence;
+    }
+  };
+
+  MPSCQueue<PendingTask> tasks;
+  std::atomic_bool parked = false;
+  std::mutex park_mutex;
+  std::condition_variable park_cv;
+  // Only accessed on the thread running the loop. Kept around so that the
+  // storage for drained tasks can be reused.
+  std::vector<PendingTask> drained_tasks;
+  // Only accessed on the thread running the loop. A min-heap of tasks whose
+  // deadlines have not been reached yet.
+  std::vector<Timer> timers;
+  size_t next_timer_sequence = 0;
+  struct ReadyTask {
+    UniqueClosure task;
+    // When the task became ready to run.
+    Clock::time_point ready;
+    const char* label = nullptr;
+    uint64_t flow_id = 0;
+  };
+  using Lane = std::deque<ReadyTask>;
+  // Only accessed on the thread running the loop. Tasks that are ready to run,
+  // one lane per priority.
+  std::array<Lane, kLaneCount> lanes;
+  // Updated by the loop after each task. Read by any thread.
+  mutable std::mutex statistics_mutex;
+  EventLoopStatistics statistics;
+
+  struct FileDescriptorSource {
+    int fd = -1;
+    FileDescriptorCallback callback;
+  };
+  // Only accessed on the thread running the loop.
+  std::map<size_t, FileDescriptorSource> fd_sources;
+  // When valid, the loop waits on epoll instead of the condition variable and
+  // is woken up by writing to the eventfd.
+  UniqueFD epoll_fd;
+  UniqueFD wake_fd;
+
+  // The epoll data of the wake eventfd. Sources use callback IDs which are
+  // never zero.
+  static constexpr uint64_t kWakeFDData = 0;
+
+  TasksHeap() {
+#if P_OS_LINUX
+    epoll_fd.Reset(::epoll_create1(EPOLL_CLOEXEC));
+    wake_fd.Reset(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+    if (!epoll_fd.IsValid() || !wake_fd.IsValid()) {
+      P_ERROR << "Could not create event loop epoll instance: "
+              << strerror(errno);
+      epoll_fd.Reset();
+      wake_fd.Reset();
+      return;
+    }
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = kWakeFDData;
+    if (::epoll_ctl(epoll_fd.Get(), EPOLL_CTL_ADD, wake_fd.Get(), &event) !=
+        0) {
+      P_ERROR << "Could not watch event loop wake eventfd: "
+              << strerror(errno);
+      epoll_fd.Reset();
+      wake_fd.Reset();
+    }
+#endif  // P_OS_LINUX
+  }
 
-  bool HasTasksLocked() const { return tasks.size() > 0; }
+  bool UsesEpoll() const { return epoll_fd.IsValid(); }
 
-  std::vector<Closure> GetPendingTasksLocked() {
-    auto copied_tasks = std::move(tasks);
-    tasks.clear();
-    return copied_tasks;
+  bool PostTask(UniqueClosure task,
+                Clock::time_point deadline,
+                TaskPriority priority,
+                const char* label) {
+    if (!task) {
+      return false;
+    }
+    deadline = std::max(deadline, Clock::now());
+    uint64_t flow_id = 0;
+    if (P_TRACING_ENABLED && IsTracingEnabled()) {
+      flow_id = GetNextTraceID();
+      P_TRACE_FLOW_BEGIN("event_loop", GetTaskTraceName(label), flow_id);
+    }
+    tasks.Push({std::move(task), deadline, priority, label, flow_id});
+
+    // Pairs with the fence in |Park|. Either the loop sees the task before it
+    // parks or this thread sees that the loop is parked and wakes it up. The
+    // mutex is only ever touched if the loop is actually waiting.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked.load(std::memory_order_relaxed)) {
+      Wake();
+    }
+    return true;
   }
 
-  bool PostTaskLocked(Closure task) {
-    if (!task) {
+  void Wake() {
+#if P_OS_LINUX
+    if (UsesEpoll()) {
+      const uint64_t value = 1;
+      if (P_TEMP_FAILURE_RETRY(
+              ::write(wake_fd.Get(), &value, sizeof(value))) < 0 &&
+          errno != EAGAIN) {
+        P_ERROR << "Could not wake event loop: " << strerror(errno);
+      }
+      return;
+    }
+#endif  // P_OS_LINUX
+    {
+      // Makes sure the loop is either not yet checking its predicate or is
+      // already waiting on the condition variable.
+      std::scoped_lock lock(park_mutex);
+    }
+    park_cv.notify_one();
+  }
+
+  void Park() {
+    if (tasks.HasPendingItems()) {
+      // A producer is still in the middle of publishing a task. Let it finish
+      // instead of spinning on it.
+      std::this_thread::yield();
+      return;
+    }
+
+    const auto idle_start = Clock::now();
+    ParkUntilWoken();
+    const auto idle_time = Clock::now() - idle_start;
+    std::scoped_lock lock(statistics_mutex);
+    statistics.idle_time += idle_time;
+  }
+
+  void ParkUntilWoken() {
+    if (UsesEpoll()) {
+      parked.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!tasks.HasPendingItems()) {
+        PollFileDescriptors(GetParkTimeout());
+      }
+      parked.store(false, std::memory_order_relaxed);
+      return;
+    }
+
+    std::unique_lock lock(park_mutex);
+    parked.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto has_pending_items = [&]() { return tasks.HasPendingItems(); };
+    if (timers.empty()) {
+      park_cv.wait(lock, has_pending_items);
+    } else {
+      park_cv.wait_until(lock, timers.front().deadline, has_pending_items);
+    }
+    parked.store(false, std::memory_order_relaxed);
+  }
+
+  Lane& GetLane(TaskPriority priority) {
+    return lanes[static_cast<size_t>(priority)];
+  }
+
+  // In milliseconds as expected by epoll. Rounded up so that the loop never
+  // wakes up before the nearest timer is due. -1 if there are no timers.
+  int GetParkTimeout() const {
+    if (timers.empty()) {
+      return -1;
+    }
+    const auto remaining = timers.front().deadline - Clock::now();
+    if (remaining <= Clock::duration::zero()) {
+      return 0;
+    }
+    return static_cast<int>(
+        std::chrono::ceil<std::chrono::milliseconds>(remaining).count());
+  }
+
+  // Invokes the callbacks of all ready file descriptor sources.
+  void PollFileDescriptors(int timeout) {
+#if P_OS_LINUX
+    constexpr int kMaxEvents = 16;
+    epoll_event events[kMaxEvents];
+    const auto count = P_TEMP_FAILURE_RETRY(
+        ::epoll_wait(epoll_fd.Get(), events, kMaxEvents, timeout));
+    if (count < 0) {
+      P_ERROR << "Could not wait on event loop epoll instance: "
+              << strerror(errno);
+      return;
+    }
+    for (int i = 0; i < count; i++) {
+      const auto& event = events[i];
+      if (event.data.u64 == kWakeFDData) {
+        uint64_t value = 0;
+        P_TEMP_FAILURE_RETRY(::read(wake_fd.Get(), &value, sizeof(value)));
+        continue;
+      }
+      // Earlier callbacks may have removed this source.
+      auto found = fd_sources.find(event.data.u64);
+      if (found == fd_sources.end()) {
+        continue;
+      }
+      uint32_t ready = 0;
+      if (event.events & (EPOLLIN | EPOLLPRI)) {
+        ready |= kFileDescriptorEventReadable;
+      }
+      if (event.events & EPOLLOUT) {
+        ready |= kFileDescriptorEventWritable;
+      }
+      if (event.events & (EPOLLERR | EPOLLHUP)) {
+        ready |= kFileDescriptorEventError;
+      }
+      // The callback may remove its own source.
+      auto callback = found->second.callback;
+      callback(ready);
+    }
+#endif  // P_OS_LINUX
+  }
+
+  std::optional<size_t> AddFileDescriptorSource(
+      int fd,
+      uint32_t events,
+      FileDescriptorCallback callback) {
+#if P_OS_LINUX
+    if (!UsesEpoll()) {
+      return std::nullopt;
+    }
+    const auto handle = GetNextCallbackID();
+    epoll_event event = {};
+    if (events & kFileDescriptorEventReadable) {
+      event.events |= EPOLLIN;
+    }
+    if (events & kFileDescriptorEventWritable) {
+      event.events |= EPOLLOUT;
+    }
+    event.data.u64 = handle;
+    if (::epoll_ctl(epoll_fd.Get(), EPOLL_CTL_ADD, fd, &event) != 0) {
+      P_ERROR << "Could not add file descriptor to event loop: "
+              << strerror(errno);
+      return std::nullopt;
+    }
+    fd_sources[handle] = {fd, std::move(callback)};
+    return handle;
+#else   // P_OS_LINUX
+    P_ERROR << "File descriptor sources are not available on this platform.";
+    return std::nullopt;
+#endif  // P_OS_LINUX
+  }
+
+  bool RemoveFileDescriptorSource(size_t handle) {
+    auto found = fd_sources.find(handle);
+    if (found == fd_sources.end()) {
       return false;
     }
-    tasks.push_back(task);
+#if P_OS_LINUX
+    if (::epoll_ctl(epoll_fd.Get(), EPOLL_CTL_DEL, found->second.fd,
+                    nullptr) != 0) {
+      P_ERROR << "Could not remove file descriptor from event loop: "
+              << strerror(errno);
+    }
+#endif  // P_OS_LINUX
+    fd_sources.erase(found);
+    return true;
+  }
+
+  // Move tasks that are ready to run into their lanes.
+  void CollectReadyTasks() {
+    if (!fd_sources.empty()) {
+      PollFileDescriptors(0);
+    }
+
+    auto pending_tasks = std::move(drained_tasks);
+    pending_tasks.clear();
+    tasks.PopAll(pending_tasks);
+
+    const auto now = Clock::now();
+
+    // Expired timers were necessarily posted before any of the tasks that were
+    // just drained. Queue them first.
+    while (!timers.empty() && timers.front().deadline <= now) {
+      std::pop_heap(timers.begin(), timers.end(), Timer::FiresAfter);
+      auto& timer = timers.back();
+      GetLane(timer.priority)
+          .emplace_back(ReadyTask{std::move(timer.task), timer.deadline,
+                                  timer.label, timer.flow_id});
+      timers.pop_back();
+    }
+
+    for (auto& pending_task : pending_tasks) {
+      if (pending_task.deadline > now) {
+        timers.push_back(Timer{pending_task.deadline, next_timer_sequence++,
+                               std::move(pending_task.task),
+                               pending_task.priority, pending_task.label,
+                               pending_task.flow_id});
+        std::push_heap(timers.begin(), timers.end(), Timer::FiresAfter);
+      } else {
+        GetLane(pending_task.priority)
+            .emplace_back(ReadyTask{std::move(pending_task.task),
+                                    pending_task.deadline, pending_task.label,
+                                    pending_task.flow_id});
+      }
+    }
+
+    pending_tasks.clear();
+    drained_tasks = std::move(pending_tasks);
 
-    // TODO: Ideally, this must be outside the critical section.
-    tasks_cv.notify_one();
+    size_t queue_depth = timers.size();
+    for (const auto& lane : lanes) {
+      queue_depth += lane.size();
+    }
+    std::scoped_lock lock(statistics_mutex);
+    statistics.queue_depth = queue_depth;
+    statistics.max_queue_depth =
+        std::max(statistics.max_queue_depth, queue_depth);
+  }
+
+  // Tasks are popped before they are run so that flushing the loop from within
+  // a task is safe.
+  bool RunNextTask(Lane& lane) {
+    if (lane.empty()) {
+      return false;
+    }
+    auto task = std::move(lane.front());
+    lane.pop_front();
+    const auto start = Clock::now();
+    {
+      P_TRACE_EVENT("event_loop", GetTaskTraceName(task.label));
+      if (task.flow_id != 0) {
+        P_TRACE_FLOW_END("event_loop", GetTaskTraceName(task.label),
+                         task.flow_id);
+      }
+      task.task();
+    }
+    const auto end = Clock::now();
+    RecordTask(task.label, start - task.ready, end - start);
     return true;
   }
+
+  void RecordTask(const char* label,
+                  Clock::duration latency,
+                  Clock::duration run_time) {
+    std::scoped_lock lock(statistics_mutex);
+    statistics.latency.Add(latency);
+    statistics.run_time.Add(run_time);
+    statistics.busy_time += run_time;
+    if (label != nullptr) {
+      auto& label_statistics = statistics.labels[label];
+      label_statistics.latency.Add(latency);
+      label_statistics.run_time.Add(run_time);
+    }
+  }
+
+  EventLoopStatistics GetStatistics() const {
+    std::scoped_lock lock(statistics_mutex);
+    return statistics;
+  }
+
+  size_t RunPendingTasks() {
+    CollectReadyTasks();
+
+    // Tasks posted while these run will be picked up in the next iteration.
+    size_t count = 0;
+    for (auto& lane : lanes) {
+      for (auto remaining = lane.size(); remaining > 0; remaining--) {
+        if (!RunNextTask(lane)) {
+          break;
+        }
+        count++;
+      }
+    }
+    return count;
+  }
+
+  size_t RunPendingTasksFor(Clock::duration budget) {
+    const auto deadline = Clock::now() + budget;
+
+    CollectReadyTasks();
+
+    size_t count = 0;
+    for (auto& lane : lanes) {
+      const auto is_high_priority =
+          &lane == &GetLane(TaskPriority::kTaskPriorityHigh);
+      const auto lane_size = lane.size();
+      for (size_t ran = 0; ran < lane_size; ran++) {
+        // High priority tasks are never deferred. And at least one task from
+        // every other lane is run so that a busy frame cannot starve it.
+        if (!is_high_priority && ran > 0 && Clock::now() >= deadline) {
+          break;
+        }
+        if (!RunNextTask(lane)) {
+          break;
+        }
+        count++;
+      }
+    }
+    return count;
+  }
 };
 
 EventLoop& EventLoop::ForCurrentThread() {
@@ -70,17 +490,8 @@ bool EventLoop::Run() {
   running_ = true;
 
   while (running_) {
-    std::unique_lock lock(tasks_heap_->tasks_mutex);
-
-    tasks_heap_->tasks_cv.wait(
-        lock, [&]() { return tasks_heap_->HasTasksLocked() && running_; });
-
-    auto tasks = tasks_heap_->GetPendingTasksLocked();
-
-    lock.unlock();
-
-    for (const auto& task : tasks) {
-      task();
+    if (tasks_heap_->RunPendingTasks() == 0 && running_) {
+      tasks_heap_->Park();
     }
   }
 
@@ -93,16 +504,19 @@ bool EventLoop::FlushTasksNow() {
     return false;
   }
 
-  std::unique_lock lock(tasks_heap_->tasks_mutex);
-
-  auto tasks = tasks_heap_->GetPendingTasksLocked();
+  tasks_heap_->RunPendingTasks();
 
-  lock.unlock();
+  return true;
+}
 
-  for (const auto& task : tasks) {
-    task();
+bool EventLoop::FlushTasksFor(std::chrono::microseconds budget) {
+  if (thread_id_ != std::this_thread::get_id()) {
+    P_ASSERT(false);
+    return false;
   }
 
+  tasks_heap_->RunPendingTasksFor(budget);
+
   return true;
 }
 
@@ -116,30 +530,99 @@ EventLoop::Dispatcher::Dispatcher(std::weak_ptr<TasksHeap> heap,
 
 EventLoop::Dispatcher::~Dispatcher() = default;
 
-bool EventLoop::Dispatcher::PostTask(Closure closure) {
+std::optional<size_t> EventLoop::AddFileDescriptorSource(
+    int fd,
+    uint32_t events,
+    FileDescriptorCallback callback) {
+  if (thread_id_ != std::this_thread::get_id()) {
+    P_ASSERT(false);
+    return std::nullopt;
+  }
+
+  if (fd < 0 || events == 0 || !callback) {
+    return std::nullopt;
+  }
+
+  return tasks_heap_->AddFileDescriptorSource(fd, events, std::move(callback));
+}
+
+bool EventLoop::RemoveFileDescriptorSource(size_t handle) {
+  if (thread_id_ != std::this_thread::get_id()) {
+    P_ASSERT(false);
+    return false;
+  }
+
+  return tasks_heap_->RemoveFileDescriptorSource(handle);
+}
+
+bool EventLoop::Dispatcher::PostTask(UniqueClosure closure,
+                                     TaskPriority priority,
+                                     const char* label) {
+  return PostTaskAt(std::move(closure), {}, priority, label);
+}
+
+bool EventLoop::Dispatcher::PostDelayedTask(UniqueClosure closure,
+                                            Clock::duration delay,
+                                            TaskPriority priority,
+                                            const char* label) {
+  return PostTaskAt(std::move(closure), Clock::now() + delay, priority, label);
+}
+
+bool EventLoop::Dispatcher::PostTaskAt(UniqueClosure closure,
+                                       Clock::time_point deadline,
+                                       TaskPriority priority,
+                                       const char* label) {
   if (!closure) {
     return false;
   }
 
   if (auto tasks_heap = tasks_heap_.lock()) {
-    std::scoped_lock lock(tasks_heap->tasks_mutex);
-    return tasks_heap->PostTaskLocked(std::move(closure));
+    return tasks_heap->PostTask(std::move(closure), deadline, priority, label);
   }
 
   return false;
-};
+}
+
+EventLoopStatistics EventLoop::Dispatcher::GetStatistics() const {
+  if (auto tasks_heap = tasks_heap_.lock()) {
+    return tasks_heap->GetStatistics();
+  }
+
+  return {};
+}
+
+EventLoop::Dispatcher::ResumeAwaiter EventLoop::Dispatcher::Resume(
+    TaskPriority priority) {
+  return ResumeAwaiter{this, priority};
+}
+
+bool EventLoop::Dispatcher::ResumeAwaiter::await_suspend(
+    std::coroutine_handle<> handle) {
+  // The coroutine may be resumed on the loop before the post returns. So this
+  // awaiter must not be touched once the task is posted.
+  posted = true;
+  if (dispatcher->PostTask([handle]() { handle.resume(); }, priority)) {
+    return true;
+  }
+  posted = false;
+  return false;
+}
 
 bool EventLoop::Dispatcher::RunsTasksOnCurrentThread() const {
   return std::this_thread::get_id() == thread_id_;
 }
 
+EventLoopStatistics EventLoop::GetStatistics() const {
+  return tasks_heap_->GetStatistics();
+}
+
 bool EventLoop::Terminate() {
   if (thread_id_ != std::this_thread::get_id()) {
     P_ASSERT(false);
     return false;
   }
   running_ = false;
-  tasks_heap_->tasks_cv.notify_all();
+  tasks_heap_->Wake();
   return true;
 }
 
@@ -1,26 +1,141 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <coroutine>
+#include <functional>
+#include <map>
 #include <memory>
+#include <optional>
+#include <string_view>
 #include <thread>
 #include <vector>
 
 #include "closure.h"
+#include "duration_histogram.h"
 #include "macros.h"
 
 namespace pixel {
 
 struct TasksHeap;
 
+//------------------------------------------------------------------------------
+/// @brief      The lane a task is run in. Tasks in higher priority lanes are
+///             run before tasks in lower priority lanes. Tasks in the same lane
+///             are run in the order they were posted.
+///
+enum class TaskPriority {
+  // Input handling and work that must be done before the next frame.
+  kTaskPriorityHigh,
+  kTaskPriorityNormal,
+  // Work that may be deferred to later frames if the loop is busy.
+  kTaskPriorityIdle,
+};
+
+//------------------------------------------------------------------------------
+/// @brief      Readiness events for file descriptors added to an event loop.
+///             These are bit flags.
+///
+enum FileDescriptorEvent : uint32_t {
+  kFileDescriptorEventReadable = 1 << 0,
+  kFileDescriptorEventWritable = 1 << 1,
+  // Only ever reported to callbacks. Errors and hang-ups are always reported.
+  kFileDescriptorEventError = 1 << 2,
+};
+
+using FileDescriptorCallback = std::function<void(uint32_t events)>;
+
+//------------------------------------------------------------------------------
+/// @brief      A snapshot of what an event loop has done since it was created.
+///
+struct EventLoopStatistics {
+  struct LabelStatistics {
+    DurationHistogram latency;
+    DurationHistogram run_time;
+  };
+
+  // The number of tasks that were ready to run or waiting on their deadlines
+  // the last time the loop collected tasks.
+  size_t queue_depth = 0;
+  size_t max_queue_depth = 0;
+  // From when a task could first have been run to when it was. That is when
+  // it was posted or its deadline, whichever is later.
+  DurationHistogram latency;
+  DurationHistogram run_time;
+  // Time spent running tasks.
+  std::chrono::nanoseconds busy_time = {};
+  // Time spent waiting for tasks. Loops that are only ever flushed are never
+  // idle.
+  std::chrono::nanoseconds idle_time = {};
+  // Only tasks that were posted with labels.
+  std::map<std::string_view, LabelStatistics> labels;
+};
+
 class EventLoop {
  public:
+  using Clock = std::chrono::steady_clock;
+
   class Dispatcher {
    public:
-    bool PostTask(Closure closure);
+    //--------------------------------------------------------------------------
+    /// @brief      Post a task that will be run on the event loop. Tasks may be
+    ///             labelled so that they show up separately in the statistics
+    ///             of the loop. Labels must be string literals.
+    ///
+    bool PostTask(UniqueClosure closure,
+                  TaskPriority priority = TaskPriority::kTaskPriorityNormal,
+                  const char* label = nullptr);
+
+    //--------------------------------------------------------------------------
+    /// @brief      Post a task that will be run on the event loop no sooner
+    ///             than the specified delay from now.
+    ///
+    bool PostDelayedTask(
+        UniqueClosure closure,
+        Clock::duration delay,
+        TaskPriority priority = TaskPriority::kTaskPriorityNormal,
+        const char* label = nullptr);
+
+    //--------------------------------------------------------------------------
+    /// @brief      Post a task that will be run on the event loop no sooner
+    ///             than the specified deadline. Tasks with the same deadline
+    ///             are run in the order they were posted.
+    ///
+    bool PostTaskAt(UniqueClosure closure,
+                    Clock::time_point deadline,
+                    TaskPriority priority = TaskPriority::kTaskPriorityNormal,
+                    const char* label = nullptr);
 
     bool RunsTasksOnCurrentThread() const;
 
+    //--------------------------------------------------------------------------
+    /// @brief      The statistics of the event loop. May be called on any
+    ///             thread. Empty if the event loop has gone away.
+    ///
+    EventLoopStatistics GetStatistics() const;
+
+    struct ResumeAwaiter {
+      Dispatcher* dispatcher = nullptr;
+      TaskPriority priority = TaskPriority::kTaskPriorityNormal;
+      bool posted = false;
+
+      bool await_ready() const { return false; }
+
+      bool await_suspend(std::coroutine_handle<> handle);
+
+      bool await_resume() const { return posted; }
+    };
+
+    //--------------------------------------------------------------------------
+    /// @brief      Returns an awaitable that resumes the awaiting coroutine on
+    ///             the event loop. The result of the await is false if the
+    ///             event loop has gone away, in which case the coroutine
+    ///             continues on the thread it was on.
+    ///
+    ResumeAwaiter Resume(
+        TaskPriority priority = TaskPriority::kTaskPriorityNormal);
+
     ~Dispatcher();
 
    private:
@@ -48,8 +163,45 @@ class EventLoop {
 
   bool FlushTasksNow();
 
+  //----------------------------------------------------------------------------
+  /// @brief      Run pending tasks till the budget is exhausted. High priority
+  ///             tasks are always run. Once the budget is exhausted, the
+  ///             remaining normal and idle priority tasks are deferred to the
+  ///             next flush. At least one task from each of those lanes is run
+  ///             per flush so that they are never starved.
+  ///
+  bool FlushTasksFor(std::chrono::microseconds budget);
+
+  //----------------------------------------------------------------------------
+  /// @brief      Invoke the callback on this loop whenever the file descriptor
+  ///             is ready for any of the events. Readiness is level-triggered.
+  ///             Ready callbacks are invoked each time the loop wakes up or is
+  ///             flushed, before pending tasks are run. May only be called on
+  ///             the thread of the loop.
+  ///
+  ///             Only supported on Linux, where the loop waits on epoll instead
+  ///             of a condition variable.
+  ///
+  /// @return     A handle that can be used to remove the source.
+  ///
+  std::optional<size_t> AddFileDescriptorSource(int fd,
+                                                uint32_t events,
+                                                FileDescriptorCallback callback);
+
+  //----------------------------------------------------------------------------
+  /// @brief      Stop watching a file descriptor. This must be done before the
+  ///             file descriptor is closed. May only be called on the thread of
+  ///             the loop.
+  ///
+  bool RemoveFileDescriptorSource(size_t handle);
+
   bool Terminate();
 
+  //----------------------------------------------------------------------------
+  /// @brief      The statistics of this loop. May be called on any thread.
+  ///
+  EventLoopStatistics GetStatistics() const;
+
  private:
   std::thread::id thread_id_;
   std::atomic_bool running_ = false;
@@ -0,0 +1,62 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+
+#include "event_loop.h"
+#include "thread.h"
+
+namespace pixel {
+namespace testing {
+
+static void BM_EventLoopPostAndRunTasks(benchmark::State& state) {
+  auto& loop = EventLoop::ForCurrentThread();
+  auto dispatcher = loop.GetDispatcher();
+  const auto count = static_cast<size_t>(state.range(0));
+  size_t run_count = 0;
+  for (auto _ : state) {
+    for (size_t i = 0; i < count; i++) {
+      dispatcher->PostTask([&run_count]() { run_count++; });
+    }
+    loop.FlushTasksNow();
+  }
+  benchmark::DoNotOptimize(run_count);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EventLoopPostAndRunTasks)->Arg(1)->Arg(64)->Arg(1024);
+
+static void BM_EventLoopPostToThread(benchmark::State& state) {
+  Thread thread("Benchmark Thread");
+  auto dispatcher = thread.GetDispatcher();
+  std::atomic_size_t run_count = 0;
+  size_t posted_count = 0;
+  for (auto _ : state) {
+    dispatcher->PostTask(
+        [&run_count]() { run_count.fetch_add(1u, std::memory_order_relaxed); });
+    posted_count++;
+  }
+  // Include the time taken to drain the tasks.
+  while (run_count.load(std::memory_order_relaxed) != posted_count) {
+    std::this_thread::yield();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EventLoopPostToThread)->UseRealTime();
+
+// From posting a task to it having run on another thread. The calling thread
+// spins so that waking it up is not measured.
+static void BM_EventLoopCrossThreadLatency(benchmark::State& state) {
+  Thread thread("Benchmark Thread");
+  auto dispatcher = thread.GetDispatcher();
+  std::atomic_bool done = false;
+  for (auto _ : state) {
+    done.store(false, std::memory_order_relaxed);
+    dispatcher->PostTask(
+        [&done]() { done.store(true, std::memory_order_release); });
+    while (!done.load(std::memory_order_acquire)) {
+    }
+  }
+}
+BENCHMARK(BM_EventLoopCrossThreadLatency)->UseRealTime();
+
+}  // namespace testing
+}  // namespace pixel
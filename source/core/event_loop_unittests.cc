@@ -1,10 +1,24 @@
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <future>
 #include <mutex>
 #include <sstream>
+#include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "event_loop.h"
+#include "file.h"
+#include "logging.h"
+#include "mpsc_queue.h"
+#include "platform.h"
+
+#if P_OS_LINUX
+#include <unistd.h>
+#endif  // P_OS_LINUX
 
 namespace pixel {
 namespace testing {
@@ -48,5 +62,472 @@ TEST(EventLoopTest, CanRunAndPostTasks) {
   ASSERT_EQ(stream.str(), "abcde");
 };
 
+TEST(EventLoopTest, QueuePreservesPerProducerOrder) {
+  // A tiny ring so that most items end up in the overflow list.
+  MPSCQueue<size_t, 8> queue;
+
+  constexpr size_t kProducerCount = 4;
+  constexpr size_t kItemsPerProducer = 10000;
+
+  std::vector<std::thread> producers;
+  for (size_t producer = 0; producer < kProducerCount; producer++) {
+    producers.emplace_back([&queue, producer]() {
+      for (size_t i = 0; i < kItemsPerProducer; i++) {
+        queue.Push(producer * kItemsPerProducer + i);
+      }
+    });
+  }
+
+  std::vector<size_t> next_expected(kProducerCount, 0);
+  std::vector<size_t> items;
+  size_t received = 0;
+  while (received < kProducerCount * kItemsPerProducer) {
+    items.clear();
+    received += queue.PopAll(items);
+    for (const auto& item : items) {
+      const auto producer = item / kItemsPerProducer;
+      ASSERT_EQ(item % kItemsPerProducer, next_expected[producer]);
+      next_expected[producer]++;
+    }
+  }
+
+  for (auto& producer : producers) {
+    producer.join();
+  }
+
+  ASSERT_FALSE(queue.HasPendingItems());
+}
+
+TEST(EventLoopTest, CanPostTasksFromManyThreads) {
+  std::promise<std::shared_ptr<EventLoop::Dispatcher>> dispatcher_promise;
+  auto dispatcher_future = dispatcher_promise.get_future();
+  size_t tasks_run = 0;
+
+  std::thread loop_thread([&]() {
+    auto& loop = EventLoop::ForCurrentThread();
+    dispatcher_promise.set_value(loop.GetDispatcher());
+    loop.Run();
+  });
+
+  auto dispatcher = dispatcher_future.get();
+
+  std::vector<std::thread> posters;
+  for (size_t i = 0; i < 8; i++) {
+    posters.emplace_back([&]() {
+      for (size_t j = 0; j < 1000; j++) {
+        ASSERT_TRUE(dispatcher->PostTask([&]() { tasks_run++; }));
+      }
+    });
+  }
+
+  for (auto& poster : posters) {
+    poster.join();
+  }
+
+  dispatcher->PostTask([]() { EventLoop::ForCurrentThread().Terminate(); });
+  loop_thread.join();
+
+  ASSERT_EQ(tasks_run, 8000u);
+}
+
+TEST(EventLoopTest, DelayedTasksRunInDeadlineOrder) {
+  std::stringstream stream;
+  std::thread thread([&]() {
+    auto& loop = EventLoop::ForCurrentThread();
+    auto dispatcher = loop.GetDispatcher();
+    const auto now = EventLoop::Clock::now();
+    using Millis = std::chrono::milliseconds;
+
+    ASSERT_TRUE(dispatcher->PostTaskAt([&]() { stream << "d"; },
+                                       now + Millis(30)));
+    ASSERT_TRUE(dispatcher->PostTaskAt([&]() { stream << "b"; },
+                                       now + Millis(10)));
+    ASSERT_TRUE(dispatcher->PostTaskAt([&]() { stream << "c"; },
+                                       now + Millis(10)));
+    ASSERT_TRUE(dispatcher->PostTask([&]() { stream << "a"; }));
+    ASSERT_TRUE(dispatcher->PostTaskAt(
+        []() { EventLoop::ForCurrentThread().Terminate(); }, now + Millis(40)));
+    ASSERT_FALSE(dispatcher->PostDelayedTask(nullptr, Millis(10)));
+
+    ASSERT_TRUE(loop.Run());
+  });
+  thread.join();
+
+  ASSERT_EQ(stream.str(), "abcd");
+}
+
+TEST(EventLoopTest, DelayedTasksDoNotRunEarly) {
+  using Clock = EventLoop::Clock;
+  const auto delay = std::chrono::milliseconds(25);
+  Clock::time_point posted_at;
+  Clock::time_point ran_at;
+  std::thread thread([&]() {
+    auto& loop = EventLoop::ForCurrentThread();
+    posted_at = Clock::now();
+    loop.GetDispatcher()->PostDelayedTask(
+        [&]() {
+          ran_at = Clock::now();
+          EventLoop::ForCurrentThread().Terminate();
+        },
+        delay);
+    ASSERT_TRUE(loop.Run());
+  });
+  thread.join();
+
+  ASSERT_GE(ran_at - posted_at, delay);
+}
+
+TEST(EventLoopTest, TasksRunInPriorityOrder) {
+  std::stringstream stream;
+  std::thread thread([&]() {
+    auto& loop = EventLoop::ForCurrentThread();
+    auto dispatcher = loop.GetDispatcher();
+    dispatcher->PostTask([&]() { stream << "e"; },
+                         TaskPriority::kTaskPriorityIdle);
+    dispatcher->PostTask([&]() { stream << "c"; });
+    dispatcher->PostTask([&]() { stream << "a"; },
+                         TaskPriority::kTaskPriorityHigh);
+    dispatcher->PostTask([&]() { stream << "f"; },
+                         TaskPriority::kTaskPriorityIdle);
+    dispatcher->PostTask([&]() { stream << "d"; });
+    dispatcher->PostTask([&]() { stream << "b"; },
+                         TaskPriority::kTaskPriorityHigh);
+    ASSERT_TRUE(loop.FlushTasksNow());
+  });
+  thread.join();
+
+  ASSERT_EQ(stream.str(), "abcdef");
+}
+
+TEST(EventLoopTest, BudgetedFlushDefersLowPriorityTasks) {
+  std::stringstream stream;
+  std::thread thread([&]() {
+    auto& loop = EventLoop::ForCurrentThread();
+    auto dispatcher = loop.GetDispatcher();
+    for (auto name : {"i", "j", "k"}) {
+      dispatcher->PostTask([&, name]() { stream << name; },
+                           TaskPriority::kTaskPriorityIdle);
+    }
+    for (auto name : {"n", "o", "p"}) {
+      dispatcher->PostTask([&, name]() { stream << name; });
+    }
+    for (auto name : {"a", "b"}) {
+      dispatcher->PostTask([&, name]() { stream << name; },
+                           TaskPriority::kTaskPriorityHigh);
+    }
+
+    // All high priority tasks run. The other lanes get one task each.
+    ASSERT_TRUE(loop.FlushTasksFor(std::chrono::microseconds(0)));
+    ASSERT_EQ(stream.str(), "abni");
+
+    dispatcher->PostTask([&]() { stream << "c"; },
+                         TaskPriority::kTaskPriorityHigh);
+    ASSERT_TRUE(loop.FlushTasksFor(std::chrono::microseconds(0)));
+    ASSERT_EQ(stream.str(), "abnicoj");
+
+    // An unbounded flush drains everything.
+    ASSERT_TRUE(loop.FlushTasksNow());
+    ASSERT_EQ(stream.str(), "abnicojpk");
+  });
+  thread.join();
+}
+
+TEST(EventLoopTest, RecordsTaskStatistics) {
+  std::thread thread([&]() {
+    auto& loop = EventLoop::ForCurrentThread();
+    auto dispatcher = loop.GetDispatcher();
+    for (size_t i = 0; i < 3; i++) {
+      dispatcher->PostTask(
+          []() { std::this_thread::sleep_for(std::chrono::milliseconds(1)); },
+          TaskPriority::kTaskPriorityNormal, "Sleep");
+    }
+    dispatcher->PostTask([]() {});
+    dispatcher->PostDelayedTask([]() {}, std::chrono::hours(1));
+    ASSERT_TRUE(loop.FlushTasksNow());
+
+    auto statistics = loop.GetStatistics();
+    ASSERT_EQ(statistics.queue_depth, 5u);
+    ASSERT_EQ(statistics.max_queue_depth, 5u);
+    ASSERT_EQ(statistics.run_time.GetCount(), 4u);
+    ASSERT_EQ(statistics.latency.GetCount(), 4u);
+    ASSERT_GE(statistics.busy_time, std::chrono::milliseconds(3));
+    ASSERT_EQ(statistics.idle_time, std::chrono::nanoseconds::zero());
+    ASSERT_EQ(statistics.labels.size(), 1u);
+    const auto& sleep = statistics.labels.at("Sleep");
+    ASSERT_EQ(sleep.run_time.GetCount(), 3u);
+    ASSERT_GE(sleep.run_time.GetMax(), std::chrono::milliseconds(1));
+
+    // The unlabelled task waited behind the sleeps.
+    ASSERT_GE(statistics.latency.GetMax(), std::chrono::milliseconds(3));
+
+    // Statistics may be queried from any thread.
+    auto from_dispatcher = std::async(std::launch::async, [dispatcher]() {
+      return dispatcher->GetStatistics().run_time.GetCount();
+    });
+    ASSERT_EQ(from_dispatcher.get(), 4u);
+  });
+  thread.join();
+}
+
+TEST(EventLoopTest, ParkedTimeIsIdleTime) {
+  std::promise<std::shared_ptr<EventLoop::Dispatcher>> dispatcher_promise;
+  std::thread thread([&]() {
+    auto& loop = EventLoop::ForCurrentThread();
+    dispatcher_promise.set_value(loop.GetDispatcher());
+    loop.Run();
+  });
+  auto dispatcher = dispatcher_promise.get_future().get();
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  auto statistics = std::make_shared<EventLoopStatistics>();
+  dispatcher->PostTask([statistics]() {
+    auto& loop = EventLoop::ForCurrentThread();
+    *statistics = loop.GetStatistics();
+    loop.Terminate();
+  });
+  thread.join();
+  ASSERT_GE(statistics->idle_time, std::chrono::milliseconds(1));
+}
+
+#if P_OS_LINUX
+
+TEST(EventLoopTest, FileDescriptorSourcesWakeTheLoop) {
+  int pipe_fds[2] = {};
+  ASSERT_EQ(::pipe(pipe_fds), 0);
+  UniqueFD read_end(pipe_fds[0]);
+  UniqueFD write_end(pipe_fds[1]);
+
+  std::promise<void> added;
+  std::string received;
+  std::thread thread([&]() {
+    auto& loop = EventLoop::ForCurrentThread();
+    auto handle = loop.AddFileDescriptorSource(
+        read_end.Get(), kFileDescriptorEventReadable, [&](uint32_t events) {
+          ASSERT_TRUE(events & kFileDescriptorEventReadable);
+          char buffer[16] = {};
+          const auto size = ::read(read_end.Get(), buffer, sizeof(buffer));
+          ASSERT_GT(size, 0);
+          received.append(buffer, size);
+          if (received == "hello") {
+            EventLoop::ForCurrentThread().Terminate();
+          }
+        });
+    ASSERT_TRUE(handle.has_value());
+    added.set_value();
+    ASSERT_TRUE(loop.Run());
+    ASSERT_TRUE(loop.RemoveFileDescriptorSource(handle.value()));
+    ASSERT_FALSE(loop.RemoveFileDescriptorSource(handle.value()));
+  });
+
+  added.get_future().wait();
+  ASSERT_EQ(::write(write_end.Get(), "hel", 3), 3);
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  ASSERT_EQ(::write(write_end.Get(), "lo", 2), 2);
+  thread.join();
+
+  ASSERT_EQ(received, "hello");
+}
+
+TEST(EventLoopTest, FileDescriptorSourcesArePolledWhenFlushing) {
+  int pipe_fds[2] = {};
+  ASSERT_EQ(::pipe(pipe_fds), 0);
+  UniqueFD read_end(pipe_fds[0]);
+  UniqueFD write_end(pipe_fds[1]);
+
+  std::thread thread([&]() {
+    auto& loop = EventLoop::ForCurrentThread();
+    size_t callbacks = 0;
+    auto handle = loop.AddFileDescriptorSource(
+        read_end.Get(), kFileDescriptorEventReadable,
+        [&](uint32_t) { callbacks++; });
+    ASSERT_TRUE(handle.has_value());
+
+    ASSERT_TRUE(loop.FlushTasksNow());
+    ASSERT_EQ(callbacks, 0u);
+
+    ASSERT_EQ(::write(write_end.Get(), "a", 1), 1);
+    ASSERT_TRUE(loop.FlushTasksNow());
+    ASSERT_EQ(callbacks, 1u);
+
+    // Level-triggered till the data is read.
+    ASSERT_TRUE(loop.FlushTasksNow());
+    ASSERT_EQ(callbacks, 2u);
+
+    ASSERT_TRUE(loop.RemoveFileDescriptorSource(handle.value()));
+    ASSERT_TRUE(loop.FlushTasksNow());
+    ASSERT_EQ(callbacks, 2u);
+  });
+  thread.join();
+}
+
+#endif  // P_OS_LINUX
+
+// The mutex and condition variable guarded task queue used by the event loop
+// before it switched to the lock-free queue. Only kept around as a baseline for
+// the benchmark below.
+class MutexTaskQueue {
+ public:
+  void PostTask(Closure task) {
+    std::scoped_lock lock(mutex_);
+    tasks_.push_back(std::move(task));
+    cv_.notify_one();
+  }
+
+  void Run() {
+    while (running_) {
+      std::unique_lock lock(mutex_);
+      cv_.wait(lock, [&]() { return !tasks_.empty(); });
+      auto tasks = std::move(tasks_);
+      tasks_.clear();
+      lock.unlock();
+      for (const auto& task : tasks) {
+        task();
+      }
+    }
+  }
+
+  // May only be called from a task.
+  void Terminate() { running_ = false; }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<Closure> tasks_;
+  bool running_ = true;
+};
+
+struct TaskQueueBenchmarkResult {
+  double posts_per_second = 0.0;
+  double mean_latency_micros = 0.0;
+  double p99_latency_micros = 0.0;
+};
+
+template <class PostFunction>
+static TaskQueueBenchmarkResult BenchmarkTaskQueue(size_t posting_threads,
+                                                   size_t posts_per_thread,
+                                                   const PostFunction& post) {
+  using Clock = std::chrono::steady_clock;
+
+  // Only touched by the consumer.
+  struct State {
+    std::vector<Clock::duration> latencies;
+    std::promise<void> done;
+    size_t remaining = 0;
+  } state;
+
+  state.remaining = posting_threads * posts_per_thread;
+  state.latencies.reserve(state.remaining);
+  auto done_future = state.done.get_future();
+
+  std::mutex start_mutex;
+  std::condition_variable start_cv;
+  bool started = false;
+
+  std::vector<std::thread> posters;
+  for (size_t i = 0; i < posting_threads; i++) {
+    posters.emplace_back([&]() {
+      {
+        std::unique_lock lock(start_mutex);
+        start_cv.wait(lock, [&]() { return started; });
+      }
+      for (size_t j = 0; j < posts_per_thread; j++) {
+        post([state = &state, posted_at = Clock::now()]() {
+          state->latencies.push_back(Clock::now() - posted_at);
+          if (--state->remaining == 0) {
+            state->done.set_value();
+          }
+        });
+      }
+    });
+  }
+
+  const auto start = Clock::now();
+  {
+    std::scoped_lock lock(start_mutex);
+    started = true;
+  }
+  start_cv.notify_all();
+
+  done_future.wait();
+  const auto elapsed = Clock::now() - start;
+
+  for (auto& poster : posters) {
+    poster.join();
+  }
+
+  std::sort(state.latencies.begin(), state.latencies.end());
+
+  using Micros = std::chrono::duration<double, std::micro>;
+  using Seconds = std::chrono::duration<double>;
+
+  TaskQueueBenchmarkResult result;
+  result.posts_per_second = state.latencies.size() /
+                            std::chrono::duration_cast<Seconds>(elapsed).count();
+  Clock::duration total_latency = {};
+  for (const auto& latency : state.latencies) {
+    total_latency += latency;
+  }
+  result.mean_latency_micros =
+      std::chrono::duration_cast<Micros>(total_latency).count() /
+      state.latencies.size();
+  result.p99_latency_micros =
+      std::chrono::duration_cast<Micros>(
+          state.latencies[state.latencies.size() * 99 / 100])
+          .count();
+  return result;
+}
+
+static TaskQueueBenchmarkResult BenchmarkEventLoop(size_t posting_threads,
+                                                   size_t posts_per_thread) {
+  std::promise<std::shared_ptr<EventLoop::Dispatcher>> dispatcher_promise;
+  auto dispatcher_future = dispatcher_promise.get_future();
+  std::thread loop_thread([&]() {
+    auto& loop = EventLoop::ForCurrentThread();
+    dispatcher_promise.set_value(loop.GetDispatcher());
+    loop.Run();
+  });
+  auto dispatcher = dispatcher_future.get();
+
+  auto result = BenchmarkTaskQueue(
+      posting_threads, posts_per_thread,
+      [&](auto task) { dispatcher->PostTask(std::move(task)); });
+
+  dispatcher->PostTask([]() { EventLoop::ForCurrentThread().Terminate(); });
+  loop_thread.join();
+  return result;
+}
+
+static TaskQueueBenchmarkResult BenchmarkMutexTaskQueue(
+    size_t posting_threads,
+    size_t posts_per_thread) {
+  MutexTaskQueue queue;
+  std::thread loop_thread([&]() { queue.Run(); });
+
+  auto result = BenchmarkTaskQueue(
+      posting_threads, posts_per_thread,
+      [&](auto task) { queue.PostTask(std::move(task)); });
+
+  queue.PostTask([&]() { queue.Terminate(); });
+  loop_thread.join();
+  return result;
+}
+
+TEST(EventLoopTest, TaskQueueContentionBenchmark) {
+  constexpr size_t kTotalPosts = 1 << 16;
+
+  P_LOG << "Posting Threads | Queue | Posts/sec | Mean Latency (us) | P99 "
+           "Latency (us)";
+  for (size_t threads : {1u, 2u, 4u, 8u, 16u}) {
+    const auto lock_free = BenchmarkEventLoop(threads, kTotalPosts / threads);
+    const auto mutex = BenchmarkMutexTaskQueue(threads, kTotalPosts / threads);
+    ASSERT_GT(lock_free.posts_per_second, 0.0);
+    ASSERT_GT(mutex.posts_per_second, 0.0);
+    P_LOG << threads << " | Lock-Free | " << lock_free.posts_per_second << " | "
+          << lock_free.mean_latency_micros << " | "
+          << lock_free.p99_latency_micros;
+    P_LOG << threads << " | Mutex | " << mutex.posts_per_second << " | "
+          << mutex.mean_latency_micros << " | " << mutex.p99_latency_micros;
+  }
+}
+
 }  // namespace testing
 }  // namespace pixel
@@ -29,6 +29,28 @@
 
 namespace pixel {
 
+#if P_OS_WINDOWS
+static void PrefetchRange(const uint8_t* data, size_t length) {
+  WIN32_MEMORY_RANGE_ENTRY range = {};
+  range.VirtualAddress = const_cast<uint8_t*>(data);
+  range.NumberOfBytes = length;
+  ::PrefetchVirtualMemory(::GetCurrentProcess(), 1u, &range, 0);
+}
+#else   // P_OS_WINDOWS
+// Advice must start on a page boundary.
+static void AdviseRange(const uint8_t* data, size_t length, int advice) {
+  static const auto page_size = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+  const auto begin = reinterpret_cast<uintptr_t>(data);
+  const auto aligned_begin = begin & ~(page_size - 1u);
+  ::madvise(reinterpret_cast<void*>(aligned_begin),
+            length + (begin - aligned_begin), advice);
+}
+
+static void PrefetchRange(const uint8_t* data, size_t length) {
+  AdviseRange(data, length, MADV_WILLNEED);
+}
+#endif  // P_OS_WINDOWS
+
 class FileMapping : public Mapping {
  public:
   struct Data {
@@ -61,6 +83,18 @@ class FileMapping : public Mapping {
   // |Mapping|
   size_t GetSize() const override { return data_.size; }
 
+  // |Mapping|
+  bool Prefetch(size_t offset, size_t length) const override {
+    if (!Mapping::Prefetch(offset, length)) {
+      return false;
+    }
+    if (length == 0) {
+      return true;
+    }
+    PrefetchRange(data_.mapping + offset, length);
+    return true;
+  }
+
  private:
   Data data_;
 
@@ -95,19 +129,35 @@ void FDTraits::Collect(Handle fd) {
 }
 
 std::unique_ptr<Mapping> OpenFile(const std::filesystem::path& file_path) {
+  return OpenFile(file_path, FileMappingOptions{});
+}
+
+std::unique_ptr<Mapping> OpenFile(const std::filesystem::path& file_path,
+                                  const FileMappingOptions& options) {
   if (file_path.empty()) {
     P_ERROR << "File path was empty.";
     return nullptr;
   }
 
 #if P_OS_WINDOWS
+  DWORD flags = FILE_ATTRIBUTE_NORMAL;
+  switch (options.access_pattern) {
+    case FileAccessPattern::kFileAccessPatternNormal:
+      break;
+    case FileAccessPattern::kFileAccessPatternSequential:
+      flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+      break;
+    case FileAccessPattern::kFileAccessPatternRandom:
+      flags |= FILE_FLAG_RANDOM_ACCESS;
+      break;
+  }
   UniqueFD fd(::CreateFileW(file_path.c_str(),  // lpFileName
                             GENERIC_READ,       // dwDesiredAccess
                             FILE_SHARE_READ | FILE_SHARE_WRITE,  // dwShareMode
-                            nullptr,                // lpSecurityAttributes
-                            OPEN_EXISTING,          // dwCreationDisposition
-                            FILE_ATTRIBUTE_NORMAL,  // dwFlagsAndAttributes
-                            nullptr                 // hTemplateFile
+                            nullptr,        // lpSecurityAttributes
+                            OPEN_EXISTING,  // dwCreationDisposition
+                            flags,          // dwFlagsAndAttributes
+                            nullptr         // hTemplateFile
                             ));
   if (!fd.IsValid()) {
     P_ERROR << "Could not open FD for file: " << file_path
@@ -147,6 +197,12 @@ std::unique_ptr<Mapping> OpenFile(const std::filesystem::path& file_path) {
     return nullptr;
   }
 
+  // There is no way to fault the mapping in synchronously. Prefetching is the
+  // closest equivalent.
+  if (options.will_need || options.populate) {
+    PrefetchRange(mapping, mapping_size);
+  }
+
   FileMapping::Data mapping_data;
   mapping_data.mapping = mapping;
   mapping_data.size = mapping_size;
@@ -170,16 +226,62 @@ std::unique_ptr<Mapping> OpenFile(const std::filesystem::path& file_path) {
     return nullptr;
   }
 
-  auto mapping_ptr = ::mmap(nullptr, stat_buf.st_size, PROT_READ,
-                            MAP_FILE | MAP_PRIVATE, fd.Get(), 0);
+  const size_t mapping_size = stat_buf.st_size;
+
+#if P_OS_LINUX
+  // Page cache advice applies to reads that fault in the mapping too.
+  switch (options.access_pattern) {
+    case FileAccessPattern::kFileAccessPatternNormal:
+      break;
+    case FileAccessPattern::kFileAccessPatternSequential:
+      ::posix_fadvise(fd.Get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+      break;
+    case FileAccessPattern::kFileAccessPatternRandom:
+      ::posix_fadvise(fd.Get(), 0, 0, POSIX_FADV_RANDOM);
+      break;
+  }
+  if (options.will_need) {
+    ::posix_fadvise(fd.Get(), 0, 0, POSIX_FADV_WILLNEED);
+  }
+#endif  // P_OS_LINUX
+
+  int mmap_flags = MAP_FILE | MAP_PRIVATE;
+#ifdef MAP_POPULATE
+  if (options.populate) {
+    mmap_flags |= MAP_POPULATE;
+  }
+#endif  // MAP_POPULATE
+
+  auto mapping_ptr =
+      ::mmap(nullptr, mapping_size, PROT_READ, mmap_flags, fd.Get(), 0);
   if (mapping_ptr == MAP_FAILED) {
     P_ERROR << "Could not mmap file descriptor.";
     return nullptr;
   }
 
+  const auto mapping = reinterpret_cast<uint8_t*>(mapping_ptr);
+  switch (options.access_pattern) {
+    case FileAccessPattern::kFileAccessPatternNormal:
+      break;
+    case FileAccessPattern::kFileAccessPatternSequential:
+      AdviseRange(mapping, mapping_size, MADV_SEQUENTIAL);
+      break;
+    case FileAccessPattern::kFileAccessPatternRandom:
+      AdviseRange(mapping, mapping_size, MADV_RANDOM);
+      break;
+  }
+  if (options.will_need) {
+    AdviseRange(mapping, mapping_size, MADV_WILLNEED);
+  }
+#ifdef MADV_HUGEPAGE
+  if (options.huge_pages) {
+    AdviseRange(mapping, mapping_size, MADV_HUGEPAGE);
+  }
+#endif  // MADV_HUGEPAGE
+
   FileMapping::Data mapping_data;
-  mapping_data.mapping = reinterpret_cast<uint8_t*>(mapping_ptr);
-  mapping_data.size = stat_buf.st_size;
+  mapping_data.mapping = mapping;
+  mapping_data.size = mapping_size;
   return std::make_unique<FileMapping>(std::move(mapping_data));
 #endif  // P_OS_WINDOWS
 }
@@ -198,6 +300,11 @@ std::filesystem::path GetCurrentExecutablePath() {
   return {std::string{path, read_size}};
 #elif P_OS_MAC
   return {std::string{[NSBundle mainBundle].executablePath.UTF8String}};
+#elif P_OS_LINUX
+  std::error_code error;
+  auto path = std::filesystem::read_symlink("/proc/self/exe", error);
+  P_ASSERT(!error);
+  return path;
 #else
 #error Not currently supported on this platform.
   return {};
@@ -27,10 +27,39 @@ struct FDTraits {
 
 using UniqueFD = UniqueObject<FDTraits::Handle, FDTraits>;
 
+enum class FileAccessPattern {
+  // Let the platform pick how much to read ahead.
+  kFileAccessPatternNormal,
+  // Read ahead aggressively and drop pages soon after they have been read.
+  kFileAccessPatternSequential,
+  // Don't read ahead.
+  kFileAccessPatternRandom,
+};
+
+struct FileMappingOptions {
+  FileAccessPattern access_pattern =
+      FileAccessPattern::kFileAccessPatternNormal;
+  // Start reading the whole file in the background.
+  bool will_need = false;
+  // Read the whole file before returning so that no reads of the mapping
+  // fault. Only on Linux and Windows.
+  bool populate = false;
+  // Allow the mapping to be backed by transparent huge pages. Only on Linux,
+  // and only if the kernel and the file system support it for file mappings.
+  bool huge_pages = false;
+};
+
 std::unique_ptr<Mapping> OpenFile(const char* file_name);
 
 std::unique_ptr<Mapping> OpenFile(const std::filesystem::path& path);
 
+//------------------------------------------------------------------------------
+/// @brief      Map a file with hints about how it is going to be read. The
+///             hints are only hints and failing to apply them is not an error.
+///
+std::unique_ptr<Mapping> OpenFile(const std::filesystem::path& path,
+                                  const FileMappingOptions& options);
+
 std::filesystem::path GetCurrentExecutablePath();
 
 }  // namespace pixel
@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <vector>
+
+#include "atomic_file_writer.h"
+#include "file.h"
+#include "logging.h"
+
+namespace pixel {
+namespace testing {
+
+static std::filesystem::path CreateBenchmarkFile(size_t size) {
+  auto path = std::filesystem::temp_directory_path() /
+              ("pixel_benchmark_" + std::to_string(size) + ".bin");
+  std::vector<uint8_t> contents(size);
+  for (size_t i = 0; i < size; i++) {
+    contents[i] = static_cast<uint8_t>(i * 31u);
+  }
+  if (!AtomicFileWriter::WriteFile(path, contents.data(), contents.size(),
+                                   false)) {
+    return {};
+  }
+  return path;
+}
+
+static void OpenFileBenchmark(benchmark::State& state,
+                              const FileMappingOptions& options,
+                              bool touch_pages) {
+  const auto size = static_cast<size_t>(state.range(0));
+  const auto path = CreateBenchmarkFile(size);
+  if (path.empty()) {
+    state.SkipWithError("Could not create the file to map.");
+    return;
+  }
+  for (auto _ : state) {
+    auto mapping = OpenFile(path, options);
+    if (!mapping) {
+      state.SkipWithError("Could not map the file.");
+      break;
+    }
+    if (touch_pages) {
+      uint8_t sum = 0;
+      const auto data = mapping->GetData();
+      for (size_t i = 0; i < mapping->GetSize(); i += 4096u) {
+        sum += data[i];
+      }
+      benchmark::DoNotOptimize(sum);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+  std::error_code error;
+  std::filesystem::remove(path, error);
+}
+
+static void BM_OpenFile(benchmark::State& state) {
+  OpenFileBenchmark(state, {}, false);
+}
+BENCHMARK(BM_OpenFile)->Arg(4 << 10)->Arg(64 << 20);
+
+// Faults in every page of the mapping.
+static void BM_OpenFileAndTouchPages(benchmark::State& state) {
+  OpenFileBenchmark(state, {}, true);
+}
+BENCHMARK(BM_OpenFileAndTouchPages)->Arg(4 << 10)->Arg(64 << 20);
+
+static void BM_OpenFilePopulated(benchmark::State& state) {
+  FileMappingOptions options;
+  options.populate = true;
+  OpenFileBenchmark(state, options, true);
+}
+BENCHMARK(BM_OpenFilePopulated)->Arg(4 << 10)->Arg(64 << 20);
+
+}  // namespace testing
+}  // namespace pixel
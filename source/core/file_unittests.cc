@@ -1,6 +1,8 @@
 
 #include <gtest/gtest.h>
 
+#include <string_view>
+
 #include "file.h"
 #include "fixture.h"
 
@@ -15,5 +17,43 @@ TEST(File, CanMemoryMapFile) {
   ASSERT_FALSE(does_not_exist);
 }
 
+TEST(File, CanMemoryMapFileWithOptions) {
+  auto plain = OpenFile(P_FIXTURES_LOCATION "hello.txt");
+  ASSERT_TRUE(plain);
+  const std::string_view expected(
+      reinterpret_cast<const char*>(plain->GetData()), plain->GetSize());
+
+  for (auto pattern : {FileAccessPattern::kFileAccessPatternNormal,
+                       FileAccessPattern::kFileAccessPatternSequential,
+                       FileAccessPattern::kFileAccessPatternRandom}) {
+    FileMappingOptions options;
+    options.access_pattern = pattern;
+    options.will_need = true;
+    options.populate = true;
+    options.huge_pages = true;
+    auto mapping = OpenFile(P_FIXTURES_LOCATION "hello.txt", options);
+    ASSERT_TRUE(mapping);
+    const std::string_view contents(
+        reinterpret_cast<const char*>(mapping->GetData()), mapping->GetSize());
+    ASSERT_EQ(contents, expected);
+  }
+}
+
+TEST(File, CanPrefetchRangesOfMapping) {
+  auto hello = OpenFile(P_FIXTURES_LOCATION "hello.txt");
+  ASSERT_TRUE(hello);
+  const auto size = hello->GetSize();
+  ASSERT_GT(size, 1u);
+  ASSERT_TRUE(hello->Prefetch(0u, size));
+  ASSERT_TRUE(hello->Prefetch(1u, size - 1u));
+  ASSERT_TRUE(hello->Prefetch(size, 0u));
+  ASSERT_FALSE(hello->Prefetch(1u, size));
+  ASSERT_FALSE(hello->Prefetch(size + 1u, 0u));
+
+  auto copy = CopyMapping(hello->GetData(), size);
+  ASSERT_TRUE(copy->Prefetch(0u, size));
+  ASSERT_FALSE(copy->Prefetch(0u, size + 1u));
+}
+
 }  // namespace testing
 }  // namespace pixel
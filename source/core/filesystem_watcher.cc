@@ -6,6 +6,8 @@
 #include "filesystem_watcher_win.h"
 #elif P_OS_MAC
 #include "filesystem_watcher_darwin.h"
+#elif P_OS_LINUX
+#include "filesystem_watcher_linux.h"
 #endif
 
 namespace pixel {
@@ -17,6 +19,9 @@ FileSystemWatcher& FileSystemWatcher::ForProcess() {
 #elif P_OS_MAC
   static FileSystemWatcherDarwin watcher;
   return watcher;
+#elif P_OS_LINUX
+  static FileSystemWatcherLinux watcher;
+  return watcher;
 #else
 #error This platform has no FS watcher.
 #endif
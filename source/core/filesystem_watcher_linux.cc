@@ -0,0 +1,192 @@
+#include "filesystem_watcher_linux.h"
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "logging.h"
+
+namespace pixel {
+
+// Editors either write the file in place or write a temporary file and rename
+// it over the original.
+static constexpr uint32_t kDirectoryWatchMask =
+    IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR;
+
+FileSystemWatcherLinux::FileSystemWatcherLinux(
+    std::chrono::milliseconds coalesce_window)
+    : coalesce_window_(coalesce_window),
+      inotify_fd_(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+      thread_("FS Watcher") {
+  if (!inotify_fd_.IsValid()) {
+    P_ERROR << "Could not create inotify instance: " << strerror(errno)
+            << ". Expect no filesystem updates.";
+    return;
+  }
+  thread_.GetDispatcher()->PostTask(
+      [this]() { StartWatchingInotify(); },
+      TaskPriority::kTaskPriorityNormal, "FS Watcher Setup");
+}
+
+FileSystemWatcherLinux::~FileSystemWatcherLinux() {
+  Terminate();
+}
+
+void FileSystemWatcherLinux::StartWatchingInotify() {
+  auto source = EventLoop::ForCurrentThread().AddFileDescriptorSource(
+      inotify_fd_.Get(), kFileDescriptorEventReadable,
+      [this](uint32_t events) { OnInotifyReadable(); });
+  if (!source.has_value()) {
+    P_ERROR << "Could not watch the inotify instance. Expect no filesystem "
+               "updates.";
+  }
+}
+
+std::optional<size_t> FileSystemWatcherLinux::WatchPathForUpdates(
+    std::filesystem::path path,
+    Closure change_callback) {
+  if (path.empty() || !path.has_parent_path() || !path.has_filename() ||
+      change_callback == nullptr || !inotify_fd_.IsValid()) {
+    return std::nullopt;
+  }
+
+  const auto directory = path.parent_path();
+
+  std::scoped_lock lock(mutex_);
+  if (terminated_) {
+    return std::nullopt;
+  }
+
+  // Watching a directory that is already watched returns the same descriptor.
+  const auto directory_watch = ::inotify_add_watch(
+      inotify_fd_.Get(), directory.c_str(), kDirectoryWatchMask);
+  if (directory_watch < 0) {
+    P_ERROR << "Could not setup watcher for " << path << ": "
+            << strerror(errno);
+    return std::nullopt;
+  }
+
+  const auto handle = ++last_handle_;
+  watches_[handle] = {directory_watch, path.filename().string(),
+                      std::move(change_callback)};
+  directory_watches_[directory_watch].insert(handle);
+  return handle;
+}
+
+bool FileSystemWatcherLinux::StopWatchingForUpdates(size_t handle) {
+  std::scoped_lock lock(mutex_);
+  auto found = watches_.find(handle);
+  if (found == watches_.end()) {
+    return false;
+  }
+  RemoveDirectoryWatchLocked(found->second.directory_watch, handle);
+  // Callbacks already scheduled will find the watch gone.
+  watches_.erase(found);
+  return true;
+}
+
+void FileSystemWatcherLinux::Terminate() {
+  std::scoped_lock lock(mutex_);
+  terminated_ = true;
+  for (const auto& directory_watch : directory_watches_) {
+    ::inotify_rm_watch(inotify_fd_.Get(), directory_watch.first);
+  }
+  directory_watches_.clear();
+  watches_.clear();
+}
+
+void FileSystemWatcherLinux::RemoveDirectoryWatchLocked(int directory_watch,
+                                                        size_t handle) {
+  auto found = directory_watches_.find(directory_watch);
+  if (found == directory_watches_.end()) {
+    return;
+  }
+  found->second.erase(handle);
+  if (found->second.empty()) {
+    ::inotify_rm_watch(inotify_fd_.Get(), directory_watch);
+    directory_watches_.erase(found);
+  }
+}
+
+void FileSystemWatcherLinux::OnInotifyReadable() {
+  alignas(struct inotify_event) char buffer[16 * 1024];
+  while (true) {
+    const auto read_size =
+        P_TEMP_FAILURE_RETRY(::read(inotify_fd_.Get(), buffer, sizeof(buffer)));
+    if (read_size <= 0) {
+      // EAGAIN once the queue has been drained.
+      return;
+    }
+    std::scoped_lock lock(mutex_);
+    for (ssize_t offset = 0; offset < read_size;) {
+      const auto event =
+          reinterpret_cast<const struct inotify_event*>(buffer + offset);
+      offset += sizeof(struct inotify_event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        // Updates were dropped. Any of the files may have changed.
+        DispatchAllLocked();
+        continue;
+      }
+      if (event->mask & IN_IGNORED) {
+        // The directory is gone or was unwatched. The watches stay around so
+        // their handles remain valid but will not see updates again.
+        directory_watches_.erase(event->wd);
+        continue;
+      }
+      if (event->len > 0) {
+        OnDirectoryDidUpdate(event->wd, event->name);
+      }
+    }
+  }
+}
+
+void FileSystemWatcherLinux::OnDirectoryDidUpdate(int directory_watch,
+                                                  const char* file_name) {
+  auto found = directory_watches_.find(directory_watch);
+  if (found == directory_watches_.end()) {
+    return;
+  }
+  for (auto handle : found->second) {
+    auto& watch = watches_[handle];
+    if (watch.file_name == file_name) {
+      ScheduleCallbackLocked(handle, watch);
+    }
+  }
+}
+
+void FileSystemWatcherLinux::DispatchAllLocked() {
+  for (auto& watch : watches_) {
+    ScheduleCallbackLocked(watch.first, watch.second);
+  }
+}
+
+void FileSystemWatcherLinux::ScheduleCallbackLocked(size_t handle,
+                                                    Watch& watch) {
+  if (watch.is_pending) {
+    // Coalesced into the callback that is already scheduled.
+    return;
+  }
+  watch.is_pending = true;
+  thread_.GetDispatcher()->PostDelayedTask(
+      [this, handle]() {
+        Closure callback;
+        {
+          std::scoped_lock lock(mutex_);
+          auto found = watches_.find(handle);
+          if (found == watches_.end()) {
+            return;
+          }
+          found->second.is_pending = false;
+          callback = found->second.callback;
+        }
+        // Outside the lock so the callback may stop watching.
+        callback();
+      },
+      coalesce_window_, TaskPriority::kTaskPriorityNormal,
+      "FS Watcher Update");
+}
+
+}  // namespace pixel
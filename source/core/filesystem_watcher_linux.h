@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+
+#include "closure.h"
+#include "file.h"
+#include "filesystem_watcher.h"
+#include "macros.h"
+#include "thread.h"
+
+namespace pixel {
+
+//------------------------------------------------------------------------------
+/// @brief      Watches files using inotify. The parent directory of each file
+///             is watched instead of the file itself so that editors that save
+///             by renaming a temporary file over the original are caught.
+///
+///             The inotify descriptor is a file descriptor source on the event
+///             loop of a dedicated thread. Callbacks are invoked on that
+///             thread. A burst of updates to the same file only invokes its
+///             callback once the coalescing window after the first update has
+///             elapsed.
+///
+class FileSystemWatcherLinux final : public FileSystemWatcher {
+ public:
+  static constexpr auto kDefaultCoalesceWindow = std::chrono::milliseconds(50);
+
+  FileSystemWatcherLinux(
+      std::chrono::milliseconds coalesce_window = kDefaultCoalesceWindow);
+
+  // |FileSystemWatcher|
+  ~FileSystemWatcherLinux() override;
+
+  // |FileSystemWatcher|
+  std::optional<size_t> WatchPathForUpdates(std::filesystem::path path,
+                                            Closure change_callback) override;
+
+  // |FileSystemWatcher|
+  bool StopWatchingForUpdates(size_t handle) override;
+
+  // |FileSystemWatcher|
+  void Terminate() override;
+
+ private:
+  struct Watch {
+    int directory_watch = -1;
+    std::string file_name;
+    Closure callback;
+    // Set while a callback is scheduled for the current burst of updates.
+    bool is_pending = false;
+  };
+
+  const std::chrono::milliseconds coalesce_window_;
+  UniqueFD inotify_fd_;
+  std::mutex mutex_;
+  std::atomic_size_t last_handle_ = 0;
+  // Keyed by handle.
+  std::map<size_t, Watch> watches_;
+  // The handles of the watches on each watched directory. inotify hands out
+  // the same watch descriptor for the same directory.
+  std::map<int, std::set<size_t>> directory_watches_;
+  bool terminated_ = false;
+  // Must be last so that the thread is gone before the rest is collected.
+  Thread thread_;
+
+  void StartWatchingInotify();
+
+  void OnInotifyReadable();
+
+  void DispatchAllLocked();
+
+  void OnDirectoryDidUpdate(int directory_watch, const char* file_name);
+
+  void ScheduleCallbackLocked(size_t handle, Watch& watch);
+
+  void RemoveDirectoryWatchLocked(int directory_watch, size_t handle);
+
+  P_DISALLOW_COPY_AND_ASSIGN(FileSystemWatcherLinux);
+};
+
+}  // namespace pixel
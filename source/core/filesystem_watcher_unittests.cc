@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <fstream>
+#include <future>
+#include <thread>
+
+#include "platform.h"
+
+#if P_OS_LINUX
+
+#include "filesystem_watcher_linux.h"
+#include "scoped_temp_directory.h"
+
+namespace pixel {
+namespace testing {
+
+static void WriteFile(const std::filesystem::path& path,
+                      const std::string& contents) {
+  std::ofstream stream(path);
+  stream << contents;
+}
+
+TEST(FileSystemWatcherLinuxTest, CoalescesBurstsOfUpdates) {
+  ScopedTempDirectory temp_directory("pixel_watch");
+  ASSERT_TRUE(temp_directory.IsValid());
+  const auto& directory = temp_directory.GetPath();
+  const auto path = directory / "shader.frag";
+  WriteFile(path, "0");
+
+  FileSystemWatcherLinux watcher(std::chrono::milliseconds(200));
+  std::atomic_size_t count = 0;
+  std::promise<void> updated;
+  auto handle = watcher.WatchPathForUpdates(path, [&]() {
+    if (count++ == 0) {
+      updated.set_value();
+    }
+  });
+  ASSERT_TRUE(handle.has_value());
+
+  for (size_t i = 0; i < 5; i++) {
+    WriteFile(path, std::to_string(i));
+  }
+  updated.get_future().wait();
+  std::this_thread::sleep_for(std::chrono::milliseconds(400));
+  ASSERT_EQ(count, 1u);
+
+  ASSERT_TRUE(watcher.StopWatchingForUpdates(handle.value()));
+  ASSERT_FALSE(watcher.StopWatchingForUpdates(handle.value()));
+}
+
+TEST(FileSystemWatcherLinuxTest, SeesFilesRenamedOverTheWatchedFile) {
+  ScopedTempDirectory temp_directory("pixel_watch");
+  ASSERT_TRUE(temp_directory.IsValid());
+  const auto& directory = temp_directory.GetPath();
+  const auto path = directory / "shader.frag";
+  WriteFile(path, "0");
+
+  FileSystemWatcherLinux watcher(std::chrono::milliseconds(10));
+  std::promise<void> updated;
+  auto handle =
+      watcher.WatchPathForUpdates(path, [&]() { updated.set_value(); });
+  ASSERT_TRUE(handle.has_value());
+
+  // Updates to other files in the same directory are not reported.
+  WriteFile(directory / "shader.frag.swp", "1");
+  std::filesystem::rename(directory / "shader.frag.swp", path);
+  updated.get_future().wait();
+
+  ASSERT_TRUE(watcher.StopWatchingForUpdates(handle.value()));
+}
+
+TEST(FileSystemWatcherLinuxTest, SharesDirectoryWatches) {
+  ScopedTempDirectory temp_directory("pixel_watch");
+  ASSERT_TRUE(temp_directory.IsValid());
+  const auto& directory = temp_directory.GetPath();
+  FileSystemWatcherLinux watcher(std::chrono::milliseconds(10));
+  std::atomic_size_t first_count = 0;
+  std::promise<void> second_updated;
+  auto first = watcher.WatchPathForUpdates(directory / "first.frag",
+                                           [&]() { first_count++; });
+  auto second = watcher.WatchPathForUpdates(
+      directory / "second.frag", [&]() { second_updated.set_value(); });
+  ASSERT_TRUE(first.has_value());
+  ASSERT_TRUE(second.has_value());
+
+  // The directory must still be watched for the second file.
+  ASSERT_TRUE(watcher.StopWatchingForUpdates(first.value()));
+  WriteFile(directory / "first.frag", "1");
+  WriteFile(directory / "second.frag", "1");
+  second_updated.get_future().wait();
+  ASSERT_EQ(first_count, 0u);
+
+  watcher.Terminate();
+  ASSERT_FALSE(watcher.StopWatchingForUpdates(second.value()));
+  auto third = watcher.WatchPathForUpdates(directory / "third.frag", []() {});
+  ASSERT_FALSE(third.has_value());
+}
+
+}  // namespace testing
+}  // namespace pixel
+
+#endif  // P_OS_LINUX
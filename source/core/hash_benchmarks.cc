@@ -0,0 +1,30 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "hash.h"
+
+namespace pixel {
+namespace testing {
+
+static void BM_HashCombineIntegers(benchmark::State& state) {
+  size_t a = 1, b = 2, c = 3, d = 4;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a);
+    benchmark::DoNotOptimize(HashCombine(a, b, c, d));
+  }
+}
+BENCHMARK(BM_HashCombineIntegers);
+
+static void BM_HashCombineMixed(benchmark::State& state) {
+  const std::string string = "baseColorTexture";
+  const float scalar = 0.5f;
+  const bool flag = true;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(HashCombine(string, scalar, flag));
+  }
+}
+BENCHMARK(BM_HashCombineMixed);
+
+}  // namespace testing
+}  // namespace pixel
@@ -1 +1,424 @@
 #include "logging.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "thread.h"
+
+namespace pixel {
+
+static std::atomic<LogLevel> gLogLevel = LogLevel::kLogLevelInfo;
+static std::atomic<uint64_t> gSuppressedCount = 0;
+
+void SetLogLevel(LogLevel level) {
+  gLogLevel.store(level, std::memory_order_relaxed);
+}
+
+LogLevel GetLogLevel() {
+  return gLogLevel.load(std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+/// @brief      A single-producer single-consumer ring of variable length
+///             records. The producer is the thread that owns the ring and the
+///             consumer is the logging thread.
+///
+class LogRing {
+ public:
+  static constexpr size_t kCapacity = 64u * 1024u;
+  // Longer messages are truncated.
+  static constexpr size_t kMaxMessageSize = kCapacity / 8u;
+
+  LogRing() : data_(std::make_unique<uint8_t[]>(kCapacity)) {}
+
+  ~LogRing() = default;
+
+  // Producer only.
+  bool TryWrite(LogLevel level, std::string_view message) {
+    message = message.substr(0u, kMaxMessageSize);
+    const Header header = {static_cast<uint32_t>(message.size()),
+                           static_cast<uint32_t>(level)};
+    const auto record_size = sizeof(Header) + message.size();
+    const auto write = write_position_.load(std::memory_order_relaxed);
+    const auto read = read_position_.load(std::memory_order_acquire);
+    if (kCapacity - (write - read) < record_size) {
+      dropped_.fetch_add(1u, std::memory_order_relaxed);
+      return false;
+    }
+    CopyIn(write, &header, sizeof(Header));
+    CopyIn(write + sizeof(Header), message.data(), message.size());
+    write_position_.store(write + record_size, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only.
+  template <class Callback>
+  size_t Drain(std::string& scratch, const Callback& callback) {
+    auto read = read_position_.load(std::memory_order_relaxed);
+    const auto write = write_position_.load(std::memory_order_acquire);
+    size_t count = 0;
+    while (read != write) {
+      Header header = {};
+      CopyOut(read, &header, sizeof(Header));
+      scratch.resize(header.size);
+      CopyOut(read + sizeof(Header), scratch.data(), header.size);
+      read += sizeof(Header) + header.size;
+      // Free up the space as soon as possible for the producer.
+      read_position_.store(read, std::memory_order_release);
+      callback(static_cast<LogLevel>(header.level), scratch);
+      count++;
+    }
+    return count;
+  }
+
+  // Consumer only.
+  bool IsEmpty() const {
+    return read_position_.load(std::memory_order_relaxed) ==
+           write_position_.load(std::memory_order_acquire);
+  }
+
+  size_t TakeDroppedCount() {
+    return dropped_.exchange(0u, std::memory_order_relaxed);
+  }
+
+ private:
+  struct Header {
+    uint32_t size = 0;
+    uint32_t level = 0;
+  };
+
+  std::unique_ptr<uint8_t[]> data_;
+  // Both positions only ever increase. They wrap around the ring.
+  alignas(64) std::atomic_size_t write_position_ = 0;
+  alignas(64) std::atomic_size_t read_position_ = 0;
+  std::atomic_size_t dropped_ = 0;
+
+  void CopyIn(size_t position, const void* source, size_t size) {
+    const auto offset = position & (kCapacity - 1u);
+    const auto first_size = std::min(size, kCapacity - offset);
+    ::memcpy(data_.get() + offset, source, first_size);
+    ::memcpy(data_.get(), static_cast<const uint8_t*>(source) + first_size,
+             size - first_size);
+  }
+
+  void CopyOut(size_t position, void* destination, size_t size) const {
+    const auto offset = position & (kCapacity - 1u);
+    const auto first_size = std::min(size, kCapacity - offset);
+    ::memcpy(destination, data_.get() + offset, first_size);
+    ::memcpy(static_cast<uint8_t*>(destination) + first_size, data_.get(),
+             size - first_size);
+  }
+
+  P_DISALLOW_COPY_AND_ASSIGN(LogRing);
+};
+
+static_assert((LogRing::kCapacity & (LogRing::kCapacity - 1u)) == 0u,
+              "Capacity must be a power of two.");
+
+//------------------------------------------------------------------------------
+/// @brief      Owns the rings of all threads that have logged and the thread
+///             that writes them out.
+///
+class AsyncLogger {
+ public:
+  static AsyncLogger& ForProcess() {
+    // Leaked so that threads may still log during static destruction.
+    static AsyncLogger* sLogger = new AsyncLogger();
+    return *sLogger;
+  }
+
+  void Log(LogLevel level, std::string_view message) {
+    if (!GetRingForCurrentThread().TryWrite(level, message)) {
+      return;
+    }
+    // Only the first message after the logging thread wakes up notifies it.
+    // Taking the lock orders the notification after the logging thread has
+    // either seen the flag or started waiting, so it cannot be lost.
+    if (!wake_pending_.exchange(true, std::memory_order_acq_rel)) {
+      { std::scoped_lock lock(mutex_); }
+      wake_cv_.notify_one();
+    }
+  }
+
+  void Flush() {
+    std::unique_lock lock(mutex_);
+    const auto flush_target = ++flush_requested_;
+    wake_cv_.notify_one();
+    flushed_cv_.wait(lock,
+                     [&]() { return flush_completed_ >= flush_target; });
+  }
+
+  LogStatistics GetStatistics() const {
+    LogStatistics statistics;
+    statistics.written = written_count_.load(std::memory_order_relaxed);
+    statistics.dropped = dropped_count_.load(std::memory_order_relaxed);
+    statistics.suppressed = gSuppressedCount.load(std::memory_order_relaxed);
+    return statistics;
+  }
+
+ private:
+  static constexpr auto kAbortFlushTimeout = std::chrono::seconds(1);
+
+  static void (*sPreviousAbortHandler)(int);
+  static thread_local bool tIsLoggingThread;
+
+  std::mutex mutex_;
+  std::condition_variable wake_cv_;
+  std::condition_variable flushed_cv_;
+  std::vector<std::shared_ptr<LogRing>> rings_;
+  uint64_t flush_requested_ = 0;
+  uint64_t flush_completed_ = 0;
+  std::atomic_bool wake_pending_ = false;
+  std::atomic<uint64_t> written_count_ = 0;
+  std::atomic<uint64_t> dropped_count_ = 0;
+  std::atomic<uint64_t> drain_count_ = 0;
+
+  AsyncLogger() {
+    std::thread([this]() { Run(); }).detach();
+    std::atexit([]() { AsyncLogger::ForProcess().Flush(); });
+    // Failed assertions and fatal errors abort. Write out what was logged
+    // before them.
+    sPreviousAbortHandler = std::signal(SIGABRT, &AsyncLogger::OnAbort);
+  }
+
+  static void OnAbort(int signal) {
+    ForProcess().FlushForAbort();
+    if (sPreviousAbortHandler != SIG_DFL && sPreviousAbortHandler != SIG_IGN &&
+        sPreviousAbortHandler != SIG_ERR) {
+      sPreviousAbortHandler(signal);
+    }
+  }
+
+  // Called from a signal handler. The aborting thread may hold any lock, so
+  // this does not take the mutex and gives up after a timeout instead.
+  void FlushForAbort() {
+    if (tIsLoggingThread) {
+      return;
+    }
+    // The drain in progress may already be past the ring of this thread. Wait
+    // for the one after it.
+    const auto drain_target = drain_count_.load(std::memory_order_acquire) + 2u;
+    const auto deadline = std::chrono::steady_clock::now() + kAbortFlushTimeout;
+    while (drain_count_.load(std::memory_order_acquire) < drain_target &&
+           std::chrono::steady_clock::now() < deadline) {
+      wake_pending_.store(true, std::memory_order_release);
+      wake_cv_.notify_one();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  LogRing& GetRingForCurrentThread() {
+    // The logger holds on to the ring after the thread exits till it has been
+    // drained.
+    thread_local std::shared_ptr<LogRing> tRing;
+    if (!tRing) {
+      tRing = std::make_shared<LogRing>();
+      std::scoped_lock lock(mutex_);
+      rings_.push_back(tRing);
+    }
+    return *tRing;
+  }
+
+  void Run() {
+    tIsLoggingThread = true;
+    Thread::SetCurrentThreadName("Logger");
+    std::string scratch;
+    std::vector<std::shared_ptr<LogRing>> rings;
+    while (true) {
+      uint64_t flush_target = 0;
+      {
+        std::unique_lock lock(mutex_);
+        wake_cv_.wait(lock, [&]() {
+          return wake_pending_.load(std::memory_order_acquire) ||
+                 flush_requested_ != flush_completed_;
+        });
+        wake_pending_.store(false, std::memory_order_release);
+        flush_target = flush_requested_;
+        rings = rings_;
+      }
+
+      DrainRings(rings, scratch);
+      rings.clear();
+      drain_count_.fetch_add(1u, std::memory_order_release);
+
+      {
+        std::scoped_lock lock(mutex_);
+        flush_completed_ = flush_target;
+        // Collect the rings of threads that are gone.
+        std::erase_if(rings_, [](const auto& ring) {
+          return ring.use_count() == 1 && ring->IsEmpty();
+        });
+      }
+      flushed_cv_.notify_all();
+    }
+  }
+
+  void DrainRings(const std::vector<std::shared_ptr<LogRing>>& rings,
+                  std::string& scratch) {
+    bool wrote_output = false;
+    bool wrote_error = false;
+    for (const auto& ring : rings) {
+      const auto written =
+          ring->Drain(scratch, [&](LogLevel level, const std::string& message) {
+            auto file = level >= LogLevel::kLogLevelWarning ? stderr : stdout;
+            ::fwrite(message.data(), 1u, message.size(), file);
+            ::fputc('\n', file);
+            (file == stderr ? wrote_error : wrote_output) = true;
+          });
+      written_count_.fetch_add(written, std::memory_order_relaxed);
+      if (const auto dropped = ring->TakeDroppedCount(); dropped > 0u) {
+        dropped_count_.fetch_add(dropped, std::memory_order_relaxed);
+        ::fprintf(stderr, "Dropped %zu log messages.\n", dropped);
+        wrote_error = true;
+      }
+    }
+    if (wrote_output) {
+      ::fflush(stdout);
+    }
+    if (wrote_error) {
+      ::fflush(stderr);
+    }
+  }
+
+  P_DISALLOW_COPY_AND_ASSIGN(AsyncLogger);
+};
+
+void (*AsyncLogger::sPreviousAbortHandler)(int) = SIG_DFL;
+thread_local bool AsyncLogger::tIsLoggingThread = false;
+
+void FlushLogs() {
+  AsyncLogger::ForProcess().Flush();
+}
+
+LogStatistics GetLogStatistics() {
+  return AsyncLogger::ForProcess().GetStatistics();
+}
+
+// *****************************************************************************
+// *** LogRateLimiter
+// *****************************************************************************
+
+static int64_t GetMonotonicNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+LogRateLimiter::LogRateLimiter(std::chrono::nanoseconds period)
+    : period_(period.count()),
+      next_allowed_(std::numeric_limits<int64_t>::min()) {}
+
+LogRateLimiter::~LogRateLimiter() = default;
+
+bool LogRateLimiter::TryAcquire(size_t& suppressed) {
+  const auto now = GetMonotonicNanoseconds();
+  auto next_allowed = next_allowed_.load(std::memory_order_relaxed);
+  while (now >= next_allowed) {
+    if (next_allowed_.compare_exchange_weak(next_allowed, now + period_,
+                                            std::memory_order_relaxed)) {
+      suppressed = suppressed_.exchange(0u, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  suppressed_.fetch_add(1u, std::memory_order_relaxed);
+  gSuppressedCount.fetch_add(1u, std::memory_order_relaxed);
+  return false;
+}
+
+// *****************************************************************************
+// *** LogMessage
+// *****************************************************************************
+
+//------------------------------------------------------------------------------
+/// @brief      A stream that formats into a string that keeps its capacity
+///             between messages.
+///
+class LogStream final : public std::streambuf {
+ public:
+  LogStream() : stream_(this) {}
+
+  // |std::streambuf|
+  ~LogStream() override = default;
+
+  std::ostream& GetStream() { return stream_; }
+
+  std::string_view GetMessage() const { return message_; }
+
+  void Reset() {
+    message_.clear();
+    stream_.clear();
+    stream_.flags(std::ios_base::dec | std::ios_base::skipws);
+    stream_.precision(6);
+    stream_.width(0);
+    stream_.fill(' ');
+  }
+
+ private:
+  std::string message_;
+  std::ostream stream_;
+
+  // |std::streambuf|
+  int_type overflow(int_type character) override {
+    if (!traits_type::eq_int_type(character, traits_type::eof())) {
+      message_.push_back(traits_type::to_char_type(character));
+    }
+    return traits_type::not_eof(character);
+  }
+
+  // |std::streambuf|
+  std::streamsize xsputn(const char* data, std::streamsize size) override {
+    message_.append(data, static_cast<size_t>(size));
+    return size;
+  }
+
+  P_DISALLOW_COPY_AND_ASSIGN(LogStream);
+};
+
+struct ThreadLogStream {
+  LogStream stream;
+  bool in_use = false;
+};
+
+static thread_local ThreadLogStream tLogStream;
+
+LogMessage::LogMessage(LogLevel level) : LogMessage(level, 0u) {}
+
+LogMessage::LogMessage(LogLevel level, size_t suppressed)
+    : level_(level), suppressed_(suppressed) {
+  // Messages logged while formatting another message on the same thread get
+  // a stream of their own.
+  if (tLogStream.in_use) {
+    log_stream_ = new LogStream();
+  } else {
+    tLogStream.in_use = true;
+    log_stream_ = &tLogStream.stream;
+  }
+  log_stream_->Reset();
+  stream_ = &log_stream_->GetStream();
+}
+
+LogMessage::~LogMessage() {
+  if (suppressed_ > 0u) {
+    *stream_ << " (" << suppressed_ << " similar messages suppressed)";
+  }
+  AsyncLogger::ForProcess().Log(level_, log_stream_->GetMessage());
+  if (log_stream_ == &tLogStream.stream) {
+    tLogStream.in_use = false;
+  } else {
+    delete log_stream_;
+  }
+}
+
+}  // namespace pixel
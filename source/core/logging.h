@@ -1,36 +1,154 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <iostream>
 
 #include "macros.h"
 
 namespace pixel {
 
-template <class Type>
-class AutoLogger {
+enum class LogLevel {
+  kLogLevelVerbose,
+  kLogLevelInfo,
+  kLogLevelWarning,
+  kLogLevelError,
+  kLogLevelNone,
+};
+
+// Messages below this level are compiled out. Use the values of `LogLevel`.
+#ifndef P_LOG_LEVEL_MINIMUM
+#define P_LOG_LEVEL_MINIMUM 0
+#endif  // P_LOG_LEVEL_MINIMUM
+
+//------------------------------------------------------------------------------
+/// @brief      Set the level below which messages are dropped at runtime. The
+///             default is `kLogLevelInfo`.
+///
+void SetLogLevel(LogLevel level);
+
+LogLevel GetLogLevel();
+
+inline bool IsLogLevelEnabled(LogLevel level) {
+  return static_cast<int>(level) >= P_LOG_LEVEL_MINIMUM &&
+         level >= GetLogLevel() && level != LogLevel::kLogLevelNone;
+}
+
+//------------------------------------------------------------------------------
+/// @brief      Blocks till all messages logged before the call have been
+///             written out. Logs are flushed at exit and when the process
+///             aborts.
+///
+void FlushLogs();
+
+struct LogStatistics {
+  // The messages written out by the logging thread.
+  uint64_t written = 0;
+  // The messages dropped because a thread logged faster than the logging
+  // thread could keep up.
+  uint64_t dropped = 0;
+  // The messages not logged because of rate limits.
+  uint64_t suppressed = 0;
+};
+
+LogStatistics GetLogStatistics();
+
+//------------------------------------------------------------------------------
+/// @brief      Limits a call site to one message per period. Use the
+///             `P_*_EVERY` macros instead of using this directly.
+///
+class LogRateLimiter {
  public:
-  AutoLogger(Type& logger) : logger_(logger) {}
+  LogRateLimiter(std::chrono::nanoseconds period);
 
-  ~AutoLogger() {
-    logger_ << std::endl;
-    logger_.flush();
-  }
+  ~LogRateLimiter();
+
+  //----------------------------------------------------------------------------
+  /// @brief      If a message may be logged now. Thread safe.
+  ///
+  /// @param[out] suppressed  The messages suppressed since the last one that
+  ///                         was allowed.
+  ///
+  bool TryAcquire(size_t& suppressed);
+
+ private:
+  const int64_t period_;
+  std::atomic<int64_t> next_allowed_;
+  std::atomic_size_t suppressed_ = 0;
+
+  P_DISALLOW_COPY_AND_ASSIGN(LogRateLimiter);
+};
+
+class LogStream;
+
+//------------------------------------------------------------------------------
+/// @brief      A message being logged. The message is formatted on the calling
+///             thread and handed off to a per-thread lock-free ring buffer on
+///             collection. A background thread writes out the rings. Logging
+///             never blocks on I/O. If the ring of a thread fills up, messages
+///             are dropped and the drop is reported later.
+///
+class LogMessage {
+ public:
+  LogMessage(LogLevel level);
+
+  //----------------------------------------------------------------------------
+  /// @brief      A message from a rate limited call site. The number of
+  ///             messages suppressed before it is appended.
+  ///
+  LogMessage(LogLevel level, size_t suppressed);
+
+  ~LogMessage();
 
   template <class T>
-  AutoLogger& operator<<(const T& object) {
-    logger_ << object;
+  LogMessage& operator<<(const T& object) {
+    *stream_ << object;
     return *this;
   }
 
  private:
-  Type& logger_;
+  const LogLevel level_;
+  size_t suppressed_ = 0;
+  LogStream* log_stream_ = nullptr;
+  std::ostream* stream_ = nullptr;
+
+  P_DISALLOW_COPY_AND_ASSIGN(LogMessage);
+};
 
-  P_DISALLOW_COPY_AND_ASSIGN(AutoLogger);
+class LogMessageVoidify {
+ public:
+  // Lower precedence than `<<` but higher than `?:`.
+  void operator&(const LogMessage&) {}
 };
 
-using AutoOStreamLogger = AutoLogger<std::ostream>;
+#define P_LOG_AT(level)                \
+  !::pixel::IsLogLevelEnabled(level)   \
+      ? (void)0                        \
+      : ::pixel::LogMessageVoidify() & \
+            ::pixel::LogMessage(level)
+
+// Arguments of suppressed messages are not evaluated.
+#define P_LOG_AT_EVERY(level, period)                           \
+  for (size_t p_log_suppressed = 0, p_log_once = 1;             \
+       p_log_once && ::pixel::IsLogLevelEnabled(level) &&       \
+       []() -> ::pixel::LogRateLimiter& {                       \
+         static ::pixel::LogRateLimiter sLimiter(period);       \
+         return sLimiter;                                       \
+       }().TryAcquire(p_log_suppressed);                        \
+       p_log_once = 0)                                          \
+  ::pixel::LogMessage(level, p_log_suppressed)
+
+#define P_VERBOSE P_LOG_AT(::pixel::LogLevel::kLogLevelVerbose)
+#define P_LOG P_LOG_AT(::pixel::LogLevel::kLogLevelInfo)
+#define P_WARNING P_LOG_AT(::pixel::LogLevel::kLogLevelWarning)
+#define P_ERROR P_LOG_AT(::pixel::LogLevel::kLogLevelError)
 
-#define P_ERROR ::pixel::AutoOStreamLogger(std::cerr)
-#define P_LOG ::pixel::AutoOStreamLogger(std::cout)
+#define P_LOG_EVERY(period) \
+  P_LOG_AT_EVERY(::pixel::LogLevel::kLogLevelInfo, period)
+#define P_WARNING_EVERY(period) \
+  P_LOG_AT_EVERY(::pixel::LogLevel::kLogLevelWarning, period)
+#define P_ERROR_EVERY(period) \
+  P_LOG_AT_EVERY(::pixel::LogLevel::kLogLevelError, period)
 
 }  // namespace pixel
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "logging.h"
+
+namespace pixel {
+namespace testing {
+
+class ScopedLogLevel {
+ public:
+  ScopedLogLevel(LogLevel level) : previous_level_(GetLogLevel()) {
+    SetLogLevel(level);
+  }
+
+  ~ScopedLogLevel() { SetLogLevel(previous_level_); }
+
+ private:
+  const LogLevel previous_level_;
+
+  P_DISALLOW_COPY_AND_ASSIGN(ScopedLogLevel);
+};
+
+TEST(LoggingTest, LevelsCanBeFilteredAtRuntime) {
+  ScopedLogLevel level(LogLevel::kLogLevelError);
+  ASSERT_FALSE(IsLogLevelEnabled(LogLevel::kLogLevelVerbose));
+  ASSERT_FALSE(IsLogLevelEnabled(LogLevel::kLogLevelInfo));
+  ASSERT_FALSE(IsLogLevelEnabled(LogLevel::kLogLevelWarning));
+  ASSERT_TRUE(IsLogLevelEnabled(LogLevel::kLogLevelError));
+  ASSERT_FALSE(IsLogLevelEnabled(LogLevel::kLogLevelNone));
+}
+
+TEST(LoggingTest, FilteredMessagesAreNotFormatted) {
+  ScopedLogLevel level(LogLevel::kLogLevelError);
+  size_t evaluations = 0;
+  auto evaluate = [&evaluations]() { return ++evaluations; };
+  P_LOG << "Not logged: " << evaluate();
+  P_VERBOSE << "Not logged: " << evaluate();
+  ASSERT_EQ(evaluations, 0u);
+}
+
+TEST(LoggingTest, MessagesAreWrittenByFlush) {
+  const auto before = GetLogStatistics();
+  for (size_t i = 0; i < 10u; i++) {
+    P_LOG << "Message " << i;
+  }
+  FlushLogs();
+  const auto after = GetLogStatistics();
+  ASSERT_GE(after.written + after.dropped,
+            before.written + before.dropped + 10u);
+}
+
+TEST(LoggingTest, MessagesAreWrittenBeforeAborting) {
+  ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+  ASSERT_DEATH(
+      {
+        P_WARNING << "Logged before aborting";
+        std::abort();
+      },
+      "Logged before aborting");
+}
+
+TEST(LoggingTest, ManyThreadsCanLog) {
+  constexpr size_t kThreadCount = 4u;
+  constexpr size_t kMessageCount = 2u;
+  const auto before = GetLogStatistics();
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < kThreadCount; i++) {
+    threads.emplace_back([i]() {
+      for (size_t j = 0; j < kMessageCount; j++) {
+        P_LOG << "Thread " << i << " message " << j;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  FlushLogs();
+  const auto after = GetLogStatistics();
+  ASSERT_GE(after.written + after.dropped,
+            before.written + before.dropped + kThreadCount * kMessageCount);
+}
+
+TEST(LoggingTest, RateLimiterAllowsOneMessagePerPeriod) {
+  LogRateLimiter limiter(std::chrono::hours(1));
+  size_t suppressed = 0;
+  ASSERT_TRUE(limiter.TryAcquire(suppressed));
+  ASSERT_EQ(suppressed, 0u);
+  for (size_t i = 0; i < 3u; i++) {
+    ASSERT_FALSE(limiter.TryAcquire(suppressed));
+  }
+
+  LogRateLimiter unlimited(std::chrono::nanoseconds(0));
+  ASSERT_TRUE(unlimited.TryAcquire(suppressed));
+  ASSERT_TRUE(unlimited.TryAcquire(suppressed));
+}
+
+TEST(LoggingTest, RateLimitedCallSitesSuppressMessages) {
+  const auto before = GetLogStatistics();
+  size_t evaluations = 0;
+  auto evaluate = [&evaluations]() { return ++evaluations; };
+  for (size_t i = 0; i < 100u; i++) {
+    P_LOG_EVERY(std::chrono::hours(1)) << "Logged once: " << evaluate();
+  }
+  ASSERT_EQ(evaluations, 1u);
+  ASSERT_EQ(GetLogStatistics().suppressed, before.suppressed + 99u);
+}
+
+struct LogsWhenFormatted {
+  friend std::ostream& operator<<(std::ostream& stream,
+                                  const LogsWhenFormatted&) {
+    P_LOG << "Logged while formatting another message.";
+    return stream << "Formatted";
+  }
+};
+
+TEST(LoggingTest, CanLogWhileFormatting) {
+  const auto before = GetLogStatistics();
+  P_LOG << "Outer message: " << LogsWhenFormatted{};
+  FlushLogs();
+  const auto after = GetLogStatistics();
+  ASSERT_GE(after.written + after.dropped,
+            before.written + before.dropped + 2u);
+}
+
+}  // namespace testing
+}  // namespace pixel
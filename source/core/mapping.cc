@@ -6,6 +6,10 @@ Mapping::Mapping() = default;
 
 Mapping::~Mapping() = default;
 
+bool Mapping::Prefetch(size_t offset, size_t length) const {
+  return offset <= GetSize() && length <= GetSize() - offset;
+}
+
 class DataMapping : public Mapping {
  public:
   DataMapping(const uint8_t* data, size_t size, Closure deleter)
@@ -50,4 +54,55 @@ std::unique_ptr<Mapping> UnownedMapping(const uint8_t* data,
   return std::make_unique<DataMapping>(data, size, closure);
 }
 
+class MappingSlice final : public Mapping {
+ public:
+  MappingSlice(std::shared_ptr<const Mapping> parent,
+               size_t offset,
+               size_t length)
+      : parent_(std::move(parent)), offset_(offset), length_(length) {}
+
+  // |Mapping|
+  ~MappingSlice() override = default;
+
+  // |Mapping|
+  const uint8_t* GetData() const override {
+    auto data = parent_->GetData();
+    return data ? data + offset_ : nullptr;
+  }
+
+  // |Mapping|
+  size_t GetSize() const override { return length_; }
+
+  // |Mapping|
+  bool Prefetch(size_t offset, size_t length) const override {
+    if (!Mapping::Prefetch(offset, length)) {
+      return false;
+    }
+    return parent_->Prefetch(offset_ + offset, length);
+  }
+
+ private:
+  std::shared_ptr<const Mapping> parent_;
+  const size_t offset_;
+  const size_t length_;
+
+  P_DISALLOW_COPY_AND_ASSIGN(MappingSlice);
+};
+
+std::shared_ptr<const Mapping> SliceMapping(
+    std::shared_ptr<const Mapping> mapping,
+    size_t offset,
+    size_t length) {
+  if (!mapping) {
+    return nullptr;
+  }
+  if (offset > mapping->GetSize() || length > mapping->GetSize() - offset) {
+    return nullptr;
+  }
+  if (offset == 0u && length == mapping->GetSize()) {
+    return mapping;
+  }
+  return std::make_shared<MappingSlice>(std::move(mapping), offset, length);
+}
+
 }  // namespace pixel
@@ -17,6 +17,16 @@ class Mapping {
 
   virtual size_t GetSize() const = 0;
 
+  //----------------------------------------------------------------------------
+  /// @brief      Hint that the given range of the mapping will be read soon so
+  ///             that it can be paged in ahead of the reads. Mappings that are
+  ///             always resident do nothing.
+  ///
+  /// @return     If the range was within the mapping. A failure to apply the
+  ///             hint is not an error.
+  ///
+  virtual bool Prefetch(size_t offset, size_t length) const;
+
  private:
   P_DISALLOW_COPY_AND_ASSIGN(Mapping);
 };
@@ -27,4 +37,16 @@ std::unique_ptr<Mapping> UnownedMapping(const uint8_t* data,
                                         size_t size,
                                         Closure closure = nullptr);
 
+//------------------------------------------------------------------------------
+/// @brief      Create a view of a range of a mapping without copying it. The
+///             slice shares ownership of the mapping so that the mapping lives
+///             at least as long as the slice.
+///
+/// @return     The slice or null if the range is not within the mapping.
+///
+std::shared_ptr<const Mapping> SliceMapping(
+    std::shared_ptr<const Mapping> mapping,
+    size_t offset,
+    size_t length);
+
 }  // namespace pixel
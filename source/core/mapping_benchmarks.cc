@@ -0,0 +1,21 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "mapping.h"
+
+namespace pixel {
+namespace testing {
+
+static void BM_CopyMapping(benchmark::State& state) {
+  std::vector<uint8_t> data(static_cast<size_t>(state.range(0)), 0xAB);
+  for (auto _ : state) {
+    auto mapping = CopyMapping(data.data(), data.size());
+    benchmark::DoNotOptimize(mapping->GetData());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CopyMapping)->Range(64, 64 << 20);
+
+}  // namespace testing
+}  // namespace pixel
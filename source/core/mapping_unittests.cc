@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+
+#include "mapping.h"
+
+namespace pixel {
+namespace testing {
+
+TEST(MappingTest, SlicesDoNotCopy) {
+  const uint8_t data[] = {0, 1, 2, 3, 4, 5, 6, 7};
+  std::shared_ptr<const Mapping> mapping = UnownedMapping(data, sizeof(data));
+  auto slice = SliceMapping(mapping, 2u, 4u);
+  ASSERT_TRUE(slice);
+  ASSERT_EQ(slice->GetData(), data + 2u);
+  ASSERT_EQ(slice->GetSize(), 4u);
+  auto inner = SliceMapping(slice, 1u, 2u);
+  ASSERT_TRUE(inner);
+  ASSERT_EQ(inner->GetData(), data + 3u);
+  ASSERT_EQ(inner->GetSize(), 2u);
+}
+
+TEST(MappingTest, SlicesKeepTheMappingAlive) {
+  bool collected = false;
+  const uint8_t data[] = {0, 1, 2, 3};
+  std::shared_ptr<const Mapping> mapping =
+      UnownedMapping(data, sizeof(data), [&collected]() { collected = true; });
+  auto slice = SliceMapping(mapping, 1u, 2u);
+  ASSERT_TRUE(slice);
+  mapping.reset();
+  ASSERT_FALSE(collected);
+  ASSERT_EQ(slice->GetData()[0], 1u);
+  slice.reset();
+  ASSERT_TRUE(collected);
+}
+
+TEST(MappingTest, SlicesMustBeInBounds) {
+  const uint8_t data[] = {0, 1, 2, 3};
+  std::shared_ptr<const Mapping> mapping = UnownedMapping(data, sizeof(data));
+  ASSERT_FALSE(SliceMapping(nullptr, 0u, 0u));
+  ASSERT_FALSE(SliceMapping(mapping, 5u, 0u));
+  ASSERT_FALSE(SliceMapping(mapping, 2u, 3u));
+  ASSERT_FALSE(SliceMapping(mapping, 1u, SIZE_MAX));
+  ASSERT_TRUE(SliceMapping(mapping, 4u, 0u));
+  ASSERT_EQ(SliceMapping(mapping, 0u, 4u), mapping);
+  auto slice = SliceMapping(mapping, 1u, 2u);
+  ASSERT_TRUE(slice->Prefetch(0u, 2u));
+  ASSERT_FALSE(slice->Prefetch(1u, 2u));
+}
+
+}  // namespace testing
+}  // namespace pixel
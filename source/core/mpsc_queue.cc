@@ -0,0 +1,7 @@
+#include "mpsc_queue.h"
+
+namespace pixel {
+
+//
+
+}  // namespace pixel
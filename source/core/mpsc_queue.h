@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "macros.h"
+
+namespace pixel {
+
+//------------------------------------------------------------------------------
+/// @brief      A multi-producer single-consumer FIFO queue.
+///
+///             Producers enqueue into a fixed capacity ring without taking any
+///             locks. If the ring fills up, items spill over into a mutex
+///             guarded overflow list that the consumer only picks up once the
+///             ring has been fully drained. Items enqueued by any one producer
+///             are always dequeued in the order they were enqueued.
+///
+///             Any thread may call `Push`. Only one thread at a time may call
+///             the consumer methods (`PopAll` and `HasPendingItems`).
+///
+template <class T, size_t kCapacity = 1024>
+class MPSCQueue {
+ public:
+  static_assert(kCapacity >= 2 && (kCapacity & (kCapacity - 1)) == 0,
+                "Capacity must be a power of two.");
+
+  MPSCQueue() : slots_(std::make_unique<Slot[]>(kCapacity)) {
+    for (size_t i = 0; i < kCapacity; i++) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~MPSCQueue() = default;
+
+  void Push(T item) {
+    if (!overflowing_.load(std::memory_order_acquire) && TryPushRing(item)) {
+      return;
+    }
+
+    std::scoped_lock lock(overflow_mutex_);
+    // Once anything has spilled over, everything goes into the overflow list
+    // till the consumer catches up. Otherwise, newer items could be dequeued
+    // before older ones.
+    if (!overflowing_.load(std::memory_order_relaxed) && TryPushRing(item)) {
+      return;
+    }
+    overflow_.emplace_back(std::move(item));
+    overflowing_.store(true, std::memory_order_release);
+  }
+
+  //----------------------------------------------------------------------------
+  /// @brief      Moves all items that are ready to be dequeued into the
+  ///             vector. Consumer only.
+  ///
+  /// @return     The number of items dequeued.
+  ///
+  size_t PopAll(std::vector<T>& items) {
+    const auto initial_size = items.size();
+
+    while (TryPopRing(items)) {
+    }
+
+    if (overflowing_.load(std::memory_order_acquire)) {
+      std::scoped_lock lock(overflow_mutex_);
+      // The overflow list may only be picked up once every item that made it
+      // into the ring has been consumed. If a producer is still in the middle
+      // of publishing into a reserved slot, come back for the overflow later.
+      if (enqueue_position_.load(std::memory_order_acquire) ==
+          dequeue_position_) {
+        for (auto& item : overflow_) {
+          items.emplace_back(std::move(item));
+        }
+        overflow_.clear();
+        overflowing_.store(false, std::memory_order_release);
+      }
+    }
+
+    return items.size() - initial_size;
+  }
+
+  //----------------------------------------------------------------------------
+  /// @brief      If there are items either ready to be dequeued or in the
+  ///             process of being enqueued. Consumer only.
+  ///
+  bool HasPendingItems() const {
+    return enqueue_position_.load(std::memory_order_seq_cst) !=
+               dequeue_position_ ||
+           overflowing_.load(std::memory_order_seq_cst);
+  }
+
+ private:
+  static constexpr size_t kCacheLineSize = 64;
+
+  struct alignas(kCacheLineSize) Slot {
+    std::atomic<size_t> sequence = 0;
+    T item = {};
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  alignas(kCacheLineSize) std::atomic<size_t> enqueue_position_ = 0;
+  alignas(kCacheLineSize) size_t dequeue_position_ = 0;
+  std::atomic_bool overflowing_ = false;
+  std::mutex overflow_mutex_;
+  std::deque<T> overflow_;
+
+  bool TryPushRing(T& item) {
+    auto position = enqueue_position_.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    while (true) {
+      slot = &slots_[position & (kCapacity - 1)];
+      const auto sequence = slot->sequence.load(std::memory_order_acquire);
+      const auto difference = static_cast<intptr_t>(sequence) -
+                              static_cast<intptr_t>(position);
+      if (difference == 0) {
+        if (enqueue_position_.compare_exchange_weak(
+                position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        // The ring is full.
+        return false;
+      } else {
+        position = enqueue_position_.load(std::memory_order_relaxed);
+      }
+    }
+    slot->item = std::move(item);
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPopRing(std::vector<T>& items) {
+    auto& slot = slots_[dequeue_position_ & (kCapacity - 1)];
+    const auto sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence != dequeue_position_ + 1) {
+      // Either empty or a producer has not finished publishing this slot.
+      return false;
+    }
+    items.emplace_back(std::move(slot.item));
+    slot.item = {};
+    slot.sequence.store(dequeue_position_ + kCapacity,
+                        std::memory_order_release);
+    dequeue_position_++;
+    return true;
+  }
+
+  P_DISALLOW_COPY_AND_ASSIGN(MPSCQueue);
+};
+
+}  // namespace pixel
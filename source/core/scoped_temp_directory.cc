@@ -0,0 +1,68 @@
+#include "scoped_temp_directory.h"
+
+#include "logging.h"
+#include "platform.h"
+
+#if P_OS_WINDOWS
+#include <random>
+#else  // P_OS_WINDOWS
+#include <stdlib.h>
+#endif  // P_OS_WINDOWS
+
+namespace pixel {
+
+static std::filesystem::path CreateUniqueDirectory(const std::string& prefix) {
+  std::error_code error;
+  const auto temp_directory = std::filesystem::temp_directory_path(error);
+  if (error) {
+    return {};
+  }
+#if P_OS_WINDOWS
+  // There is no mkdtemp. Creating a directory that already exists fails, so
+  // a random name is tried till one was not taken.
+  std::random_device device;
+  for (size_t i = 0; i < 100u; i++) {
+    const auto path =
+        temp_directory / (prefix + "_" + std::to_string(device()));
+    if (std::filesystem::create_directory(path, error)) {
+      return path;
+    }
+  }
+  return {};
+#else   // P_OS_WINDOWS
+  auto path_template = (temp_directory / (prefix + "_XXXXXX")).string();
+  if (::mkdtemp(path_template.data()) == nullptr) {
+    return {};
+  }
+  return path_template;
+#endif  // P_OS_WINDOWS
+}
+
+ScopedTempDirectory::ScopedTempDirectory(const std::string& prefix)
+    : path_(CreateUniqueDirectory(prefix)) {
+  if (path_.empty()) {
+    P_ERROR << "Could not create a temporary directory.";
+  }
+}
+
+ScopedTempDirectory::~ScopedTempDirectory() {
+  if (path_.empty()) {
+    return;
+  }
+  std::error_code error;
+  std::filesystem::remove_all(path_, error);
+  if (error) {
+    P_ERROR << "Could not remove temporary directory " << path_ << ": "
+            << error.message();
+  }
+}
+
+bool ScopedTempDirectory::IsValid() const {
+  return !path_.empty();
+}
+
+const std::filesystem::path& ScopedTempDirectory::GetPath() const {
+  return path_;
+}
+
+}  // namespace pixel
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+#include "macros.h"
+
+namespace pixel {
+
+//------------------------------------------------------------------------------
+/// @brief      A directory with a unique name in the temporary directory of the
+///             system. The directory and everything in it are removed when it
+///             is collected. Tests use it for the files they write so that
+///             concurrent runs never share files.
+///
+class ScopedTempDirectory {
+ public:
+  //----------------------------------------------------------------------------
+  /// @brief      Create the directory. Its name starts with the prefix.
+  ///
+  ScopedTempDirectory(const std::string& prefix = "pixel");
+
+  ~ScopedTempDirectory();
+
+  bool IsValid() const;
+
+  const std::filesystem::path& GetPath() const;
+
+ private:
+  std::filesystem::path path_;
+
+  P_DISALLOW_COPY_AND_ASSIGN(ScopedTempDirectory);
+};
+
+}  // namespace pixel
@@ -0,0 +1,28 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+#include "scoped_temp_directory.h"
+
+namespace pixel {
+namespace testing {
+
+TEST(ScopedTempDirectoryTest, DirectoriesAreUniqueAndRemoved) {
+  std::filesystem::path first_path;
+  {
+    ScopedTempDirectory first("pixel_test");
+    ScopedTempDirectory second("pixel_test");
+    ASSERT_TRUE(first.IsValid());
+    ASSERT_TRUE(second.IsValid());
+    ASSERT_NE(first.GetPath(), second.GetPath());
+    ASSERT_TRUE(std::filesystem::is_directory(first.GetPath()));
+    ASSERT_EQ(first.GetPath().filename().string().rfind("pixel_test_", 0), 0u);
+    first_path = first.GetPath();
+    std::filesystem::create_directories(first_path / "nested");
+    std::ofstream(first_path / "nested" / "file.txt") << "contents";
+  }
+  ASSERT_FALSE(std::filesystem::exists(first_path));
+}
+
+}  // namespace testing
+}  // namespace pixel
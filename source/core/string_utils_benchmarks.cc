@@ -0,0 +1,28 @@
+#include <benchmark/benchmark.h>
+
+#include "string_utils.h"
+
+namespace pixel {
+namespace testing {
+
+static void BM_MakeStringFShort(benchmark::State& state) {
+  int frame = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(MakeStringF("Frame %d", frame++));
+  }
+}
+BENCHMARK(BM_MakeStringFShort);
+
+// Too long for the small string optimization.
+static void BM_MakeStringFLong(benchmark::State& state) {
+  int frame = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        MakeStringF("Frame %d took %.3f ms on thread '%s' with %zu draws.",
+                    frame++, 16.667, "Main Renderer", size_t{1024}));
+  }
+}
+BENCHMARK(BM_MakeStringFLong);
+
+}  // namespace testing
+}  // namespace pixel
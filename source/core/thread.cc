@@ -1,8 +1,13 @@
 #include "thread.h"
 
+#include <cstdlib>
+#include <cstring>
 #include <future>
 
+#include "logging.h"
 #include "platform.h"
+#include "trace_event.h"
+#include "worker_pool.h"
 
 #if P_OS_WINDOWS
 #include <windows.h>
@@ -17,11 +22,18 @@ typedef struct tagTHREADNAME_INFO {
 } THREADNAME_INFO;
 #else
 #include <pthread.h>
+#include <sched.h>
 #endif
 
+#if P_OS_LINUX
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif  // P_OS_LINUX
+
 namespace pixel {
 
-static void SetCurrentThreadName(const std::string& thread_name) {
+void Thread::SetCurrentThreadName(const std::string& thread_name) {
 #if P_OS_WINDOWS
   THREADNAME_INFO info;
   info.dwType = 0x1000;
@@ -40,39 +52,203 @@ static void SetCurrentThreadName(const std::string& thread_name) {
 #else
 #error Cannot set thread name on this platform.
 #endif
+  SetTraceThreadName(thread_name);
+}
+
+bool Thread::SetCurrentThreadAffinity(const std::vector<size_t>& cpus) {
+  if (cpus.empty()) {
+    return false;
+  }
+#if P_OS_LINUX
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : cpus) {
+    if (cpu >= CPU_SETSIZE) {
+      return false;
+    }
+    CPU_SET(cpu, &set);
+  }
+  if (const auto result = pthread_setaffinity_np(pthread_self(), sizeof(set),
+                                                 &set);
+      result != 0) {
+    P_ERROR << "Could not set thread affinity: " << strerror(result);
+    return false;
+  }
+  return true;
+#elif P_OS_WINDOWS
+  DWORD_PTR mask = 0;
+  for (auto cpu : cpus) {
+    if (cpu >= sizeof(mask) * 8) {
+      return false;
+    }
+    mask |= DWORD_PTR{1} << cpu;
+  }
+  return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+  P_ERROR << "Thread affinity is not supported on this platform.";
+  return false;
+#endif
+}
+
+bool Thread::SetCurrentThreadPolicy(ThreadPolicy policy,
+                                    std::optional<int> priority) {
+#if P_OS_WINDOWS
+  if (policy != ThreadPolicy::kThreadPolicyDefault) {
+    P_ERROR << "Thread policies are not supported on this platform.";
+    return false;
+  }
+  return !priority.has_value() ||
+         SetThreadPriority(GetCurrentThread(), priority.value()) != 0;
+#else
+  int native_policy = SCHED_OTHER;
+  switch (policy) {
+    case ThreadPolicy::kThreadPolicyDefault:
+      native_policy = SCHED_OTHER;
+      break;
+    case ThreadPolicy::kThreadPolicyBatch:
+    case ThreadPolicy::kThreadPolicyIdle:
+#if P_OS_LINUX
+      native_policy = policy == ThreadPolicy::kThreadPolicyBatch ? SCHED_BATCH
+                                                                 : SCHED_IDLE;
+      break;
+#else
+      P_ERROR << "Thread policy is not supported on this platform.";
+      return false;
+#endif  // P_OS_LINUX
+    case ThreadPolicy::kThreadPolicyFIFO:
+      native_policy = SCHED_FIFO;
+      break;
+    case ThreadPolicy::kThreadPolicyRoundRobin:
+      native_policy = SCHED_RR;
+      break;
+  }
+
+  const auto is_real_time =
+      native_policy == SCHED_FIFO || native_policy == SCHED_RR;
+
+  sched_param param = {};
+  if (is_real_time) {
+    param.sched_priority =
+        priority.value_or(sched_get_priority_min(native_policy));
+  }
+  if (const auto result =
+          pthread_setschedparam(pthread_self(), native_policy, &param);
+      result != 0) {
+    P_ERROR << "Could not set thread policy: " << strerror(result);
+    return false;
+  }
+
+  if (is_real_time || !priority.has_value()) {
+    return true;
+  }
+
+#if P_OS_LINUX
+  // Nice values are per-thread on Linux.
+  if (::setpriority(PRIO_PROCESS, ::syscall(SYS_gettid), priority.value()) !=
+      0) {
+    P_ERROR << "Could not set thread nice value: " << strerror(errno);
+    return false;
+  }
+  return true;
+#else
+  P_ERROR << "Thread nice values are not supported on this platform.";
+  return false;
+#endif  // P_OS_LINUX
+#endif  // P_OS_WINDOWS
 }
 
-void Thread::PostBackgroundTask(Closure closure) {
+void Thread::PostBackgroundTask(UniqueClosure closure) {
   if (!closure) {
     return;
   }
-  static Thread sThread("BackgroundWorker");
-  sThread.GetDispatcher()->PostTask(closure);
+  WorkerPool::ForProcess().PostTask(std::move(closure));
+}
+
+struct Thread::Handle {
+#if P_OS_WINDOWS
+  std::thread thread;
+#else
+  pthread_t thread = {};
+#endif  // P_OS_WINDOWS
+};
+
+#if !P_OS_WINDOWS
+static void* ThreadMain(void* closure) {
+  std::unique_ptr<UniqueClosure> main(static_cast<UniqueClosure*>(closure));
+  (*main)();
+  return nullptr;
 }
+#endif  // !P_OS_WINDOWS
 
-Thread::Thread(std::string thread_name) {
+Thread::Thread(std::string thread_name)
+    : Thread(ThreadOptions{.name = std::move(thread_name)}) {}
+
+Thread::Thread(ThreadOptions options) : handle_(std::make_unique<Handle>()) {
   std::promise<std::shared_ptr<EventLoop::Dispatcher>> on_done;
   auto on_done_future = on_done.get_future();
-  thread_ =
-      std::make_unique<std::thread>([thread_name = std::move(thread_name),
-                                     on_done = std::move(on_done)]() mutable {
-        SetCurrentThreadName(std::move(thread_name));
-        auto& loop = EventLoop::ForCurrentThread();
-        on_done.set_value(loop.GetDispatcher());
-        loop.Run();
-      });
+  const auto stack_size = options.stack_size;
+  UniqueClosure main = [options = std::move(options),
+                        on_done = std::move(on_done)]() mutable {
+    SetCurrentThreadName(options.name);
+    if (!options.affinity.empty() &&
+        !SetCurrentThreadAffinity(options.affinity)) {
+      P_ERROR << "Could not set the affinity of thread " << options.name;
+    }
+    if ((options.policy != ThreadPolicy::kThreadPolicyDefault ||
+         options.priority.has_value()) &&
+        !SetCurrentThreadPolicy(options.policy, options.priority)) {
+      P_ERROR << "Could not set the policy of thread " << options.name;
+    }
+    auto& loop = EventLoop::ForCurrentThread();
+    on_done.set_value(loop.GetDispatcher());
+    loop.Run();
+  };
+
+#if P_OS_WINDOWS
+  if (stack_size != 0) {
+    P_ERROR << "Thread stack sizes are not supported on this platform.";
+  }
+  handle_->thread = std::thread(std::move(main));
+#else   // P_OS_WINDOWS
+  pthread_attr_t attributes;
+  pthread_attr_init(&attributes);
+  if (stack_size != 0 &&
+      pthread_attr_setstacksize(&attributes, stack_size) != 0) {
+    P_ERROR << "Invalid thread stack size " << stack_size
+            << ". Using the default.";
+  }
+  auto closure = std::make_unique<UniqueClosure>(std::move(main));
+  const auto result =
+      pthread_create(&handle_->thread, &attributes, &ThreadMain, closure.get());
+  pthread_attr_destroy(&attributes);
+  if (result != 0) {
+    P_ERROR << "Could not create thread: " << strerror(result);
+    std::abort();
+  }
+  // Now owned by the thread.
+  closure.release();
+#endif  // P_OS_WINDOWS
+
   dispatcher_ = on_done_future.get();
 }
 
 Thread::~Thread() {
   Terminate();
-  thread_->join();
+#if P_OS_WINDOWS
+  handle_->thread.join();
+#else   // P_OS_WINDOWS
+  pthread_join(handle_->thread, nullptr);
+#endif  // P_OS_WINDOWS
 }
 
 std::shared_ptr<EventLoop::Dispatcher> Thread::GetDispatcher() const {
   return dispatcher_;
 }
 
+EventLoopStatistics Thread::GetStatistics() const {
+  return dispatcher_->GetStatistics();
+}
+
 void Thread::Terminate() {
   dispatcher_->PostTask([]() { EventLoop::ForCurrentThread().Terminate(); });
 }
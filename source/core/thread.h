@@ -1,7 +1,9 @@
 #pragma once
 
+#include <optional>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "closure.h"
 #include "event_loop.h"
@@ -9,20 +11,73 @@
 
 namespace pixel {
 
+enum class ThreadPolicy {
+  // The default time-sharing policy.
+  kThreadPolicyDefault,
+  // Time-sharing for throughput oriented work. Only on Linux.
+  kThreadPolicyBatch,
+  // Only runs when nothing else wants the CPU. Only on Linux.
+  kThreadPolicyIdle,
+  // Real-time policies. These usually need elevated privileges.
+  kThreadPolicyFIFO,
+  kThreadPolicyRoundRobin,
+};
+
+struct ThreadOptions {
+  std::string name;
+  // The logical CPUs the thread may run on. Any CPU if empty. See
+  // `CPUTopology` for how CPUs are related.
+  std::vector<size_t> affinity;
+  ThreadPolicy policy = ThreadPolicy::kThreadPolicyDefault;
+  // The nice value for time-sharing policies or the priority for real-time
+  // policies. The platform default if not set.
+  std::optional<int> priority;
+  // The platform default if zero.
+  size_t stack_size = 0;
+};
+
 class Thread {
  public:
-  static void PostBackgroundTask(Closure closure);
+  //----------------------------------------------------------------------------
+  /// @brief      Post a task to the process-wide worker pool.
+  ///
+  static void PostBackgroundTask(UniqueClosure closure);
+
+  static void SetCurrentThreadName(const std::string& thread_name);
+
+  //----------------------------------------------------------------------------
+  /// @brief      Restrict the calling thread to the given logical CPUs. Not
+  ///             supported on macOS, which only takes affinity hints.
+  ///
+  static bool SetCurrentThreadAffinity(const std::vector<size_t>& cpus);
+
+  //----------------------------------------------------------------------------
+  /// @brief      Set the scheduling policy and priority of the calling thread.
+  ///
+  static bool SetCurrentThreadPolicy(ThreadPolicy policy,
+                                     std::optional<int> priority);
 
   Thread(std::string thread_name);
 
+  //----------------------------------------------------------------------------
+  /// @brief      Create a thread running an event loop. Affinity and policy
+  ///             are applied by the thread itself before it runs any tasks.
+  ///             Failing to apply them is logged but is not fatal.
+  ///
+  Thread(ThreadOptions options);
+
   ~Thread();
 
   std::shared_ptr<EventLoop::Dispatcher> GetDispatcher() const;
 
+  EventLoopStatistics GetStatistics() const;
+
   void Terminate();
 
  private:
-  std::unique_ptr<std::thread> thread_;
+  struct Handle;
+
+  std::unique_ptr<Handle> handle_;
   std::shared_ptr<EventLoop::Dispatcher> dispatcher_;
 
   P_DISALLOW_COPY_AND_ASSIGN(Thread);
@@ -0,0 +1,18 @@
+#include <benchmark/benchmark.h>
+
+#include "thread.h"
+
+namespace pixel {
+namespace testing {
+
+// Includes waiting for the thread to start its event loop and to exit.
+static void BM_ThreadCreateAndJoin(benchmark::State& state) {
+  for (auto _ : state) {
+    Thread thread("Benchmark Thread");
+    benchmark::DoNotOptimize(thread.GetDispatcher());
+  }
+}
+BENCHMARK(BM_ThreadCreateAndJoin)->UseRealTime();
+
+}  // namespace testing
+}  // namespace pixel
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+
+#include <future>
+
+#include "platform.h"
+#include "thread.h"
+
+#if P_OS_LINUX
+#include <sched.h>
+#endif  // P_OS_LINUX
+
+namespace pixel {
+namespace testing {
+
+TEST(ThreadTest, CanRunTasksOnThread) {
+  Thread thread("Test Thread");
+  std::promise<bool> promise;
+  auto dispatcher = thread.GetDispatcher();
+  dispatcher->PostTask([&, dispatcher]() {
+    promise.set_value(dispatcher->RunsTasksOnCurrentThread());
+  });
+  ASSERT_TRUE(promise.get_future().get());
+}
+
+TEST(ThreadTest, CanCreateThreadWithStackSize) {
+  ThreadOptions options;
+  options.name = "Large Stack";
+  options.stack_size = 8u * 1024u * 1024u;
+  Thread thread(std::move(options));
+  std::promise<void> promise;
+  thread.GetDispatcher()->PostTask([&]() {
+    // Would overflow the smaller default stacks of some platforms.
+    volatile char buffer[4u * 1024u * 1024u];
+    buffer[sizeof(buffer) - 1] = 1;
+    promise.set_value();
+  });
+  promise.get_future().get();
+}
+
+#if P_OS_LINUX
+TEST(ThreadTest, ThreadRunsOnAffineCPU) {
+  ThreadOptions options;
+  options.name = "Pinned";
+  options.affinity = {0u};
+  options.policy = ThreadPolicy::kThreadPolicyBatch;
+  options.priority = 1;
+  Thread thread(std::move(options));
+  std::promise<int> promise;
+  thread.GetDispatcher()->PostTask(
+      [&]() { promise.set_value(::sched_getcpu()); });
+  ASSERT_EQ(promise.get_future().get(), 0);
+}
+#endif  // P_OS_LINUX
+
+}  // namespace testing
+}  // namespace pixel
@@ -0,0 +1,356 @@
+#include "trace_event.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include "atomic_file_writer.h"
+#include "logging.h"
+
+namespace pixel {
+
+static int64_t GetTraceTimestamp() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct TraceRecord {
+  const char* category = nullptr;
+  const char* name = nullptr;
+  int64_t timestamp = 0;
+  // The duration of complete events. The ID of async and flow events.
+  uint64_t value = 0;
+  // The Chrome trace event phase.
+  char phase = 0;
+};
+
+//------------------------------------------------------------------------------
+/// @brief      The events recorded by one thread. Only that thread adds events.
+///             Events are added to fixed size chunks without taking locks.
+///             Locks are only taken to add a chunk, and by readers.
+///
+class TraceBuffer {
+ public:
+  static constexpr size_t kChunkSize = 4096u;
+  // Events beyond this are dropped.
+  static constexpr size_t kMaxChunks = 64u;
+
+  TraceBuffer(uint64_t thread_id) : thread_id_(thread_id) {}
+
+  ~TraceBuffer() = default;
+
+  void Add(const TraceRecord& record, uint64_t session) {
+    if (session != session_ || current_ == nullptr ||
+        current_->size.load(std::memory_order_relaxed) == kChunkSize) {
+      if (!AddChunk(session)) {
+        return;
+      }
+    }
+    const auto size = current_->size.load(std::memory_order_relaxed);
+    current_->records[size] = record;
+    current_->size.store(size + 1u, std::memory_order_release);
+  }
+
+  void SetName(std::string name) {
+    std::scoped_lock lock(mutex_);
+    name_ = std::move(name);
+  }
+
+  void WriteJSON(std::ostream& stream,
+                 uint64_t session,
+                 int64_t origin,
+                 bool& is_first) const;
+
+ private:
+  struct Chunk {
+    std::array<TraceRecord, kChunkSize> records;
+    std::atomic_size_t size = 0;
+  };
+
+  const uint64_t thread_id_;
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Chunk>> chunks_;
+  std::string name_;
+  // The session the chunks belong to.
+  uint64_t chunks_session_ = 0;
+  // Only accessed by the owning thread.
+  Chunk* current_ = nullptr;
+  uint64_t session_ = 0;
+
+  bool AddChunk(uint64_t session) {
+    std::scoped_lock lock(mutex_);
+    if (session != chunks_session_) {
+      chunks_.clear();
+      chunks_session_ = session;
+    }
+    session_ = session;
+    current_ = nullptr;
+    if (chunks_.size() >= kMaxChunks) {
+      return false;
+    }
+    chunks_.emplace_back(std::make_unique<Chunk>());
+    current_ = chunks_.back().get();
+    return true;
+  }
+
+  P_DISALLOW_COPY_AND_ASSIGN(TraceBuffer);
+};
+
+//------------------------------------------------------------------------------
+/// @brief      Owns the buffers of all threads that have recorded events.
+///
+class TraceLog {
+ public:
+  static TraceLog& ForProcess() {
+    // Leaked so that threads may still trace during static destruction.
+    static TraceLog* sLog = new TraceLog();
+    return *sLog;
+  }
+
+  void Start() {
+    std::scoped_lock lock(mutex_);
+    origin_ = GetTraceTimestamp();
+    session_.fetch_add(1u, std::memory_order_relaxed);
+    // Forget the buffers of threads that are gone.
+    std::erase_if(buffers_,
+                  [](const auto& buffer) { return buffer.use_count() == 1; });
+    enabled_.store(true, std::memory_order_release);
+  }
+
+  void Stop() { enabled_.store(false, std::memory_order_release); }
+
+  bool IsEnabled() const { return enabled_.load(std::memory_order_acquire); }
+
+  void Add(const TraceRecord& record) {
+    if (!IsEnabled()) {
+      return;
+    }
+    GetBufferForCurrentThread().Add(
+        record, session_.load(std::memory_order_relaxed));
+  }
+
+  void SetCurrentThreadName(std::string name) {
+    GetBufferForCurrentThread().SetName(std::move(name));
+  }
+
+  uint64_t GetNextID() {
+    return next_id_.fetch_add(1u, std::memory_order_relaxed);
+  }
+
+  std::string GetJSON() {
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;
+    uint64_t session = 0;
+    int64_t origin = 0;
+    {
+      std::scoped_lock lock(mutex_);
+      buffers = buffers_;
+      session = session_.load(std::memory_order_relaxed);
+      origin = origin_;
+    }
+    std::stringstream stream;
+    stream << R"({"displayTimeUnit":"ns","traceEvents":[)";
+    bool is_first = true;
+    for (const auto& buffer : buffers) {
+      buffer->WriteJSON(stream, session, origin, is_first);
+    }
+    stream << "]}";
+    return stream.str();
+  }
+
+ private:
+  std::atomic_bool enabled_ = false;
+  std::atomic<uint64_t> session_ = 0;
+  std::atomic<uint64_t> next_id_ = 1;
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<TraceBuffer>> buffers_;
+  uint64_t next_thread_id_ = 1;
+  int64_t origin_ = 0;
+
+  TraceLog() = default;
+
+  TraceBuffer& GetBufferForCurrentThread() {
+    thread_local std::shared_ptr<TraceBuffer> tBuffer;
+    if (!tBuffer) {
+      std::scoped_lock lock(mutex_);
+      tBuffer = std::make_shared<TraceBuffer>(next_thread_id_++);
+      buffers_.push_back(tBuffer);
+    }
+    return *tBuffer;
+  }
+
+  P_DISALLOW_COPY_AND_ASSIGN(TraceLog);
+};
+
+static void WriteJSONString(std::ostream& stream, std::string_view string) {
+  stream << '"';
+  for (auto character : string) {
+    switch (character) {
+      case '"':
+        stream << "\\\"";
+        break;
+      case '\\':
+        stream << "\\\\";
+        break;
+      case '\n':
+        stream << "\\n";
+        break;
+      default:
+        if (static_cast<unsigned char>(character) < 0x20u) {
+          stream << ' ';
+        } else {
+          stream << character;
+        }
+        break;
+    }
+  }
+  stream << '"';
+}
+
+// Chrome traces are in microseconds.
+static void WriteJSONMicroseconds(std::ostream& stream, int64_t nanoseconds) {
+  if (nanoseconds < 0) {
+    stream << '-';
+    nanoseconds = -nanoseconds;
+  }
+  const auto fraction = nanoseconds % 1000;
+  stream << nanoseconds / 1000 << '.' << (fraction < 100 ? "0" : "")
+         << (fraction < 10 ? "0" : "") << fraction;
+}
+
+void TraceBuffer::WriteJSON(std::ostream& stream,
+                            uint64_t session,
+                            int64_t origin,
+                            bool& is_first) const {
+  std::scoped_lock lock(mutex_);
+  if (chunks_session_ != session) {
+    return;
+  }
+  auto begin_event = [&]() {
+    stream << (is_first ? "" : ",") << "\n{";
+    is_first = false;
+  };
+  begin_event();
+  stream << R"("ph":"M","name":"thread_name","pid":1,"tid":)" << thread_id_
+         << R"(,"args":{"name":)";
+  WriteJSONString(stream,
+                  name_.empty() ? "Thread " + std::to_string(thread_id_)
+                                : name_);
+  stream << "}}";
+  for (const auto& chunk : chunks_) {
+    const auto size = chunk->size.load(std::memory_order_acquire);
+    for (size_t i = 0; i < size; i++) {
+      const auto& record = chunk->records[i];
+      begin_event();
+      stream << R"("ph":")" << record.phase << R"(","cat":)";
+      WriteJSONString(stream, record.category);
+      stream << R"(,"name":)";
+      WriteJSONString(stream, record.name);
+      stream << R"(,"pid":1,"tid":)" << thread_id_ << R"(,"ts":)";
+      WriteJSONMicroseconds(stream, record.timestamp - origin);
+      switch (record.phase) {
+        case 'X':
+          stream << R"(,"dur":)";
+          WriteJSONMicroseconds(stream, static_cast<int64_t>(record.value));
+          break;
+        case 'i':
+          stream << R"(,"s":"t")";
+          break;
+        case 'f':
+          // Bind to the enclosing slice instead of the next one.
+          stream << R"(,"bp":"e","id":)" << record.value;
+          break;
+        default:
+          stream << R"(,"id":)" << record.value;
+          break;
+      }
+      stream << "}";
+    }
+  }
+}
+
+void StartTracing() {
+  TraceLog::ForProcess().Start();
+}
+
+void StopTracing() {
+  TraceLog::ForProcess().Stop();
+}
+
+bool IsTracingEnabled() {
+  return TraceLog::ForProcess().IsEnabled();
+}
+
+std::string GetTraceJSON() {
+  return TraceLog::ForProcess().GetJSON();
+}
+
+bool WriteTraceJSON(const std::filesystem::path& path) {
+  const auto json = GetTraceJSON();
+  if (!AtomicFileWriter::WriteFile(
+          path, reinterpret_cast<const uint8_t*>(json.data()), json.size())) {
+    P_ERROR << "Could not write trace to " << path;
+    return false;
+  }
+  return true;
+}
+
+uint64_t GetNextTraceID() {
+  return TraceLog::ForProcess().GetNextID();
+}
+
+void SetTraceThreadName(const std::string& name) {
+  TraceLog::ForProcess().SetCurrentThreadName(name);
+}
+
+static void AddRecord(const char* category,
+                      const char* name,
+                      char phase,
+                      uint64_t value) {
+  TraceLog::ForProcess().Add(
+      {category, name, GetTraceTimestamp(), value, phase});
+}
+
+void TraceInstant(const char* category, const char* name) {
+  AddRecord(category, name, 'i', 0u);
+}
+
+void TraceAsyncBegin(const char* category, const char* name, uint64_t id) {
+  AddRecord(category, name, 'b', id);
+}
+
+void TraceAsyncEnd(const char* category, const char* name, uint64_t id) {
+  AddRecord(category, name, 'e', id);
+}
+
+void TraceFlowBegin(const char* category, const char* name, uint64_t id) {
+  AddRecord(category, name, 's', id);
+}
+
+void TraceFlowEnd(const char* category, const char* name, uint64_t id) {
+  AddRecord(category, name, 'f', id);
+}
+
+ScopedTraceEvent::ScopedTraceEvent(const char* category, const char* name) {
+  if (!IsTracingEnabled()) {
+    return;
+  }
+  category_ = category;
+  name_ = name;
+  start_ = GetTraceTimestamp();
+}
+
+ScopedTraceEvent::~ScopedTraceEvent() {
+  if (start_ < 0) {
+    return;
+  }
+  const auto duration = GetTraceTimestamp() - start_;
+  TraceLog::ForProcess().Add(
+      {category_, name_, start_, static_cast<uint64_t>(duration), 'X'});
+}
+
+}  // namespace pixel
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "macros.h"
+
+// Set to zero to compile out all trace events.
+#ifndef P_TRACING_ENABLED
+#define P_TRACING_ENABLED 1
+#endif  // P_TRACING_ENABLED
+
+namespace pixel {
+
+//------------------------------------------------------------------------------
+/// @brief      Start recording trace events. Events recorded by earlier
+///             sessions are discarded.
+///
+void StartTracing();
+
+void StopTracing();
+
+bool IsTracingEnabled();
+
+//------------------------------------------------------------------------------
+/// @brief      The events of the last session in the Chrome trace event JSON
+///             format. This can be opened in Perfetto or chrome://tracing.
+///             Call this after tracing has been stopped.
+///
+std::string GetTraceJSON();
+
+bool WriteTraceJSON(const std::filesystem::path& path);
+
+//------------------------------------------------------------------------------
+/// @brief      A process unique ID for async and flow events.
+///
+uint64_t GetNextTraceID();
+
+//------------------------------------------------------------------------------
+/// @brief      The name of the calling thread in traces. `Thread` sets this.
+///
+void SetTraceThreadName(const std::string& name);
+
+// Categories and names must be string literals or otherwise outlive the trace.
+void TraceInstant(const char* category, const char* name);
+
+void TraceAsyncBegin(const char* category, const char* name, uint64_t id);
+
+void TraceAsyncEnd(const char* category, const char* name, uint64_t id);
+
+//------------------------------------------------------------------------------
+/// @brief      Flows connect the slice enclosing the beginning of the flow to
+///             the slice enclosing its end. They are usually on different
+///             threads.
+///
+void TraceFlowBegin(const char* category, const char* name, uint64_t id);
+
+void TraceFlowEnd(const char* category, const char* name, uint64_t id);
+
+//------------------------------------------------------------------------------
+/// @brief      Records a slice from its construction to its collection.
+///             Nothing is recorded if tracing was disabled on construction.
+///
+class ScopedTraceEvent {
+ public:
+  ScopedTraceEvent(const char* category, const char* name);
+
+  ~ScopedTraceEvent();
+
+ private:
+  const char* category_ = nullptr;
+  const char* name_ = nullptr;
+  // Negative if tracing was disabled.
+  int64_t start_ = -1;
+
+  P_DISALLOW_COPY_AND_ASSIGN(ScopedTraceEvent);
+};
+
+}  // namespace pixel
+
+#define P_TRACE_CONCAT_INNER(a, b) a##b
+#define P_TRACE_CONCAT(a, b) P_TRACE_CONCAT_INNER(a, b)
+
+#if P_TRACING_ENABLED
+
+#define P_TRACE_EVENT(category, name)                      \
+  ::pixel::ScopedTraceEvent P_TRACE_CONCAT(p_trace_event_, \
+                                           __LINE__)(category, name)
+#define P_TRACE_INSTANT(category, name) ::pixel::TraceInstant(category, name)
+#define P_TRACE_ASYNC_BEGIN(category, name, id) \
+  ::pixel::TraceAsyncBegin(category, name, id)
+#define P_TRACE_ASYNC_END(category, name, id) \
+  ::pixel::TraceAsyncEnd(category, name, id)
+#define P_TRACE_FLOW_BEGIN(category, name, id) \
+  ::pixel::TraceFlowBegin(category, name, id)
+#define P_TRACE_FLOW_END(category, name, id) \
+  ::pixel::TraceFlowEnd(category, name, id)
+
+#else  // P_TRACING_ENABLED
+
+#define P_TRACE_EVENT(category, name)
+#define P_TRACE_INSTANT(category, name)
+#define P_TRACE_ASYNC_BEGIN(category, name, id)
+#define P_TRACE_ASYNC_END(category, name, id)
+#define P_TRACE_FLOW_BEGIN(category, name, id)
+#define P_TRACE_FLOW_END(category, name, id)
+
+#endif  // P_TRACING_ENABLED
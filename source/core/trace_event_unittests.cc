@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include <future>
+#include <string>
+
+#include "thread.h"
+#include "trace_event.h"
+
+namespace pixel {
+namespace testing {
+
+static size_t CountOccurrences(const std::string& string,
+                               const std::string& substring) {
+  size_t count = 0;
+  for (auto position = string.find(substring); position != std::string::npos;
+       position = string.find(substring, position + substring.size())) {
+    count++;
+  }
+  return count;
+}
+
+TEST(TraceEventTest, RecordsScopedEvents) {
+  StartTracing();
+  ASSERT_TRUE(IsTracingEnabled());
+  for (size_t i = 0; i < 3u; i++) {
+    P_TRACE_EVENT("test", "ScopedEvent");
+  }
+  StopTracing();
+  ASSERT_FALSE(IsTracingEnabled());
+  const auto json = GetTraceJSON();
+  ASSERT_EQ(json.front(), '{');
+  ASSERT_EQ(json.back(), '}');
+  ASSERT_EQ(CountOccurrences(
+                json, R"("ph":"X","cat":"test","name":"ScopedEvent")"),
+            3u);
+}
+
+TEST(TraceEventTest, RecordsNothingWhenStopped) {
+  StartTracing();
+  StopTracing();
+  {
+    P_TRACE_EVENT("test", "WhileStopped");
+    P_TRACE_INSTANT("test", "WhileStopped");
+  }
+  ASSERT_EQ(CountOccurrences(GetTraceJSON(), "WhileStopped"), 0u);
+}
+
+TEST(TraceEventTest, StartingDiscardsEarlierSessions) {
+  StartTracing();
+  P_TRACE_INSTANT("test", "FirstSession");
+  StopTracing();
+  ASSERT_EQ(CountOccurrences(GetTraceJSON(), "FirstSession"), 1u);
+  StartTracing();
+  P_TRACE_INSTANT("test", "SecondSession");
+  StopTracing();
+  const auto json = GetTraceJSON();
+  ASSERT_EQ(CountOccurrences(json, "FirstSession"), 0u);
+  ASSERT_EQ(CountOccurrences(json, "SecondSession"), 1u);
+}
+
+TEST(TraceEventTest, RecordsAsyncEvents) {
+  StartTracing();
+  const auto id = GetNextTraceID();
+  ASSERT_NE(GetNextTraceID(), id);
+  P_TRACE_ASYNC_BEGIN("test", "Async \"Quoted\"", id);
+  P_TRACE_ASYNC_END("test", "Async \"Quoted\"", id);
+  StopTracing();
+  const auto json = GetTraceJSON();
+  const auto id_string = R"("id":)" + std::to_string(id);
+  ASSERT_EQ(CountOccurrences(json, R"("ph":"b")"), 1u);
+  ASSERT_EQ(CountOccurrences(json, R"("ph":"e")"), 1u);
+  ASSERT_EQ(CountOccurrences(json, id_string), 2u);
+  ASSERT_EQ(CountOccurrences(json, R"(Async \"Quoted\")"), 2u);
+}
+
+TEST(TraceEventTest, TasksAreConnectedByFlows) {
+  Thread thread("Traced Thread");
+  StartTracing();
+  auto dispatcher = thread.GetDispatcher();
+  dispatcher->PostTask([]() {}, TaskPriority::kTaskPriorityNormal,
+                       "Traced Task");
+  // The slice of the traced task ends before the next task runs.
+  std::promise<void> promise;
+  dispatcher->PostTask([&]() { promise.set_value(); });
+  promise.get_future().get();
+  StopTracing();
+  const auto json = GetTraceJSON();
+  ASSERT_EQ(CountOccurrences(
+                json, R"("ph":"s","cat":"event_loop","name":"Traced Task")"),
+            1u);
+  ASSERT_EQ(CountOccurrences(
+                json, R"("ph":"f","cat":"event_loop","name":"Traced Task")"),
+            1u);
+  ASSERT_EQ(CountOccurrences(
+                json, R"("ph":"X","cat":"event_loop","name":"Traced Task")"),
+            1u);
+  ASSERT_EQ(CountOccurrences(json, R"("name":"Traced Thread")"), 1u);
+}
+
+}  // namespace testing
+}  // namespace pixel
@@ -0,0 +1,46 @@
+#include <benchmark/benchmark.h>
+
+#include "unshared_weak.h"
+
+namespace pixel {
+namespace testing {
+
+namespace {
+
+struct Object {
+  int value = 42;
+};
+
+}  // namespace
+
+static void BM_UnsharedWeakCreate(benchmark::State& state) {
+  Object object;
+  UnsharedWeakFactory<Object> factory(&object);
+  for (auto _ : state) {
+    auto weak = factory.CreateWeakPtr();
+    benchmark::DoNotOptimize(weak);
+  }
+}
+BENCHMARK(BM_UnsharedWeakCreate);
+
+static void BM_UnsharedWeakValidate(benchmark::State& state) {
+  Object object;
+  UnsharedWeakFactory<Object> factory(&object);
+  const auto weak = factory.CreateWeakPtr();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(weak.get());
+  }
+}
+BENCHMARK(BM_UnsharedWeakValidate);
+
+static void BM_UnsharedWeakFactoryCreate(benchmark::State& state) {
+  Object object;
+  for (auto _ : state) {
+    UnsharedWeakFactory<Object> factory(&object);
+    benchmark::DoNotOptimize(factory.CreateWeakPtr().get());
+  }
+}
+BENCHMARK(BM_UnsharedWeakFactoryCreate);
+
+}  // namespace testing
+}  // namespace pixel
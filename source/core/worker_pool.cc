@@ -0,0 +1,270 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+#include "logging.h"
+#include "thread.h"
+
+namespace pixel {
+
+// Set on worker threads so that tasks posted from a worker can be put on its
+// own deque.
+thread_local WorkerPool* tCurrentPool = nullptr;
+thread_local size_t tCurrentWorkerIndex = 0;
+
+WorkerPool& WorkerPool::ForProcess() {
+  static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+  return pool;
+}
+
+WorkerPool::WorkerPool(size_t worker_count, ThreadOptions options) {
+  if (options.name.empty()) {
+    options.name = "Worker";
+  }
+  worker_count = std::max<size_t>(worker_count, 1u);
+  for (size_t i = 0; i < worker_count; i++) {
+    workers_.emplace_back(std::make_unique<Worker>());
+  }
+  // Workers may steal from each other as soon as they start. So only start
+  // them after all deques have been created.
+  for (size_t i = 0; i < worker_count; i++) {
+    workers_[i]->thread =
+        std::thread([this, i, options]() { WorkerMain(i, options); });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  terminated_ = true;
+  NotifyWaiters();
+  for (auto& worker : workers_) {
+    worker->thread.join();
+  }
+}
+
+size_t WorkerPool::GetWorkerCount() const {
+  return workers_.size();
+}
+
+bool WorkerPool::IsCurrentThreadWorker() const {
+  return tCurrentPool == this;
+}
+
+bool WorkerPool::PostTask(UniqueClosure task) {
+  if (!task) {
+    return false;
+  }
+
+  const auto worker_index = tCurrentPool == this
+                                ? tCurrentWorkerIndex
+                                : next_worker_++ % workers_.size();
+
+  // Counted before the task is visible so that the count never underflows
+  // when the task is taken right away.
+  pending_tasks_++;
+  {
+    auto& worker = *workers_[worker_index];
+    std::scoped_lock lock(worker.mutex);
+    worker.tasks.emplace_back(std::move(task));
+  }
+
+  // Pairs with the increment of |sleepers_| before a thread goes to sleep.
+  // Either that thread sees the pending task or this one sees the sleeper.
+  if (sleepers_ > 0) {
+    {
+      std::scoped_lock lock(sleep_mutex_);
+    }
+    sleep_cv_.notify_one();
+  }
+  return true;
+}
+
+WorkerPoolStatistics WorkerPool::GetStatistics() const {
+  WorkerPoolStatistics statistics;
+  statistics.worker_count = workers_.size();
+  statistics.pending_tasks = pending_tasks_;
+  for (const auto& worker : workers_) {
+    std::scoped_lock lock(worker->statistics_mutex);
+    statistics.run_time.Merge(worker->run_time);
+  }
+  return statistics;
+}
+
+void WorkerPool::WaitUntil(const std::function<bool(void)>& predicate) {
+  while (!predicate()) {
+    if (RunOneTask()) {
+      continue;
+    }
+
+    std::unique_lock lock(sleep_mutex_);
+    sleepers_++;
+    sleep_cv_.wait(lock, [&]() { return predicate() || pending_tasks_ > 0; });
+    sleepers_--;
+  }
+}
+
+void WorkerPool::NotifyWaiters() {
+  {
+    std::scoped_lock lock(sleep_mutex_);
+  }
+  sleep_cv_.notify_all();
+}
+
+void WorkerPool::ParallelFor(size_t count,
+                             const std::function<void(size_t)>& body) {
+  const auto chunk_count = GetChunkCount(count);
+  auto run_chunk = [&](size_t chunk) {
+    const auto end = count * (chunk + 1) / chunk_count;
+    for (auto i = count * chunk / chunk_count; i < end; i++) {
+      body(i);
+    }
+  };
+
+  if (chunk_count <= 1) {
+    if (chunk_count == 1) {
+      run_chunk(0);
+    }
+    return;
+  }
+
+  TaskGroup group(*this);
+  for (size_t chunk = 1; chunk < chunk_count; chunk++) {
+    group.PostTask([&run_chunk, chunk]() { run_chunk(chunk); });
+  }
+  run_chunk(0);
+  group.Wait();
+}
+
+void WorkerPool::WorkerMain(size_t worker_index, const ThreadOptions& options) {
+  {
+    std::stringstream name;
+    name << options.name << " " << worker_index + 1;
+    Thread::SetCurrentThreadName(name.str());
+  }
+  if (!options.affinity.empty() &&
+      !Thread::SetCurrentThreadAffinity(options.affinity)) {
+    P_ERROR << "Could not set the affinity of worker " << worker_index + 1;
+  }
+  if ((options.policy != ThreadPolicy::kThreadPolicyDefault ||
+       options.priority.has_value()) &&
+      !Thread::SetCurrentThreadPolicy(options.policy, options.priority)) {
+    P_ERROR << "Could not set the policy of worker " << worker_index + 1;
+  }
+  tCurrentPool = this;
+  tCurrentWorkerIndex = worker_index;
+
+  while (true) {
+    if (RunOneTask()) {
+      continue;
+    }
+
+    std::unique_lock lock(sleep_mutex_);
+    // Tasks still running on other workers may post more tasks. But those end
+    // up on their own deques.
+    if (terminated_ && pending_tasks_ == 0) {
+      break;
+    }
+    sleepers_++;
+    sleep_cv_.wait(lock, [&]() { return pending_tasks_ > 0 || terminated_; });
+    sleepers_--;
+  }
+
+  tCurrentPool = nullptr;
+}
+
+bool WorkerPool::RunOneTask() {
+  const auto worker_count = workers_.size();
+  const auto is_worker = tCurrentPool == this;
+  const auto first_victim = is_worker ? tCurrentWorkerIndex : next_worker_.load();
+
+  if (is_worker) {
+    if (auto task = TakeTask(tCurrentWorkerIndex, false)) {
+      RunTask(std::move(task), is_worker);
+      return true;
+    }
+  }
+
+  for (size_t i = 0; i < worker_count; i++) {
+    const auto victim = (first_victim + i) % worker_count;
+    if (is_worker && victim == tCurrentWorkerIndex) {
+      continue;
+    }
+    if (auto task = TakeTask(victim, true)) {
+      RunTask(std::move(task), is_worker);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void WorkerPool::RunTask(UniqueClosure task, bool is_worker) {
+  if (!is_worker) {
+    task();
+    return;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  task();
+  const auto run_time = std::chrono::steady_clock::now() - start;
+
+  auto& worker = *workers_[tCurrentWorkerIndex];
+  std::scoped_lock lock(worker.statistics_mutex);
+  worker.run_time.Add(run_time);
+}
+
+UniqueClosure WorkerPool::TakeTask(size_t worker_index, bool steal) {
+  auto& worker = *workers_[worker_index];
+  std::scoped_lock lock(worker.mutex);
+  if (worker.tasks.empty()) {
+    return nullptr;
+  }
+
+  UniqueClosure task;
+  // Owners take the most recently posted task since its data is most likely
+  // to still be in cache. Thieves take the oldest.
+  if (steal) {
+    task = std::move(worker.tasks.front());
+    worker.tasks.pop_front();
+  } else {
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+  }
+  pending_tasks_--;
+  return task;
+}
+
+size_t WorkerPool::GetChunkCount(size_t count) const {
+  // A few chunks per worker so that uneven chunks can be balanced by stealing.
+  return std::min(count, workers_.size() * 4u);
+}
+
+TaskGroup::TaskGroup(WorkerPool& pool) : pool_(pool) {}
+
+TaskGroup::~TaskGroup() {
+  Wait();
+}
+
+bool TaskGroup::PostTask(UniqueClosure task) {
+  if (!task) {
+    return false;
+  }
+
+  pending_tasks_++;
+  // The group may be collected as soon as the last task is done. So the pool
+  // is captured directly instead of being accessed via the group.
+  return pool_.PostTask(
+      [this, &pool = pool_, task = std::move(task)]() {
+        task();
+        if (--pending_tasks_ == 0) {
+          pool.NotifyWaiters();
+        }
+      });
+}
+
+void TaskGroup::Wait() {
+  pool_.WaitUntil([&]() { return pending_tasks_ == 0; });
+}
+
+}  // namespace pixel
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "closure.h"
+#include "duration_histogram.h"
+#include "macros.h"
+#include "thread.h"
+
+namespace pixel {
+
+//------------------------------------------------------------------------------
+/// @brief      A snapshot of what a worker pool has done since it was created.
+///
+struct WorkerPoolStatistics {
+  size_t worker_count = 0;
+  // Tasks that have been posted but not yet taken by any thread.
+  size_t pending_tasks = 0;
+  // Tasks run by the workers. Tasks run by threads waiting on the pool are
+  // not counted.
+  DurationHistogram run_time;
+};
+
+//------------------------------------------------------------------------------
+/// @brief      A fixed size pool of worker threads. Each worker owns a deque of
+///             tasks. Workers run tasks from the back of their own deque and
+///             steal tasks from the front of other workers' deques when they
+///             run out of work.
+///
+///             Tasks posted from a worker go on that worker's deque. Tasks
+///             posted from any other thread are distributed round robin.
+///             There are no ordering guarantees between tasks.
+///
+class WorkerPool {
+ public:
+  //----------------------------------------------------------------------------
+  /// @brief      The process-wide worker pool. It has one worker per hardware
+  ///             thread.
+  ///
+  static WorkerPool& ForProcess();
+
+  //----------------------------------------------------------------------------
+  /// @brief      Create a pool with the given number of workers. The affinity
+  ///             and policy in the options apply to every worker. Workers are
+  ///             named after the name in the options followed by their index.
+  ///             The stack size is ignored.
+  ///
+  WorkerPool(size_t worker_count, ThreadOptions options = {});
+
+  //----------------------------------------------------------------------------
+  /// @brief      Waits for all pending tasks to be run before joining the
+  ///             workers.
+  ///
+  ~WorkerPool();
+
+  size_t GetWorkerCount() const;
+
+  //----------------------------------------------------------------------------
+  /// @brief      If the calling thread is one of the workers of this pool.
+  ///
+  bool IsCurrentThreadWorker() const;
+
+  bool PostTask(UniqueClosure task);
+
+  //----------------------------------------------------------------------------
+  /// @brief      The statistics of the pool. May be called on any thread.
+  ///
+  WorkerPoolStatistics GetStatistics() const;
+
+  struct ResumeAwaiter {
+    WorkerPool* pool = nullptr;
+
+    bool await_ready() const { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+      pool->PostTask([handle]() { handle.resume(); });
+    }
+
+    void await_resume() const {}
+  };
+
+  //----------------------------------------------------------------------------
+  /// @brief      Returns an awaitable that resumes the awaiting coroutine on
+  ///             one of the workers.
+  ///
+  ResumeAwaiter Resume() { return ResumeAwaiter{this}; }
+
+  //----------------------------------------------------------------------------
+  /// @brief      Run tasks on the calling thread, or wait for tasks to be
+  ///             run on the workers, till the predicate returns true. The
+  ///             predicate is re-checked whenever a task is run and when
+  ///             `NotifyWaiters` is called.
+  ///
+  void WaitUntil(const std::function<bool(void)>& predicate);
+
+  //----------------------------------------------------------------------------
+  /// @brief      Wake up all threads in `WaitUntil` so that they re-check their
+  ///             predicates.
+  ///
+  void NotifyWaiters();
+
+  //----------------------------------------------------------------------------
+  /// @brief      Invoke the body for each index in [0, count) and wait for all
+  ///             invocations to finish. The calling thread helps run the
+  ///             invocations.
+  ///
+  void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+  //----------------------------------------------------------------------------
+  /// @brief      Map each index in [0, count) to a value and combine all
+  ///             values into one. The reducer must be associative and the
+  ///             identity must not change a value it is combined with. Values
+  ///             are always combined in index order so the result is
+  ///             deterministic.
+  ///
+  template <class T, class Mapper, class Reducer>
+  T ParallelReduce(size_t count,
+                   T identity,
+                   const Mapper& mapper,
+                   const Reducer& reducer) {
+    const auto chunk_count = GetChunkCount(count);
+    std::vector<T> partials(chunk_count, identity);
+    ParallelFor(chunk_count, [&](size_t chunk) {
+      const auto begin = count * chunk / chunk_count;
+      const auto end = count * (chunk + 1) / chunk_count;
+      auto partial = identity;
+      for (auto i = begin; i < end; i++) {
+        partial = reducer(std::move(partial), mapper(i));
+      }
+      partials[chunk] = std::move(partial);
+    });
+    auto result = std::move(identity);
+    for (auto& partial : partials) {
+      result = reducer(std::move(result), std::move(partial));
+    }
+    return result;
+  }
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<UniqueClosure> tasks;
+    std::thread thread;
+    mutable std::mutex statistics_mutex;
+    DurationHistogram run_time;
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic_size_t pending_tasks_ = 0;
+  std::atomic_size_t sleepers_ = 0;
+  std::atomic_size_t next_worker_ = 0;
+  std::atomic_bool terminated_ = false;
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_cv_;
+
+  void WorkerMain(size_t worker_index, const ThreadOptions& options);
+
+  bool RunOneTask();
+
+  void RunTask(UniqueClosure task, bool is_worker);
+
+  UniqueClosure TakeTask(size_t worker_index, bool steal);
+
+  size_t GetChunkCount(size_t count) const;
+
+  P_DISALLOW_COPY_AND_ASSIGN(WorkerPool);
+};
+
+//------------------------------------------------------------------------------
+/// @brief      Tracks a group of tasks posted to a worker pool so that they
+///             can be waited on together. The calling thread helps run tasks
+///             while it waits.
+///
+class TaskGroup {
+ public:
+  TaskGroup(WorkerPool& pool = WorkerPool::ForProcess());
+
+  //----------------------------------------------------------------------------
+  /// @brief      Waits for all tasks in the group.
+  ///
+  ~TaskGroup();
+
+  bool PostTask(UniqueClosure task);
+
+  void Wait();
+
+ private:
+  WorkerPool& pool_;
+  std::atomic_size_t pending_tasks_ = 0;
+
+  P_DISALLOW_COPY_AND_ASSIGN(TaskGroup);
+};
+
+}  // namespace pixel
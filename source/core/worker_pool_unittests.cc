@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "worker_pool.h"
+
+namespace pixel {
+namespace testing {
+
+TEST(WorkerPoolTest, CanCreateAndDestroyPool) {
+  WorkerPool pool(4u);
+  ASSERT_EQ(pool.GetWorkerCount(), 4u);
+}
+
+TEST(WorkerPoolTest, PendingTasksRunBeforeCollection) {
+  std::atomic_size_t count = 0;
+  {
+    WorkerPool pool(2u);
+    for (size_t i = 0; i < 1000; i++) {
+      ASSERT_TRUE(pool.PostTask([&]() { count++; }));
+    }
+    ASSERT_FALSE(pool.PostTask(nullptr));
+  }
+  ASSERT_EQ(count, 1000u);
+}
+
+TEST(WorkerPoolTest, RecordsTaskStatistics) {
+  WorkerPool pool(2u);
+  TaskGroup group(pool);
+  for (size_t i = 0; i < 10; i++) {
+    group.PostTask([]() {});
+  }
+  group.Wait();
+  const auto statistics = pool.GetStatistics();
+  ASSERT_EQ(statistics.worker_count, 2u);
+  ASSERT_EQ(statistics.pending_tasks, 0u);
+  // The waiting thread may have helped run some of the tasks.
+  ASSERT_LE(statistics.run_time.GetCount(), 10u);
+}
+
+TEST(WorkerPoolTest, ParallelForVisitsEachIndexOnce) {
+  WorkerPool pool(4u);
+  std::vector<std::atomic_size_t> visits(10000u);
+  pool.ParallelFor(visits.size(), [&](size_t index) { visits[index]++; });
+  for (const auto& visit : visits) {
+    ASSERT_EQ(visit, 1u);
+  }
+  pool.ParallelFor(0u, [](size_t) { FAIL(); });
+}
+
+TEST(WorkerPoolTest, ParallelReduceIsDeterministic) {
+  WorkerPool pool(4u);
+  const size_t count = 100000u;
+  const auto sum = pool.ParallelReduce(
+      count, size_t{0}, [](size_t index) { return index; },
+      [](size_t a, size_t b) { return a + b; });
+  ASSERT_EQ(sum, count * (count - 1u) / 2u);
+
+  const auto concat = pool.ParallelReduce(
+      26u, std::string{},
+      [](size_t index) { return std::string(1, 'a' + index); },
+      [](std::string a, std::string b) { return a + b; });
+  ASSERT_EQ(concat, "abcdefghijklmnopqrstuvwxyz");
+}
+
+TEST(WorkerPoolTest, NestedParallelForDoesNotDeadlock) {
+  WorkerPool pool(2u);
+  std::atomic_size_t count = 0;
+  pool.ParallelFor(16u, [&](size_t) {
+    pool.ParallelFor(16u, [&](size_t) { count++; });
+  });
+  ASSERT_EQ(count, 256u);
+}
+
+TEST(WorkerPoolTest, TaskGroupWaitsForTasksPostedByTasks) {
+  WorkerPool pool(3u);
+  std::atomic_size_t count = 0;
+  {
+    TaskGroup group(pool);
+    for (size_t i = 0; i < 10; i++) {
+      group.PostTask([&]() {
+        count++;
+        for (size_t j = 0; j < 10; j++) {
+          group.PostTask([&]() { count++; });
+        }
+      });
+    }
+    group.Wait();
+    ASSERT_EQ(count, 110u);
+  }
+}
+
+TEST(WorkerPoolTest, BackgroundTasksRunOnProcessPool) {
+  ASSERT_GE(WorkerPool::ForProcess().GetWorkerCount(), 1u);
+  std::promise<void> promise;
+  auto future = promise.get_future();
+  WorkerPool::ForProcess().PostTask([&]() { promise.set_value(); });
+  future.wait();
+}
+
+TEST(WorkerPoolTest, KnowsItsWorkerThreads) {
+  WorkerPool pool(2u);
+  WorkerPool other_pool(1u);
+  ASSERT_FALSE(pool.IsCurrentThreadWorker());
+  std::promise<bool> promise;
+  auto future = promise.get_future();
+  pool.PostTask([&]() {
+    promise.set_value(pool.IsCurrentThreadWorker() &&
+                      !other_pool.IsCurrentThreadWorker());
+  });
+  ASSERT_TRUE(future.get());
+}
+
+}  // namespace testing
+}  // namespace pixel
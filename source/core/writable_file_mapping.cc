@@ -0,0 +1,182 @@
+#include "writable_file_mapping.h"
+
+#if P_OS_WINDOWS
+#include <Windows.h>
+
+#include "win_utils.h"
+#else  // P_OS_WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#endif  // P_OS_WINDOWS
+
+#include "logging.h"
+
+namespace pixel {
+
+std::unique_ptr<WritableFileMapping> WritableFileMapping::Create(
+    const std::filesystem::path& path,
+    size_t size) {
+  if (path.empty()) {
+    P_ERROR << "File path was empty.";
+    return nullptr;
+  }
+
+#if P_OS_WINDOWS
+  UniqueFD fd(::CreateFileW(path.c_str(),                  // lpFileName
+                            GENERIC_READ | GENERIC_WRITE,  // dwDesiredAccess
+                            FILE_SHARE_READ,               // dwShareMode
+                            nullptr,                // lpSecurityAttributes
+                            OPEN_ALWAYS,            // dwCreationDisposition
+                            FILE_ATTRIBUTE_NORMAL,  // dwFlagsAndAttributes
+                            nullptr                 // hTemplateFile
+                            ));
+  if (!fd.IsValid()) {
+    P_ERROR << "Could not open " << path
+            << " for writing: " << GetLastErrorMessage();
+    return nullptr;
+  }
+#else   // P_OS_WINDOWS
+  UniqueFD fd(P_TEMP_FAILURE_RETRY(
+      ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)));
+  if (!fd.IsValid()) {
+    P_ERROR << "Could not open " << path
+            << " for writing: " << strerror(errno);
+    return nullptr;
+  }
+#endif  // P_OS_WINDOWS
+
+  auto mapping = std::unique_ptr<WritableFileMapping>(
+      new WritableFileMapping(std::move(fd)));
+  if (!mapping->Resize(size)) {
+    return nullptr;
+  }
+  return mapping;
+}
+
+WritableFileMapping::WritableFileMapping(UniqueFD fd) : fd_(std::move(fd)) {}
+
+WritableFileMapping::~WritableFileMapping() {
+  Unmap();
+}
+
+const uint8_t* WritableFileMapping::GetData() const {
+  return data_;
+}
+
+size_t WritableFileMapping::GetSize() const {
+  return size_;
+}
+
+uint8_t* WritableFileMapping::GetMutableData() {
+  return data_;
+}
+
+bool WritableFileMapping::Resize(size_t size) {
+  Unmap();
+
+#if P_OS_WINDOWS
+  LARGE_INTEGER file_size = {};
+  file_size.QuadPart = size;
+  if (!::SetFilePointerEx(fd_.Get(), file_size, nullptr, FILE_BEGIN) ||
+      !::SetEndOfFile(fd_.Get())) {
+    P_ERROR << "Could not resize file: " << GetLastErrorMessage();
+    return false;
+  }
+#else   // P_OS_WINDOWS
+  if (P_TEMP_FAILURE_RETRY(::ftruncate(fd_.Get(), size)) != 0) {
+    P_ERROR << "Could not resize file: " << strerror(errno);
+    return false;
+  }
+#endif  // P_OS_WINDOWS
+
+  return Map(size);
+}
+
+bool WritableFileMapping::Map(size_t size) {
+  // Empty files cannot be mapped.
+  if (size == 0) {
+    return true;
+  }
+
+#if P_OS_WINDOWS
+  mapping_fd_.Reset(::CreateFileMapping(fd_.Get(),       // hFile
+                                        nullptr,         // lpAttributes
+                                        PAGE_READWRITE,  // flProtect
+                                        0,               // dwMaximumSizeHigh
+                                        0,               // dwMaximumSizeLow
+                                        nullptr          // lpName
+                                        ));
+  if (!mapping_fd_.IsValid()) {
+    P_ERROR << "Could not setup file mapping: " << GetLastErrorMessage();
+    return false;
+  }
+  auto mapping = ::MapViewOfFile(mapping_fd_.Get(),  // hFileMappingObject
+                                 FILE_MAP_WRITE,     // dwDesiredAccess
+                                 0,                  // dwFileOffsetHigh
+                                 0,                  // dwFileOffsetLow
+                                 size                // dwNumberOfBytesToMap
+  );
+  if (mapping == nullptr) {
+    P_ERROR << "Could not map file: " << GetLastErrorMessage();
+    mapping_fd_.Reset();
+    return false;
+  }
+#else   // P_OS_WINDOWS
+  auto mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                        fd_.Get(), 0);
+  if (mapping == MAP_FAILED) {
+    P_ERROR << "Could not mmap file descriptor: " << strerror(errno);
+    return false;
+  }
+#endif  // P_OS_WINDOWS
+
+  data_ = static_cast<uint8_t*>(mapping);
+  size_ = size;
+  return true;
+}
+
+void WritableFileMapping::Unmap() {
+  if (data_ == nullptr) {
+    return;
+  }
+#if P_OS_WINDOWS
+  if (!::UnmapViewOfFile(data_)) {
+    P_ERROR << "Could not unmap view of file.";
+  }
+  mapping_fd_.Reset();
+#else   // P_OS_WINDOWS
+  if (::munmap(data_, size_) != 0) {
+    P_ERROR << "Could not unmap data.";
+  }
+#endif  // P_OS_WINDOWS
+  data_ = nullptr;
+  size_ = 0;
+}
+
+bool WritableFileMapping::Sync(bool wait) {
+  if (data_ == nullptr) {
+    return true;
+  }
+#if P_OS_WINDOWS
+  if (!::FlushViewOfFile(data_, size_)) {
+    P_ERROR << "Could not flush mapping: " << GetLastErrorMessage();
+    return false;
+  }
+  if (wait && !::FlushFileBuffers(fd_.Get())) {
+    P_ERROR << "Could not flush file: " << GetLastErrorMessage();
+    return false;
+  }
+#else   // P_OS_WINDOWS
+  if (::msync(data_, size_, wait ? MS_SYNC : MS_ASYNC) != 0) {
+    P_ERROR << "Could not sync mapping: " << strerror(errno);
+    return false;
+  }
+#endif  // P_OS_WINDOWS
+  return true;
+}
+
+}  // namespace pixel
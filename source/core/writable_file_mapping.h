@@ -0,0 +1,71 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+
+#include "file.h"
+#include "macros.h"
+#include "mapping.h"
+
+namespace pixel {
+
+//------------------------------------------------------------------------------
+/// @brief      A file mapped for reading and writing. Writes to the mapping
+///             are writes to the file. They reach the disk eventually or when
+///             the mapping is synced.
+///
+class WritableFileMapping final : public Mapping {
+ public:
+  //----------------------------------------------------------------------------
+  /// @brief      Map the file at the path, creating it if necessary. The file
+  ///             is resized to the given size. Existing contents within the
+  ///             size are preserved and new contents are zero.
+  ///
+  static std::unique_ptr<WritableFileMapping> Create(
+      const std::filesystem::path& path,
+      size_t size);
+
+  // |Mapping|
+  ~WritableFileMapping() override;
+
+  // |Mapping|
+  const uint8_t* GetData() const override;
+
+  // |Mapping|
+  size_t GetSize() const override;
+
+  uint8_t* GetMutableData();
+
+  //----------------------------------------------------------------------------
+  /// @brief      Resize the file and remap it. Pointers into the mapping are
+  ///             invalidated. On failure, the mapping is unmapped and has no
+  ///             data.
+  ///
+  bool Resize(size_t size);
+
+  //----------------------------------------------------------------------------
+  /// @brief      Write the dirty pages of the mapping to the file.
+  ///
+  /// @param[in]  wait  If the call should only return once the pages are on
+  ///                   disk. Otherwise, the writes are only scheduled.
+  ///
+  bool Sync(bool wait = true);
+
+ private:
+  UniqueFD fd_;
+#if P_OS_WINDOWS
+  UniqueFD mapping_fd_;
+#endif  // P_OS_WINDOWS
+  uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+
+  WritableFileMapping(UniqueFD fd);
+
+  bool Map(size_t size);
+
+  void Unmap();
+
+  P_DISALLOW_COPY_AND_ASSIGN(WritableFileMapping);
+};
+
+}  // namespace pixel
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string_view>
+
+#include "file.h"
+#include "scoped_temp_directory.h"
+#include "writable_file_mapping.h"
+
+namespace pixel {
+namespace testing {
+
+TEST(WritableFileMappingTest, WritesAreVisibleToReaders) {
+  ScopedTempDirectory directory("pixel_writable");
+  ASSERT_TRUE(directory.IsValid());
+  const auto path = directory.GetPath() / "mapping";
+  {
+    auto mapping = WritableFileMapping::Create(path, 5u);
+    ASSERT_TRUE(mapping);
+    ASSERT_EQ(mapping->GetSize(), 5u);
+    ::memcpy(mapping->GetMutableData(), "hello", 5u);
+    ASSERT_TRUE(mapping->Sync());
+  }
+  auto read = OpenFile(path);
+  ASSERT_TRUE(read);
+  ASSERT_EQ(std::string_view(reinterpret_cast<const char*>(read->GetData()),
+                             read->GetSize()),
+            "hello");
+}
+
+TEST(WritableFileMappingTest, ResizePreservesContents) {
+  ScopedTempDirectory directory("pixel_writable");
+  ASSERT_TRUE(directory.IsValid());
+  const auto path = directory.GetPath() / "resize";
+  auto mapping = WritableFileMapping::Create(path, 0u);
+  ASSERT_TRUE(mapping);
+  ASSERT_EQ(mapping->GetSize(), 0u);
+  ASSERT_EQ(mapping->GetData(), nullptr);
+  ASSERT_TRUE(mapping->Sync());
+
+  ASSERT_TRUE(mapping->Resize(3u));
+  ::memcpy(mapping->GetMutableData(), "abc", 3u);
+  ASSERT_TRUE(mapping->Resize(64u * 1024u));
+  ASSERT_EQ(::memcmp(mapping->GetData(), "abc", 3u), 0);
+  ASSERT_EQ(mapping->GetData()[64u * 1024u - 1u], 0u);
+  ASSERT_TRUE(mapping->Sync(false));
+  ASSERT_TRUE(mapping->Resize(2u));
+  ASSERT_EQ(std::filesystem::file_size(path), 2u);
+  ASSERT_EQ(::memcmp(mapping->GetData(), "ab", 2u), 0);
+}
+
+}  // namespace testing
+}  // namespace pixel
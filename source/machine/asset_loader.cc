@@ -1,25 +1,82 @@
 #include "asset_loader.h"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <optional>
 #include <sstream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
+#include <tinygltf/json.hpp>
+
+#include "async_file_reader.h"
+#include "deferred_image.h"
 #include "file.h"
 #include "logging.h"
+#include "model.h"
+#include "model_cache.h"
+#include "model_draw_data.h"
+#include "trace_event.h"
+#include "worker_pool.h"
 
 namespace pixel {
 
-std::shared_ptr<AssetLoader> AssetLoader::GetGlobal() {
-  static auto sLoader = std::make_shared<AssetLoader>();
-  return sLoader;
+CancellationToken::CancellationToken() = default;
+
+CancellationToken::~CancellationToken() = default;
+
+void CancellationToken::Cancel() {
+  is_cancelled_ = true;
 }
 
-AssetLoader::AssetLoader() : thread_("AssetLoader") {}
+bool CancellationToken::IsCancelled() const {
+  return is_cancelled_;
+}
 
-AssetLoader::~AssetLoader() = default;
+//------------------------------------------------------------------------------
+/// @brief      Called by TinyGLTF for each image instead of decoding it. Only
+///             the encoded image is recorded and decoding starts on the worker
+///             pool right away.
+///
+static bool DeferImageDecode(tinygltf::Image* image,
+                             const int image_index,
+                             std::string* error,
+                             std::string* warning,
+                             int requested_width,
+                             int requested_height,
+                             const unsigned char* bytes,
+                             int size,
+                             void* user_data) {
+  if (image_index < 0 || bytes == nullptr || size <= 0) {
+    if (error) {
+      *error += "Image " + std::to_string(image_index) + " is empty.\n";
+    }
+    return false;
+  }
+  auto& images =
+      *reinterpret_cast<std::vector<std::shared_ptr<DeferredImage>>*>(
+          user_data);
+  if (images.size() <= static_cast<size_t>(image_index)) {
+    images.resize(image_index + 1u);
+  }
+  // TinyGLTF only keeps the encoded bytes alive for the duration of the call.
+  images[image_index] =
+      DeferredImage::Decode(CopyMapping(bytes, static_cast<size_t>(size)));
+  return true;
+}
 
-static std::unique_ptr<Asset> LoadAssetFromMapping(
-    const Mapping& mapping,
-    std::string assets_base_dir) {
+static std::unique_ptr<Asset> LoadAssetFromText(const Mapping& mapping,
+                                                const std::string& base_dir) {
+  P_TRACE_EVENT("asset", "ParseGLTF");
   tinygltf::TinyGLTF loader;
+  std::vector<std::shared_ptr<DeferredImage>> images;
+  loader.SetImageLoader(&DeferImageDecode, &images);
 
   tinygltf::Model model;
   std::string errors, warnings;
@@ -27,7 +84,7 @@ static std::unique_ptr<Asset> LoadAssetFromMapping(
   if (!loader.LoadASCIIFromString(
           &model, &errors, &warnings,
           reinterpret_cast<const char*>(mapping.GetData()), mapping.GetSize(),
-          assets_base_dir)) {
+          base_dir)) {
     P_ERROR << "Could not load GLTF file: " << errors;
   }
 
@@ -35,17 +92,298 @@ static std::unique_ptr<Asset> LoadAssetFromMapping(
     P_ERROR << "Warnings while loading model: " << warnings;
   }
 
-  return std::make_unique<Asset>(std::move(model));
+  images.resize(model.images.size());
+  return std::make_unique<Asset>(std::move(model),
+                                 std::vector<std::shared_ptr<const Mapping>>{},
+                                 std::move(images));
 }
 
-static std::unique_ptr<Mapping> GetAssetFileMapping(
-    const std::string& assets_base_dir,
+// *****************************************************************************
+// *** Binary glTF
+// *****************************************************************************
+
+// All values in binary glTF files are little endian.
+static constexpr uint32_t kGLBMagic = 0x46546C67u;      // "glTF"
+static constexpr uint32_t kGLBChunkJSON = 0x4E4F534Au;  // "JSON"
+static constexpr uint32_t kGLBChunkBIN = 0x004E4942u;   // "BIN\0"
+static constexpr size_t kGLBHeaderSize = 12u;
+static constexpr size_t kGLBChunkHeaderSize = 8u;
+
+static uint32_t ReadUint32(const uint8_t* data) {
+  uint32_t value = 0;
+  ::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+static void WriteUint32(std::vector<uint8_t>& data, uint32_t value) {
+  const auto offset = data.size();
+  data.resize(offset + sizeof(value));
+  ::memcpy(data.data() + offset, &value, sizeof(value));
+}
+
+static bool IsGLB(const Mapping& mapping) {
+  return mapping.GetSize() >= kGLBHeaderSize &&
+         ReadUint32(mapping.GetData()) == kGLBMagic;
+}
+
+struct GLBChunks {
+  std::string_view json;
+  // The BIN chunk is optional. Its size is zero if there is none.
+  size_t bin_offset = 0;
+  size_t bin_size = 0;
+};
+
+static std::optional<GLBChunks> ReadGLBChunks(const Mapping& mapping) {
+  const auto data = mapping.GetData();
+  const auto version = ReadUint32(data + 4u);
+  const auto length = ReadUint32(data + 8u);
+  if (version != 2u) {
+    P_ERROR << "Unsupported binary glTF version " << version;
+    return std::nullopt;
+  }
+  if (length > mapping.GetSize()) {
+    P_ERROR << "Binary glTF file is truncated.";
+    return std::nullopt;
+  }
+  GLBChunks chunks;
+  size_t offset = kGLBHeaderSize;
+  for (size_t index = 0; offset + kGLBChunkHeaderSize <= length; index++) {
+    const size_t chunk_size = ReadUint32(data + offset);
+    const auto chunk_type = ReadUint32(data + offset + 4u);
+    const auto chunk_offset = offset + kGLBChunkHeaderSize;
+    if (chunk_size > length - chunk_offset) {
+      P_ERROR << "Binary glTF chunk overruns the file.";
+      return std::nullopt;
+    }
+    if (index == 0u) {
+      if (chunk_type != kGLBChunkJSON) {
+        P_ERROR << "The first chunk of binary glTF files must be JSON.";
+        return std::nullopt;
+      }
+      chunks.json = {reinterpret_cast<const char*>(data + chunk_offset),
+                     chunk_size};
+    } else if (index == 1u && chunk_type == kGLBChunkBIN) {
+      chunks.bin_offset = chunk_offset;
+      chunks.bin_size = chunk_size;
+    }
+    // Chunks are padded to four bytes. Unknown chunks are skipped.
+    offset = chunk_offset + ((chunk_size + 3u) & ~size_t{3u});
+  }
+  if (chunks.json.empty()) {
+    P_ERROR << "Binary glTF file has no JSON chunk.";
+    return std::nullopt;
+  }
+  return chunks;
+}
+
+static std::vector<uint8_t> CreateGLB(const std::string& json,
+                                      const std::vector<uint8_t>& bin) {
+  const auto json_size = (json.size() + 3u) & ~size_t{3u};
+  const auto bin_size = (bin.size() + 3u) & ~size_t{3u};
+  const auto length = kGLBHeaderSize + kGLBChunkHeaderSize + json_size +
+                      (bin.empty() ? 0u : kGLBChunkHeaderSize + bin_size);
+  std::vector<uint8_t> glb;
+  glb.reserve(length);
+  WriteUint32(glb, kGLBMagic);
+  WriteUint32(glb, 2u);
+  WriteUint32(glb, static_cast<uint32_t>(length));
+  WriteUint32(glb, static_cast<uint32_t>(json_size));
+  WriteUint32(glb, kGLBChunkJSON);
+  glb.insert(glb.end(), json.begin(), json.end());
+  glb.resize(glb.size() + json_size - json.size(), ' ');
+  if (!bin.empty()) {
+    WriteUint32(glb, static_cast<uint32_t>(bin_size));
+    WriteUint32(glb, kGLBChunkBIN);
+    glb.insert(glb.end(), bin.begin(), bin.end());
+    glb.resize(glb.size() + bin_size - bin.size(), 0u);
+  }
+  P_ASSERT(glb.size() == length);
+  return glb;
+}
+
+// Unlike `nlohmann::json::value`, these don't abort on type mismatches.
+static size_t GetJSONSize(const nlohmann::json& object, const char* key) {
+  auto found = object.find(key);
+  return found != object.end() && found->is_number_unsigned()
+             ? found->get<size_t>()
+             : 0u;
+}
+
+static int GetJSONIndex(const nlohmann::json& object, const char* key) {
+  auto found = object.find(key);
+  return found != object.end() && found->is_number_integer()
+             ? found->get<int>()
+             : -1;
+}
+
+static std::string GetJSONString(const nlohmann::json& object,
+                                 const char* key) {
+  auto found = object.find(key);
+  return found != object.end() && found->is_string()
+             ? found->get<std::string>()
+             : std::string{};
+}
+
+//------------------------------------------------------------------------------
+/// @brief      Load a binary glTF file without copying its BIN chunk.
+///
+///             TinyGLTF copies the BIN chunk into the model and decodes images
+///             stored in it from that copy. Instead, it is handed a copy of the
+///             JSON chunk in which the buffer of the BIN chunk is a stub and
+///             the images stored in buffer views are removed. The buffer is
+///             then backed by the mapping of the file and the images are
+///             decoded from the mapping directly on the worker pool.
+///
+static std::unique_ptr<Asset> LoadAssetFromGLB(
+    std::shared_ptr<const Mapping> mapping,
+    const std::string& base_dir) {
+  P_TRACE_EVENT("asset", "ParseGLB");
+  const auto chunks = ReadGLBChunks(*mapping);
+  if (!chunks.has_value()) {
+    return nullptr;
+  }
+
+  auto json = nlohmann::json::parse(chunks->json.begin(), chunks->json.end(),
+                                    nullptr, false);
+  if (json.is_discarded() || !json.is_object()) {
+    P_ERROR << "Could not parse the JSON chunk of the binary glTF file.";
+    return nullptr;
+  }
+
+  // Only the first buffer may refer to the BIN chunk.
+  std::shared_ptr<const Mapping> bin_data;
+  auto buffers = json.find("buffers");
+  if (buffers != json.end() && buffers->is_array() && !buffers->empty() &&
+      buffers->front().is_object() && !buffers->front().contains("uri")) {
+    auto& buffer = buffers->front();
+    const auto byte_length = GetJSONSize(buffer, "byteLength");
+    if (byte_length == 0u || byte_length > chunks->bin_size) {
+      P_ERROR << "The BIN chunk of the binary glTF file is missing or too "
+                 "small.";
+      return nullptr;
+    }
+    bin_data = SliceMapping(mapping, chunks->bin_offset, byte_length);
+    if (!bin_data) {
+      return nullptr;
+    }
+    buffer["byteLength"] = 1u;
+  }
+
+  // The images are added back to the model after it has been loaded. TinyGLTF
+  // does not check the image references of textures.
+  nlohmann::json images;
+  if (auto found = json.find("images"); found != json.end()) {
+    images = std::move(*found);
+    json.erase(found);
+  }
+  if (!images.is_null() && !images.is_array()) {
+    P_ERROR << "Images in the binary glTF file are not an array.";
+    return nullptr;
+  }
+
+  tinygltf::TinyGLTF loader;
+  tinygltf::Model model;
+  std::string errors, warnings;
+  const auto glb = CreateGLB(
+      json.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace),
+      bin_data ? std::vector<uint8_t>(1u) : std::vector<uint8_t>{});
+  if (!loader.LoadBinaryFromMemory(&model, &errors, &warnings, glb.data(),
+                                   static_cast<unsigned int>(glb.size()),
+                                   base_dir)) {
+    P_ERROR << "Could not load binary GLTF file: " << errors;
+    return nullptr;
+  }
+
+  if (warnings.size() != 0) {
+    P_ERROR << "Warnings while loading model: " << warnings;
+  }
+
+  std::vector<std::shared_ptr<const Mapping>> buffer_data(
+      model.buffers.size());
+  std::vector<std::shared_ptr<DeferredImage>> deferred_images;
+  if (bin_data) {
+    // Replace the stub.
+    model.buffers.front().data = {};
+    model.buffers.front().byteLength = bin_data->GetSize();
+    buffer_data.front() = bin_data;
+  }
+
+  for (size_t i = 0, count = images.is_array() ? images.size() : 0u;
+       i < count; i++) {
+    const auto& image_json = images[i];
+    auto& image = model.images.emplace_back();
+    auto& deferred_image = deferred_images.emplace_back();
+    if (!image_json.is_object()) {
+      continue;
+    }
+    image.name = GetJSONString(image_json, "name");
+    image.mimeType = GetJSONString(image_json, "mimeType");
+    image.bufferView = GetJSONIndex(image_json, "bufferView");
+    image.uri = GetJSONString(image_json, "uri");
+    if (image.bufferView < 0 ||
+        static_cast<size_t>(image.bufferView) >= model.bufferViews.size()) {
+      P_ERROR << "Only images stored in the binary glTF file are supported.";
+      continue;
+    }
+    const auto& view = model.bufferViews[image.bufferView];
+    if (view.buffer < 0 ||
+        static_cast<size_t>(view.buffer) >= model.buffers.size()) {
+      continue;
+    }
+    // Images in the BIN chunk are decoded straight from the mapping.
+    std::shared_ptr<const Mapping> encoded;
+    if (const auto& mapped = buffer_data[view.buffer]) {
+      encoded = SliceMapping(mapped, view.byteOffset, view.byteLength);
+    } else {
+      const auto& data = model.buffers[view.buffer].data;
+      if (view.byteOffset <= data.size() &&
+          view.byteLength <= data.size() - view.byteOffset) {
+        encoded = CopyMapping(data.data() + view.byteOffset, view.byteLength);
+      }
+    }
+    if (!encoded) {
+      P_ERROR << "Image " << i << " (" << image.name
+              << ") of the binary glTF file overruns its buffer.";
+      continue;
+    }
+    deferred_image = DeferredImage::Decode(std::move(encoded));
+  }
+
+  return std::make_unique<Asset>(std::move(model), std::move(buffer_data),
+                                 std::move(deferred_images));
+}
+
+static std::unique_ptr<Asset> LoadAssetFromMapping(
+    std::shared_ptr<const Mapping> mapping,
+    const std::string& assets_base_dir) {
+  if (IsGLB(*mapping)) {
+    return LoadAssetFromGLB(std::move(mapping), assets_base_dir);
+  }
+  return LoadAssetFromText(*mapping, assets_base_dir);
+}
+
+static FileMappingOptions GetAssetFileMappingOptions(
     const std::string& asset_file) {
+  FileMappingOptions options;
+  // Text files are parsed front to back right away. Most of a binary file is
+  // its BIN chunk, which is only read as its buffers are used.
+  if (std::filesystem::path(asset_file).extension() != ".glb") {
+    options.access_pattern = FileAccessPattern::kFileAccessPatternSequential;
+    options.will_need = true;
+  }
+  return options;
+}
+
+static std::shared_ptr<const Mapping> GetAssetFileMapping(
+    const std::string& assets_base_dir,
+    const std::string& asset_file,
+    const FileMappingOptions& options) {
+  P_TRACE_EVENT("asset", "OpenAssetFile");
   std::stringstream stream;
   stream << assets_base_dir << "/" << asset_file;
   auto file_path = stream.str();
 
-  auto mapping = OpenFile(file_path.c_str());
+  auto mapping = OpenFile(file_path, options);
   if (!mapping) {
     P_ERROR << "Could not open file: " << file_path;
     return nullptr;
@@ -54,24 +392,686 @@ static std::unique_ptr<Mapping> GetAssetFileMapping(
   return mapping;
 }
 
+static std::shared_ptr<const Mapping> GetAssetFileMapping(
+    const std::string& assets_base_dir,
+    const std::string& asset_file) {
+  return GetAssetFileMapping(assets_base_dir, asset_file,
+                             GetAssetFileMappingOptions(asset_file));
+}
+
+std::unique_ptr<Asset> AssetLoader::LoadAssetWithMappingOptions(
+    const std::string& assets_base_dir,
+    const std::string& asset_file,
+    const FileMappingOptions& options) {
+  auto mapping = GetAssetFileMapping(assets_base_dir, asset_file, options);
+  if (!mapping) {
+    return nullptr;
+  }
+  return LoadAssetFromMapping(std::move(mapping), assets_base_dir);
+}
+
 void AssetLoader::LoadAsset(
     std::string assets_base_dir,
     std::string asset_file,
-    std::function<void(std::unique_ptr<Asset>)> on_done) {
+    UniqueFunction<void(std::unique_ptr<Asset>)> on_done) {
   if (!on_done) {
     return;
   }
 
-  thread_.GetDispatcher()->PostTask(
-      MakeCopyable([assets_base_dir = std::move(assets_base_dir),
-                    asset_file = std::move(asset_file), on_done] {
+  // Spans the time from the request to the asset being handed over.
+  const auto load_id = GetNextTraceID();
+  P_TRACE_ASYNC_BEGIN("asset", "LoadAsset", load_id);
+  WorkerPool::ForProcess().PostTask(
+      [assets_base_dir = std::move(assets_base_dir),
+       asset_file = std::move(asset_file), on_done = std::move(on_done),
+       load_id] {
+        P_TRACE_EVENT("asset", "LoadAsset");
         auto mapping = GetAssetFileMapping(assets_base_dir, asset_file);
         if (!mapping) {
+          P_TRACE_ASYNC_END("asset", "LoadAsset", load_id);
           on_done(nullptr);
           return;
         }
-        on_done(LoadAssetFromMapping(*mapping, std::move(assets_base_dir)));
-      }));
+        auto asset = LoadAssetFromMapping(std::move(mapping), assets_base_dir);
+        P_TRACE_ASYNC_END("asset", "LoadAsset", load_id);
+        on_done(std::move(asset));
+      });
+}
+
+// Adds the contents of the files referred to by the objects in the array to
+// the hash. Data URIs are part of the JSON that has already been hashed.
+static bool HashReferencedFiles(ContentHasher& hasher,
+                                const nlohmann::json& json,
+                                const char* array_key,
+                                const std::string& assets_base_dir) {
+  auto array = json.find(array_key);
+  if (array == json.end() || !array->is_array()) {
+    return true;
+  }
+  FileMappingOptions options;
+  options.access_pattern = FileAccessPattern::kFileAccessPatternSequential;
+  for (const auto& object : *array) {
+    if (!object.is_object()) {
+      continue;
+    }
+    const auto uri = GetJSONString(object, "uri");
+    if (uri.empty() || uri.starts_with("data:")) {
+      continue;
+    }
+    const auto file_path = std::filesystem::path(assets_base_dir) / uri;
+    auto mapping = OpenFile(file_path, options);
+    if (!mapping) {
+      P_ERROR << "Could not open file referenced by asset: " << file_path;
+      return false;
+    }
+    hasher.Update(uri.data(), uri.size());
+    hasher.Update(*mapping);
+  }
+  return true;
+}
+
+// Hashes an asset file that has already been mapped. See
+// `AssetLoader::HashAsset`.
+static std::optional<Hash128> HashAssetMapping(
+    const Mapping& mapping,
+    const std::string& assets_base_dir,
+    const std::string& asset_file) {
+  std::string_view json_text;
+  if (IsGLB(mapping)) {
+    const auto chunks = ReadGLBChunks(mapping);
+    if (!chunks.has_value()) {
+      return std::nullopt;
+    }
+    json_text = chunks->json;
+  } else {
+    json_text = {reinterpret_cast<const char*>(mapping.GetData()),
+                 mapping.GetSize()};
+  }
+
+  auto json =
+      nlohmann::json::parse(json_text.begin(), json_text.end(), nullptr, false);
+  if (json.is_discarded() || !json.is_object()) {
+    P_ERROR << "Could not parse the JSON of the asset: " << asset_file;
+    return std::nullopt;
+  }
+
+  ContentHasher hasher;
+  hasher.Update(mapping);
+  if (!HashReferencedFiles(hasher, json, "buffers", assets_base_dir) ||
+      !HashReferencedFiles(hasher, json, "images", assets_base_dir)) {
+    return std::nullopt;
+  }
+  return hasher.Digest128();
+}
+
+//------------------------------------------------------------------------------
+/// @brief      The models loaded by a loader. Entries are either being loaded,
+///             in which case they collect the callbacks of all loads of the
+///             same file, or ready and in the least recently used list.
+///
+class LoadedModels final : public std::enable_shared_from_this<LoadedModels> {
+ public:
+  LoadedModels(std::shared_ptr<model::ModelCache> baked_models)
+      : baked_models_(std::move(baked_models)) {
+    statistics_.budget = AssetLoader::kDefaultModelMemoryBudget;
+  }
+
+  ~LoadedModels() = default;
+
+  void Load(std::string assets_base_dir,
+            std::string asset_file,
+            AssetLoader::ModelCallback on_done) {
+    WorkerPool::ForProcess().PostTask(
+        [models = shared_from_this(),
+         assets_base_dir = std::move(assets_base_dir),
+         asset_file = std::move(asset_file),
+         on_done = std::move(on_done)]() mutable {
+          models->LoadOnWorker(std::move(assets_base_dir),
+                               std::move(asset_file), std::move(on_done));
+        });
+  }
+
+  void SetBudget(size_t bytes) {
+    std::scoped_lock lock(mutex_);
+    statistics_.budget = bytes;
+    EvictLocked();
+  }
+
+  ModelMemoryStatistics GetStatistics() const {
+    std::scoped_lock lock(mutex_);
+    return statistics_;
+  }
+
+ private:
+  using DrawData = std::shared_ptr<const model::ModelDrawData>;
+
+  struct Entry {
+    // Null while the model is being loaded.
+    DrawData draw_data;
+    size_t size = 0;
+    // The handles to the draw data that have been handed out and are still
+    // alive. Entries in use are not evicted.
+    size_t users = 0;
+    std::list<std::string>::iterator lru_position;
+    std::vector<AssetLoader::ModelCallback> waiters;
+  };
+
+  const std::shared_ptr<model::ModelCache> baked_models_;
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  // The keys of the ready entries, most recently loaded first.
+  std::list<std::string> lru_;
+  ModelMemoryStatistics statistics_;
+
+  // Files are identified by their canonical path, modification time and size
+  // so that files that are replaced are loaded again.
+  static std::optional<std::string> GetKey(const std::string& assets_base_dir,
+                                           const std::string& asset_file) {
+    std::error_code error;
+    const auto path = std::filesystem::canonical(
+        std::filesystem::path(assets_base_dir) / asset_file, error);
+    if (error) {
+      P_ERROR << "Could not find asset file: " << asset_file;
+      return std::nullopt;
+    }
+    const auto write_time = std::filesystem::last_write_time(path, error);
+    if (error) {
+      return std::nullopt;
+    }
+    const auto size = std::filesystem::file_size(path, error);
+    if (error) {
+      return std::nullopt;
+    }
+    std::stringstream stream;
+    stream << path.string() << "|" << write_time.time_since_epoch().count()
+           << "|" << size;
+    return stream.str();
+  }
+
+  void LoadOnWorker(std::string assets_base_dir,
+                    std::string asset_file,
+                    AssetLoader::ModelCallback on_done) {
+    P_TRACE_EVENT("asset", "LoadModel");
+    const auto key = GetKey(assets_base_dir, asset_file);
+    if (!key.has_value()) {
+      on_done(nullptr);
+      return;
+    }
+
+    DrawData loaded;
+    {
+      std::scoped_lock lock(mutex_);
+      auto found = entries_.find(key.value());
+      if (found == entries_.end()) {
+        statistics_.misses++;
+        entries_[key.value()].waiters.emplace_back(std::move(on_done));
+      } else {
+        statistics_.hits++;
+        auto& entry = found->second;
+        if (!entry.draw_data) {
+          entry.waiters.emplace_back(std::move(on_done));
+          return;
+        }
+        lru_.splice(lru_.begin(), lru_, entry.lru_position);
+        loaded = HandOutLocked(key.value(), entry);
+      }
+    }
+    if (loaded) {
+      on_done(std::move(loaded));
+      return;
+    }
+
+    auto draw_data = LoadDrawData(assets_base_dir, asset_file);
+    const auto size = draw_data ? draw_data->GetSizeInBytes() : 0u;
+
+    std::vector<AssetLoader::ModelCallback> waiters;
+    std::vector<DrawData> handles;
+    {
+      std::scoped_lock lock(mutex_);
+      auto found = entries_.find(key.value());
+      P_ASSERT(found != entries_.end());
+      waiters = std::move(found->second.waiters);
+      if (draw_data) {
+        auto& entry = found->second;
+        entry.draw_data = std::move(draw_data);
+        entry.size = size;
+        entry.lru_position = lru_.insert(lru_.begin(), key.value());
+        statistics_.models++;
+        statistics_.bytes += size;
+        // Handed out before evicting so that the model is not evicted
+        // before its waiters get it.
+        for (size_t i = 0; i < waiters.size(); i++) {
+          handles.emplace_back(HandOutLocked(key.value(), entry));
+        }
+        EvictLocked();
+      } else {
+        // Failed loads are tried again by the next load of the file.
+        entries_.erase(found);
+        handles.resize(waiters.size());
+      }
+    }
+
+    for (size_t i = 0; i < waiters.size(); i++) {
+      waiters[i](std::move(handles[i]));
+    }
+  }
+
+  // Each user gets a handle of its own so that the loader is told when the
+  // last one is dropped. The handle keeps the draw data alive even if the
+  // entry is evicted or the loader is gone.
+  DrawData HandOutLocked(const std::string& key, Entry& entry) {
+    entry.users++;
+    const auto draw_data = entry.draw_data.get();
+    return DrawData(
+        draw_data, [models = weak_from_this(), key,
+                    draw_data = entry.draw_data](const model::ModelDrawData*) {
+          if (auto strong_models = models.lock()) {
+            strong_models->DidDropHandle(key, draw_data);
+          }
+          // The draw data is released here, outside the lock of the loader.
+        });
+  }
+
+  void DidDropHandle(const std::string& key, const DrawData& draw_data) {
+    std::scoped_lock lock(mutex_);
+    auto found = entries_.find(key);
+    if (found == entries_.end() || found->second.draw_data != draw_data) {
+      return;
+    }
+    P_ASSERT(found->second.users > 0u);
+    if (--found->second.users == 0u) {
+      // Models that were in use when the loader went over its budget are
+      // evicted as soon as they are no longer used.
+      EvictLocked();
+    }
+  }
+
+  DrawData LoadDrawData(const std::string& assets_base_dir,
+                        const std::string& asset_file) const {
+    auto mapping = GetAssetFileMapping(assets_base_dir, asset_file);
+    if (!mapping) {
+      return nullptr;
+    }
+
+    // Models baked before are mapped instead of being loaded. The source is
+    // hashed from the mapping that is parsed otherwise, so the asset file is
+    // only read once.
+    std::optional<Hash128> source_hash;
+    if (baked_models_) {
+      P_TRACE_EVENT("asset", "HashAsset");
+      source_hash = HashAssetMapping(*mapping, assets_base_dir, asset_file);
+      if (source_hash.has_value()) {
+        if (auto baked = baked_models_->Load(source_hash.value(), asset_file)) {
+          return baked;
+        }
+      }
+    }
+
+    auto asset = LoadAssetFromMapping(std::move(mapping), assets_base_dir);
+    if (!asset) {
+      return nullptr;
+    }
+    DrawData draw_data = model::Model(*asset).CreateDrawData(asset_file);
+    if (!draw_data) {
+      P_ERROR << "Could not create the draw data of the asset: " << asset_file;
+      return nullptr;
+    }
+
+    // The model is handed out while it is being baked. Baking needs the
+    // decoded texels, so it only starts once the images have been decoded
+    // instead of waiting on them on a worker.
+    if (source_hash.has_value()) {
+      OnAllDecoded(asset->images, [baked_models = baked_models_,
+                                   source_hash = source_hash.value(),
+                                   draw_data]() {
+        WorkerPool::ForProcess().PostTask(
+            [baked_models, source_hash, draw_data]() {
+              baked_models->Store(source_hash, *draw_data);
+            });
+      });
+    }
+    return draw_data;
+  }
+
+  void EvictLocked() {
+    auto position = lru_.end();
+    while (statistics_.bytes > statistics_.budget &&
+           position != lru_.begin()) {
+      --position;
+      auto found = entries_.find(*position);
+      P_ASSERT(found != entries_.end());
+      // Draw data used by anyone else would not be freed.
+      if (found->second.users > 0u) {
+        continue;
+      }
+      statistics_.bytes -= found->second.size;
+      statistics_.models--;
+      statistics_.evictions++;
+      entries_.erase(found);
+      position = lru_.erase(position);
+    }
+  }
+
+  P_DISALLOW_COPY_AND_ASSIGN(LoadedModels);
+};
+
+std::shared_ptr<AssetLoader> AssetLoader::GetGlobal() {
+  static auto sLoader =
+      std::make_shared<AssetLoader>(model::ModelCache::GetGlobal());
+  return sLoader;
+}
+
+AssetLoader::AssetLoader() : AssetLoader(nullptr) {}
+
+AssetLoader::AssetLoader(std::shared_ptr<model::ModelCache> baked_models)
+    : loaded_models_(std::make_shared<LoadedModels>(std::move(baked_models))) {}
+
+AssetLoader::~AssetLoader() = default;
+
+//------------------------------------------------------------------------------
+/// @brief      The state of a batch of loads. Each asset is first read, then
+///             parsed and handed over. Each of the two stages has its own
+///             queue and runs at most the configured number of assets at once.
+///
+class AssetLoadBatch final
+    : public std::enable_shared_from_this<AssetLoadBatch> {
+ public:
+  AssetLoadBatch(std::vector<AssetLoadRequest> requests,
+                 std::shared_ptr<EventLoop::Dispatcher> dispatcher,
+                 AssetBatchOptions options)
+      : requests_(std::move(requests)),
+        dispatcher_(std::move(dispatcher)),
+        options_(std::move(options)),
+        trace_id_(GetNextTraceID()),
+        mappings_(requests_.size()) {
+    progress_.assets_total = requests_.size();
+    for (size_t i = 0; i < requests_.size(); i++) {
+      GetLane(read_queue_, i).push_back(i);
+    }
+  }
+
+  ~AssetLoadBatch() = default;
+
+  void Start() {
+    P_TRACE_ASYNC_BEGIN("asset", "LoadAssets", trace_id_);
+    if (requests_.empty()) {
+      std::scoped_lock lock(mutex_);
+      PostProgressLocked(true);
+      return;
+    }
+    Pump();
+  }
+
+ private:
+  enum class Outcome {
+    kOutcomeLoaded,
+    kOutcomeFailed,
+    kOutcomeCancelled,
+  };
+
+  static constexpr size_t kPriorityCount =
+      static_cast<size_t>(TaskPriority::kTaskPriorityIdle) + 1;
+  using Queue = std::array<std::deque<size_t>, kPriorityCount>;
+
+  const std::vector<AssetLoadRequest> requests_;
+  const std::shared_ptr<EventLoop::Dispatcher> dispatcher_;
+  // The callbacks posted to the dispatcher are only touched on its loop.
+  AssetBatchOptions options_;
+  const uint64_t trace_id_;
+  std::mutex mutex_;
+  Queue read_queue_;
+  Queue parse_queue_;
+  // Files that have been read and are waiting to be parsed.
+  std::vector<std::shared_ptr<const Mapping>> mappings_;
+  size_t reads_in_flight_ = 0;
+  size_t parses_in_flight_ = 0;
+  AssetLoadProgress progress_;
+
+  Queue::value_type& GetLane(Queue& queue, size_t index) const {
+    return queue[static_cast<size_t>(requests_[index].priority)];
+  }
+
+  static std::optional<size_t> PopNext(Queue& queue) {
+    for (auto& lane : queue) {
+      if (!lane.empty()) {
+        const auto index = lane.front();
+        lane.pop_front();
+        return index;
+      }
+    }
+    return std::nullopt;
+  }
+
+  bool IsCancelled(size_t index) const {
+    const auto& cancellation = requests_[index].cancellation;
+    return cancellation && cancellation->IsCancelled();
+  }
+
+  // Start as many reads and parses as the limit allows. Cancelled loads that
+  // are still queued are dropped without taking up a slot.
+  void Pump() {
+    std::vector<size_t> reads;
+    std::vector<std::pair<size_t, std::shared_ptr<const Mapping>>> parses;
+    std::vector<size_t> cancelled;
+    {
+      std::scoped_lock lock(mutex_);
+      while (reads_in_flight_ < options_.max_concurrent_loads) {
+        const auto index = PopNext(read_queue_);
+        if (!index.has_value()) {
+          break;
+        }
+        if (IsCancelled(index.value())) {
+          cancelled.push_back(index.value());
+          continue;
+        }
+        reads_in_flight_++;
+        reads.push_back(index.value());
+      }
+      while (parses_in_flight_ < options_.max_concurrent_loads) {
+        const auto index = PopNext(parse_queue_);
+        if (!index.has_value()) {
+          break;
+        }
+        auto mapping = std::move(mappings_[index.value()]);
+        if (IsCancelled(index.value())) {
+          cancelled.push_back(index.value());
+          continue;
+        }
+        parses_in_flight_++;
+        parses.emplace_back(index.value(), std::move(mapping));
+      }
+    }
+
+    for (const auto index : reads) {
+      Read(index);
+    }
+    for (auto& [index, mapping] : parses) {
+      WorkerPool::ForProcess().PostTask(
+          [batch = shared_from_this(), index = index,
+           mapping = std::move(mapping)]() { batch->Parse(index, mapping); });
+    }
+    for (const auto index : cancelled) {
+      PostComplete(index, Outcome::kOutcomeCancelled);
+    }
+  }
+
+  // The callback is invoked on a worker even if the asset was not parsed.
+  void PostComplete(size_t index, Outcome outcome) {
+    WorkerPool::ForProcess().PostTask(
+        [batch = shared_from_this(), index, outcome]() {
+          batch->Complete(index, nullptr, outcome, false);
+        });
+  }
+
+  void Read(size_t index) {
+    const auto& request = requests_[index];
+    auto path = std::filesystem::path(request.assets_base_dir) /
+                std::filesystem::path(request.asset_file);
+    // The read completes on the reader so that only progress is posted to
+    // the dispatcher.
+    const auto posted = AsyncFileReader::ForProcess().ReadFile(
+        std::move(path),
+        [batch = shared_from_this(), index](std::unique_ptr<Mapping> mapping) {
+          batch->DidRead(index, std::move(mapping));
+        });
+    if (!posted) {
+      DidRead(index, nullptr);
+    }
+  }
+
+  void DidRead(size_t index, std::shared_ptr<const Mapping> mapping) {
+    std::optional<Outcome> outcome;
+    {
+      std::scoped_lock lock(mutex_);
+      reads_in_flight_--;
+      if (IsCancelled(index)) {
+        outcome = Outcome::kOutcomeCancelled;
+      } else if (!mapping || mapping->GetSize() == 0u) {
+        P_ERROR << "Could not read asset file: "
+                << requests_[index].asset_file;
+        outcome = Outcome::kOutcomeFailed;
+      } else {
+        progress_.bytes_read += mapping->GetSize();
+        mappings_[index] = std::move(mapping);
+        GetLane(parse_queue_, index).push_back(index);
+        PostProgressLocked(false);
+      }
+    }
+    if (outcome.has_value()) {
+      PostComplete(index, outcome.value());
+    }
+    Pump();
+  }
+
+  void Parse(size_t index, std::shared_ptr<const Mapping> mapping) {
+    if (IsCancelled(index)) {
+      Complete(index, nullptr, Outcome::kOutcomeCancelled, true);
+      return;
+    }
+    auto asset = LoadAssetFromMapping(std::move(mapping),
+                                      requests_[index].assets_base_dir);
+    const auto outcome =
+        asset ? Outcome::kOutcomeLoaded : Outcome::kOutcomeFailed;
+    Complete(index, std::move(asset), outcome, true);
+  }
+
+  void Complete(size_t index,
+                std::unique_ptr<Asset> asset,
+                Outcome outcome,
+                bool was_parsed) {
+    if (options_.on_asset_loaded) {
+      options_.on_asset_loaded(index, std::move(asset));
+    }
+    {
+      std::scoped_lock lock(mutex_);
+      if (was_parsed) {
+        parses_in_flight_--;
+      }
+      progress_.assets_completed++;
+      switch (outcome) {
+        case Outcome::kOutcomeLoaded:
+          break;
+        case Outcome::kOutcomeFailed:
+          progress_.assets_failed++;
+          break;
+        case Outcome::kOutcomeCancelled:
+          progress_.assets_cancelled++;
+          break;
+      }
+      PostProgressLocked(progress_.assets_completed == progress_.assets_total);
+    }
+    Pump();
+  }
+
+  // Posting while holding the lock keeps the updates in order.
+  void PostProgressLocked(bool is_done) {
+    if (is_done) {
+      P_TRACE_ASYNC_END("asset", "LoadAssets", trace_id_);
+    }
+    dispatcher_->PostTask(
+        [batch = shared_from_this(), progress = progress_, is_done]() {
+          if (batch->options_.on_progress) {
+            batch->options_.on_progress(progress);
+          }
+          if (is_done && batch->options_.on_done) {
+            auto on_done = std::move(batch->options_.on_done);
+            on_done();
+          }
+        });
+  }
+
+  P_DISALLOW_COPY_AND_ASSIGN(AssetLoadBatch);
+};
+
+bool AssetLoader::LoadAssets(std::vector<AssetLoadRequest> requests,
+                             std::shared_ptr<EventLoop::Dispatcher> dispatcher,
+                             AssetBatchOptions options) {
+  if (!dispatcher || options.max_concurrent_loads == 0u) {
+    return false;
+  }
+  std::make_shared<AssetLoadBatch>(std::move(requests), std::move(dispatcher),
+                                   std::move(options))
+      ->Start();
+  return true;
+}
+
+AssetLoader::LoadAwaiter AssetLoader::Load(std::string assets_base_dir,
+                                           std::string asset_file) {
+  return LoadAwaiter{this, std::move(assets_base_dir), std::move(asset_file)};
+}
+
+std::optional<Hash128> AssetLoader::HashAsset(
+    const std::string& assets_base_dir,
+    const std::string& asset_file) {
+  P_TRACE_EVENT("asset", "HashAsset");
+  auto mapping = GetAssetFileMapping(assets_base_dir, asset_file);
+  if (!mapping) {
+    return std::nullopt;
+  }
+  return HashAssetMapping(*mapping, assets_base_dir, asset_file);
+}
+
+void AssetLoader::LoadModel(std::string assets_base_dir,
+                            std::string asset_file,
+                            ModelCallback on_done) {
+  if (!on_done) {
+    return;
+  }
+  loaded_models_->Load(std::move(assets_base_dir), std::move(asset_file),
+                       std::move(on_done));
+}
+
+AssetLoader::LoadModelAwaiter AssetLoader::AwaitModel(
+    std::string assets_base_dir,
+    std::string asset_file) {
+  return LoadModelAwaiter{this, std::move(assets_base_dir),
+                          std::move(asset_file)};
+}
+
+void AssetLoader::SetModelMemoryBudget(size_t bytes) {
+  loaded_models_->SetBudget(bytes);
+}
+
+ModelMemoryStatistics AssetLoader::GetModelMemoryStatistics() const {
+  return loaded_models_->GetStatistics();
+}
+
+void AssetLoader::LoadAwaiter::await_suspend(std::coroutine_handle<> handle) {
+  loader->LoadAsset(std::move(assets_base_dir), std::move(asset_file),
+                    [this, handle](std::unique_ptr<Asset> loaded) {
+                      asset = std::move(loaded);
+                      handle.resume();
+                    });
+}
+
+void AssetLoader::LoadModelAwaiter::await_suspend(
+    std::coroutine_handle<> handle) {
+  loader->LoadModel(
+      std::move(assets_base_dir), std::move(asset_file),
+      [this, handle](std::shared_ptr<const model::ModelDrawData> loaded) {
+        draw_data = std::move(loaded);
+        handle.resume();
+      });
 }
 
 }  // namespace pixel
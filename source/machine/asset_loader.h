@@ -1,34 +1,273 @@
 #pragma once
 
+#include <atomic>
+#include <coroutine>
 #include <memory>
+#include <optional>
+#include <string>
+#include <vector>
 
+#include "closure.h"
+#include "content_hash.h"
+#include "deferred_image.h"
+#include "event_loop.h"
+#include "file.h"
 #include "macros.h"
 #include "mapping.h"
-#include "thread.h"
 #include "tiny_gltf.h"
 
 namespace pixel {
 
 struct Asset {
   tinygltf::Model model;
+  // The data of buffers that were not copied into the model, indexed like the
+  // buffers of the model. This is the BIN chunk of binary glTF files, which
+  // refers directly to the mapping of the file. The data of these buffers in
+  // the model is empty.
+  std::vector<std::shared_ptr<const Mapping>> buffer_data;
+  // The images being decoded, indexed like the images of the model. The
+  // pixels of these images in the model are empty.
+  std::vector<std::shared_ptr<DeferredImage>> images;
 
-  Asset(tinygltf::Model model) : model(std::move(model)) {}
+  Asset(tinygltf::Model model,
+        std::vector<std::shared_ptr<const Mapping>> buffer_data = {},
+        std::vector<std::shared_ptr<DeferredImage>> images = {})
+      : model(std::move(model)),
+        buffer_data(std::move(buffer_data)),
+        images(std::move(images)) {}
 };
 
+namespace model {
+class ModelCache;
+class ModelDrawData;
+}  // namespace model
+
+//------------------------------------------------------------------------------
+/// @brief      Cancels the asset loads it is handed to. A token may be shared
+///             by many loads and may be cancelled from any thread.
+///
+class CancellationToken {
+ public:
+  CancellationToken();
+
+  ~CancellationToken();
+
+  void Cancel();
+
+  bool IsCancelled() const;
+
+ private:
+  std::atomic_bool is_cancelled_ = false;
+
+  P_DISALLOW_COPY_AND_ASSIGN(CancellationToken);
+};
+
+struct AssetLoadRequest {
+  std::string assets_base_dir;
+  std::string asset_file;
+  // Assets of higher priority are read and parsed before the other assets of
+  // the batch that are waiting on the same stage.
+  TaskPriority priority = TaskPriority::kTaskPriorityNormal;
+  // Optional. Cancelled loads are dropped at the next stage and complete
+  // without an asset.
+  std::shared_ptr<CancellationToken> cancellation;
+};
+
+struct AssetLoadProgress {
+  size_t assets_total = 0;
+  // Assets that have been loaded, have failed or have been cancelled.
+  size_t assets_completed = 0;
+  size_t assets_failed = 0;
+  size_t assets_cancelled = 0;
+  // The size of the asset files that have been read so far.
+  size_t bytes_read = 0;
+};
+
+struct AssetBatchOptions {
+  static constexpr size_t kDefaultMaxConcurrentLoads = 4u;
+
+  // At most this many assets are read while at most this many others are
+  // parsed. Must not be zero.
+  size_t max_concurrent_loads = kDefaultMaxConcurrentLoads;
+  // Invoked on the worker that parsed the asset, with the index of its
+  // request. Assets may be converted here, which is pipelined with the loads
+  // of the rest of the batch and counts against the concurrency limit. May be
+  // invoked concurrently. The asset is null if it could not be loaded or its
+  // load was cancelled.
+  UniqueFunction<void(size_t index, std::unique_ptr<Asset> asset)>
+      on_asset_loaded;
+  // Posted to the dispatcher whenever an asset has been read or completed.
+  // Reads complete off the dispatcher, so a busy loop does not hold up the
+  // batch.
+  UniqueFunction<void(const AssetLoadProgress& progress)> on_progress;
+  // Posted to the dispatcher once all assets have completed.
+  UniqueClosure on_done;
+};
+
+struct ModelMemoryStatistics {
+  // The models held by the loader and the memory they use.
+  size_t models = 0;
+  size_t bytes = 0;
+  size_t budget = 0;
+  // Loads that were handed a model that was already loaded or being loaded.
+  size_t hits = 0;
+  size_t misses = 0;
+  size_t evictions = 0;
+};
+
+class LoadedModels;
+
+//------------------------------------------------------------------------------
+/// @brief      Loads glTF assets on the process-wide worker pool. Both text
+///             (.gltf) and binary (.glb) files are supported. Multiple assets
+///             may be loaded concurrently.
+///
 class AssetLoader {
  public:
+  static constexpr size_t kDefaultModelMemoryBudget = 512u * 1024u * 1024u;
+
+  //----------------------------------------------------------------------------
+  /// @brief      The process-wide loader. Models loaded by it are shared by
+  ///             everything in the process and are baked into the
+  ///             process-wide model cache.
+  ///
   static std::shared_ptr<AssetLoader> GetGlobal();
 
   AssetLoader();
 
+  //----------------------------------------------------------------------------
+  /// @brief      Create a loader that maps models baked into the given cache
+  ///             instead of loading them, and bakes models that were not.
+  ///
+  AssetLoader(std::shared_ptr<model::ModelCache> baked_models);
+
   ~AssetLoader();
 
   void LoadAsset(std::string assets_base_dir,
                  std::string asset_file,
-                 std::function<void(std::unique_ptr<Asset>)>);
+                 UniqueFunction<void(std::unique_ptr<Asset>)> on_done);
+
+  struct LoadAwaiter {
+    AssetLoader* loader = nullptr;
+    std::string assets_base_dir;
+    std::string asset_file;
+    std::unique_ptr<Asset> asset;
+
+    bool await_ready() const { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle);
+
+    std::unique_ptr<Asset> await_resume() { return std::move(asset); }
+  };
+
+  //----------------------------------------------------------------------------
+  /// @brief      Returns an awaitable for the asset. The awaiting coroutine is
+  ///             resumed on the worker that loaded the asset. The asset is
+  ///             null if it could not be loaded.
+  ///
+  LoadAwaiter Load(std::string assets_base_dir, std::string asset_file);
+
+  //----------------------------------------------------------------------------
+  /// @brief      Load the asset on the calling thread with the asset file
+  ///             mapped with the given options instead of the ones the loader
+  ///             picks for it. Used to compare mapping policies. Images are
+  ///             still decoded on the worker pool.
+  ///
+  /// @return     The asset or null if it could not be loaded.
+  ///
+  static std::unique_ptr<Asset> LoadAssetWithMappingOptions(
+      const std::string& assets_base_dir,
+      const std::string& asset_file,
+      const FileMappingOptions& options);
+
+  //----------------------------------------------------------------------------
+  /// @brief      Load many assets in pipelined stages. Asset files are read by
+  ///             the process-wide file reader, so that slow storage does not
+  ///             hold up the workers, while other assets are being parsed on
+  ///             the worker pool. Images are decoded on the worker pool as
+  ///             soon as parsing finds them. Within each stage, assets are
+  ///             taken in order of priority and then in the order of their
+  ///             requests.
+  ///
+  /// @param[in]  requests    The assets to load.
+  /// @param[in]  dispatcher  The loop progress and completion are posted to.
+  /// @param[in]  options     The concurrency limit and the callbacks.
+  ///
+  /// @return     If the batch was started. The callbacks are not invoked if it
+  ///             was not.
+  ///
+  bool LoadAssets(std::vector<AssetLoadRequest> requests,
+                  std::shared_ptr<EventLoop::Dispatcher> dispatcher,
+                  AssetBatchOptions options);
+
+  //----------------------------------------------------------------------------
+  /// @brief      Hash the contents of the asset file and of the buffers and
+  ///             images it refers to by URI. Only the JSON of the asset is
+  ///             parsed, so this is much cheaper than loading the asset. The
+  ///             hash may be used to key data derived from the asset.
+  ///
+  /// @return     The hash or nothing if the asset or one of its files could
+  ///             not be read.
+  ///
+  static std::optional<Hash128> HashAsset(const std::string& assets_base_dir,
+                                          const std::string& asset_file);
+
+  using ModelCallback =
+      UniqueFunction<void(std::shared_ptr<const model::ModelDrawData>)>;
+
+  //----------------------------------------------------------------------------
+  /// @brief      Load the draw data of the model in the asset file. The draw
+  ///             data is immutable and shared by all loads of the same file
+  ///             through this loader, including loads that are still in
+  ///             flight. Files are the same if they have the same canonical
+  ///             path, modification time and size.
+  ///
+  ///             The loader keeps the models it has loaded till the memory
+  ///             used by all of them exceeds its budget. The least recently
+  ///             loaded models that are not used by anyone else are released
+  ///             first. Releasing models that are still in use would not free
+  ///             their memory. They are kept till their last user drops them
+  ///             and are released then if the loader is still over budget.
+  ///
+  ///             The callback is invoked on a worker. The draw data is null if
+  ///             the model could not be loaded. Failed loads are not kept.
+  ///
+  void LoadModel(std::string assets_base_dir,
+                 std::string asset_file,
+                 ModelCallback on_done);
+
+  struct LoadModelAwaiter {
+    AssetLoader* loader = nullptr;
+    std::string assets_base_dir;
+    std::string asset_file;
+    std::shared_ptr<const model::ModelDrawData> draw_data;
+
+    bool await_ready() const { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle);
+
+    std::shared_ptr<const model::ModelDrawData> await_resume() {
+      return std::move(draw_data);
+    }
+  };
+
+  //----------------------------------------------------------------------------
+  /// @brief      Returns an awaitable for the draw data of the model. See
+  ///             `LoadModel`. The awaiting coroutine is resumed on a worker.
+  ///
+  LoadModelAwaiter AwaitModel(std::string assets_base_dir,
+                              std::string asset_file);
+
+  //----------------------------------------------------------------------------
+  /// @brief      Set the memory the models kept by the loader may use. Models
+  ///             are released right away if they use more than the budget.
+  ///
+  void SetModelMemoryBudget(size_t bytes);
+
+  ModelMemoryStatistics GetModelMemoryStatistics() const;
 
  private:
-  Thread thread_;
+  std::shared_ptr<LoadedModels> loaded_models_;
 
   P_DISALLOW_COPY_AND_ASSIGN(AssetLoader);
 };
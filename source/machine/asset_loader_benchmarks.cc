@@ -0,0 +1,218 @@
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <future>
+
+#include "asset_loader.h"
+#include "assets_location.h"
+#include "file.h"
+#include "platform.h"
+
+#if P_OS_LINUX
+#include <fcntl.h>
+#endif  // P_OS_LINUX
+
+namespace pixel {
+namespace test {
+
+static std::unique_ptr<Asset> LoadAssetSync(AssetLoader& loader,
+                                            const char* base_dir,
+                                            const char* asset_file) {
+  std::promise<std::unique_ptr<Asset>> promise;
+  auto future = promise.get_future();
+  loader.LoadAsset(base_dir, asset_file, [&promise](auto asset) {
+    promise.set_value(std::move(asset));
+  });
+  return future.get();
+}
+
+// Till the asset has been handed over. Images may still be decoding.
+static void BM_LoadAsset(benchmark::State& state,
+                         const char* base_dir,
+                         const char* asset_file) {
+  AssetLoader loader;
+  for (auto _ : state) {
+    auto asset = LoadAssetSync(loader, base_dir, asset_file);
+    if (!asset) {
+      state.SkipWithError("Could not load the asset.");
+      break;
+    }
+    state.PauseTiming();
+    // Don't let decodes from this iteration run into the next one.
+    for (const auto& image : asset->images) {
+      if (image) {
+        image->Wait();
+      }
+    }
+    state.ResumeTiming();
+  }
+}
+
+// Till all images have been decoded.
+static void BM_LoadAssetAndDecodeImages(benchmark::State& state,
+                                        const char* base_dir,
+                                        const char* asset_file) {
+  AssetLoader loader;
+  size_t image_count = 0;
+  for (auto _ : state) {
+    auto asset = LoadAssetSync(loader, base_dir, asset_file);
+    if (!asset) {
+      state.SkipWithError("Could not load the asset.");
+      break;
+    }
+    image_count = 0;
+    for (const auto& image : asset->images) {
+      if (image) {
+        image->Wait();
+        image_count++;
+      }
+    }
+  }
+  state.counters["images"] = image_count;
+}
+
+#define P_ASSET_BENCHMARKS(name, base_dir, asset_file)                        \
+  BENCHMARK_CAPTURE(BM_LoadAsset, name,                                       \
+                    PIXEL_GLTF_MODELS_LOCATION base_dir, asset_file)          \
+      ->Unit(benchmark::kMillisecond)                                         \
+      ->UseRealTime();                                                        \
+  BENCHMARK_CAPTURE(BM_LoadAssetAndDecodeImages, name,                        \
+                    PIXEL_GLTF_MODELS_LOCATION base_dir, asset_file)          \
+      ->Unit(benchmark::kMillisecond)                                         \
+      ->UseRealTime();
+
+P_ASSET_BENCHMARKS(DamagedHelmet, "/DamagedHelmet/glTF", "DamagedHelmet.gltf")
+P_ASSET_BENCHMARKS(DamagedHelmetBinary,
+                   "/DamagedHelmet/glTF-Binary",
+                   "DamagedHelmet.glb")
+P_ASSET_BENCHMARKS(FlightHelmet, "/FlightHelmet/glTF", "FlightHelmet.gltf")
+P_ASSET_BENCHMARKS(Sponza, "/Sponza/glTF", "Sponza.gltf")
+
+// *****************************************************************************
+// *** Mapping Policies
+// *****************************************************************************
+
+static void WaitForImages(const Asset& asset) {
+  for (const auto& image : asset.images) {
+    if (image) {
+      image->Wait();
+    }
+  }
+}
+
+// Drops the files of the asset from the page cache. Only pages that are not
+// mapped by anyone and not dirty are dropped. This needs no privileges,
+// unlike dropping the whole page cache.
+static bool EvictFromPageCache(const char* base_dir) {
+#if P_OS_LINUX
+  std::error_code error;
+  for (const auto& entry :
+       std::filesystem::recursive_directory_iterator(base_dir, error)) {
+    std::error_code entry_error;
+    if (!entry.is_regular_file(entry_error)) {
+      continue;
+    }
+    UniqueFD fd(P_TEMP_FAILURE_RETRY(
+        ::open(entry.path().c_str(), O_RDONLY | O_CLOEXEC)));
+    if (!fd.IsValid() ||
+        ::posix_fadvise(fd.Get(), 0, 0, POSIX_FADV_DONTNEED) != 0) {
+      return false;
+    }
+  }
+  return !error;
+#else   // P_OS_LINUX
+  return false;
+#endif  // P_OS_LINUX
+}
+
+// Till the asset has been loaded and all of its images decoded with the
+// asset file mapped with the given options. Cold loads start with the files
+// of the asset out of the page cache. Only the asset file is mapped with the
+// options. Files it refers to are read the same way for all policies.
+static void BM_LoadAssetWithMappingOptions(benchmark::State& state,
+                                           const char* base_dir,
+                                           const char* asset_file,
+                                           FileMappingOptions options,
+                                           bool cold) {
+  for (auto _ : state) {
+    if (cold) {
+      state.PauseTiming();
+      const auto evicted = EvictFromPageCache(base_dir);
+      state.ResumeTiming();
+      if (!evicted) {
+        state.SkipWithError("Could not drop the asset from the page cache.");
+        break;
+      }
+    }
+    auto asset =
+        AssetLoader::LoadAssetWithMappingOptions(base_dir, asset_file, options);
+    if (!asset) {
+      state.SkipWithError("Could not load the asset.");
+      break;
+    }
+    WaitForImages(*asset);
+  }
+}
+
+static FileMappingOptions MappingOptions(FileAccessPattern access_pattern) {
+  FileMappingOptions options;
+  options.access_pattern = access_pattern;
+  return options;
+}
+
+static FileMappingOptions MappingOptionsWillNeed() {
+  FileMappingOptions options;
+  options.will_need = true;
+  return options;
+}
+
+static FileMappingOptions MappingOptionsPopulate() {
+  FileMappingOptions options;
+  options.populate = true;
+  return options;
+}
+
+static FileMappingOptions MappingOptionsHugePages() {
+  FileMappingOptions options;
+  options.huge_pages = true;
+  return options;
+}
+
+#define P_MAPPING_BENCHMARK(name, base_dir, asset_file, options, cold) \
+  BENCHMARK_CAPTURE(BM_LoadAssetWithMappingOptions, name,              \
+                    PIXEL_GLTF_MODELS_LOCATION base_dir, asset_file,   \
+                    options, cold)                                     \
+      ->Unit(benchmark::kMillisecond)                                  \
+      ->UseRealTime();
+
+#define P_MAPPING_BENCHMARKS_FOR_OPTIONS(name, base_dir, asset_file,  \
+                                         options)                     \
+  P_MAPPING_BENCHMARK(name##_Cold, base_dir, asset_file, options, true) \
+  P_MAPPING_BENCHMARK(name##_Warm, base_dir, asset_file, options, false)
+
+#define P_MAPPING_BENCHMARKS(name, base_dir, asset_file)                   \
+  P_MAPPING_BENCHMARKS_FOR_OPTIONS(                                        \
+      name##_Normal, base_dir, asset_file,                                 \
+      MappingOptions(FileAccessPattern::kFileAccessPatternNormal))         \
+  P_MAPPING_BENCHMARKS_FOR_OPTIONS(                                        \
+      name##_Sequential, base_dir, asset_file,                             \
+      MappingOptions(FileAccessPattern::kFileAccessPatternSequential))     \
+  P_MAPPING_BENCHMARKS_FOR_OPTIONS(                                        \
+      name##_Random, base_dir, asset_file,                                 \
+      MappingOptions(FileAccessPattern::kFileAccessPatternRandom))         \
+  P_MAPPING_BENCHMARKS_FOR_OPTIONS(name##_WillNeed, base_dir, asset_file,  \
+                                   MappingOptionsWillNeed())               \
+  P_MAPPING_BENCHMARKS_FOR_OPTIONS(name##_Populate, base_dir, asset_file,  \
+                                   MappingOptionsPopulate())               \
+  P_MAPPING_BENCHMARKS_FOR_OPTIONS(name##_HugePages, base_dir, asset_file, \
+                                   MappingOptionsHugePages())
+
+P_MAPPING_BENCHMARKS(DamagedHelmet, "/DamagedHelmet/glTF", "DamagedHelmet.gltf")
+P_MAPPING_BENCHMARKS(DamagedHelmetBinary,
+                     "/DamagedHelmet/glTF-Binary",
+                     "DamagedHelmet.glb")
+P_MAPPING_BENCHMARKS(FlightHelmet, "/FlightHelmet/glTF", "FlightHelmet.gltf")
+P_MAPPING_BENCHMARKS(Sponza, "/Sponza/glTF", "Sponza.gltf")
+
+}  // namespace test
+}  // namespace pixel
@@ -1,9 +1,16 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <chrono>
 #include <future>
+#include <mutex>
+#include <vector>
 
 #include "asset_loader.h"
+#include "async_task.h"
 #include "assets_location.h"
+#include "model_draw_data.h"
+#include "thread.h"
 
 namespace pixel {
 namespace test {
@@ -23,14 +30,332 @@ TEST(AssetLoaderTest, CanLoadAsset) {
 
   loader.LoadAsset(
       base_dir, asset_file,
-      MakeCopyable([promise = std::move(asset_promise)](auto asset) mutable {
+      [promise = std::move(asset_promise)](auto asset) mutable {
         ASSERT_TRUE(asset);
         promise.set_value(std::move(asset));
-      }));
+      });
 
   auto asset = future.get();
   ASSERT_TRUE(asset);
 }
 
+TEST(AssetLoaderTest, CanLoadBinaryAssetWithoutCopyingBuffers) {
+  AssetLoader loader;
+
+  std::promise<std::unique_ptr<Asset>> asset_promise;
+  auto future = asset_promise.get_future();
+
+  loader.LoadAsset(
+      PIXEL_GLTF_MODELS_LOCATION "/DamagedHelmet/glTF-Binary",
+      "DamagedHelmet.glb",
+      [promise = std::move(asset_promise)](auto asset) mutable {
+        promise.set_value(std::move(asset));
+      });
+
+  auto asset = future.get();
+  ASSERT_TRUE(asset);
+  ASSERT_EQ(asset->model.buffers.size(), 1u);
+  ASSERT_EQ(asset->buffer_data.size(), 1u);
+  ASSERT_TRUE(asset->buffer_data[0]);
+  ASSERT_EQ(asset->buffer_data[0]->GetSize(),
+            asset->model.buffers[0].byteLength);
+  ASSERT_TRUE(asset->model.buffers[0].data.empty());
+  ASSERT_FALSE(asset->model.images.empty());
+  ASSERT_EQ(asset->images.size(), asset->model.images.size());
+  for (const auto& image : asset->images) {
+    ASSERT_TRUE(image);
+    const auto& decoded = image->Wait();
+    ASSERT_GT(decoded.width, 0u);
+    ASSERT_GT(decoded.height, 0u);
+    ASSERT_TRUE(decoded.pixels);
+  }
+}
+
+TEST(AssetLoaderTest, ImagesAreDecodedAfterLoading) {
+  AssetLoader loader;
+
+  std::promise<std::unique_ptr<Asset>> asset_promise;
+  auto future = asset_promise.get_future();
+
+  loader.LoadAsset(
+      PIXEL_GLTF_MODELS_LOCATION "/DamagedHelmet/glTF", "DamagedHelmet.gltf",
+      [promise = std::move(asset_promise)](auto asset) mutable {
+        promise.set_value(std::move(asset));
+      });
+
+  auto asset = future.get();
+  ASSERT_TRUE(asset);
+  ASSERT_FALSE(asset->model.images.empty());
+  ASSERT_EQ(asset->images.size(), asset->model.images.size());
+  for (size_t i = 0; i < asset->images.size(); i++) {
+    // TinyGLTF did not decode the image.
+    ASSERT_TRUE(asset->model.images[i].image.empty());
+    ASSERT_TRUE(asset->images[i]);
+    // Images are sized from their headers before they have been decoded.
+    const auto size = asset->images[i]->GetSizeInBytes();
+    const auto& decoded = asset->images[i]->Wait();
+    ASSERT_TRUE(asset->images[i]->IsDecoded());
+    ASSERT_GT(decoded.width, 0u);
+    ASSERT_GT(decoded.height, 0u);
+    ASSERT_EQ(decoded.components, 4u);
+    ASSERT_TRUE(decoded.pixels);
+    ASSERT_EQ(decoded.pixels->GetSize(),
+              decoded.width * decoded.height * decoded.components *
+                  decoded.bits_per_component / 8u);
+    ASSERT_EQ(decoded.pixels->GetSize(), size);
+  }
+}
+
+TEST(AssetLoaderTest, CanBeNotifiedWhenImagesAreDecoded) {
+  auto asset = AssetLoader::LoadAssetWithMappingOptions(
+      PIXEL_GLTF_MODELS_LOCATION "/DamagedHelmet/glTF", "DamagedHelmet.gltf",
+      {});
+  ASSERT_TRUE(asset);
+  ASSERT_FALSE(asset->images.empty());
+
+  std::promise<bool> decoded_promise;
+  auto decoded = decoded_promise.get_future();
+  OnAllDecoded(asset->images, [&]() {
+    decoded_promise.set_value(std::all_of(
+        asset->images.begin(), asset->images.end(),
+        [](const auto& image) { return image->IsDecoded(); }));
+  });
+  ASSERT_TRUE(decoded.get());
+
+  // Images that have been decoded notify right away.
+  bool notified = false;
+  asset->images.front()->OnDecoded([&]() { notified = true; });
+  ASSERT_TRUE(notified);
+}
+
+TEST(AssetLoaderTest, CanHashAsset) {
+  const auto text_hash = AssetLoader::HashAsset(
+      PIXEL_GLTF_MODELS_LOCATION "/DamagedHelmet/glTF", "DamagedHelmet.gltf");
+  ASSERT_TRUE(text_hash.has_value());
+  ASSERT_EQ(text_hash,
+            AssetLoader::HashAsset(
+                PIXEL_GLTF_MODELS_LOCATION "/DamagedHelmet/glTF",
+                "DamagedHelmet.gltf"));
+
+  const auto binary_hash = AssetLoader::HashAsset(
+      PIXEL_GLTF_MODELS_LOCATION "/DamagedHelmet/glTF-Binary",
+      "DamagedHelmet.glb");
+  ASSERT_TRUE(binary_hash.has_value());
+  ASSERT_NE(text_hash, binary_hash);
+
+  ASSERT_FALSE(AssetLoader::HashAsset(
+      PIXEL_GLTF_MODELS_LOCATION "/DamagedHelmet/glTF", "Missing.gltf"));
+}
+
+struct AssetBatchResult {
+  std::vector<std::unique_ptr<Asset>> assets;
+  std::vector<size_t> order;
+  AssetLoadProgress progress;
+};
+
+static AssetBatchResult LoadAssetBatch(std::vector<AssetLoadRequest> requests,
+                                       size_t max_concurrent_loads) {
+  AssetLoader loader;
+  Thread thread("Asset Batch");
+
+  auto result = std::make_shared<AssetBatchResult>();
+  result->assets.resize(requests.size());
+  auto mutex = std::make_shared<std::mutex>();
+  std::promise<void> done;
+
+  AssetBatchOptions options;
+  options.max_concurrent_loads = max_concurrent_loads;
+  options.on_asset_loaded = [result, mutex](size_t index, auto asset) {
+    std::scoped_lock lock(*mutex);
+    result->assets[index] = std::move(asset);
+    result->order.push_back(index);
+  };
+  options.on_progress = [result](const AssetLoadProgress& progress) {
+    EXPECT_GE(progress.assets_completed, result->progress.assets_completed);
+    EXPECT_GE(progress.bytes_read, result->progress.bytes_read);
+    result->progress = progress;
+  };
+  options.on_done = [&done]() { done.set_value(); };
+  EXPECT_TRUE(loader.LoadAssets(std::move(requests), thread.GetDispatcher(),
+                                std::move(options)));
+  done.get_future().wait();
+
+  std::scoped_lock lock(*mutex);
+  return std::move(*result);
+}
+
+TEST(AssetLoaderTest, CanLoadBatchOfAssets) {
+  auto result = LoadAssetBatch(
+      {
+          {PIXEL_GLTF_MODELS_LOCATION "/DamagedHelmet/glTF",
+           "DamagedHelmet.gltf"},
+          {PIXEL_GLTF_MODELS_LOCATION "/DamagedHelmet/glTF-Binary",
+           "DamagedHelmet.glb"},
+          {PIXEL_GLTF_MODELS_LOCATION "/DamagedHelmet/glTF", "Missing.gltf"},
+      },
+      2u);
+  ASSERT_EQ(result.assets.size(), 3u);
+  ASSERT_TRUE(result.assets[0]);
+  ASSERT_TRUE(result.assets[1]);
+  ASSERT_FALSE(result.assets[2]);
+  ASSERT_EQ(result.order.size(), 3u);
+  ASSERT_EQ(result.progress.assets_total, 3u);
+  ASSERT_EQ(result.progress.assets_completed, 3u);
+  ASSERT_EQ(result.progress.assets_failed, 1u);
+  ASSERT_EQ(result.progress.assets_cancelled, 0u);
+  ASSERT_GT(result.progress.bytes_read, 0u);
+}
+
+TEST(AssetLoaderTest, HigherPriorityAssetsInBatchLoadFirst) {
+  AssetLoadRequest low = {PIXEL_GLTF_MODELS_LOCATION "/DamagedHelmet/glTF",
+                          "DamagedHelmet.gltf"};
+  low.priority = TaskPriority::kTaskPriorityIdle;
+  AssetLoadRequest high = {
+      PIXEL_GLTF_MODELS_LOCATION "/DamagedHelmet/glTF-Binary",
+      "DamagedHelmet.glb"};
+  high.priority = TaskPriority::kTaskPriorityHigh;
+
+  // With one load at a time, the stages of the assets can't overlap.
+  auto result = LoadAssetBatch({low, high}, 1u);
+  ASSERT_EQ(result.order, (std::vector<size_t>{1u, 0u}));
+  ASSERT_TRUE(result.assets[0]);
+  ASSERT_TRUE(result.assets[1]);
+}
+
+TEST(AssetLoaderTest, CancelledAssetsInBatchCompleteWithoutAssets) {
+  auto cancellation = std::make_shared<CancellationToken>();
+  cancellation->Cancel();
+
+  AssetLoadRequest cancelled = {
+      PIXEL_GLTF_MODELS_LOCATION "/DamagedHelmet/glTF", "DamagedHelmet.gltf"};
+  cancelled.cancellation = cancellation;
+  AssetLoadRequest loaded = {
+      PIXEL_GLTF_MODELS_LOCATION "/DamagedHelmet/glTF-Binary",
+      "DamagedHelmet.glb"};
+
+  auto result = LoadAssetBatch({cancelled, loaded}, 1u);
+  ASSERT_FALSE(result.assets[0]);
+  ASSERT_TRUE(result.assets[1]);
+  ASSERT_EQ(result.progress.assets_completed, 2u);
+  ASSERT_EQ(result.progress.assets_cancelled, 1u);
+  ASSERT_EQ(result.progress.assets_failed, 0u);
+}
+
+TEST(AssetLoaderTest, BatchLoadsWhileDispatcherIsBusy) {
+  AssetLoader loader;
+  Thread thread("Asset Batch");
+
+  // The loop stays busy until the asset has been loaded, so the load must not
+  // need it.
+  std::promise<bool> loaded;
+  auto loaded_future = loaded.get_future();
+  std::promise<bool> finished_busy;
+  ASSERT_TRUE(thread.GetDispatcher()->PostTask([&]() {
+    finished_busy.set_value(loaded_future.wait_for(std::chrono::seconds(10)) ==
+                            std::future_status::ready);
+  }));
+
+  std::promise<void> done;
+  AssetBatchOptions options;
+  options.on_asset_loaded = [&loaded](size_t, std::unique_ptr<Asset> asset) {
+    loaded.set_value(static_cast<bool>(asset));
+  };
+  options.on_done = [&done]() { done.set_value(); };
+  ASSERT_TRUE(loader.LoadAssets(
+      {{PIXEL_GLTF_MODELS_LOCATION "/DamagedHelmet/glTF-Binary",
+        "DamagedHelmet.glb"}},
+      thread.GetDispatcher(), std::move(options)));
+  ASSERT_TRUE(finished_busy.get_future().get());
+  ASSERT_TRUE(loaded_future.get());
+  done.get_future().wait();
+}
+
+TEST(AssetLoaderTest, EmptyBatchCompletes) {
+  auto result = LoadAssetBatch({}, 1u);
+  ASSERT_TRUE(result.assets.empty());
+  ASSERT_EQ(result.progress.assets_total, 0u);
+}
+
+static AsyncTask<void> LoadDamagedHelmet(
+    AssetLoader& loader,
+    std::promise<std::unique_ptr<Asset>>& promise) {
+  promise.set_value(co_await loader.Load(
+      PIXEL_GLTF_MODELS_LOCATION "/DamagedHelmet/glTF", "DamagedHelmet.gltf"));
+}
+
+TEST(AssetLoaderTest, CanAwaitAsset) {
+  AssetLoader loader;
+
+  std::promise<std::unique_ptr<Asset>> asset_promise;
+  auto future = asset_promise.get_future();
+  LoadDamagedHelmet(loader, asset_promise).Detach();
+
+  auto asset = future.get();
+  ASSERT_TRUE(asset);
+}
+
+using SharedDrawData = std::shared_ptr<const model::ModelDrawData>;
+
+static std::future<SharedDrawData> LoadSharedModel(AssetLoader& loader,
+                                                   std::string asset_file) {
+  std::promise<SharedDrawData> promise;
+  auto future = promise.get_future();
+  loader.LoadModel(PIXEL_GLTF_MODELS_LOCATION "/DamagedHelmet/glTF",
+                   std::move(asset_file),
+                   [promise = std::move(promise)](auto draw_data) mutable {
+                     promise.set_value(std::move(draw_data));
+                   });
+  return future;
+}
+
+TEST(AssetLoaderTest, ModelsAreSharedByLoadsOfTheSameFile) {
+  AssetLoader loader;
+
+  auto first = LoadSharedModel(loader, "DamagedHelmet.gltf");
+  auto second = LoadSharedModel(loader, "DamagedHelmet.gltf");
+  auto first_draw_data = first.get();
+  auto second_draw_data = second.get();
+  ASSERT_TRUE(first_draw_data);
+  ASSERT_EQ(first_draw_data, second_draw_data);
+  ASSERT_EQ(LoadSharedModel(loader, "./DamagedHelmet.gltf").get(),
+            first_draw_data);
+
+  const auto statistics = loader.GetModelMemoryStatistics();
+  ASSERT_EQ(statistics.models, 1u);
+  ASSERT_EQ(statistics.misses, 1u);
+  ASSERT_EQ(statistics.hits, 2u);
+  ASSERT_EQ(statistics.bytes, first_draw_data->GetSizeInBytes());
+  ASSERT_GT(statistics.bytes, 0u);
+}
+
+TEST(AssetLoaderTest, UnusedModelsAreEvictedOverBudget) {
+  AssetLoader loader;
+  loader.SetModelMemoryBudget(0u);
+
+  // Models in use are kept even if they are over the budget.
+  auto draw_data = LoadSharedModel(loader, "DamagedHelmet.gltf").get();
+  ASSERT_TRUE(draw_data);
+  loader.SetModelMemoryBudget(0u);
+  ASSERT_EQ(loader.GetModelMemoryStatistics().models, 1u);
+  ASSERT_EQ(loader.GetModelMemoryStatistics().evictions, 0u);
+
+  // Models are evicted as soon as their last user drops them.
+  draw_data.reset();
+  auto statistics = loader.GetModelMemoryStatistics();
+  ASSERT_EQ(statistics.models, 0u);
+  ASSERT_EQ(statistics.bytes, 0u);
+  ASSERT_EQ(statistics.evictions, 1u);
+
+  ASSERT_TRUE(LoadSharedModel(loader, "DamagedHelmet.gltf").get());
+  ASSERT_EQ(loader.GetModelMemoryStatistics().misses, 2u);
+}
+
+TEST(AssetLoaderTest, FailedModelLoadsAreNotKept) {
+  AssetLoader loader;
+
+  ASSERT_FALSE(LoadSharedModel(loader, "Missing.gltf").get());
+  ASSERT_EQ(loader.GetModelMemoryStatistics().models, 0u);
+}
+
 }  // namespace test
 }  // namespace pixel
@@ -65,7 +65,7 @@ bool CommandBuffer::SubmitWithCompletionCallback(
     vk::ArrayProxy<vk::Semaphore> wait_semaphores,
     vk::ArrayProxy<vk::PipelineStageFlags> wait_stages,
     vk::ArrayProxy<vk::Semaphore> signal_semaphores,
-    std::function<void(void)> on_done) {
+    UniqueClosure on_done) {
   if (!on_done) {
     return Submit(std::move(wait_semaphores),    //
                   std::move(wait_stages),        //
@@ -98,15 +98,16 @@ bool CommandBuffer::SubmitWithCompletionCallback(
   // This is going to be moved into a capture.
   auto raw_fence = on_done_fence.get();
 
-  auto fence_release =
-      MakeCopyable([fence = std::move(on_done_fence), on_done]() mutable {
-        fence.reset();
-        on_done();
-      });
+  auto fence_release = [fence = std::move(on_done_fence),
+                        on_done = std::move(on_done)]() mutable {
+    fence.reset();
+    on_done();
+  };
 
-  if (!pool->GetFenceWaiter().AddCompletionHandler(raw_fence, fence_release)) {
-    // Manually release the fence so we don't leak it.
-    fence_release();
+  // The fence is owned by the handler. So it is released even if the handler
+  // could not be registered.
+  if (!pool->GetFenceWaiter().AddCompletionHandler(raw_fence,
+                                                   std::move(fence_release))) {
     P_ERROR << "Could not register a fence completion callback.";
     return false;
   }
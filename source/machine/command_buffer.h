@@ -3,6 +3,7 @@
 #include <functional>
 #include <limits>
 
+#include "closure.h"
 #include "command_pool.h"
 #include "macros.h"
 #include "vulkan.h"
@@ -23,7 +24,7 @@ class CommandBuffer {
       vk::ArrayProxy<vk::Semaphore> wait_semaphores = nullptr,
       vk::ArrayProxy<vk::PipelineStageFlags> wait_stages = nullptr,
       vk::ArrayProxy<vk::Semaphore> signal_semaphores = nullptr,
-      std::function<void(void)> on_done = nullptr);
+      UniqueClosure on_done = nullptr);
 
   ~CommandBuffer();
 
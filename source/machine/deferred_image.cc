@@ -0,0 +1,168 @@
+#include "deferred_image.h"
+
+#include <limits>
+
+#include "tiny_gltf.h"
+#include "trace_event.h"
+#include "worker_pool.h"
+
+namespace pixel {
+
+DecodedImage DecodeImage(const Mapping& encoded) {
+  P_TRACE_EVENT("asset", "DecodeImage");
+  DecodedImage decoded;
+  if (encoded.GetData() == nullptr ||
+      encoded.GetSize() > std::numeric_limits<int>::max()) {
+    return decoded;
+  }
+  const auto data = encoded.GetData();
+  const auto size = static_cast<int>(encoded.GetSize());
+  constexpr int kComponents = 4;
+  int width = 0;
+  int height = 0;
+  int components_in_file = 0;
+  int bits = 8;
+  void* pixels = nullptr;
+  if (::stbi_is_16_bit_from_memory(data, size)) {
+    pixels = ::stbi_load_16_from_memory(data, size, &width, &height,
+                                        &components_in_file, kComponents);
+    bits = 16;
+  } else {
+    pixels = ::stbi_load_from_memory(data, size, &width, &height,
+                                     &components_in_file, kComponents);
+  }
+  if (pixels == nullptr || width <= 0 || height <= 0) {
+    ::stbi_image_free(pixels);
+    return decoded;
+  }
+  decoded.width = width;
+  decoded.height = height;
+  decoded.components = kComponents;
+  decoded.bits_per_component = bits;
+  decoded.pixel_type = bits == 16 ? TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT
+                                  : TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+  // The pixels are handed over without copying.
+  decoded.pixels = UnownedMapping(
+      static_cast<const uint8_t*>(pixels),
+      decoded.width * decoded.height * kComponents * (bits / 8),
+      [pixels]() { ::stbi_image_free(pixels); });
+  return decoded;
+}
+
+// The size DecodeImage will decode the image to, from its header only.
+static size_t GetDecodedImageSize(const Mapping& encoded) {
+  if (encoded.GetData() == nullptr ||
+      encoded.GetSize() > std::numeric_limits<int>::max()) {
+    return 0u;
+  }
+  const auto data = encoded.GetData();
+  const auto size = static_cast<int>(encoded.GetSize());
+  int width = 0;
+  int height = 0;
+  int components_in_file = 0;
+  if (!::stbi_info_from_memory(data, size, &width, &height,
+                               &components_in_file) ||
+      width <= 0 || height <= 0) {
+    return 0u;
+  }
+  const size_t bytes_per_component =
+      ::stbi_is_16_bit_from_memory(data, size) ? 2u : 1u;
+  return static_cast<size_t>(width) * static_cast<size_t>(height) * 4u *
+         bytes_per_component;
+}
+
+std::shared_ptr<DeferredImage> DeferredImage::Decode(
+    std::shared_ptr<const Mapping> encoded) {
+  auto image = std::shared_ptr<DeferredImage>(new DeferredImage());
+  image->expected_size_ = encoded ? GetDecodedImageSize(*encoded) : 0u;
+  WorkerPool::ForProcess().PostTask(
+      [image, encoded = std::move(encoded)]() mutable {
+        image->decoded_ = DecodeImage(*encoded);
+        encoded.reset();
+        std::vector<UniqueClosure> on_decoded;
+        {
+          std::scoped_lock lock(image->mutex_);
+          image->is_decoded_.store(true, std::memory_order_release);
+          std::swap(on_decoded, image->on_decoded_);
+        }
+        image->decoded_cv_.notify_all();
+        WorkerPool::ForProcess().NotifyWaiters();
+        for (auto& callback : on_decoded) {
+          callback();
+        }
+      });
+  return image;
+}
+
+DeferredImage::DeferredImage() = default;
+
+DeferredImage::~DeferredImage() = default;
+
+bool DeferredImage::IsDecoded() const {
+  return is_decoded_.load(std::memory_order_acquire);
+}
+
+size_t DeferredImage::GetSizeInBytes() const {
+  if (!IsDecoded()) {
+    return expected_size_;
+  }
+  return decoded_.pixels ? decoded_.pixels->GetSize() : 0u;
+}
+
+void DeferredImage::OnDecoded(UniqueClosure callback) {
+  if (!callback) {
+    return;
+  }
+  {
+    std::scoped_lock lock(mutex_);
+    if (!IsDecoded()) {
+      on_decoded_.emplace_back(std::move(callback));
+      return;
+    }
+  }
+  callback();
+}
+
+const DecodedImage& DeferredImage::Wait() const {
+  if (IsDecoded()) {
+    return decoded_;
+  }
+  P_TRACE_EVENT("asset", "WaitForImageDecode");
+  auto& pool = WorkerPool::ForProcess();
+  if (pool.IsCurrentThreadWorker()) {
+    // The decode may be queued behind this worker, so run tasks instead of
+    // blocking it.
+    pool.WaitUntil([this]() { return IsDecoded(); });
+  } else {
+    std::unique_lock lock(mutex_);
+    decoded_cv_.wait(lock, [this]() { return IsDecoded(); });
+  }
+  return decoded_;
+}
+
+void OnAllDecoded(const std::vector<std::shared_ptr<DeferredImage>>& images,
+                  UniqueClosure callback) {
+  // One count for each image and one for this call, so the callback cannot
+  // be invoked before all images have been visited.
+  struct Countdown {
+    std::atomic_size_t remaining = 1;
+    UniqueClosure callback;
+  };
+  auto countdown = std::make_shared<Countdown>();
+  countdown->callback = std::move(callback);
+  auto count_down = [countdown]() {
+    if (--countdown->remaining == 0u && countdown->callback) {
+      countdown->callback();
+    }
+  };
+  for (const auto& image : images) {
+    if (!image) {
+      continue;
+    }
+    countdown->remaining++;
+    image->OnDecoded(count_down);
+  }
+  count_down();
+}
+
+}  // namespace pixel
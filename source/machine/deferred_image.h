@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "closure.h"
+#include "macros.h"
+#include "mapping.h"
+
+namespace pixel {
+
+struct DecodedImage {
+  size_t width = 0;
+  size_t height = 0;
+  size_t components = 0;
+  size_t bits_per_component = 0;
+  // One of the TINYGLTF_COMPONENT_TYPE_* values.
+  int pixel_type = -1;
+  // Null if the image could not be decoded.
+  std::shared_ptr<const Mapping> pixels;
+};
+
+//------------------------------------------------------------------------------
+/// @brief      Decode the image the same way TinyGLTF does. Images are always
+///             decoded to four components.
+///
+DecodedImage DecodeImage(const Mapping& encoded);
+
+class DeferredImage;
+
+//------------------------------------------------------------------------------
+/// @brief      Invoke the callback once all the images have been decoded. Null
+///             images are ignored. The callback is invoked on the worker that
+///             decoded the last image, or right away on the calling thread if
+///             all of them already have been.
+///
+void OnAllDecoded(const std::vector<std::shared_ptr<DeferredImage>>& images,
+                  UniqueClosure callback);
+
+//------------------------------------------------------------------------------
+/// @brief      An image being decoded on the process-wide worker pool. Images
+///             are decoded concurrently with each other and with the rest of
+///             the asset being loaded.
+///
+class DeferredImage {
+ public:
+  //----------------------------------------------------------------------------
+  /// @brief      Start decoding the image. The encoded image is released once
+  ///             it has been decoded.
+  ///
+  static std::shared_ptr<DeferredImage> Decode(
+      std::shared_ptr<const Mapping> encoded);
+
+  ~DeferredImage();
+
+  bool IsDecoded() const;
+
+  //----------------------------------------------------------------------------
+  /// @brief      The size of the decoded pixels. Before the image has been
+  ///             decoded, this is the size given by the header of the encoded
+  ///             image and does not wait for the decode.
+  ///
+  size_t GetSizeInBytes() const;
+
+  //----------------------------------------------------------------------------
+  /// @brief      Invoke the callback once the image has been decoded. The
+  ///             callback is invoked on the worker that decoded the image, or
+  ///             right away on the calling thread if it already has been.
+  ///
+  void OnDecoded(UniqueClosure callback);
+
+  //----------------------------------------------------------------------------
+  /// @brief      Blocks till the image has been decoded. Workers of the
+  ///             process-wide pool help run its tasks while waiting. Other
+  ///             threads, like render threads, only wait for this image and
+  ///             should prefer `IsDecoded` or `OnDecoded` to avoid blocking.
+  ///
+  const DecodedImage& Wait() const;
+
+ private:
+  DecodedImage decoded_;
+  std::atomic_bool is_decoded_ = false;
+  size_t expected_size_ = 0;
+  mutable std::mutex mutex_;
+  mutable std::condition_variable decoded_cv_;
+  std::vector<UniqueClosure> on_decoded_;
+
+  DeferredImage();
+
+  P_DISALLOW_COPY_AND_ASSIGN(DeferredImage);
+};
+
+}  // namespace pixel
@@ -120,7 +120,7 @@ std::optional<std::vector<vk::Fence>> FenceWaiter::CreateWaitSetLocked() {
 }
 
 void FenceWaiter::ProcessSignalledFences(std::vector<vk::Fence> fences) {
-  std::vector<Closure> callbacks_to_fire;
+  std::vector<CompletionHandler> callbacks_to_fire;
 
   {
     // All access to fences must be guarded by the mutex.
@@ -129,31 +129,48 @@ void FenceWaiter::ProcessSignalledFences(std::vector<vk::Fence> fences) {
       auto found = awaited_fences_.find(fence);
       // A fence we weren't waiting on cannot be signalled.
       P_ASSERT(found != awaited_fences_.end());
-      callbacks_to_fire.push_back(found->second);
+      callbacks_to_fire.emplace_back(std::move(found->second));
       awaited_fences_.erase(found);
     }
   }
 
   // Fire the callbacks after the fences mutex has been released.
-  for (const auto& callback : callbacks_to_fire) {
-    callback();
+  for (auto& callback : callbacks_to_fire) {
+    callback.dispatcher->PostTask(std::move(callback.handler),
+                                  TaskPriority::kTaskPriorityNormal,
+                                  "Fence Completion");
   }
 }
 
-bool FenceWaiter::AddCompletionHandler(vk::Fence fence, Closure handler) {
+bool FenceWaiter::AddCompletionHandler(vk::Fence fence,
+                                       UniqueClosure handler) {
   if (!fence || !handler) {
     return false;
   }
 
-  auto dispatcher = EventLoop::ForCurrentThread().GetDispatcher();
-  auto calling_thread_posted_handeler = [dispatcher, handler]() {
-    dispatcher->PostTask(handler);
-  };
+  CompletionHandler completion_handler;
+  completion_handler.dispatcher = EventLoop::ForCurrentThread().GetDispatcher();
+  completion_handler.handler = std::move(handler);
 
   std::scoped_lock lock(fences_mutex_);
-  awaited_fences_[fence] = calling_thread_posted_handeler;
+  awaited_fences_[fence] = std::move(completion_handler);
   fences_cv_.notify_one();
   return true;
 }
 
+FenceWaiter::WaitAwaiter FenceWaiter::Wait(vk::Fence fence) {
+  return WaitAwaiter{this, fence};
+}
+
+bool FenceWaiter::WaitAwaiter::await_suspend(std::coroutine_handle<> handle) {
+  // The coroutine may be resumed before the handler is added. So this awaiter
+  // must not be touched once the handler is added.
+  added = true;
+  if (waiter->AddCompletionHandler(fence, [handle]() { handle.resume(); })) {
+    return true;
+  }
+  added = false;
+  return false;
+}
+
 }  // namespace pixel
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <condition_variable>
+#include <coroutine>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -9,6 +10,7 @@
 #include <vector>
 
 #include "closure.h"
+#include "event_loop.h"
 #include "macros.h"
 #include "vulkan.h"
 
@@ -30,7 +32,31 @@ class FenceWaiter : public std::enable_shared_from_this<FenceWaiter> {
   ///
   /// @return     If the completion handler was registered.
   ///
-  bool AddCompletionHandler(vk::Fence fence, Closure handler);
+  bool AddCompletionHandler(vk::Fence fence, UniqueClosure handler);
+
+  struct WaitAwaiter {
+    FenceWaiter* waiter = nullptr;
+    vk::Fence fence;
+    bool added = false;
+
+    bool await_ready() const { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle);
+
+    bool await_resume() const { return added; }
+  };
+
+  //----------------------------------------------------------------------------
+  /// @brief      Returns an awaitable that resumes the awaiting coroutine on
+  ///             the calling thread once the fence is signaled. The calling
+  ///             thread must be running an event loop.
+  ///
+  /// @param[in]  fence  The fence. It must stay alive till the await is done.
+  ///
+  /// @return     The result of the await is false if the fence could not be
+  ///             waited on. The coroutine is resumed right away in that case.
+  ///
+  WaitAwaiter Wait(vk::Fence fence);
 
  private:
   vk::Device device_;
@@ -38,7 +64,12 @@ class FenceWaiter : public std::enable_shared_from_this<FenceWaiter> {
   std::unique_ptr<std::thread> waiter_;
   std::mutex fences_mutex_;
   std::condition_variable fences_cv_;
-  std::map<vk::Fence, Closure> awaited_fences_;
+  struct CompletionHandler {
+    // The dispatcher of the thread that added the handler.
+    std::shared_ptr<EventLoop::Dispatcher> dispatcher;
+    UniqueClosure handler;
+  };
+  std::map<vk::Fence, CompletionHandler> awaited_fences_;
   bool is_valid_ = false;
 
   FenceWaiter(vk::Device device, vk::Queue queue);
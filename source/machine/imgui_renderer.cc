@@ -3,16 +3,21 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_vulkan.h>
 #include <algorithm>
+#include <filesystem>
 
 #include "command_buffer.h"
 #include "command_pool.h"
+#include "event_loop.h"
 #include "imgui.h"
 #include "macros.h"
+#include "trace_event.h"
 #include "vulkan.h"
+#include "worker_pool.h"
 
 namespace pixel {
 
 constexpr size_t kFrameSamplesCount = 1500u;
+constexpr auto kTaskSampleInterval = std::chrono::seconds(1);
 
 ImguiRenderer::ImguiRenderer(std::shared_ptr<RenderingContext> context,
                              GLFWwindow* window)
@@ -184,6 +189,99 @@ bool ImguiRenderer::GatherAndRenderPerformanceMetrics() {
   return true;
 }
 
+static float ToMillis(std::chrono::nanoseconds duration) {
+  return std::chrono::duration<float, std::milli>(duration).count();
+}
+
+static void RenderDurationHistogram(const char* title,
+                                    const DurationHistogram& histogram) {
+  ::ImGui::Text("%s", title);
+  ::ImGui::Text("(P50, P99, Max)");
+  ::ImGui::Text("(%2.2f, %2.2f, %2.2f) ms",
+                ToMillis(histogram.GetPercentile(0.5)),
+                ToMillis(histogram.GetPercentile(0.99)),
+                ToMillis(histogram.GetMax()));
+}
+
+bool ImguiRenderer::GatherAndRenderTaskMetrics() {
+  const auto loop_statistics = EventLoop::ForCurrentThread().GetStatistics();
+  const auto pool_statistics = WorkerPool::ForProcess().GetStatistics();
+  const auto pool_busy_time = pool_statistics.run_time.GetTotal();
+
+  // Sampled even when the tab is hidden so that the utilization is current
+  // as soon as it is shown.
+  const auto now = Clock::now();
+  const auto elapsed = now - last_task_sample_.time;
+  if (elapsed >= kTaskSampleInterval) {
+    const auto elapsed_seconds = std::chrono::duration<float>(elapsed).count();
+    loop_utilization_ =
+        std::chrono::duration<float>(loop_statistics.busy_time -
+                                     last_task_sample_.loop_busy_time)
+            .count() /
+        elapsed_seconds;
+    pool_utilization_ =
+        std::chrono::duration<float>(pool_busy_time -
+                                     last_task_sample_.pool_busy_time)
+            .count() /
+        (elapsed_seconds * pool_statistics.worker_count);
+    last_task_sample_ = {now, loop_statistics.busy_time, pool_busy_time};
+  }
+
+  if (!::ImGui::BeginTabItem("Tasks")) {
+    return true;
+  }
+
+  ::ImGui::Text("Main Loop");
+  ::ImGui::Text("Utilization: %3.0f%%", loop_utilization_ * 100.0f);
+  ::ImGui::Text("Tasks Run: %zu", loop_statistics.run_time.GetCount());
+  ::ImGui::Text("Queue Depth (Last, Max): (%zu, %zu)",
+                loop_statistics.queue_depth, loop_statistics.max_queue_depth);
+  RenderDurationHistogram("Latency", loop_statistics.latency);
+  RenderDurationHistogram("Run Time", loop_statistics.run_time);
+  for (const auto& label : loop_statistics.labels) {
+    ::ImGui::Separator();
+    ::ImGui::Text("%.*s: %zu tasks", static_cast<int>(label.first.size()),
+                  label.first.data(), label.second.run_time.GetCount());
+    RenderDurationHistogram("Run Time", label.second.run_time);
+  }
+  ::ImGui::Separator();
+  ::ImGui::Text("Worker Pool");
+  ::ImGui::Text("Utilization: %3.0f%% of %zu workers",
+                pool_utilization_ * 100.0f, pool_statistics.worker_count);
+  ::ImGui::Text("Tasks Run: %zu", pool_statistics.run_time.GetCount());
+  ::ImGui::Text("Pending Tasks: %zu", pool_statistics.pending_tasks);
+  RenderDurationHistogram("Run Time", pool_statistics.run_time);
+  ::ImGui::EndTabItem();
+
+  return true;
+}
+
+bool ImguiRenderer::RenderTracingControls() {
+  if (!::ImGui::BeginTabItem("Tracing")) {
+    return true;
+  }
+
+  if (IsTracingEnabled()) {
+    ::ImGui::Text("Recording...");
+    if (::ImGui::Button("Stop and Save Trace")) {
+      StopTracing();
+      const auto path =
+          std::filesystem::temp_directory_path() / "pixel_trace.json";
+      last_trace_path_ =
+          WriteTraceJSON(path) ? path.string() : "Could not write the trace.";
+    }
+  } else if (::ImGui::Button("Start Tracing")) {
+    StartTracing();
+  }
+  if (!last_trace_path_.empty()) {
+    ::ImGui::Separator();
+    ::ImGui::TextWrapped("Last Trace: %s", last_trace_path_.c_str());
+  }
+  ::ImGui::EndTabItem();
+
+  return true;
+}
+
 // |Renderer|
 bool ImguiRenderer::Teardown() {
   // Nothing to do here. Destructor performs all cleanup.
@@ -200,6 +298,14 @@ bool ImguiRenderer::RenderFrame(vk::CommandBuffer buffer) {
     return false;
   }
 
+  if (!GatherAndRenderTaskMetrics()) {
+    return false;
+  }
+
+  if (!RenderTracingControls()) {
+    return false;
+  }
+
   ::ImGui::EndTabBar();  // Instrumentation
   ::ImGui::End();        // Machine
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <chrono>
+#include <string>
 
 #include "command_pool.h"
 // TODO: This must be removed to make the main renderer GLFW agnostic.
@@ -29,6 +30,17 @@ class ImguiRenderer final : public Renderer {
   Clock::time_point last_frame_begin_;
   std::vector<float> frame_times_millis_;
   size_t frames_rendered_ = 0;
+  // Task utilization is averaged over the interval between two samples.
+  struct TaskSample {
+    Clock::time_point time;
+    std::chrono::nanoseconds loop_busy_time = {};
+    std::chrono::nanoseconds pool_busy_time = {};
+  };
+  TaskSample last_task_sample_;
+  float loop_utilization_ = 0.0f;
+  float pool_utilization_ = 0.0f;
+  // Where the last trace was written. Empty if none was.
+  std::string last_trace_path_;
 
   // |Renderer|
   bool IsValid() const override;
@@ -47,6 +59,10 @@ class ImguiRenderer final : public Renderer {
 
   bool GatherAndRenderPerformanceMetrics();
 
+  bool GatherAndRenderTaskMetrics();
+
+  bool RenderTracingControls();
+
   P_DISALLOW_COPY_AND_ASSIGN(ImguiRenderer);
 };
 
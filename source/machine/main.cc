@@ -1,5 +1,6 @@
 #include <stdlib.h>
 
+#include <chrono>
 #include <cstdlib>
 #include <iostream>
 #include <optional>
@@ -252,8 +253,12 @@ static bool Main(int argc, char const* argv[]) {
     return false;
   }
 
+  // Leaves most of a 60Hz frame for rendering. Tasks that don't fit are
+  // deferred to the next frame.
+  constexpr auto kTasksBudgetPerFrame = std::chrono::milliseconds(4);
+
   while (true) {
-    if (!loop.FlushTasksNow()) {
+    if (!loop.FlushTasksFor(kTasksBudgetPerFrame)) {
       P_ERROR << "Could not flush event loop tasks.";
       return false;
     }
@@ -3,6 +3,7 @@
 #include "assets_location.h"
 #include "imgui_renderer.h"
 #include "model_renderer.h"
+#include "trace_event.h"
 #include "tutorial_renderer.h"
 #include "vulkan_swapchain.h"
 
@@ -93,26 +94,41 @@ bool MainRenderer::BeginFrame() {
 }
 
 bool MainRenderer::Render() {
+  P_TRACE_EVENT("renderer", "Render");
   while (true) {
-    auto buffer = connection_.GetSwapchain().AcquireNextCommandBuffer();
+    std::optional<vk::CommandBuffer> buffer;
+    {
+      P_TRACE_EVENT("renderer", "AcquireNextCommandBuffer");
+      buffer = connection_.GetSwapchain().AcquireNextCommandBuffer();
+    }
 
     if (!buffer.has_value()) {
       return false;
     }
 
-    if (!BeginFrame()) {
-      P_ERROR << "Could not begin a new frame.";
-      return false;
+    {
+      P_TRACE_EVENT("renderer", "BeginFrame");
+      if (!BeginFrame()) {
+        P_ERROR_EVERY(std::chrono::seconds(1))
+            << "Could not begin a new frame.";
+        return false;
+      }
     }
 
     GetContext().GetMemoryAllocator().TraceUsageStatistics();
 
-    if (!RenderFrame(buffer.value())) {
-      P_ERROR << "Could not render frame.";
+    {
+      P_TRACE_EVENT("renderer", "RenderFrame");
+      if (!RenderFrame(buffer.value())) {
+        P_ERROR_EVERY(std::chrono::seconds(1)) << "Could not render frame.";
+      }
     }
 
-    auto result =
-        connection_.GetSwapchain().SubmitCommandBuffer(buffer.value());
+    auto result = VulkanSwapchain::SubmitResult::kFailure;
+    {
+      P_TRACE_EVENT("renderer", "SubmitCommandBuffer");
+      result = connection_.GetSwapchain().SubmitCommandBuffer(buffer.value());
+    }
 
     switch (result) {
       case VulkanSwapchain::SubmitResult::kSuccess:
@@ -18,6 +18,7 @@ GCC_PRAGMA("GCC diagnostic pop")
 #include "command_pool.h"
 #include "logging.h"
 #include "string_utils.h"
+#include "trace_event.h"
 
 namespace pixel {
 
@@ -301,6 +302,8 @@ std::unique_ptr<Buffer> MemoryAllocator::CreateDeviceLocalBufferCopy(
     return nullptr;
   }
 
+  P_TRACE_EVENT("memory", "CreateDeviceLocalBufferCopy");
+
   auto staging_buffer = CreateHostVisibleBuffer(
       usage | vk::BufferUsageFlagBits::eTransferSrc,      //
       buffer_size,                                        //
@@ -357,21 +360,25 @@ std::unique_ptr<Buffer> MemoryAllocator::CreateDeviceLocalBufferCopy(
 
   auto on_done_fence = device_.createFenceUnique({});
 
-  auto on_transfer_done = MakeCopyable(
-      [transfer_command_buffer, staging_buffer = std::move(staging_buffer),
-       on_done]() mutable {
-        transfer_command_buffer.reset();
-        staging_buffer.reset();
-        if (on_done) {
-          on_done();
-        }
-      });
+  // Spans the submission till the device is done with the transfer.
+  const auto upload_id = GetNextTraceID();
+  P_TRACE_ASYNC_BEGIN("memory", "Upload", upload_id);
+  auto on_transfer_done = [transfer_command_buffer,
+                           staging_buffer = std::move(staging_buffer),
+                           on_done = std::move(on_done), upload_id]() mutable {
+    P_TRACE_ASYNC_END("memory", "Upload", upload_id);
+    transfer_command_buffer.reset();
+    staging_buffer.reset();
+    if (on_done) {
+      on_done();
+    }
+  };
 
   if (!transfer_command_buffer->SubmitWithCompletionCallback(
           std::move(wait_semaphores),    //
           std::move(wait_stages),        //
           std::move(signal_semaphores),  //
-          on_transfer_done)              //
+          std::move(on_transfer_done))   //
   ) {
     P_ERROR << "Could not commit transfer command buffer.";
     return nullptr;
@@ -398,6 +405,8 @@ std::unique_ptr<Image> MemoryAllocator::CreateDeviceLocalImageCopy(
     return nullptr;
   }
 
+  P_TRACE_EVENT("memory", "CreateDeviceLocalImageCopy");
+
   auto staging_buffer =
       CreateHostVisibleBufferCopy(vk::BufferUsageFlagBits::eTransferSrc,
                                   image_data, image_data_size, debug_name);
@@ -500,18 +509,23 @@ std::unique_ptr<Image> MemoryAllocator::CreateDeviceLocalImageCopy(
     cmd_buffer.end();
   }
 
-  auto on_transfer_done = MakeCopyable(
-      [transfer_command_buffer, staging_buffer = std::move(staging_buffer),
-       on_done]() mutable {
-        transfer_command_buffer.reset();
-        staging_buffer.reset();
-        if (on_done) {
-          on_done();
-        }
-      });
+  // Spans the submission till the device is done with the transfer.
+  const auto upload_id = GetNextTraceID();
+  P_TRACE_ASYNC_BEGIN("memory", "Upload", upload_id);
+  auto on_transfer_done = [transfer_command_buffer,
+                           staging_buffer = std::move(staging_buffer),
+                           on_done = std::move(on_done), upload_id]() mutable {
+    P_TRACE_ASYNC_END("memory", "Upload", upload_id);
+    transfer_command_buffer.reset();
+    staging_buffer.reset();
+    if (on_done) {
+      on_done();
+    }
+  };
 
   if (!transfer_command_buffer->SubmitWithCompletionCallback(
-          wait_semaphores, wait_stages, signal_semaphores, on_transfer_done)) {
+          wait_semaphores, wait_stages, signal_semaphores,
+          std::move(on_transfer_done))) {
     return nullptr;
   }
 
@@ -1,8 +1,11 @@
 #include "model.h"
 
+#include <algorithm>
+#include <cstring>
 #include <type_traits>
 
 #include "model_draw_data.h"
+#include "trace_event.h"
 
 namespace pixel {
 namespace model {
@@ -40,9 +43,15 @@ static void ResolveCollectionReferences(
 }
 
 Model::Model(const Asset& asset) {
+  P_TRACE_EVENT("model", "Model::Model");
   accessors_ = Inflate<Accessor, tinygltf::Accessor>(asset.model.accessors);
   animations_ = Inflate<Animation, tinygltf::Animation>(asset.model.animations);
   buffers_ = Inflate<Buffer, tinygltf::Buffer>(asset.model.buffers);
+  for (size_t i = 0; i < asset.buffer_data.size() && i < buffers_.size(); i++) {
+    if (asset.buffer_data[i]) {
+      buffers_[i]->AdoptData(asset.buffer_data[i]);
+    }
+  }
   bufferViews_ =
       Inflate<BufferView, tinygltf::BufferView>(asset.model.bufferViews);
   materials_ = Inflate<Material, tinygltf::Material>(asset.model.materials);
@@ -50,6 +59,11 @@ Model::Model(const Asset& asset) {
   nodes_ = Inflate<Node, tinygltf::Node>(asset.model.nodes);
   textures_ = Inflate<Texture, tinygltf::Texture>(asset.model.textures);
   images_ = Inflate<Image, tinygltf::Image>(asset.model.images);
+  for (size_t i = 0; i < asset.images.size() && i < images_.size(); i++) {
+    if (asset.images[i]) {
+      images_[i]->AdoptDeferredImage(asset.images[i]);
+    }
+  }
   skins_ = Inflate<Skin, tinygltf::Skin>(asset.model.skins);
   samplers_ = Inflate<Sampler, tinygltf::Sampler>(asset.model.samplers);
   cameras_ = Inflate<Camera, tinygltf::Camera>(asset.model.cameras);
@@ -282,6 +296,11 @@ std::unique_ptr<ModelDrawData> Model::CreateDrawData(
     std::string debug_name) const {
   auto draw_data = std::make_unique<ModelDrawData>(std::move(debug_name));
 
+  // Get the buffers paging in while the scene graph is being walked.
+  for (const auto& accessor : accessors_) {
+    accessor->Prefetch();
+  }
+
   TransformationStack stack;
   for (const auto& scene : scenes_) {
     if (!scene->CollectDrawData(*draw_data, stack)) {
@@ -446,6 +465,16 @@ static std::optional<std::vector<T>> ReadTypedList(
   return std::nullopt;
 }
 
+void Accessor::Prefetch() const {
+  if (!buffer_view_) {
+    return;
+  }
+  const auto element_size = SizeOfComponentType(component_type_) *
+                            NumberOfComponentsInDataType(data_type_);
+  const auto stride = std::max(buffer_view_->GetStride(), element_size);
+  buffer_view_->Prefetch(byte_offset_, stride * count_);
+}
+
 std::optional<std::vector<uint32_t>> Accessor::ReadIndexList() const {
   const auto component_count = NumberOfComponentsInDataType(data_type_);
   if (component_count != 1) {
@@ -461,6 +490,21 @@ std::optional<std::vector<uint32_t>> Accessor::ReadIndexList() const {
   );
 }
 
+std::shared_ptr<const Mapping> Accessor::GetIndexSlice() const {
+  if (!buffer_view_ || count_ == 0 ||
+      data_type_ != DataType::kDataTypeScalar ||
+      component_type_ != ComponentType::kComponentTypeUnsignedInt) {
+    return nullptr;
+  }
+
+  const auto stride = buffer_view_->GetStride();
+  if (stride != 0 && stride != sizeof(uint32_t)) {
+    return nullptr;
+  }
+
+  return buffer_view_->GetSlice(byte_offset_, count_ * sizeof(uint32_t));
+}
+
 std::optional<std::vector<glm::vec3>> Accessor::ReadVec3List() const {
   const auto component_count = NumberOfComponentsInDataType(data_type_);
   if (component_count != 3) {
@@ -554,6 +598,10 @@ void Buffer::ReadFromArchive(const tinygltf::Buffer& buffer) {
 void Buffer::ResolveReferences(const Model& model,
                                const tinygltf::Buffer& buffer) {}
 
+void Buffer::AdoptData(std::shared_ptr<const Mapping> data) {
+  data_ = std::move(data);
+}
+
 std::optional<const uint8_t*> Buffer::GetByteMapping(size_t byte_offset,
                                                      size_t byte_length) const {
   if (!data_ || data_->GetData() == nullptr) {
@@ -571,6 +619,29 @@ std::optional<const uint8_t*> Buffer::GetByteMapping(size_t byte_offset,
   return data_ptr + byte_offset;
 }
 
+bool Buffer::Prefetch(size_t byte_offset, size_t byte_length) const {
+  if (!data_) {
+    return false;
+  }
+  return data_->Prefetch(byte_offset, byte_length);
+}
+
+std::shared_ptr<const Mapping> Buffer::GetSlice(size_t byte_offset,
+                                                size_t byte_length) const {
+  if (!data_ || data_->GetData() == nullptr) {
+    P_ERROR << "Buffer data could not be resolved.";
+    return nullptr;
+  }
+
+  auto slice = SliceMapping(data_, byte_offset, byte_length);
+  if (!slice) {
+    P_ERROR << "Buffer specified ranges with overruns.";
+    return nullptr;
+  }
+
+  return slice;
+}
+
 // *****************************************************************************
 // *** BufferView
 // *****************************************************************************
@@ -614,6 +685,29 @@ std::optional<const uint8_t*> BufferView::GetByteMapping(
   return buffer_ptr.value() + accessor_offset;
 }
 
+bool BufferView::Prefetch(size_t offset, size_t length) const {
+  if (!buffer_ || offset > byte_length_) {
+    return false;
+  }
+  return buffer_->Prefetch(byte_offset_ + offset,
+                           std::min(length, byte_length_ - offset));
+}
+
+std::shared_ptr<const Mapping> BufferView::GetSlice(size_t offset,
+                                                    size_t length) const {
+  if (!buffer_) {
+    P_ERROR << "Buffer was not present.";
+    return nullptr;
+  }
+
+  if (offset > byte_length_ || length > byte_length_ - offset) {
+    P_ERROR << "Buffer view specified ranges with overruns.";
+    return nullptr;
+  }
+
+  return buffer_->GetSlice(byte_offset_ + offset, length);
+}
+
 size_t BufferView::GetStride() const {
   return byte_stride_;
 }
@@ -909,10 +1003,22 @@ bool Primitive::CollectDrawData(ModelDrawData& draw_data,
     draw_call_builder.SetVertices(std::move(vertices));
   }
 
-  // Collect indices.
+  // Collect indices. 32-bit indices are used straight from the buffer.
   if (indices_) {
-    auto index_data = indices_->ReadIndexList();
-    if (index_data.has_value()) {
+    if (auto index_slice = indices_->GetIndexSlice()) {
+      const auto index_bytes = index_slice->GetData();
+      for (size_t i = 0; i < index_slice->GetSize(); i += sizeof(uint32_t)) {
+        uint32_t index = 0;
+        ::memcpy(&index, index_bytes + i, sizeof(uint32_t));
+        if (index >= positions.size()) {
+          P_ERROR << "Index specified vertex position that was out of bounds.";
+          return false;
+        }
+      }
+
+      draw_call_builder.SetIndexData(std::move(index_slice));
+    } else if (auto index_data = indices_->ReadIndexList();
+               index_data.has_value()) {
       auto indices = std::move(index_data.value());
 
       for (const auto& index : indices) {
@@ -1077,12 +1183,13 @@ static ScalarFormat PixelTypeToScalarFormat(int pixel_type) {
 
 void Image::ReadFromArchive(const tinygltf::Image& image) {
   name_ = image.name;
-  width_ = std::max<int>(0u, image.width);
-  height_ = std::max<int>(0u, image.height);
-  components_ = std::max<int>(0u, image.component);
-  bits_per_component_ = std::max<int>(0u, image.bits);
-  component_format_ = PixelTypeToScalarFormat(image.pixel_type);
-  decompressed_image_ = CopyMapping(image.image.data(), image.image.size());
+  decompressed_image_.width = std::max<int>(0u, image.width);
+  decompressed_image_.height = std::max<int>(0u, image.height);
+  decompressed_image_.components = std::max<int>(0u, image.component);
+  decompressed_image_.bits_per_component = std::max<int>(0u, image.bits);
+  decompressed_image_.pixel_type = image.pixel_type;
+  decompressed_image_.pixels =
+      CopyMapping(image.image.data(), image.image.size());
   mime_type_ = image.mimeType;
   uri_ = image.uri;
 }
@@ -1092,19 +1199,54 @@ void Image::ResolveReferences(const Model& model,
   buffer_view_ = BoundsCheckGet(model.bufferViews_, image.bufferView);
 }
 
+void Image::AdoptDeferredImage(std::shared_ptr<DeferredImage> image) {
+  deferred_image_ = std::move(image);
+}
+
+void Image::AdoptDecodedImage(DecodedImage image) {
+  deferred_image_.reset();
+  decompressed_image_ = std::move(image);
+}
+
+const DecodedImage& Image::GetDecodedImage() const {
+  if (deferred_image_) {
+    return deferred_image_->Wait();
+  }
+  return decompressed_image_;
+}
+
+size_t Image::GetSizeInBytes() const {
+  if (deferred_image_) {
+    return deferred_image_->GetSizeInBytes();
+  }
+  const auto& pixels = decompressed_image_.pixels;
+  return pixels ? pixels->GetSize() : 0u;
+}
+
+const std::shared_ptr<DeferredImage>& Image::GetDeferredImage() const {
+  return deferred_image_;
+}
+
 std::unique_ptr<pixel::ImageView> Image::CreateImageView(
-    const RenderingContext& context) const {
-  if (width_ == 0 || height_ == 0) {
+    const RenderingContext& context,
+    std::function<void(void)> on_done) const {
+  const auto& decoded = GetDecodedImage();
+  const auto width = decoded.width;
+  const auto height = decoded.height;
+  const auto& pixels = decoded.pixels;
+
+  if (width == 0 || height == 0) {
     return nullptr;
   }
 
-  if (!decompressed_image_ || decompressed_image_->GetData() == nullptr) {
+  if (!pixels || pixels->GetData() == nullptr) {
     return nullptr;
   }
 
-  auto format = context.GetOptimalSampledImageFormat(components_,          //
-                                                     bits_per_component_,  //
-                                                     component_format_     //
+  auto format = context.GetOptimalSampledImageFormat(
+      decoded.components,                          //
+      decoded.bits_per_component,                  //
+      PixelTypeToScalarFormat(decoded.pixel_type)  //
   );
 
   if (!format.has_value()) {
@@ -1115,12 +1257,12 @@ std::unique_ptr<pixel::ImageView> Image::CreateImageView(
       {},                  // flags
       vk::ImageType::e2D,  // image type
       format.value(),      // image format
-      vk::Extent3D{static_cast<uint32_t>(width_),
-                   static_cast<uint32_t>(height_), 1u},  // extents
-      1u,                                                // mip levels
-      1u,                                                // array layers
-      vk::SampleCountFlagBits::e1,                       // samples
-      vk::ImageTiling::eOptimal,                         // tiling
+      vk::Extent3D{static_cast<uint32_t>(width),
+                   static_cast<uint32_t>(height), 1u},  // extents
+      1u,                                               // mip levels
+      1u,                                               // array layers
+      vk::SampleCountFlagBits::e1,                      // samples
+      vk::ImageTiling::eOptimal,                        // tiling
       vk::ImageUsageFlagBits::eSampled |
           vk::ImageUsageFlagBits::eTransferDst,  // usage
       vk::SharingMode::eExclusive,               // sharing (we are not)
@@ -1129,18 +1271,16 @@ std::unique_ptr<pixel::ImageView> Image::CreateImageView(
       vk::ImageLayout::eUndefined  // initial layout
   };
 
-  // TODO: Figure out device synchronization.
-
   auto image = context.GetMemoryAllocator().CreateDeviceLocalImageCopy(
       image_create_info,                              //
-      decompressed_image_->GetData(),                 //
-      decompressed_image_->GetSize(),                 //
+      pixels->GetData(),                              //
+      pixels->GetSize(),                              //
       context.GetTransferCommandPool(),               //
       name_.empty() ? "Model Image" : name_.c_str(),  //
       nullptr,                                        // wait semaphores
       nullptr,                                        //  wait stages
       nullptr,                                        // signal semaphores
-      nullptr                                         // on done
+      std::move(on_done)                              // on done
   );
 
   if (!image) {
@@ -1229,11 +1369,12 @@ Sampler::~Sampler() = default;
 void Sampler::ReadFromArchive(const tinygltf::Sampler& sampler) {
   name_ = sampler.name;
   // https://github.com/KhronosGroup/glTF/blob/master/specification/2.0/schema/sampler.schema.json
-  std::tie(mag_filter_, std::ignore) = ParseVkFilter(sampler.magFilter);
-  std::tie(min_filter_, mipmap_mode_) = ParseVkFilter(sampler.minFilter);
-  wrap_s_ = ParseVkSamplerAddressMode(sampler.wrapS);
-  wrap_t_ = ParseVkSamplerAddressMode(sampler.wrapT);
-  wrap_r_ = ParseVkSamplerAddressMode(sampler.wrapR);
+  std::tie(info_.mag_filter, std::ignore) = ParseVkFilter(sampler.magFilter);
+  std::tie(info_.min_filter, info_.mipmap_mode) =
+      ParseVkFilter(sampler.minFilter);
+  info_.wrap_s = ParseVkSamplerAddressMode(sampler.wrapS);
+  info_.wrap_t = ParseVkSamplerAddressMode(sampler.wrapT);
+  info_.wrap_r = ParseVkSamplerAddressMode(sampler.wrapR);
 }
 
 void Sampler::ResolveReferences(const Model& model,
@@ -1241,16 +1382,24 @@ void Sampler::ResolveReferences(const Model& model,
   // Nothing to do.
 }
 
+void Sampler::AdoptSamplerInfo(SamplerInfo info) {
+  info_ = info;
+}
+
+const SamplerInfo& Sampler::GetSamplerInfo() const {
+  return info_;
+}
+
 vk::UniqueSampler Sampler::CreateSampler(
     const RenderingContext& context) const {
   vk::SamplerCreateInfo sampler_info = {
       {},                                       // flags
-      mag_filter_,                              // mag filter
-      min_filter_,                              // min filter
-      mipmap_mode_,                             // mip map mode
-      wrap_s_,                                  // address mode U
-      wrap_t_,                                  // address mode V
-      wrap_r_,                                  // address mode W
+      info_.mag_filter,                         // mag filter
+      info_.min_filter,                         // min filter
+      info_.mipmap_mode,                        // mip map mode
+      info_.wrap_s,                             // address mode U
+      info_.wrap_t,                             // address mode V
+      info_.wrap_r,                             // address mode W
       0.0f,                                     // mip LOD bias
       context.GetFeatures().samplerAnisotropy,  // enable anisotropic filtering
       16.0f,                                    // max anisotropy
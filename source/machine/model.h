@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <functional>
 #include <map>
 #include <memory>
 #include <optional>
@@ -112,10 +113,25 @@ class Accessor final : public GLTFArchivable<tinygltf::Accessor> {
 
   std::optional<std::vector<uint32_t>> ReadIndexList() const;
 
+  //----------------------------------------------------------------------------
+  /// @brief      The indices of the accessor as a slice of its buffer if they
+  ///             are already tightly packed 32-bit indices. The indices are
+  ///             not copied and the slice keeps the buffer alive.
+  ///
+  /// @return     The slice or null if the indices must be converted. Use
+  ///             `ReadIndexList` then.
+  ///
+  std::shared_ptr<const Mapping> GetIndexSlice() const;
+
   std::optional<std::vector<glm::vec3>> ReadVec3List() const;
 
   std::optional<std::vector<glm::vec2>> ReadVec2List() const;
 
+  //----------------------------------------------------------------------------
+  /// @brief      Hint that the data of the accessor is going to be read soon.
+  ///
+  void Prefetch() const;
+
  private:
   std::string name_;
   std::shared_ptr<BufferView> buffer_view_;
@@ -158,12 +174,27 @@ class Buffer final : public GLTFArchivable<tinygltf::Buffer> {
   void ResolveReferences(const Model& model,
                          const tinygltf::Buffer& buffer) override;
 
+  //----------------------------------------------------------------------------
+  /// @brief      Use data that is already in memory instead of the data in the
+  ///             archive. The data is not copied.
+  ///
+  void AdoptData(std::shared_ptr<const Mapping> data);
+
   std::optional<const uint8_t*> GetByteMapping(size_t byte_offset,
                                                size_t byte_length) const;
 
+  bool Prefetch(size_t byte_offset, size_t byte_length) const;
+
+  //----------------------------------------------------------------------------
+  /// @brief      A view of the given range of the buffer that keeps the buffer
+  ///             data alive. The data is not copied.
+  ///
+  std::shared_ptr<const Mapping> GetSlice(size_t byte_offset,
+                                          size_t byte_length) const;
+
  private:
   std::string name_;
-  std::unique_ptr<Mapping> data_;
+  std::shared_ptr<const Mapping> data_;
   std::string uri_;
 
   P_DISALLOW_COPY_AND_ASSIGN(Buffer);
@@ -183,6 +214,18 @@ class BufferView final : public GLTFArchivable<tinygltf::BufferView> {
   std::optional<const uint8_t*> GetByteMapping(size_t offset,
                                                size_t length) const;
 
+  //----------------------------------------------------------------------------
+  /// @brief      Hint that the given range is going to be read soon. The range
+  ///             is clamped to the view.
+  ///
+  bool Prefetch(size_t offset, size_t length) const;
+
+  //----------------------------------------------------------------------------
+  /// @brief      A view of the given range of the buffer view that keeps the
+  ///             buffer data alive. The data is not copied.
+  ///
+  std::shared_ptr<const Mapping> GetSlice(size_t offset, size_t length) const;
+
   size_t GetStride() const;
 
  private:
@@ -431,19 +474,53 @@ class Image final : public GLTFArchivable<tinygltf::Image> {
   void ResolveReferences(const Model& model,
                          const tinygltf::Image& image) override;
 
+  //----------------------------------------------------------------------------
+  /// @brief      Use the pixels of an image that is being decoded instead of
+  ///             the pixels in the archive.
+  ///
+  void AdoptDeferredImage(std::shared_ptr<DeferredImage> image);
+
+  //----------------------------------------------------------------------------
+  /// @brief      Use pixels that have already been decoded, like the texels of
+  ///             a baked model, instead of the pixels in the archive.
+  ///
+  void AdoptDecodedImage(DecodedImage image);
+
+  //----------------------------------------------------------------------------
+  /// @brief      The pixels of the image. If the image is still being decoded,
+  ///             this waits for it to be decoded first.
+  ///
+  const DecodedImage& GetDecodedImage() const;
+
+  //----------------------------------------------------------------------------
+  /// @brief      The size of the decoded pixels of the image. This does not
+  ///             wait for the image to be decoded.
+  ///
+  size_t GetSizeInBytes() const;
+
+  //----------------------------------------------------------------------------
+  /// @brief      The image being decoded, or null if the pixels are available
+  ///             without waiting.
+  ///
+  const std::shared_ptr<DeferredImage>& GetDeferredImage() const;
+
+  //----------------------------------------------------------------------------
+  /// @brief      Create the device image and start uploading the image to it.
+  ///             The image may not be sampled till the upload is done, which
+  ///             is signalled by the callback on the loop of the calling
+  ///             thread. If the image is still being decoded, this waits for
+  ///             it to be decoded first.
+  ///
   std::unique_ptr<pixel::ImageView> CreateImageView(
-      const RenderingContext& context) const;
+      const RenderingContext& context,
+      std::function<void(void)> on_done = nullptr) const;
 
  private:
   std::string name_;
-  size_t width_ = 0;
-  size_t height_ = 0;
-  size_t components_ = 0;
-  size_t bits_per_component_ = 0;
-  ScalarFormat component_format_ = ScalarFormat::kUnknown;
   // Default image decompression can be disabled by the Image::as_is flag and a
   // custom image decompression routine.
-  std::unique_ptr<Mapping> decompressed_image_;
+  DecodedImage decompressed_image_;
+  std::shared_ptr<DeferredImage> deferred_image_;
   std::shared_ptr<BufferView> buffer_view_;
   std::string mime_type_;
   std::string uri_;
@@ -467,6 +544,15 @@ class Skin final : public GLTFArchivable<tinygltf::Skin> {
   P_DISALLOW_COPY_AND_ASSIGN(Skin);
 };
 
+struct SamplerInfo {
+  vk::Filter min_filter = vk::Filter::eLinear;
+  vk::Filter mag_filter = vk::Filter::eLinear;
+  vk::SamplerMipmapMode mipmap_mode = vk::SamplerMipmapMode::eLinear;
+  vk::SamplerAddressMode wrap_s = vk::SamplerAddressMode::eRepeat;
+  vk::SamplerAddressMode wrap_t = vk::SamplerAddressMode::eRepeat;
+  vk::SamplerAddressMode wrap_r = vk::SamplerAddressMode::eRepeat;
+};
+
 class Sampler final : public GLTFArchivable<tinygltf::Sampler> {
  public:
   Sampler();
@@ -478,16 +564,19 @@ class Sampler final : public GLTFArchivable<tinygltf::Sampler> {
   void ResolveReferences(const Model& model,
                          const tinygltf::Sampler& sampler) override;
 
+  //----------------------------------------------------------------------------
+  /// @brief      Use the given parameters, like those of a baked model, instead
+  ///             of the parameters in the archive.
+  ///
+  void AdoptSamplerInfo(SamplerInfo info);
+
+  const SamplerInfo& GetSamplerInfo() const;
+
   vk::UniqueSampler CreateSampler(const RenderingContext& context) const;
 
  private:
   std::string name_;
-  vk::Filter min_filter_;
-  vk::Filter mag_filter_;
-  vk::SamplerMipmapMode mipmap_mode_;
-  vk::SamplerAddressMode wrap_s_;
-  vk::SamplerAddressMode wrap_t_;
-  vk::SamplerAddressMode wrap_r_;
+  SamplerInfo info_;
 
   P_DISALLOW_COPY_AND_ASSIGN(Sampler);
 };
@@ -0,0 +1,519 @@
+#include "model_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include "assets_location.h"
+#include "atomic_file_writer.h"
+#include "file.h"
+#include "logging.h"
+#include "trace_event.h"
+
+namespace pixel {
+namespace model {
+
+// Bump the version whenever the layout of the file or the meaning of any of
+// its fields changes.
+static constexpr uint8_t kBakedModelMagic[8] = {'P', 'X', 'M', 'O',
+                                                'D', 'E', 'L', '\0'};
+static constexpr uint32_t kBakedModelVersion = 1u;
+static constexpr size_t kBakedModelAlignment = 64u;
+static constexpr uint32_t kNoIndex = std::numeric_limits<uint32_t>::max();
+
+struct BakedModelHeader {
+  uint8_t magic[8];
+  uint32_t version;
+  uint32_t vertex_size;
+  uint32_t index_size;
+  uint32_t draw_call_count;
+  uint64_t source_hash_low;
+  uint64_t source_hash_high;
+  uint64_t file_size;
+  uint32_t image_count;
+  uint32_t sampler_count;
+  uint8_t padding[8];
+};
+
+struct BakedDrawCall {
+  uint32_t topology;
+  uint32_t base_color_image;
+  uint32_t base_color_sampler;
+  uint32_t padding;
+  uint64_t vertices_offset;
+  uint64_t vertices_size;
+  uint64_t indices_offset;
+  uint64_t indices_size;
+};
+
+struct BakedImage {
+  uint32_t width;
+  uint32_t height;
+  uint32_t components;
+  uint32_t bits_per_component;
+  int32_t pixel_type;
+  uint32_t padding;
+  uint64_t pixels_offset;
+  uint64_t pixels_size;
+};
+
+struct BakedSampler {
+  uint32_t min_filter;
+  uint32_t mag_filter;
+  uint32_t mipmap_mode;
+  uint32_t wrap_s;
+  uint32_t wrap_t;
+  uint32_t wrap_r;
+};
+
+static_assert(sizeof(BakedModelHeader) == kBakedModelAlignment);
+static_assert(sizeof(BakedDrawCall) == 48u);
+static_assert(sizeof(BakedImage) == 40u);
+static_assert(sizeof(BakedSampler) == 24u);
+static_assert(std::is_trivially_copyable_v<BakedDrawCall> &&
+              std::is_trivially_copyable_v<BakedImage> &&
+              std::is_trivially_copyable_v<BakedSampler>);
+
+static constexpr uint64_t Align(uint64_t offset) {
+  return (offset + kBakedModelAlignment - 1u) & ~(kBakedModelAlignment - 1u);
+}
+
+// The tables follow the header in a fixed order and their offsets only depend
+// on the number of entries in each.
+struct BakedModelLayout {
+  uint64_t draw_calls_offset = 0;
+  uint64_t images_offset = 0;
+  uint64_t samplers_offset = 0;
+  uint64_t blobs_offset = 0;
+
+  BakedModelLayout(uint64_t draw_call_count,
+                   uint64_t image_count,
+                   uint64_t sampler_count)
+      : draw_calls_offset(sizeof(BakedModelHeader)),
+        images_offset(
+            Align(draw_calls_offset + draw_call_count * sizeof(BakedDrawCall))),
+        samplers_offset(
+            Align(images_offset + image_count * sizeof(BakedImage))),
+        blobs_offset(
+            Align(samplers_offset + sampler_count * sizeof(BakedSampler))) {}
+};
+
+std::shared_ptr<ModelCache> ModelCache::GetGlobal() {
+  static auto sCache =
+      std::make_shared<ModelCache>(PIXEL_MODEL_CACHE_LOCATION);
+  return sCache;
+}
+
+ModelCache::ModelCache(std::filesystem::path directory)
+    : directory_(std::move(directory)) {
+  std::error_code error;
+  std::filesystem::create_directories(directory_, error);
+  if (error) {
+    P_ERROR << "Could not create model cache directory " << directory_ << ": "
+            << error.message();
+    return;
+  }
+  is_valid_ = true;
+}
+
+ModelCache::~ModelCache() = default;
+
+bool ModelCache::IsValid() const {
+  return is_valid_;
+}
+
+std::filesystem::path ModelCache::GetBakedModelPath(
+    const Hash128& source_hash) const {
+  return directory_ / (source_hash.ToString() + ".pxmodel");
+}
+
+// *****************************************************************************
+// *** Loading
+// *****************************************************************************
+
+template <class T>
+static T ReadEntry(const Mapping& mapping, uint64_t offset, size_t index) {
+  T entry = {};
+  ::memcpy(&entry, mapping.GetData() + offset + index * sizeof(T), sizeof(T));
+  return entry;
+}
+
+static bool IsValidFilter(uint32_t filter) {
+  return filter == static_cast<uint32_t>(vk::Filter::eNearest) ||
+         filter == static_cast<uint32_t>(vk::Filter::eLinear);
+}
+
+static bool IsValidMipmapMode(uint32_t mode) {
+  return mode == static_cast<uint32_t>(vk::SamplerMipmapMode::eNearest) ||
+         mode == static_cast<uint32_t>(vk::SamplerMipmapMode::eLinear);
+}
+
+static bool IsValidAddressMode(uint32_t mode) {
+  return mode <=
+         static_cast<uint32_t>(vk::SamplerAddressMode::eMirrorClampToEdge);
+}
+
+static std::shared_ptr<Sampler> ReadSampler(const BakedSampler& baked) {
+  if (!IsValidFilter(baked.min_filter) || !IsValidFilter(baked.mag_filter) ||
+      !IsValidMipmapMode(baked.mipmap_mode) ||
+      !IsValidAddressMode(baked.wrap_s) || !IsValidAddressMode(baked.wrap_t) ||
+      !IsValidAddressMode(baked.wrap_r)) {
+    return nullptr;
+  }
+  auto sampler = std::make_shared<Sampler>();
+  sampler->AdoptSamplerInfo({
+      .min_filter = static_cast<vk::Filter>(baked.min_filter),
+      .mag_filter = static_cast<vk::Filter>(baked.mag_filter),
+      .mipmap_mode = static_cast<vk::SamplerMipmapMode>(baked.mipmap_mode),
+      .wrap_s = static_cast<vk::SamplerAddressMode>(baked.wrap_s),
+      .wrap_t = static_cast<vk::SamplerAddressMode>(baked.wrap_t),
+      .wrap_r = static_cast<vk::SamplerAddressMode>(baked.wrap_r),
+  });
+  return sampler;
+}
+
+static std::shared_ptr<Image> ReadImage(
+    const std::shared_ptr<const Mapping>& mapping,
+    const BakedImage& baked) {
+  const uint64_t expected_size = uint64_t{baked.width} * baked.height *
+                                 baked.components * baked.bits_per_component /
+                                 8u;
+  if (baked.pixels_size != expected_size) {
+    return nullptr;
+  }
+  DecodedImage decoded;
+  decoded.width = baked.width;
+  decoded.height = baked.height;
+  decoded.components = baked.components;
+  decoded.bits_per_component = baked.bits_per_component;
+  decoded.pixel_type = baked.pixel_type;
+  decoded.pixels =
+      SliceMapping(mapping, baked.pixels_offset, baked.pixels_size);
+  if (!decoded.pixels) {
+    return nullptr;
+  }
+  auto image = std::make_shared<Image>();
+  image->AdoptDecodedImage(std::move(decoded));
+  return image;
+}
+
+static std::shared_ptr<ModelDrawCall> ReadDrawCall(
+    const std::shared_ptr<const Mapping>& mapping,
+    const BakedDrawCall& baked,
+    const Images& images,
+    const Samplers& samplers) {
+  if (baked.topology >
+      static_cast<uint32_t>(vk::PrimitiveTopology::ePatchList)) {
+    return nullptr;
+  }
+  if (baked.vertices_size % sizeof(ModelDrawCall::VertexValueType) != 0u ||
+      baked.indices_size % sizeof(ModelDrawCall::IndexValueType) != 0u) {
+    return nullptr;
+  }
+  auto vertices =
+      SliceMapping(mapping, baked.vertices_offset, baked.vertices_size);
+  auto indices =
+      SliceMapping(mapping, baked.indices_offset, baked.indices_size);
+  if (!vertices || !indices) {
+    return nullptr;
+  }
+  ModelTextureMap textures;
+  if (baked.base_color_image != kNoIndex) {
+    if (baked.base_color_image >= images.size() ||
+        baked.base_color_sampler >= samplers.size()) {
+      return nullptr;
+    }
+    textures[TextureType::kTextureTypeBaseColor] = {
+        images[baked.base_color_image], samplers[baked.base_color_sampler]};
+  }
+  return std::make_shared<ModelDrawCall>(
+      static_cast<vk::PrimitiveTopology>(baked.topology),  //
+      std::move(indices),                                  //
+      std::move(vertices),                                 //
+      std::move(textures)                                  //
+  );
+}
+
+static std::unique_ptr<ModelDrawData> ReadBakedModel(
+    std::shared_ptr<const Mapping> mapping,
+    const Hash128& source_hash,
+    std::string debug_name) {
+  if (mapping->GetSize() < sizeof(BakedModelHeader)) {
+    return nullptr;
+  }
+  const auto header = ReadEntry<BakedModelHeader>(*mapping, 0u, 0u);
+  if (::memcmp(header.magic, kBakedModelMagic, sizeof(kBakedModelMagic)) !=
+          0 ||
+      header.version != kBakedModelVersion ||
+      header.vertex_size != sizeof(ModelDrawCall::VertexValueType) ||
+      header.index_size != sizeof(ModelDrawCall::IndexValueType)) {
+    // Baked by a different version or on a different machine. This is not an
+    // error as the next store replaces the file.
+    return nullptr;
+  }
+  if (header.source_hash_low != source_hash.low ||
+      header.source_hash_high != source_hash.high ||
+      header.file_size != mapping->GetSize()) {
+    P_ERROR << "Baked model does not match its source or is truncated.";
+    return nullptr;
+  }
+  const BakedModelLayout layout(header.draw_call_count, header.image_count,
+                                header.sampler_count);
+  if (layout.blobs_offset > mapping->GetSize()) {
+    P_ERROR << "Baked model tables overrun the file.";
+    return nullptr;
+  }
+
+  Samplers samplers;
+  samplers.reserve(header.sampler_count);
+  for (size_t i = 0; i < header.sampler_count; i++) {
+    auto sampler = ReadSampler(
+        ReadEntry<BakedSampler>(*mapping, layout.samplers_offset, i));
+    if (!sampler) {
+      P_ERROR << "Baked model sampler " << i << " is invalid.";
+      return nullptr;
+    }
+    samplers.emplace_back(std::move(sampler));
+  }
+
+  Images images;
+  images.reserve(header.image_count);
+  for (size_t i = 0; i < header.image_count; i++) {
+    auto image = ReadImage(
+        mapping, ReadEntry<BakedImage>(*mapping, layout.images_offset, i));
+    if (!image) {
+      P_ERROR << "Baked model image " << i << " is invalid.";
+      return nullptr;
+    }
+    images.emplace_back(std::move(image));
+  }
+
+  auto draw_data = std::make_unique<ModelDrawData>(std::move(debug_name));
+  for (size_t i = 0; i < header.draw_call_count; i++) {
+    const auto baked =
+        ReadEntry<BakedDrawCall>(*mapping, layout.draw_calls_offset, i);
+    auto draw_call = ReadDrawCall(mapping, baked, images, samplers);
+    if (!draw_call) {
+      P_ERROR << "Baked model draw call " << i << " is invalid.";
+      return nullptr;
+    }
+    draw_data->AddDrawCall(std::move(draw_call));
+  }
+  return draw_data;
+}
+
+std::unique_ptr<ModelDrawData> ModelCache::Load(const Hash128& source_hash,
+                                                std::string debug_name) const {
+  P_TRACE_EVENT("model", "LoadBakedModel");
+  if (!is_valid_) {
+    return nullptr;
+  }
+
+  const auto path = GetBakedModelPath(source_hash);
+  std::error_code error;
+  if (!std::filesystem::exists(path, error)) {
+    return nullptr;
+  }
+
+  // All of the file is uploaded to the device right away.
+  FileMappingOptions options;
+  options.access_pattern = FileAccessPattern::kFileAccessPatternSequential;
+  options.will_need = true;
+  std::shared_ptr<const Mapping> mapping = OpenFile(path, options);
+  if (!mapping) {
+    return nullptr;
+  }
+
+  return ReadBakedModel(std::move(mapping), source_hash, std::move(debug_name));
+}
+
+// *****************************************************************************
+// *** Storing
+// *****************************************************************************
+
+// Writes the file front to back, padding up to each offset with zeros.
+class BakedModelWriter {
+ public:
+  BakedModelWriter(AtomicFileWriter& writer) : writer_(writer) {}
+
+  bool WriteAt(uint64_t offset, const void* data, size_t size) {
+    if (!PadTo(offset)) {
+      return false;
+    }
+    if (size == 0u) {
+      return true;
+    }
+    if (!writer_.Write(reinterpret_cast<const uint8_t*>(data), size)) {
+      return false;
+    }
+    written_ += size;
+    return true;
+  }
+
+  bool PadTo(uint64_t offset) {
+    static constexpr uint8_t kZeros[kBakedModelAlignment] = {};
+    if (offset < written_) {
+      return false;
+    }
+    while (written_ < offset) {
+      const auto size =
+          std::min<uint64_t>(offset - written_, kBakedModelAlignment);
+      if (!writer_.Write(kZeros, size)) {
+        return false;
+      }
+      written_ += size;
+    }
+    return true;
+  }
+
+ private:
+  AtomicFileWriter& writer_;
+  uint64_t written_ = 0;
+
+  P_DISALLOW_COPY_AND_ASSIGN(BakedModelWriter);
+};
+
+bool ModelCache::Store(const Hash128& source_hash,
+                       const ModelDrawData& draw_data) const {
+  P_TRACE_EVENT("model", "StoreBakedModel");
+  if (!is_valid_) {
+    return false;
+  }
+
+  const auto& calls = draw_data.GetDrawCalls();
+
+  // Images and samplers shared by draw calls are only baked once.
+  std::map<std::shared_ptr<Image>, uint32_t> image_indices;
+  std::map<std::shared_ptr<Sampler>, uint32_t> sampler_indices;
+  std::vector<const DecodedImage*> images;
+  std::vector<const Sampler*> samplers;
+  for (const auto& call : calls) {
+    for (const auto& texture : call->GetTextures()) {
+      const auto& [image, sampler] = texture.second;
+      if (!image || !sampler) {
+        return false;
+      }
+      if (image_indices.emplace(image, images.size()).second) {
+        // Waits for the image if it is still being decoded.
+        images.push_back(&image->GetDecodedImage());
+      }
+      if (sampler_indices.emplace(sampler, samplers.size()).second) {
+        samplers.push_back(sampler.get());
+      }
+    }
+  }
+
+  const BakedModelLayout layout(calls.size(), images.size(), samplers.size());
+  uint64_t blob_offset = layout.blobs_offset;
+  auto allocate_blob = [&blob_offset](uint64_t size) {
+    const auto offset = blob_offset;
+    blob_offset = Align(blob_offset + size);
+    return offset;
+  };
+
+  std::vector<BakedDrawCall> baked_calls;
+  baked_calls.reserve(calls.size());
+  for (const auto& call : calls) {
+    BakedDrawCall baked = {};
+    baked.topology = static_cast<uint32_t>(call->GetTopology());
+    baked.base_color_image = kNoIndex;
+    baked.base_color_sampler = kNoIndex;
+    call->GetImageSampler(TextureType::kTextureTypeBaseColor,
+                          [&](auto image, auto sampler) -> void {
+                            baked.base_color_image = image_indices.at(image);
+                            baked.base_color_sampler =
+                                sampler_indices.at(sampler);
+                          });
+    baked.vertices_size = call->GetVertexData().GetSize();
+    baked.vertices_offset = allocate_blob(baked.vertices_size);
+    baked_calls.push_back(baked);
+  }
+  for (size_t i = 0; i < calls.size(); i++) {
+    baked_calls[i].indices_size = calls[i]->GetIndexData().GetSize();
+    baked_calls[i].indices_offset = allocate_blob(baked_calls[i].indices_size);
+  }
+
+  std::vector<BakedImage> baked_images;
+  baked_images.reserve(images.size());
+  for (const auto image : images) {
+    if (!image->pixels || image->pixels->GetData() == nullptr) {
+      P_ERROR << "Could not bake an image that could not be decoded.";
+      return false;
+    }
+    BakedImage baked = {};
+    baked.width = static_cast<uint32_t>(image->width);
+    baked.height = static_cast<uint32_t>(image->height);
+    baked.components = static_cast<uint32_t>(image->components);
+    baked.bits_per_component = static_cast<uint32_t>(image->bits_per_component);
+    baked.pixel_type = image->pixel_type;
+    baked.pixels_size = image->pixels->GetSize();
+    baked.pixels_offset = allocate_blob(baked.pixels_size);
+    baked_images.push_back(baked);
+  }
+
+  std::vector<BakedSampler> baked_samplers;
+  baked_samplers.reserve(samplers.size());
+  for (const auto sampler : samplers) {
+    const auto& info = sampler->GetSamplerInfo();
+    baked_samplers.push_back({
+        .min_filter = static_cast<uint32_t>(info.min_filter),
+        .mag_filter = static_cast<uint32_t>(info.mag_filter),
+        .mipmap_mode = static_cast<uint32_t>(info.mipmap_mode),
+        .wrap_s = static_cast<uint32_t>(info.wrap_s),
+        .wrap_t = static_cast<uint32_t>(info.wrap_t),
+        .wrap_r = static_cast<uint32_t>(info.wrap_r),
+    });
+  }
+
+  BakedModelHeader header = {};
+  ::memcpy(header.magic, kBakedModelMagic, sizeof(kBakedModelMagic));
+  header.version = kBakedModelVersion;
+  header.vertex_size = sizeof(ModelDrawCall::VertexValueType);
+  header.index_size = sizeof(ModelDrawCall::IndexValueType);
+  header.draw_call_count = static_cast<uint32_t>(calls.size());
+  header.source_hash_low = source_hash.low;
+  header.source_hash_high = source_hash.high;
+  header.file_size = blob_offset;
+  header.image_count = static_cast<uint32_t>(images.size());
+  header.sampler_count = static_cast<uint32_t>(samplers.size());
+
+  // A crash can at worst leave an empty file, which is rejected on load.
+  AtomicFileWriter file(GetBakedModelPath(source_hash), false);
+  BakedModelWriter writer(file);
+  bool written =
+      file.IsValid() && writer.WriteAt(0u, &header, sizeof(header)) &&
+      writer.WriteAt(layout.draw_calls_offset, baked_calls.data(),
+                     baked_calls.size() * sizeof(BakedDrawCall)) &&
+      writer.WriteAt(layout.images_offset, baked_images.data(),
+                     baked_images.size() * sizeof(BakedImage)) &&
+      writer.WriteAt(layout.samplers_offset, baked_samplers.data(),
+                     baked_samplers.size() * sizeof(BakedSampler));
+  for (size_t i = 0; written && i < calls.size(); i++) {
+    written = writer.WriteAt(baked_calls[i].vertices_offset,
+                             calls[i]->GetVertexData().GetData(),
+                             baked_calls[i].vertices_size);
+  }
+  for (size_t i = 0; written && i < calls.size(); i++) {
+    written = writer.WriteAt(baked_calls[i].indices_offset,
+                             calls[i]->GetIndexData().GetData(),
+                             baked_calls[i].indices_size);
+  }
+  for (size_t i = 0; written && i < images.size(); i++) {
+    written = writer.WriteAt(baked_images[i].pixels_offset,
+                             images[i]->pixels->GetData(),
+                             baked_images[i].pixels_size);
+  }
+  written = written && writer.PadTo(blob_offset) && file.Commit();
+  if (!written) {
+    P_ERROR << "Could not store baked model for " << draw_data.GetDebugName();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace model
+}  // namespace pixel
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "content_hash.h"
+#include "macros.h"
+#include "model_draw_data.h"
+
+namespace pixel {
+namespace model {
+
+//------------------------------------------------------------------------------
+/// @brief      Baked models on disk keyed by the content hash of the assets
+///             they were created from.
+///
+///             A baked model is the draw data of a model in a single file. It
+///             holds the vertices and indices of the draw calls, the decoded
+///             texels of their images and the parameters of their samplers.
+///             All tables and blobs in the file are 64-byte aligned so that
+///             the draw data can be backed by a mapping of the file directly.
+///             Loading a baked model does not parse the asset or decode any
+///             of its images.
+///
+///             Baked models are in the byte order and vertex layout of the
+///             machine that baked them. Files with a different version or
+///             layout are ignored and replaced by the next store.
+///
+class ModelCache {
+ public:
+  static std::shared_ptr<ModelCache> GetGlobal();
+
+  //----------------------------------------------------------------------------
+  /// @brief      Create a cache in the directory. The directory is created if
+  ///             it does not exist.
+  ///
+  ModelCache(std::filesystem::path directory);
+
+  ~ModelCache();
+
+  bool IsValid() const;
+
+  std::filesystem::path GetBakedModelPath(const Hash128& source_hash) const;
+
+  //----------------------------------------------------------------------------
+  /// @brief      Map the baked model for the source. The draw calls and images
+  ///             of the draw data refer to the mapping, so uploads to the
+  ///             device are made straight from the file.
+  ///
+  /// @return     The draw data or null if there is no usable baked model for
+  ///             the source.
+  ///
+  std::unique_ptr<ModelDrawData> Load(const Hash128& source_hash,
+                                      std::string debug_name) const;
+
+  //----------------------------------------------------------------------------
+  /// @brief      Bake the draw data and replace the baked model for the
+  ///             source. May be called on any thread. This waits for images
+  ///             that are still being decoded, so callers that must not block
+  ///             should call it from `ModelDrawData::OnImagesDecoded`.
+  ///
+  bool Store(const Hash128& source_hash, const ModelDrawData& draw_data) const;
+
+ private:
+  const std::filesystem::path directory_;
+  bool is_valid_ = false;
+
+  P_DISALLOW_COPY_AND_ASSIGN(ModelCache);
+};
+
+}  // namespace model
+}  // namespace pixel
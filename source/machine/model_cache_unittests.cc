@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <string>
+
+#include "asset_loader.h"
+#include "assets_location.h"
+#include "model.h"
+#include "model_cache.h"
+#include "scoped_temp_directory.h"
+
+namespace pixel {
+namespace model {
+namespace test {
+
+static std::unique_ptr<ModelDrawData> LoadDamagedHelmet() {
+  AssetLoader loader;
+
+  std::promise<std::unique_ptr<Asset>> asset_promise;
+  auto future = asset_promise.get_future();
+
+  loader.LoadAsset(PIXEL_GLTF_MODELS_LOCATION "/DamagedHelmet/glTF",
+                   "DamagedHelmet.gltf",
+                   [promise = std::move(asset_promise)](auto asset) mutable {
+                     promise.set_value(std::move(asset));
+                   });
+
+  auto asset = future.get();
+  if (!asset) {
+    return nullptr;
+  }
+  Model model(*asset);
+  return model.CreateDrawData("DamagedHelmet");
+}
+
+static bool MappingsAreEqual(const Mapping& lhs, const Mapping& rhs) {
+  return lhs.GetSize() == rhs.GetSize() &&
+         (lhs.GetSize() == 0u ||
+          ::memcmp(lhs.GetData(), rhs.GetData(), lhs.GetSize()) == 0);
+}
+
+TEST(ModelCacheTest, CanRoundTripBakedModel) {
+  auto draw_data = LoadDamagedHelmet();
+  ASSERT_TRUE(draw_data);
+  ASSERT_FALSE(draw_data->GetDrawCalls().empty());
+
+  ScopedTempDirectory directory("pixel_model_cache");
+  ASSERT_TRUE(directory.IsValid());
+  ModelCache cache(directory.GetPath() / "models");
+  ASSERT_TRUE(cache.IsValid());
+  const Hash128 source_hash = {.low = 1u, .high = 2u};
+  ASSERT_FALSE(cache.Load(source_hash, "Baked"));
+  ASSERT_TRUE(cache.Store(source_hash, *draw_data));
+
+  auto baked = cache.Load(source_hash, "Baked");
+  ASSERT_TRUE(baked);
+  ASSERT_EQ(baked->GetDebugName(), "Baked");
+  const auto& calls = draw_data->GetDrawCalls();
+  const auto& baked_calls = baked->GetDrawCalls();
+  ASSERT_EQ(baked_calls.size(), calls.size());
+  for (size_t i = 0; i < calls.size(); i++) {
+    ASSERT_EQ(baked_calls[i]->GetTopology(), calls[i]->GetTopology());
+    ASSERT_EQ(baked_calls[i]->GetVertexCount(), calls[i]->GetVertexCount());
+    ASSERT_EQ(baked_calls[i]->GetIndexCount(), calls[i]->GetIndexCount());
+    ASSERT_TRUE(MappingsAreEqual(baked_calls[i]->GetVertexData(),
+                                 calls[i]->GetVertexData()));
+    ASSERT_TRUE(MappingsAreEqual(baked_calls[i]->GetIndexData(),
+                                 calls[i]->GetIndexData()));
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(
+                  baked_calls[i]->GetVertexData().GetData()) %
+                  64u,
+              0u);
+
+    std::shared_ptr<Image> image, baked_image;
+    std::shared_ptr<Sampler> sampler, baked_sampler;
+    calls[i]->GetImageSampler(TextureType::kTextureTypeBaseColor,
+                              [&](auto found_image, auto found_sampler) {
+                                image = found_image;
+                                sampler = found_sampler;
+                              });
+    baked_calls[i]->GetImageSampler(TextureType::kTextureTypeBaseColor,
+                                    [&](auto found_image, auto found_sampler) {
+                                      baked_image = found_image;
+                                      baked_sampler = found_sampler;
+                                    });
+    ASSERT_EQ(!!image, !!baked_image);
+    if (!image) {
+      continue;
+    }
+    const auto& decoded = image->GetDecodedImage();
+    const auto& baked_decoded = baked_image->GetDecodedImage();
+    ASSERT_EQ(baked_decoded.width, decoded.width);
+    ASSERT_EQ(baked_decoded.height, decoded.height);
+    ASSERT_EQ(baked_decoded.components, decoded.components);
+    ASSERT_EQ(baked_decoded.bits_per_component, decoded.bits_per_component);
+    ASSERT_EQ(baked_decoded.pixel_type, decoded.pixel_type);
+    ASSERT_TRUE(MappingsAreEqual(*baked_decoded.pixels, *decoded.pixels));
+
+    const auto& info = sampler->GetSamplerInfo();
+    const auto& baked_info = baked_sampler->GetSamplerInfo();
+    ASSERT_EQ(baked_info.min_filter, info.min_filter);
+    ASSERT_EQ(baked_info.mag_filter, info.mag_filter);
+    ASSERT_EQ(baked_info.mipmap_mode, info.mipmap_mode);
+    ASSERT_EQ(baked_info.wrap_s, info.wrap_s);
+    ASSERT_EQ(baked_info.wrap_t, info.wrap_t);
+    ASSERT_EQ(baked_info.wrap_r, info.wrap_r);
+  }
+}
+
+TEST(ModelCacheTest, BakedModelsAreKeyedBySource) {
+  auto draw_data = LoadDamagedHelmet();
+  ASSERT_TRUE(draw_data);
+
+  ScopedTempDirectory directory("pixel_model_cache");
+  ASSERT_TRUE(directory.IsValid());
+  ModelCache cache(directory.GetPath() / "models");
+  const Hash128 source_hash = {.low = 1u, .high = 2u};
+  const Hash128 other_hash = {.low = 2u, .high = 1u};
+  ASSERT_TRUE(cache.Store(source_hash, *draw_data));
+  ASSERT_TRUE(cache.Load(source_hash, "Baked"));
+  ASSERT_FALSE(cache.Load(other_hash, "Baked"));
+
+  // A file renamed to the key of another source is not used for it.
+  std::filesystem::rename(cache.GetBakedModelPath(source_hash),
+                          cache.GetBakedModelPath(other_hash));
+  ASSERT_FALSE(cache.Load(other_hash, "Baked"));
+}
+
+TEST(ModelCacheTest, TruncatedBakedModelsAreRejected) {
+  auto draw_data = LoadDamagedHelmet();
+  ASSERT_TRUE(draw_data);
+
+  ScopedTempDirectory directory("pixel_model_cache");
+  ASSERT_TRUE(directory.IsValid());
+  ModelCache cache(directory.GetPath() / "models");
+  const Hash128 source_hash = {.low = 1u, .high = 2u};
+  ASSERT_TRUE(cache.Store(source_hash, *draw_data));
+  const auto path = cache.GetBakedModelPath(source_hash);
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) / 2u);
+  ASSERT_FALSE(cache.Load(source_hash, "Baked"));
+  std::filesystem::resize_file(path, 0u);
+  ASSERT_FALSE(cache.Load(source_hash, "Baked"));
+}
+
+}  // namespace test
+}  // namespace model
+}  // namespace pixel
@@ -1,8 +1,11 @@
 #include "model_draw_data.h"
 
+#include <algorithm>
+
 #include "pipeline_builder.h"
 #include "pipeline_layout.h"
 #include "string_utils.h"
+#include "trace_event.h"
 
 namespace pixel {
 namespace model {
@@ -11,14 +14,21 @@ namespace model {
 // *** ModelDrawCall
 // *****************************************************************************
 
-ModelDrawCall::ModelDrawCall(
-    vk::PrimitiveTopology topology,
-    std::vector<uint32_t> indices,
-    std::vector<pixel::shaders::model_renderer::Vertex> vertices,
-    ModelTextureMap textures)
+static std::shared_ptr<const Mapping> EmptyIfNull(
+    std::shared_ptr<const Mapping> mapping) {
+  if (mapping) {
+    return mapping;
+  }
+  return UnownedMapping(nullptr, 0u);
+}
+
+ModelDrawCall::ModelDrawCall(vk::PrimitiveTopology topology,
+                             std::shared_ptr<const Mapping> indices,
+                             std::shared_ptr<const Mapping> vertices,
+                             ModelTextureMap textures)
     : topology_(topology),
-      indices_(std::move(indices)),
-      vertices_(std::move(vertices)),
+      indices_(EmptyIfNull(std::move(indices))),
+      vertices_(EmptyIfNull(std::move(vertices))),
       textures_(std::move(textures)) {}
 
 ModelDrawCall::~ModelDrawCall() = default;
@@ -27,13 +37,20 @@ vk::PrimitiveTopology ModelDrawCall::GetTopology() const {
   return topology_;
 }
 
-const std::vector<uint32_t>& ModelDrawCall::GetIndices() const {
-  return indices_;
+size_t ModelDrawCall::GetIndexCount() const {
+  return indices_->GetSize() / sizeof(IndexValueType);
+}
+
+size_t ModelDrawCall::GetVertexCount() const {
+  return vertices_->GetSize() / sizeof(VertexValueType);
 }
 
-const std::vector<pixel::shaders::model_renderer::Vertex>&
-ModelDrawCall::GetVertices() const {
-  return vertices_;
+const Mapping& ModelDrawCall::GetIndexData() const {
+  return *indices_;
+}
+
+const Mapping& ModelDrawCall::GetVertexData() const {
+  return *vertices_;
 }
 
 const ModelTextureMap& ModelDrawCall::GetTextures() const {
@@ -71,6 +88,14 @@ ModelDrawCallBuilder& ModelDrawCallBuilder::SetTopology(
 ModelDrawCallBuilder& ModelDrawCallBuilder::SetIndices(
     std::vector<uint32_t> indices) {
   indices_ = std::move(indices);
+  index_data_ = nullptr;
+  return *this;
+}
+
+ModelDrawCallBuilder& ModelDrawCallBuilder::SetIndexData(
+    std::shared_ptr<const Mapping> indices) {
+  index_data_ = std::move(indices);
+  indices_.clear();
   return *this;
 }
 
@@ -88,10 +113,24 @@ ModelDrawCallBuilder& ModelDrawCallBuilder::SetTexture(
   return *this;
 }
 
+template <class T>
+static std::shared_ptr<const Mapping> AdoptVector(std::vector<T> vector) {
+  auto owned = std::make_shared<std::vector<T>>(std::move(vector));
+  const auto data = reinterpret_cast<const uint8_t*>(owned->data());
+  const auto size = owned->size() * sizeof(T);
+  // The vector is released along with the mapping.
+  return UnownedMapping(data, size, [owned]() {});
+}
+
 std::shared_ptr<ModelDrawCall> ModelDrawCallBuilder::CreateDrawCall() {
-  return std::make_shared<ModelDrawCall>(topology_, std::move(indices_),
-                                         std::move(vertices_),
-                                         std::move(textures_));
+  auto indices =
+      index_data_ ? std::move(index_data_) : AdoptVector(std::move(indices_));
+  return std::make_shared<ModelDrawCall>(
+      topology_,                          //
+      std::move(indices),                 //
+      AdoptVector(std::move(vertices_)),  //
+      std::move(textures_)                //
+  );
 }
 
 // *****************************************************************************
@@ -102,6 +141,7 @@ ModelDeviceContext::ModelDeviceContext(
     std::shared_ptr<RenderingContext> context,
     std::unique_ptr<pixel::Buffer> vertex_buffer,
     std::unique_ptr<pixel::Buffer> index_buffer,
+    std::vector<UploadStatus> buffer_uploads,
     std::vector<ModelDeviceDrawData> draw_data,
     std::vector<vk::UniqueSampler> samplers,
     std::vector<std::unique_ptr<pixel::ImageView>> image_views,
@@ -111,6 +151,7 @@ ModelDeviceContext::ModelDeviceContext(
       draw_data_(std::move(draw_data)),
       vertex_buffer_(std::move(vertex_buffer)),
       index_buffer_(std::move(index_buffer)),
+      buffer_uploads_(std::move(buffer_uploads)),
       samplers_(std::move(samplers)),
       image_views_(std::move(image_views)) {
   for (const auto& draw_call : draw_data_) {
@@ -162,6 +203,15 @@ bool ModelDeviceContext::IsValid() const {
   return is_valid_;
 }
 
+bool ModelDeviceContext::IsGeometryResident() const {
+  if (!placeholder_image_upload_ || !*placeholder_image_upload_) {
+    return false;
+  }
+
+  return std::all_of(buffer_uploads_.begin(), buffer_uploads_.end(),
+                     [](const auto& upload) { return *upload; });
+}
+
 bool ModelDeviceContext::CreatePlaceholders() {
   placeholder_sampler_ =
       UnwrapResult(context_->GetDevice().createSamplerUnique({}));
@@ -191,6 +241,7 @@ bool ModelDeviceContext::CreatePlaceholders() {
   };
 
   auto data = std::make_shared<uint32_t>(~0u);
+  placeholder_image_upload_ = std::make_shared<bool>(false);
   auto image = context_->GetMemoryAllocator().CreateDeviceLocalImageCopy(
       image_info,                          // info
       data.get(),                          // data
@@ -200,7 +251,10 @@ bool ModelDeviceContext::CreatePlaceholders() {
       nullptr,                             // wait sema
       nullptr,                             // wait stages
       nullptr,                             // signal sema
-      [data]() mutable { data.reset(); }   // on done
+      [data, upload = placeholder_image_upload_]() mutable {
+        data.reset();
+        *upload = true;
+      }  // on done
   );
 
   if (!image) {
@@ -502,7 +556,7 @@ bool ModelDeviceContext::Render(vk::CommandBuffer buffer) {
     return false;
   }
 
-  if (draw_data_.empty()) {
+  if (draw_data_.empty() || !IsGeometryResident()) {
     return true;
   }
 
@@ -536,7 +590,7 @@ bool ModelDeviceContext::Render(vk::CommandBuffer buffer) {
     std::vector<vk::DescriptorSet> descriptor_sets;
     descriptor_sets.push_back(descriptor_sets_[uniform_index]);
 
-    if (draw.texture_image.has_value()) {
+    if (draw.texture_image.has_value() && *draw.texture_image_upload) {
       descriptor_sets.push_back(
           sampler_descriptor_sets_.at(draw.texture_image.value()).get());
     } else {
@@ -593,13 +647,55 @@ bool ModelDrawData::AddDrawCall(std::shared_ptr<ModelDrawCall> draw_call) {
   return true;
 }
 
+const std::string& ModelDrawData::GetDebugName() const {
+  return debug_name_;
+}
+
+const std::vector<std::shared_ptr<const ModelDrawCall>>&
+ModelDrawData::GetDrawCalls() const {
+  return draw_calls_;
+}
+
+size_t ModelDrawData::GetSizeInBytes() const {
+  size_t size = 0;
+  std::set<const Image*> images;
+  for (const auto& call : draw_calls_) {
+    size += call->GetVertexData().GetSize() + call->GetIndexData().GetSize();
+    for (const auto& texture : call->GetTextures()) {
+      const auto& image = texture.second.first;
+      if (!image || !images.insert(image.get()).second) {
+        continue;
+      }
+      size += image->GetSizeInBytes();
+    }
+  }
+  return size;
+}
+
+void ModelDrawData::OnImagesDecoded(UniqueClosure callback) const {
+  // Images shared by draw calls are listed more than once, which is harmless.
+  std::vector<std::shared_ptr<DeferredImage>> images;
+  for (const auto& call : draw_calls_) {
+    for (const auto& texture : call->GetTextures()) {
+      if (const auto& image = texture.second.first) {
+        images.push_back(image->GetDeferredImage());
+      }
+    }
+  }
+  OnAllDecoded(images, std::move(callback));
+}
+
+static std::function<void(void)> MarkUploadDone(UploadStatus upload) {
+  return [upload = std::move(upload)]() { *upload = true; };
+}
+
 std::unique_ptr<pixel::Buffer> ModelDrawData::CreateVertexBuffer(
-    const RenderingContext& context) const {
+    const RenderingContext& context,
+    UploadStatus upload) const {
   vk::DeviceSize vertex_buffer_size = 0;
   for (const auto& call : draw_calls_) {
-    const auto& vertices = call->GetVertices();
     vertex_buffer_size +=
-        vertices.size() * sizeof(ModelDrawCall::VertexValueType);
+        call->GetVertexCount() * sizeof(ModelDrawCall::VertexValueType);
   }
 
   auto copy_callback = [&](uint8_t* staging_buffer,
@@ -610,12 +706,11 @@ std::unique_ptr<pixel::Buffer> ModelDrawData::CreateVertexBuffer(
 
     size_t current_size = 0;
     for (const auto& call : draw_calls_) {
-      const auto& vertices = call->GetVertices();
       const size_t copy_size =
-          vertices.size() * sizeof(ModelDrawCall::VertexValueType);
-      ::memcpy(staging_buffer + current_size,  //
-               vertices.data(),                //
-               copy_size                       //
+          call->GetVertexCount() * sizeof(ModelDrawCall::VertexValueType);
+      ::memcpy(staging_buffer + current_size,    //
+               call->GetVertexData().GetData(),  //
+               copy_size                         //
       );
       current_size += copy_size;
     }
@@ -632,16 +727,17 @@ std::unique_ptr<pixel::Buffer> ModelDrawData::CreateVertexBuffer(
       nullptr,                                                  //
       nullptr,                                                  //
       nullptr,                                                  //
-      nullptr                                                   //
+      MarkUploadDone(std::move(upload))                         //
   );
 }
 
 std::unique_ptr<pixel::Buffer> ModelDrawData::CreateIndexBuffer(
-    const RenderingContext& context) const {
+    const RenderingContext& context,
+    UploadStatus upload) const {
   vk::DeviceSize index_buffer_size = 0;
   for (const auto& call : draw_calls_) {
-    const auto& indices = call->GetIndices();
-    index_buffer_size += indices.size() * sizeof(ModelDrawCall::IndexValueType);
+    index_buffer_size +=
+        call->GetIndexCount() * sizeof(ModelDrawCall::IndexValueType);
   }
 
   auto copy_callback = [&](uint8_t* staging_buffer,
@@ -652,12 +748,11 @@ std::unique_ptr<pixel::Buffer> ModelDrawData::CreateIndexBuffer(
 
     size_t current_size = 0;
     for (const auto& call : draw_calls_) {
-      const auto& indices = call->GetIndices();
       const size_t copy_size =
-          indices.size() * sizeof(ModelDrawCall::IndexValueType);
-      ::memcpy(staging_buffer + current_size,  //
-               indices.data(),                 //
-               copy_size                       //
+          call->GetIndexCount() * sizeof(ModelDrawCall::IndexValueType);
+      ::memcpy(staging_buffer + current_size,   //
+               call->GetIndexData().GetData(),  //
+               copy_size                        //
       );
       current_size += copy_size;
     }
@@ -674,12 +769,11 @@ std::unique_ptr<pixel::Buffer> ModelDrawData::CreateIndexBuffer(
       nullptr,                                                 //
       nullptr,                                                 //
       nullptr,                                                 //
-      nullptr                                                  //
+      MarkUploadDone(std::move(upload))                        //
   );
 }
 
-std::optional<
-    std::map<std::shared_ptr<Image>, std::unique_ptr<pixel::ImageView>>>
+std::optional<std::map<std::shared_ptr<Image>, ModelDrawData::DeviceImage>>
 ModelDrawData::CreateImages(std::shared_ptr<RenderingContext> context) const {
   std::set<std::shared_ptr<Image>> images;
   for (const auto& call : draw_calls_) {
@@ -688,10 +782,12 @@ ModelDrawData::CreateImages(std::shared_ptr<RenderingContext> context) const {
     }
   }
 
-  std::map<std::shared_ptr<Image>, std::unique_ptr<pixel::ImageView>> result;
+  std::map<std::shared_ptr<Image>, DeviceImage> result;
   for (const auto& image : images) {
-    if (auto image_view = image->CreateImageView(*context)) {
-      result[image] = std::move(image_view);
+    auto upload = std::make_shared<bool>(false);
+    if (auto image_view = image->CreateImageView(*context,
+                                                 MarkUploadDone(upload))) {
+      result[image] = {std::move(image_view), std::move(upload)};
     } else {
       return std::nullopt;
     }
@@ -731,12 +827,25 @@ std::vector<T> MapValues(std::map<Ignored, T> map) {
 
 std::unique_ptr<ModelDeviceContext> ModelDrawData::CreateModelDeviceContext(
     std::shared_ptr<RenderingContext> context) const {
+  P_TRACE_EVENT("model", "CreateModelDeviceContext");
   if (!context || !context->IsValid()) {
     return nullptr;
   }
 
-  auto vertex_buffer = CreateVertexBuffer(*context);
-  auto index_buffer = CreateIndexBuffer(*context);
+  std::vector<UploadStatus> buffer_uploads;
+
+  auto vertex_upload = std::make_shared<bool>(false);
+  auto vertex_buffer = CreateVertexBuffer(*context, vertex_upload);
+  if (vertex_buffer) {
+    buffer_uploads.emplace_back(std::move(vertex_upload));
+  }
+
+  auto index_upload = std::make_shared<bool>(false);
+  auto index_buffer = CreateIndexBuffer(*context, index_upload);
+  if (index_buffer) {
+    buffer_uploads.emplace_back(std::move(index_upload));
+  }
+
   auto samplers = CreateSamplers(context);
   auto images = CreateImages(context);
 
@@ -758,35 +867,44 @@ std::unique_ptr<ModelDeviceContext> ModelDrawData::CreateModelDeviceContext(
     data.topology = call->GetTopology();
     data.vertex_buffer_offset = vertex_buffer_offset;
     data.index_buffer_offset = index_buffer_offset;
-    data.vertex_count = call->GetVertices().size();
-    data.index_count = call->GetIndices().size();
+    data.vertex_count = call->GetVertexCount();
+    data.index_count = call->GetIndexCount();
 
     call->GetImageSampler(TextureType::kTextureTypeBaseColor,
                           [&](auto image, auto sampler) -> void {
                             // Using at here is fine because we just iterated
                             // over these calls to resolve the images and
                             // samplers.
+                            const auto& device_image = images.value().at(image);
                             data.texture_image = {
                                 samplers.value().at(sampler).get(),
-                                images.value().at(image).get()->GetImageView(),
+                                device_image.image_view->GetImageView(),
                             };
+                            data.texture_image_upload = device_image.upload;
                           });
 
     vertex_buffer_offset +=
-        call->GetVertices().size() * sizeof(ModelDrawCall::VertexValueType);
+        call->GetVertexCount() * sizeof(ModelDrawCall::VertexValueType);
     index_buffer_offset +=
-        call->GetIndices().size() * sizeof(ModelDrawCall::IndexValueType);
+        call->GetIndexCount() * sizeof(ModelDrawCall::IndexValueType);
 
     draw_data.push_back(data);
   }
 
+  std::vector<std::unique_ptr<pixel::ImageView>> image_views;
+  image_views.reserve(images.value().size());
+  for (auto& image : images.value()) {
+    image_views.emplace_back(std::move(image.second.image_view));
+  }
+
   auto device_context = std::make_unique<ModelDeviceContext>(
       context,                                 //
       std::move(vertex_buffer),                //
       std::move(index_buffer),                 //
+      std::move(buffer_uploads),               //
       std::move(draw_data),                    //
       MapValues(std::move(samplers.value())),  //
-      MapValues(std::move(images.value())),    //
+      std::move(image_views),                  //
       debug_name_                              //
   );
 
@@ -794,9 +912,6 @@ std::unique_ptr<ModelDeviceContext> ModelDrawData::CreateModelDeviceContext(
     return nullptr;
   }
 
-  // TODO: Remove this and add fence waits.
-  context->GetDevice().waitIdle();
-
   return device_context;
 }
 
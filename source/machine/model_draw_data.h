@@ -1,5 +1,6 @@
 #pragma once
 
+#include <coroutine>
 #include <functional>
 #include <map>
 #include <memory>
@@ -7,6 +8,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "closure.h"
 #include "image.h"
 #include "macros.h"
 #include "mapping.h"
@@ -22,6 +24,13 @@
 namespace pixel {
 namespace model {
 
+//------------------------------------------------------------------------------
+/// @brief      Set once an upload to the device is complete. Uploads complete
+///             on the loop of the thread that started them and the status may
+///             only be read on that thread.
+///
+using UploadStatus = std::shared_ptr<bool>;
+
 using ModelTextureMap =
     std::map<TextureType,
              std::pair<std::shared_ptr<Image>, std::shared_ptr<Sampler>>>;
@@ -31,19 +40,28 @@ class ModelDrawCall {
   using VertexValueType = pixel::shaders::model_renderer::Vertex;
   using IndexValueType = uint32_t;
 
+  //----------------------------------------------------------------------------
+  /// @brief      Create a draw call whose indices and vertices are tightly
+  ///             packed `IndexValueType`s and `VertexValueType`s in the
+  ///             mappings. The mappings may be slices of a baked model file
+  ///             and need not be aligned.
+  ///
   ModelDrawCall(vk::PrimitiveTopology topology,
-                std::vector<uint32_t> indices,
-                std::vector<pixel::shaders::model_renderer::Vertex> vertices,
+                std::shared_ptr<const Mapping> indices,
+                std::shared_ptr<const Mapping> vertices,
                 ModelTextureMap textures);
 
   ~ModelDrawCall();
 
   vk::PrimitiveTopology GetTopology() const;
 
-  const std::vector<uint32_t>& GetIndices() const;
+  size_t GetIndexCount() const;
+
+  size_t GetVertexCount() const;
+
+  const Mapping& GetIndexData() const;
 
-  const std::vector<pixel::shaders::model_renderer::Vertex>& GetVertices()
-      const;
+  const Mapping& GetVertexData() const;
 
   const ModelTextureMap& GetTextures() const;
 
@@ -54,8 +72,8 @@ class ModelDrawCall {
 
  private:
   vk::PrimitiveTopology topology_;
-  std::vector<uint32_t> indices_;
-  std::vector<pixel::shaders::model_renderer::Vertex> vertices_;
+  std::shared_ptr<const Mapping> indices_;
+  std::shared_ptr<const Mapping> vertices_;
   ModelTextureMap textures_;
 
   P_DISALLOW_COPY_AND_ASSIGN(ModelDrawCall);
@@ -71,6 +89,12 @@ class ModelDrawCallBuilder {
 
   ModelDrawCallBuilder& SetIndices(std::vector<uint32_t> indices);
 
+  //----------------------------------------------------------------------------
+  /// @brief      Use tightly packed `ModelDrawCall::IndexValueType`s that are
+  ///             already in memory. The indices are not copied.
+  ///
+  ModelDrawCallBuilder& SetIndexData(std::shared_ptr<const Mapping> indices);
+
   ModelDrawCallBuilder& SetVertices(
       std::vector<pixel::shaders::model_renderer::Vertex> vertices);
 
@@ -83,6 +107,7 @@ class ModelDrawCallBuilder {
  private:
   vk::PrimitiveTopology topology_ = vk::PrimitiveTopology::eTriangleStrip;
   std::vector<uint32_t> indices_;
+  std::shared_ptr<const Mapping> index_data_;
   std::vector<pixel::shaders::model_renderer::Vertex> vertices_;
   ModelTextureMap textures_;
 
@@ -114,6 +139,8 @@ struct ModelDeviceDrawData {
   size_t index_count = 0;
   size_t vertex_count = 0;
   std::optional<ImageSampler> texture_image = {};
+  // The placeholder image is used till the texture image is uploaded.
+  UploadStatus texture_image_upload = {};
 };
 
 class ModelDeviceContext {
@@ -121,6 +148,7 @@ class ModelDeviceContext {
   ModelDeviceContext(std::shared_ptr<RenderingContext> context,
                      std::unique_ptr<pixel::Buffer> vertex_buffer,
                      std::unique_ptr<pixel::Buffer> index_buffer,
+                     std::vector<UploadStatus> buffer_uploads,
                      std::vector<ModelDeviceDrawData> draw_data,
                      std::vector<vk::UniqueSampler> samplers,
                      std::vector<std::unique_ptr<pixel::ImageView>> image_views,
@@ -130,10 +158,17 @@ class ModelDeviceContext {
 
   UniformBuffer<shaders::model_renderer::UniformBuffer>& GetUniformBuffer();
 
+  //----------------------------------------------------------------------------
+  /// @brief      Nothing is rendered till the vertex and index buffers are
+  ///             uploaded. Draw calls whose texture images are still being
+  ///             uploaded are rendered with a placeholder image.
+  ///
   bool Render(vk::CommandBuffer buffer);
 
   bool IsValid() const;
 
+  bool IsGeometryResident() const;
+
  private:
   std::shared_ptr<RenderingContext> context_;
   const std::string debug_name_;
@@ -144,6 +179,7 @@ class ModelDeviceContext {
   vk::UniquePipelineLayout pipeline_layout_;
   std::unique_ptr<pixel::Buffer> vertex_buffer_;
   std::unique_ptr<pixel::Buffer> index_buffer_;
+  std::vector<UploadStatus> buffer_uploads_;
   UniformBuffer<shaders::model_renderer::UniformBuffer> uniform_buffer_;
   DescriptorSets descriptor_sets_;
   std::set<vk::PrimitiveTopology> required_topologies_;
@@ -158,6 +194,7 @@ class ModelDeviceContext {
   vk::UniqueSampler placeholder_sampler_;
   std::unique_ptr<ImageView> placeholder_image_view_;
   vk::UniqueDescriptorSet placeholder_image_descriptor_set_;
+  UploadStatus placeholder_image_upload_;
   bool is_valid_ = false;
 
   bool CreatePlaceholders();
@@ -189,6 +226,54 @@ class ModelDrawData {
 
   bool AddDrawCall(std::shared_ptr<ModelDrawCall> draw_call);
 
+  const std::string& GetDebugName() const;
+
+  const std::vector<std::shared_ptr<const ModelDrawCall>>& GetDrawCalls() const;
+
+  //----------------------------------------------------------------------------
+  /// @brief      The size of the vertices, indices and decoded texels of the
+  ///             draw calls. Images shared by draw calls are counted once.
+  ///             Images that are still being decoded are sized from their
+  ///             headers without waiting for them.
+  ///
+  size_t GetSizeInBytes() const;
+
+  //----------------------------------------------------------------------------
+  /// @brief      Invoke the callback once the images of the draw calls have
+  ///             been decoded. The callback is invoked on the worker that
+  ///             decoded the last image, or right away on the calling thread
+  ///             if all of them already have been.
+  ///
+  void OnImagesDecoded(UniqueClosure callback) const;
+
+  struct ImagesDecodedAwaiter {
+    const ModelDrawData* draw_data = nullptr;
+
+    bool await_ready() const { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+      draw_data->OnImagesDecoded([handle]() { handle.resume(); });
+    }
+
+    void await_resume() const {}
+  };
+
+  //----------------------------------------------------------------------------
+  /// @brief      Returns an awaitable that resumes the awaiting coroutine once
+  ///             the images of the draw calls have been decoded. See
+  ///             `OnImagesDecoded`.
+  ///
+  ImagesDecodedAwaiter ImagesDecoded() const {
+    return ImagesDecodedAwaiter{this};
+  }
+
+  //----------------------------------------------------------------------------
+  /// @brief      Create the device context and start uploading the model to
+  ///             the device. This does not wait for the uploads to finish. The
+  ///             context must be created on a thread with an event loop. Images
+  ///             that are still being decoded are waited for, so await
+  ///             `ImagesDecoded` first on threads that must not block.
+  ///
   std::unique_ptr<ModelDeviceContext> CreateModelDeviceContext(
       std::shared_ptr<RenderingContext> context) const;
 
@@ -196,15 +281,21 @@ class ModelDrawData {
   std::string debug_name_;
   std::vector<std::shared_ptr<const ModelDrawCall>> draw_calls_;
 
+  struct DeviceImage {
+    std::unique_ptr<pixel::ImageView> image_view;
+    UploadStatus upload;
+  };
+
   std::unique_ptr<pixel::Buffer> CreateVertexBuffer(
-      const RenderingContext& context) const;
+      const RenderingContext& context,
+      UploadStatus upload) const;
 
   std::unique_ptr<pixel::Buffer> CreateIndexBuffer(
-      const RenderingContext& context) const;
+      const RenderingContext& context,
+      UploadStatus upload) const;
 
-  std::optional<
-      std::map<std::shared_ptr<Image>, std::unique_ptr<pixel::ImageView>>>
-  CreateImages(std::shared_ptr<RenderingContext> context) const;
+  std::optional<std::map<std::shared_ptr<Image>, DeviceImage>> CreateImages(
+      std::shared_ptr<RenderingContext> context) const;
 
   std::optional<std::map<std::shared_ptr<Sampler>, vk::UniqueSampler>>
   CreateSamplers(std::shared_ptr<RenderingContext> context) const;
@@ -1,50 +1,66 @@
 #include "model_renderer.h"
 
 #include <algorithm>
-#include <future>
 
 #include <imgui.h>
 
+#include "event_loop.h"
 #include "pipeline_builder.h"
 #include "pipeline_layout.h"
 #include "string_utils.h"
 
 namespace pixel {
 
-ModelRenderer::ModelRenderer(std::shared_ptr<RenderingContext> context,
-                             std::string model_assets_dir,
-                             std::string model_path,
-                             std::string debug_name)
-    : Renderer(context), debug_name_(std::move(debug_name)) {
-  std::promise<std::unique_ptr<model::ModelDrawData>> model_draw_data_promise;
-  auto model_draw_data_future = model_draw_data_promise.get_future();
-  AssetLoader::GetGlobal()->LoadAsset(
-      model_assets_dir, model_path,
-      MakeCopyable(
-          [promise = std::move(model_draw_data_promise),
-           debug_name = debug_name_](std::unique_ptr<Asset> asset) mutable {
-            if (!asset) {
-              promise.set_value(nullptr);
-              return;
-            }
-            auto model = std::make_unique<model::Model>(*asset);
-            auto draw_data = model->CreateDrawData(debug_name);
-            promise.set_value(std::move(draw_data));
-          }));
-  auto draw_data = model_draw_data_future.get();
+AsyncTask<> ModelRenderer::LoadModelDeviceContext(
+    std::shared_ptr<RenderingContext> context,
+    std::string model_assets_dir,
+    std::string model_path,
+    UnsharedWeak<ModelRenderer> weak_renderer) {
+  auto dispatcher = EventLoop::GetCurrentThreadDispatcher();
+
+  // The draw data is shared with all other renderers of the same model.
+  auto draw_data = co_await AssetLoader::GetGlobal()->AwaitModel(
+      std::move(model_assets_dir), std::move(model_path));
+
+  // Creating the device images must not block the thread of the renderer on
+  // image decodes.
+  if (draw_data) {
+    co_await draw_data->ImagesDecoded();
+  }
+
+  // Device resources are created on the thread of the renderer. The frame
+  // also holds a reference to the rendering context and must be collected on
+  // that thread.
+  if (!co_await dispatcher->Resume()) {
+    co_return;
+  }
+
   if (!draw_data) {
     P_ERROR << "Draw data was invalid.";
-    return;
+    co_return;
+  }
+
+  auto renderer = weak_renderer.get();
+  if (!renderer) {
+    co_return;
   }
 
   auto model_device_context = draw_data->CreateModelDeviceContext(context);
   if (!model_device_context || !model_device_context->IsValid()) {
     P_ERROR << "Could not create model device context.";
-    return;
+    co_return;
   }
 
-  model_device_context_ = std::move(model_device_context);
+  renderer->model_device_context_ = std::move(model_device_context);
+}
 
+ModelRenderer::ModelRenderer(std::shared_ptr<RenderingContext> context,
+                             std::string model_assets_dir,
+                             std::string model_path,
+                             std::string debug_name)
+    : Renderer(context),
+      debug_name_(std::move(debug_name)),
+      weak_factory_(this) {
   view_xformation_.SetInitialValue(glm::lookAt(
       glm::vec3(0.0f, 0.0f, -2.0f),  // eye
       glm::vec3(0.0f),               // center
@@ -52,6 +68,13 @@ ModelRenderer::ModelRenderer(std::shared_ptr<RenderingContext> context,
       ));
   view_xformation_.SetUpdateRate(0.01);
 
+  LoadModelDeviceContext(std::move(context),             //
+                         std::move(model_assets_dir),    //
+                         std::move(model_path),          //
+                         weak_factory_.CreateWeakPtr()   //
+                         )
+      .Detach();
+
   is_valid_ = true;
 }
 
@@ -83,6 +106,11 @@ bool ModelRenderer::RenderFrame(vk::CommandBuffer buffer) {
     return false;
   }
 
+  if (!model_device_context_) {
+    // Still loading.
+    return true;
+  }
+
   const auto now = std::chrono::high_resolution_clock::now();
 
   view_xformation_.UpdateSimulation(now);
@@ -2,15 +2,22 @@
 
 #include <chrono>
 
+#include "async_task.h"
 #include "macros.h"
 #include "matrix_simulation.h"
 #include "model.h"
 #include "model_draw_data.h"
 #include "renderer.h"
+#include "unshared_weak.h"
 #include "vulkan.h"
 
 namespace pixel {
 
+//------------------------------------------------------------------------------
+/// @brief      Renders a glTF model. The model is loaded asynchronously and
+///             nothing is rendered till its geometry is on the device.
+///             Textures are drawn as they finish uploading.
+///
 class ModelRenderer : public Renderer {
  public:
   ModelRenderer(std::shared_ptr<RenderingContext> context,
@@ -26,6 +33,13 @@ class ModelRenderer : public Renderer {
   std::unique_ptr<model::ModelDeviceContext> model_device_context_;
   MatrixSimulation view_xformation_;
   bool is_valid_ = false;
+  UnsharedWeakFactory<ModelRenderer> weak_factory_;
+
+  static AsyncTask<> LoadModelDeviceContext(
+      std::shared_ptr<RenderingContext> context,
+      std::string model_assets_dir,
+      std::string model_path,
+      UnsharedWeak<ModelRenderer> weak_renderer);
 
   // |Renderer|
   bool IsValid() const override;
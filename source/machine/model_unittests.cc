@@ -1,11 +1,13 @@
 #include <gtest/gtest.h>
 
+#include <cstring>
 #include <filesystem>
 #include <future>
 
 #include "asset_loader.h"
 #include "assets_location.h"
 #include "model.h"
+#include "model_draw_data.h"
 
 namespace pixel {
 namespace model {
@@ -22,10 +24,10 @@ TEST(ModelTest, CanLoadModelFromAsset) {
 
   loader.LoadAsset(
       base_dir, asset_file,
-      MakeCopyable([promise = std::move(asset_promise)](auto asset) mutable {
+      [promise = std::move(asset_promise)](auto asset) mutable {
         ASSERT_TRUE(asset);
         promise.set_value(std::move(asset));
-      }));
+      });
 
   auto asset = future.get();
   ASSERT_TRUE(asset);
@@ -36,6 +38,88 @@ TEST(ModelTest, CanLoadModelFromAsset) {
   ASSERT_EQ(model.GetScenes()[0]->GetNodes().size(), 1u);
 };
 
+// A triangle whose positions are followed by its indices in a single buffer.
+static Asset CreateIndexedTriangle(int index_component_type,
+                                   uint32_t last_index = 2u) {
+  const float positions[] = {0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+                             0.0f, 0.0f, 1.0f, 0.0f};
+  const size_t index_size =
+      index_component_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT ? 4u : 2u;
+  std::vector<uint8_t> data(sizeof(positions) + 3u * index_size);
+  ::memcpy(data.data(), positions, sizeof(positions));
+  const uint32_t indices[] = {0u, 1u, last_index};
+  for (size_t i = 0; i < 3u; i++) {
+    // Little endian.
+    ::memcpy(data.data() + sizeof(positions) + i * index_size, &indices[i],
+             index_size);
+  }
+
+  tinygltf::Model model;
+  model.buffers.resize(1u);
+  model.bufferViews.resize(2u);
+  model.bufferViews[0].buffer = 0;
+  model.bufferViews[0].byteLength = sizeof(positions);
+  model.bufferViews[1].buffer = 0;
+  model.bufferViews[1].byteOffset = sizeof(positions);
+  model.bufferViews[1].byteLength = 3u * index_size;
+  model.accessors.resize(2u);
+  model.accessors[0].bufferView = 0;
+  model.accessors[0].componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
+  model.accessors[0].type = TINYGLTF_TYPE_VEC3;
+  model.accessors[0].count = 3u;
+  model.accessors[1].bufferView = 1;
+  model.accessors[1].componentType = index_component_type;
+  model.accessors[1].type = TINYGLTF_TYPE_SCALAR;
+  model.accessors[1].count = 3u;
+  tinygltf::Primitive primitive;
+  primitive.attributes["POSITION"] = 0;
+  primitive.indices = 1;
+  primitive.mode = TINYGLTF_MODE_TRIANGLES;
+  model.meshes.resize(1u);
+  model.meshes[0].primitives.push_back(primitive);
+  model.nodes.resize(1u);
+  model.nodes[0].mesh = 0;
+  model.scenes.resize(1u);
+  model.scenes[0].nodes.push_back(0);
+
+  std::vector<std::shared_ptr<const Mapping>> buffer_data;
+  buffer_data.emplace_back(CopyMapping(data.data(), data.size()));
+  return Asset(std::move(model), std::move(buffer_data));
+}
+
+static std::vector<uint32_t> ReadIndices(const ModelDrawCall& call) {
+  std::vector<uint32_t> indices(call.GetIndexCount());
+  ::memcpy(indices.data(), call.GetIndexData().GetData(),
+           indices.size() * sizeof(uint32_t));
+  return indices;
+}
+
+TEST(ModelTest, IndicesAreUsedFromTheBufferWithoutCopying) {
+  auto asset = CreateIndexedTriangle(TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT);
+  auto draw_data = Model(asset).CreateDrawData("Triangle");
+  ASSERT_TRUE(draw_data);
+  ASSERT_EQ(draw_data->GetDrawCalls().size(), 1u);
+  const auto& call = *draw_data->GetDrawCalls()[0];
+  ASSERT_EQ(call.GetIndexCount(), 3u);
+  ASSERT_EQ(call.GetIndexData().GetData(),
+            asset.buffer_data[0]->GetData() + 9u * sizeof(float));
+  ASSERT_EQ(ReadIndices(call), (std::vector<uint32_t>{0u, 1u, 2u}));
+}
+
+TEST(ModelTest, NarrowIndicesAreConverted) {
+  auto asset = CreateIndexedTriangle(TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT);
+  auto draw_data = Model(asset).CreateDrawData("Triangle");
+  ASSERT_TRUE(draw_data);
+  ASSERT_EQ(draw_data->GetDrawCalls().size(), 1u);
+  ASSERT_EQ(ReadIndices(*draw_data->GetDrawCalls()[0]),
+            (std::vector<uint32_t>{0u, 1u, 2u}));
+}
+
+TEST(ModelTest, OutOfBoundsIndicesInTheBufferAreRejected) {
+  auto asset = CreateIndexedTriangle(TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, 3u);
+  ASSERT_FALSE(Model(asset).CreateDrawData("Triangle"));
+}
+
 #if 0
 static std::optional<DrawData> GetDrawDataForModelName(
     const std::string& model_name) {
@@ -59,10 +143,10 @@ static std::optional<DrawData> GetDrawDataForModelName(
   loader.LoadAsset(
       reinterpret_cast<const char*>(base_dir.u8string().c_str()),
       reinterpret_cast<const char*>(asset_file.u8string().c_str()),
-      MakeCopyable([promise = std::move(asset_promise)](auto asset) mutable {
+      [promise = std::move(asset_promise)](auto asset) mutable {
         ASSERT_TRUE(asset);
         promise.set_value(std::move(asset));
-      }));
+      });
 
   auto asset = future.get();
 
@@ -1,6 +1,7 @@
 #include "pixel.h"
 
 #include "application.h"
+#include "logging.h"
 #include "object.h"
 
 namespace pixel {
@@ -20,11 +21,15 @@ CApplication* ApplicationGetMain() {
     return nullptr;
   }
 
-  return tApplication->GetPeerObject().Get()->Get();
+  return tApplication->GetPeerObject().Get()->GetFFIHandle();
 }
 
 CResult ApplicationSetScene(CApplication* application, CScene* scene) {
-  if (!application || !scene) {
+  auto application_object =
+      Application::PeerAutoObject::FromFFIHandle(application);
+  auto scene_object = AutoObject<CScene>::FromFFIHandle(scene);
+  if (!application_object.IsValid() || !scene_object.IsValid()) {
+    P_ERROR << "Stale or invalid handle passed to ApplicationSetScene.";
     return CResult::kFailure;
   }
   return CResult::kSuccess;
@@ -35,11 +40,17 @@ CResult ApplicationSetScene(CApplication* application, CScene* scene) {
 ////////////////////////////////////////////////////////////////////////////////
 
 CScene* SceneCreate() {
-  return AutoObject<CScene>::Create().TakeOwnership()->Get();
+  auto scene = AutoObject<CScene>::Create();
+  if (!scene.IsValid()) {
+    return nullptr;
+  }
+  return scene.TakeOwnership()->GetFFIHandle();
 }
 
 void SceneCollect(CScene* scene) {
-  ToObject(scene)->Release();
+  if (!ReleaseFFIHandle(scene)) {
+    P_ERROR << "Stale or invalid handle passed to SceneCollect.";
+  }
 }
 
 }  // namespace pixel
@@ -220,32 +220,43 @@ vk::ShaderModule ShaderModule::GetShaderModule() const {
 }
 
 void ShaderModule::OnShaderFileDidUpdate() {
-  const auto now = std::chrono::high_resolution_clock::now();
-  if (now - last_shader_update_ > std::chrono::milliseconds(125)) {
-    last_shader_update_ = now;
-    Thread::PostBackgroundTask([device = device_,                      //
-                                path = original_file_path_,            //
-                                weak = weak_factory_.CreateWeakPtr(),  //
-                                debug_name = debug_name_,              //
-                                dispatcher =
-                                    EventLoop::GetCurrentThreadDispatcher()  //
-    ]() {
-      auto module = LoadShaderModuleSource(device, path, debug_name.c_str());
-      if (!module) {
-        // Nothing to do. Compilation on the updated shader failed.
-        P_ERROR
-            << "Shader was updated but could not be re-compiled successfully.";
-        return;
-      }
-
-      dispatcher->PostTask(
-          MakeCopyable([weak, module = std::move(module)]() mutable {
-            if (weak) {
-              weak.get()->OnShaderModuleDidUpdate(std::move(module));
-            }
-          }));
-    });
-  }
+  // Editors usually touch the file more than once while saving. Only recompile
+  // once the updates have settled down.
+  const auto generation = ++shader_update_generation_;
+  EventLoop::GetCurrentThreadDispatcher()->PostDelayedTask(
+      [weak = weak_factory_.CreateWeakPtr(), generation]() {
+        if (weak && weak.get()->shader_update_generation_ == generation) {
+          weak.get()->RecompileShaderModule();
+        }
+      },
+      std::chrono::milliseconds(125), TaskPriority::kTaskPriorityNormal,
+      "Shader Recompile");
+}
+
+void ShaderModule::RecompileShaderModule() {
+  Thread::PostBackgroundTask([device = device_,                      //
+                              path = original_file_path_,            //
+                              weak = weak_factory_.CreateWeakPtr(),  //
+                              debug_name = debug_name_,              //
+                              dispatcher =
+                                  EventLoop::GetCurrentThreadDispatcher()  //
+  ]() {
+    auto module = LoadShaderModuleSource(device, path, debug_name.c_str());
+    if (!module) {
+      // Nothing to do. Compilation on the updated shader failed.
+      P_ERROR
+          << "Shader was updated but could not be re-compiled successfully.";
+      return;
+    }
+
+    dispatcher->PostTask(
+        [weak, module = std::move(module)]() mutable {
+          if (weak) {
+            weak.get()->OnShaderModuleDidUpdate(std::move(module));
+          }
+        },
+        TaskPriority::kTaskPriorityNormal, "Shader Update");
+  });
 }
 
 void ShaderModule::OnShaderModuleDidUpdate(vk::UniqueShaderModule module) {
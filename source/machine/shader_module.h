@@ -1,6 +1,5 @@
 #pragma once
 
-#include <chrono>
 #include <filesystem>
 #include <map>
 #include <memory>
@@ -33,7 +32,7 @@ class ShaderModule {
   const std::filesystem::path original_file_path_;
   const std::string debug_name_;
   std::optional<size_t> fs_watcher_handler_;
-  std::chrono::high_resolution_clock::time_point last_shader_update_ = {};
+  size_t shader_update_generation_ = 0;
   IdentifiableCallbacks<void(const ShaderModule*)> live_update_callbacks_;
   UnsharedWeakFactory<ShaderModule> weak_factory_;
 
@@ -44,6 +43,8 @@ class ShaderModule {
 
   void OnShaderFileDidUpdate();
 
+  void RecompileShaderModule();
+
   void OnShaderModuleDidUpdate(vk::UniqueShaderModule module);
 
   P_DISALLOW_COPY_AND_ASSIGN(ShaderModule);
@@ -641,8 +641,9 @@ void VulkanConnection::OnSwapchainNeedsRecreation(
   auto new_swapchain =
       std::make_unique<VulkanSwapchain>(*old_swapchain, new_extents);
 
-  EventLoop::ForCurrentThread().GetDispatcher()->PostTask(MakeCopyable(
-      [swapchain = std::move(old_swapchain)]() mutable { swapchain.reset(); }));
+  EventLoop::ForCurrentThread().GetDispatcher()->PostTask(
+      [swapchain = std::move(old_swapchain)]() mutable { swapchain.reset(); },
+      TaskPriority::kTaskPriorityIdle, "Swapchain Release");
 
   if (!new_swapchain->IsValid()) {
     return;
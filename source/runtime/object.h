@@ -1,5 +1,14 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "logging.h"
 #include "macros.h"
 
 namespace pixel {
@@ -7,14 +16,285 @@ namespace pixel {
 // TODO: Remove this.
 struct NullPeer {};
 
+static_assert(sizeof(void*) == sizeof(uint64_t),
+              "Handles are handed out in place of pointers.");
+
+//------------------------------------------------------------------------------
+/// @brief      Identifies an object in a handle table. The generation of a slot
+///             changes each time the object in it is collected, so handles to
+///             collected objects are detected instead of referring to whatever
+///             object took their slot. Zero is never a valid handle.
+///
+struct ObjectHandle {
+  uint32_t index = 0;
+  uint32_t generation = 0;
+
+  constexpr bool operator==(const ObjectHandle& other) const = default;
+
+  bool IsValid() const { return generation != 0u; }
+
+  uint64_t ToOpaque() const {
+    return (static_cast<uint64_t>(generation) << 32u) | index;
+  }
+
+  static ObjectHandle FromOpaque(uint64_t opaque) {
+    return {static_cast<uint32_t>(opaque),
+            static_cast<uint32_t>(opaque >> 32u)};
+  }
+};
+
+//------------------------------------------------------------------------------
+/// @brief      Owns all objects of one type. Objects are constructed in place
+///             in slabs of slots that are never freed, so objects are dense in
+///             memory and collected slots are reused without allocating.
+///
+///             Objects may be retained, released and looked up on any thread.
+///
+template <class ObjectType>
+class HandleTable {
+ public:
+  static constexpr size_t kSlabSize = 256u;
+  static constexpr size_t kMaxSlabs = 4096u;
+
+  static HandleTable& ForType() {
+    // Leaked so that objects may still be collected during static destruction.
+    static HandleTable* sTable = new HandleTable();
+    return *sTable;
+  }
+
+  //----------------------------------------------------------------------------
+  /// @brief      Create an object with a reference count of one.
+  ///
+  /// @return     The object or nullptr if the table is full.
+  ///
+  template <class... Args>
+  ObjectType* Create(Args&&... args) {
+    std::unique_lock lock(mutex_);
+    if (free_head_ == kNoFreeSlot && !AddSlab()) {
+      lock.unlock();
+      P_ERROR << "Handle table is full.";
+      return nullptr;
+    }
+    const auto index = free_head_;
+    auto& slot = GetSlot(index);
+    free_head_ = slot.next_free;
+    live_count_++;
+    lock.unlock();
+
+    const auto generation =
+        GetGeneration(slot.state.load(std::memory_order_relaxed));
+    auto object = new (slot.storage) ObjectType(
+        ObjectHandle{index, generation}, std::forward<Args>(args)...);
+    slot.state.store(MakeState(generation, 1u), std::memory_order_release);
+    return object;
+  }
+
+  //----------------------------------------------------------------------------
+  /// @brief      The object for the handle without retaining it. The caller
+  ///             must otherwise ensure the object stays alive.
+  ///
+  /// @return     The object or nullptr if the handle is stale or invalid.
+  ///
+  ObjectType* Lookup(ObjectHandle handle) const {
+    auto slot = FindSlot(handle);
+    if (!slot) {
+      return nullptr;
+    }
+    const auto state = slot->state.load(std::memory_order_acquire);
+    if (GetGeneration(state) != handle.generation || GetRefCount(state) == 0u) {
+      return nullptr;
+    }
+    return std::launder(reinterpret_cast<ObjectType*>(slot->storage));
+  }
+
+  //----------------------------------------------------------------------------
+  /// @brief      Retain the object for the handle if it is still alive. This is
+  ///             safe even if the last reference is being released on another
+  ///             thread.
+  ///
+  /// @return     The retained object or nullptr if the handle is stale or
+  ///             invalid.
+  ///
+  ObjectType* TryRetain(ObjectHandle handle) {
+    auto slot = FindSlot(handle);
+    if (!slot) {
+      return nullptr;
+    }
+    auto state = slot->state.load(std::memory_order_relaxed);
+    do {
+      if (GetGeneration(state) != handle.generation ||
+          GetRefCount(state) == 0u) {
+        return nullptr;
+      }
+    } while (!slot->state.compare_exchange_weak(state, state + 1u,
+                                                std::memory_order_acquire,
+                                                std::memory_order_relaxed));
+    return std::launder(reinterpret_cast<ObjectType*>(slot->storage));
+  }
+
+  //----------------------------------------------------------------------------
+  /// @brief      Retain the object for a handle that is known to be alive.
+  ///
+  /// @return     If the object was retained. Nothing changes if the handle is
+  ///             stale or the object is being collected.
+  ///
+  bool Retain(ObjectHandle handle) {
+    auto slot = FindSlot(handle);
+    if (!slot) {
+      return false;
+    }
+    auto state = slot->state.load(std::memory_order_relaxed);
+    do {
+      if (GetGeneration(state) != handle.generation ||
+          GetRefCount(state) == 0u) {
+        return false;
+      }
+    } while (!slot->state.compare_exchange_weak(state, state + 1u,
+                                                std::memory_order_relaxed));
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  /// @brief      Release a reference to the object for the handle and collect
+  ///             the object if it was the last one. Releasing a stale handle,
+  ///             for instance from a second collection of the same object on
+  ///             another thread, is detected.
+  ///
+  /// @return     If a reference was released. Nothing changes if the handle is
+  ///             stale or the object is already being collected.
+  ///
+  bool Release(ObjectHandle handle) {
+    auto slot = FindSlot(handle);
+    if (!slot) {
+      return false;
+    }
+    auto state = slot->state.load(std::memory_order_relaxed);
+    do {
+      if (GetGeneration(state) != handle.generation ||
+          GetRefCount(state) == 0u) {
+        return false;
+      }
+    } while (!slot->state.compare_exchange_weak(state, state - 1u,
+                                                std::memory_order_acq_rel,
+                                                std::memory_order_relaxed));
+    if (GetRefCount(state) != 1u) {
+      return true;
+    }
+    std::launder(reinterpret_cast<ObjectType*>(slot->storage))->~ObjectType();
+    // Handles to the collected object are stale from here on.
+    slot->state.store(MakeState(GetNextGeneration(handle.generation), 0u),
+                      std::memory_order_release);
+    std::scoped_lock lock(mutex_);
+    slot->next_free = free_head_;
+    free_head_ = handle.index;
+    live_count_--;
+    return true;
+  }
+
+  size_t GetRefCount(ObjectHandle handle) const {
+    auto slot = FindSlot(handle);
+    if (!slot) {
+      return 0u;
+    }
+    const auto state = slot->state.load(std::memory_order_acquire);
+    return GetGeneration(state) == handle.generation ? GetRefCount(state) : 0u;
+  }
+
+  size_t GetLiveCount() const {
+    std::scoped_lock lock(mutex_);
+    return live_count_;
+  }
+
+ private:
+  static constexpr uint32_t kNoFreeSlot = UINT32_MAX;
+
+  struct Slot {
+    alignas(ObjectType) uint8_t storage[sizeof(ObjectType)];
+    // The generation in the upper half and the reference count in the lower
+    // half. Updated together so that a slot cannot be retained once it has
+    // been collected.
+    std::atomic<uint64_t> state = MakeState(1u, 0u);
+    // Only accessed with the table mutex held.
+    uint32_t next_free = kNoFreeSlot;
+  };
+
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Slot[]>> owned_slabs_;
+  std::array<std::atomic<Slot*>, kMaxSlabs> slabs_ = {};
+  std::atomic_size_t slab_count_ = 0;
+  uint32_t free_head_ = kNoFreeSlot;
+  size_t live_count_ = 0;
+
+  HandleTable() = default;
+
+  static constexpr uint64_t MakeState(uint32_t generation, uint32_t ref_count) {
+    return (static_cast<uint64_t>(generation) << 32u) | ref_count;
+  }
+
+  static constexpr uint32_t GetGeneration(uint64_t state) {
+    return static_cast<uint32_t>(state >> 32u);
+  }
+
+  static constexpr uint32_t GetRefCount(uint64_t state) {
+    return static_cast<uint32_t>(state);
+  }
+
+  static constexpr uint32_t GetNextGeneration(uint32_t generation) {
+    // Zero is reserved for invalid handles.
+    return generation == UINT32_MAX ? 1u : generation + 1u;
+  }
+
+  Slot& GetSlot(uint32_t index) const {
+    return slabs_[index / kSlabSize].load(
+        std::memory_order_acquire)[index % kSlabSize];
+  }
+
+  Slot* FindSlot(ObjectHandle handle) const {
+    if (!handle.IsValid() ||
+        handle.index / kSlabSize >=
+            slab_count_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &GetSlot(handle.index);
+  }
+
+  bool AddSlab() {
+    const auto slab_index = owned_slabs_.size();
+    if (slab_index >= kMaxSlabs) {
+      return false;
+    }
+    auto slab = std::make_unique<Slot[]>(kSlabSize);
+    // Hand out the lower indices first.
+    for (size_t i = 0; i < kSlabSize; i++) {
+      slab[i].next_free =
+          i + 1u == kSlabSize
+              ? kNoFreeSlot
+              : static_cast<uint32_t>(slab_index * kSlabSize + i + 1u);
+    }
+    free_head_ = static_cast<uint32_t>(slab_index * kSlabSize);
+    slabs_[slab_index].store(slab.get(), std::memory_order_release);
+    owned_slabs_.emplace_back(std::move(slab));
+    slab_count_.store(owned_slabs_.size(), std::memory_order_release);
+    return true;
+  }
+
+  P_DISALLOW_COPY_AND_ASSIGN(HandleTable);
+};
+
+//------------------------------------------------------------------------------
+/// @brief      An object whose C type is shared with Dart. Dart is handed the
+///             handle of the object disguised as a pointer to the C type (see
+///             `GetFFIHandle`) and must treat it as opaque.
+///
 template <class _CType, class _PeerType = NullPeer>
 class Object {
  public:
   using CType = _CType;
   using PeerType = _PeerType;
+  using Table = HandleTable<Object<CType, PeerType>>;
 
   static Object<CType, PeerType>* New(PeerType peer = {}) {
-    return new Object<CType, PeerType>(std::move(peer));
+    return Table::ForType().Create(std::move(peer));
   }
 
   CType* Get() { return &ffi_object_; }
@@ -23,25 +303,34 @@ class Object {
 
   operator CType*() { return Get(); }
 
-  void Retain() { ref_count_++; }
+  ObjectHandle GetHandle() const { return handle_; }
 
-  void Release() {
-    P_ASSERT(ref_count_ > 0u);
-    ref_count_--;
-    if (ref_count_ == 0) {
-      delete this;
-    }
+  //----------------------------------------------------------------------------
+  /// @brief      The value handed to Dart in place of a pointer to the C type.
+  ///             Use `ToObject` to get back to the object.
+  ///
+  CType* GetFFIHandle() const {
+    return reinterpret_cast<CType*>(
+        static_cast<uintptr_t>(handle_.ToOpaque()));
   }
 
-  size_t GetRefCount() const { return ref_count_; }
+  bool Retain() { return Table::ForType().Retain(handle_); }
+
+  bool Release() { return Table::ForType().Release(handle_); }
+
+  size_t GetRefCount() const { return Table::ForType().GetRefCount(handle_); }
 
  private:
+  friend Table;
+
   CType ffi_object_ = {};
   const PeerType peer_;
-  size_t ref_count_ = 1;
+  const ObjectHandle handle_;
 
-  Object(PeerType peer) : peer_(std::move(peer)) {
-    ffi_object_.ffi_peer = this;
+  Object(ObjectHandle handle, PeerType peer)
+      : peer_(std::move(peer)), handle_(handle) {
+    ffi_object_.ffi_peer =
+        reinterpret_cast<void*>(static_cast<uintptr_t>(handle.ToOpaque()));
   }
 
   // Must use reference counting.
@@ -50,9 +339,29 @@ class Object {
   P_DISALLOW_COPY_AND_ASSIGN(Object);
 };
 
-template <class CType>
-Object<CType>* ToObject(CType* object) {
-  return reinterpret_cast<Object<CType>*>(object->ffi_peer);
+//------------------------------------------------------------------------------
+/// @brief      The object for a handle received from Dart. The object is not
+///             retained.
+///
+/// @return     The object or nullptr if the handle is stale or invalid.
+///
+template <class CType, class PeerType = NullPeer>
+Object<CType, PeerType>* ToObject(CType* ffi_handle) {
+  return Object<CType, PeerType>::Table::ForType().Lookup(
+      ObjectHandle::FromOpaque(reinterpret_cast<uintptr_t>(ffi_handle)));
+}
+
+//------------------------------------------------------------------------------
+/// @brief      Release a reference to the object for a handle received from
+///             Dart.
+///
+/// @return     If a reference was released. False if the handle is stale or
+///             invalid, for instance because the object was already collected.
+///
+template <class CType, class PeerType = NullPeer>
+bool ReleaseFFIHandle(CType* ffi_handle) {
+  return Object<CType, PeerType>::Table::ForType().Release(
+      ObjectHandle::FromOpaque(reinterpret_cast<uintptr_t>(ffi_handle)));
 }
 
 template <class _CType, class _PeerType = NullPeer>
@@ -68,6 +377,19 @@ class AutoObject {
     return object;
   }
 
+  //----------------------------------------------------------------------------
+  /// @brief      Retain the object for a handle received from Dart. The result
+  ///             is invalid if the handle is stale or invalid.
+  ///
+  static AutoObject FromFFIHandle(CType* ffi_handle) {
+    AutoObject<CType, PeerType> object;
+    object.Reset(
+        ObjectType::Table::ForType().TryRetain(ObjectHandle::FromOpaque(
+            reinterpret_cast<uintptr_t>(ffi_handle))),
+        true);
+    return object;
+  }
+
   AutoObject() = default;
 
   AutoObject(const AutoObject& other) { Reset(other.object_); }
@@ -1,4 +1,10 @@
 #include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include "object.h"
 
 namespace pixel {
@@ -122,5 +128,158 @@ TEST(ObjectTest, AutoObjectsWork) {
   ASSERT_TRUE(deleted);
 }
 
+
+struct HandleTestStruct {
+  void* ffi_peer;
+  size_t baton = 42;
+};
+
+TEST(ObjectTest, FFIHandlesRoundTrip) {
+  auto object = AutoObject<HandleTestStruct>::Create();
+  ASSERT_TRUE(object.IsValid());
+  auto ffi_handle = object->GetFFIHandle();
+  ASSERT_NE(ffi_handle, nullptr);
+  ASSERT_EQ(ToObject(ffi_handle), object.Get());
+  ASSERT_EQ(object->Get()->ffi_peer, static_cast<void*>(ffi_handle));
+  auto retained = AutoObject<HandleTestStruct>::FromFFIHandle(ffi_handle);
+  ASSERT_TRUE(retained.IsValid());
+  ASSERT_EQ(retained.Get(), object.Get());
+  ASSERT_EQ(object->GetRefCount(), 2u);
+  ASSERT_EQ(retained->Get()->baton, 42u);
+}
+
+TEST(ObjectTest, StaleHandlesAreDetected) {
+  auto object = AutoObject<HandleTestStruct>::Create();
+  const auto handle = object->GetHandle();
+  auto ffi_handle = object->GetFFIHandle();
+  object.Reset();
+  ASSERT_EQ(ToObject(ffi_handle), nullptr);
+  ASSERT_FALSE(
+      AutoObject<HandleTestStruct>::FromFFIHandle(ffi_handle).IsValid());
+
+  // The slot is reused with a new generation.
+  auto other = AutoObject<HandleTestStruct>::Create();
+  ASSERT_EQ(other->GetHandle().index, handle.index);
+  ASSERT_NE(other->GetHandle().generation, handle.generation);
+  ASSERT_EQ(ToObject(ffi_handle), nullptr);
+  ASSERT_EQ(ToObject(other->GetFFIHandle()), other.Get());
+}
+
+TEST(ObjectTest, InvalidHandlesAreDetected) {
+  ASSERT_EQ(ToObject<HandleTestStruct>(nullptr), nullptr);
+  ASSERT_FALSE(AutoObject<HandleTestStruct>::FromFFIHandle(nullptr).IsValid());
+  // An index past the end of the table.
+  auto bogus = reinterpret_cast<HandleTestStruct*>(
+      static_cast<uintptr_t>(ObjectHandle{UINT32_MAX - 1u, 1u}.ToOpaque()));
+  ASSERT_EQ(ToObject(bogus), nullptr);
+}
+
+TEST(ObjectTest, ObjectsAreDenseAndSlotsAreReused) {
+  auto& table = Object<HandleTestStruct>::Table::ForType();
+  const auto live_count = table.GetLiveCount();
+  std::vector<AutoObject<HandleTestStruct>> objects;
+  for (size_t i = 0; i < 1000u; i++) {
+    objects.emplace_back(AutoObject<HandleTestStruct>::Create());
+    ASSERT_TRUE(objects.back().IsValid());
+  }
+  ASSERT_EQ(table.GetLiveCount(), live_count + 1000u);
+  // Objects in the same slab are adjacent.
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(objects[1].Get()) -
+                reinterpret_cast<uintptr_t>(objects[0].Get()),
+            reinterpret_cast<uintptr_t>(objects[2].Get()) -
+                reinterpret_cast<uintptr_t>(objects[1].Get()));
+  std::vector<uint32_t> indices;
+  for (const auto& object : objects) {
+    indices.push_back(object->GetHandle().index);
+  }
+  objects.clear();
+  ASSERT_EQ(table.GetLiveCount(), live_count);
+  for (size_t i = 0; i < 1000u; i++) {
+    objects.emplace_back(AutoObject<HandleTestStruct>::Create());
+  }
+  std::vector<uint32_t> reused_indices;
+  for (const auto& object : objects) {
+    reused_indices.push_back(object->GetHandle().index);
+  }
+  std::sort(indices.begin(), indices.end());
+  std::sort(reused_indices.begin(), reused_indices.end());
+  ASSERT_EQ(indices, reused_indices);
+}
+
+TEST(ObjectTest, CanRetainAndReleaseOnManyThreads) {
+  static std::atomic_size_t sDestroyed = 0;
+  struct CountedStruct {
+    void* ffi_peer;
+    ~CountedStruct() { sDestroyed++; }
+  };
+  sDestroyed = 0;
+  constexpr size_t kObjectCount = 64u;
+  std::vector<CountedStruct*> ffi_handles;
+  for (size_t i = 0; i < kObjectCount; i++) {
+    ffi_handles.push_back(
+        AutoObject<CountedStruct>::Create().TakeOwnership()->GetFFIHandle());
+  }
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < 4u; i++) {
+    threads.emplace_back([&]() {
+      for (size_t j = 0; j < 1000u; j++) {
+        for (auto ffi_handle : ffi_handles) {
+          auto object = AutoObject<CountedStruct>::FromFFIHandle(ffi_handle);
+          ASSERT_TRUE(object.IsValid());
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(sDestroyed, 0u);
+  for (auto ffi_handle : ffi_handles) {
+    ASSERT_EQ(ToObject(ffi_handle)->GetRefCount(), 1u);
+    ToObject(ffi_handle)->Release();
+  }
+  ASSERT_EQ(sDestroyed, kObjectCount);
+}
+
+TEST(ObjectTest, ConcurrentCollectionsReleaseOnce) {
+  static std::atomic_size_t sDestroyed = 0;
+  struct CountedStruct {
+    void* ffi_peer;
+    ~CountedStruct() { sDestroyed++; }
+  };
+  sDestroyed = 0;
+  for (size_t i = 0; i < 1000u; i++) {
+    auto ffi_handle =
+        AutoObject<CountedStruct>::Create().TakeOwnership()->GetFFIHandle();
+    std::atomic_size_t released = 0;
+    std::atomic_bool start = false;
+    std::vector<std::thread> threads;
+    for (size_t j = 0; j < 2u; j++) {
+      threads.emplace_back([&]() {
+        while (!start) {
+        }
+        if (ReleaseFFIHandle(ffi_handle)) {
+          released++;
+        }
+      });
+    }
+    start = true;
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    ASSERT_EQ(released, 1u);
+    ASSERT_EQ(sDestroyed, i + 1u);
+  }
+
+  // A collection through a stale handle leaves the object that took its slot
+  // alone.
+  auto object = AutoObject<CountedStruct>::Create();
+  auto stale_handle = object->GetFFIHandle();
+  object.Reset();
+  auto other = AutoObject<CountedStruct>::Create();
+  ASSERT_FALSE(ReleaseFFIHandle(stale_handle));
+  ASSERT_EQ(other->GetRefCount(), 1u);
+}
+
 }  // namespace testing
 }  // namespace pixel